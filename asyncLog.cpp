@@ -0,0 +1,127 @@
+#include "asyncLog.h"
+
+#include <algorithm>
+#include <cstdarg>
+
+asyncLog::asyncLog( FILE* output ) :
+    my_output( output ), my_lines( new line[CAPACITY] ), my_writePosition( 0 ), my_readPosition( 0 ),
+    my_dropped( 0 ), my_isWriterIdle( false ), my_isRunning( true ),
+    my_functor_thread_write( this, &asyncLog::thread_write )
+{
+    for( size_t i = 0; i < CAPACITY; i++ )
+        my_lines[i].sequence.store( i, std::memory_order_relaxed );
+    my_thread_write.create( &my_functor_thread_write );
+}
+
+asyncLog::~asyncLog()
+{
+    my_mutex.lock();
+    my_isRunning = false;
+    my_condition.notify_all();
+    my_mutex.unlock();
+    my_thread_write.join();
+
+    // Messages added while the thread was stopping
+    while( writeNext() )
+        ;
+    fflush( my_output );
+    delete[] my_lines;
+}
+
+void asyncLog::print( const char* format, ... )
+{
+    // Bounded multi-producer queue: a slot is claimed by advancing the write position
+    size_t position = my_writePosition.load( std::memory_order_relaxed );
+    line* slot;
+    for( ;; )
+    {
+        slot = &my_lines[position & ( CAPACITY - 1 )];
+        size_t sequence = slot->sequence.load( std::memory_order_acquire );
+        if( sequence == position )
+        {
+            if( my_writePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ))
+                break;
+        }
+        else if( sequence < position )
+        {
+            // The writer has not caught up yet - drop rather than wait
+            my_dropped.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+        else
+            position = my_writePosition.load( std::memory_order_relaxed );
+    }
+
+    va_list arguments;
+    va_start( arguments, format );
+    int length = vsnprintf( slot->text, LINE_SIZE, format, arguments );
+    va_end( arguments );
+    slot->length = std::min( std::max( length, 0 ), (int) LINE_SIZE - 1 );
+    slot->sequence.store( position + 1 );
+
+    // Only the first message after an idle period pays for waking the writer
+    if( my_isWriterIdle.exchange( false ))
+    {
+        my_mutex.lock();
+        my_condition.notify_one();
+        my_mutex.unlock();
+    }
+}
+
+unsigned long long asyncLog::getDroppedCount() const
+{
+    return my_dropped.load();
+}
+
+asyncLog* asyncLog::getDefault()
+{
+    // Never destroyed - Aria threads may still log while static objects are destroyed at exit
+    static asyncLog* defaultLog = new asyncLog( stdout );
+    return defaultLog;
+}
+
+bool asyncLog::writeNext()
+{
+    line& slot = my_lines[my_readPosition & ( CAPACITY - 1 )];
+    if( slot.sequence.load( std::memory_order_acquire ) != my_readPosition + 1 )
+        return false;
+
+    fwrite( slot.text, 1, slot.length, my_output );
+    slot.sequence.store( my_readPosition + CAPACITY, std::memory_order_release );
+    my_readPosition++;
+    return true;
+}
+
+bool asyncLog::hasNext() const
+{
+    return my_lines[my_readPosition & ( CAPACITY - 1 )].sequence.load() == my_readPosition + 1;
+}
+
+void asyncLog::thread_write()
+{
+    for( ;; )
+    {
+        bool hasWritten = false;
+        while( writeNext() )
+            hasWritten = true;
+        if( hasWritten )
+        {
+            fflush( my_output );
+            continue;
+        }
+
+        my_mutex.lock();
+        if( !my_isRunning )
+        {
+            my_mutex.unlock();
+            return;
+        }
+        // Announce the sleep before the last check, so a message added meanwhile either
+        // is seen here or sees the flag and wakes the thread
+        my_isWriterIdle.store( true );
+        if( !hasNext() )
+            my_condition.wait( my_mutex );
+        my_isWriterIdle.store( false );
+        my_mutex.unlock();
+    }
+}
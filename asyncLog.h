@@ -0,0 +1,102 @@
+#ifndef ASYNCLOG_H_INCLUDED
+#define ASYNCLOG_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+
+#include "Aria.h"
+
+/** \brief Dziennik zapisywany przez osobny wątek
+ *
+ * Metoda \c print() jedynie formatuje komunikat do wolnego miejsca w buforze
+ * cyklicznym (bez blokad i bez wywołań systemowych), więc może być wywoływana
+ * z wątku odbierającego dane z serwera bez spowalniania odbioru. Komunikaty
+ * zapisuje do pliku wątek dziennika - wszystkie oczekujące naraz, z jednym
+ * \c fflush() na serię. Wątek śpi, gdy bufor jest pusty, i jest budzony tylko
+ * przez pierwszy komunikat po okresie ciszy.
+ *
+ * Gdy bufor jest pełny, komunikat jest odrzucany (patrz \c getDroppedCount()),
+ * a komunikat dłuższy niż \c LINE_SIZE - 1 znaków jest obcinany.
+ */
+class asyncLog
+{
+public:
+    enum
+    {
+        LINE_SIZE = 512,/**< największa długość komunikatu (z kończącym zerem) */
+        CAPACITY = 1024/**< liczba komunikatów w buforze (potęga dwójki) */
+    };
+
+    /** \brief Konstruktor klasy \c asyncLog - uruchamia wątek dziennika
+     *
+     * \param output FILE* - strumień wyjściowy
+     *
+     */
+    asyncLog( FILE* output );
+    /** \brief Destruktor klasy \c asyncLog - zapisuje oczekujące komunikaty i zatrzymuje wątek
+     *
+     *
+     */
+    ~asyncLog();
+
+    /** \brief Dodaje komunikat sformatowany jak w \c printf()
+     *
+     * \param format const char* - format komunikatu
+     * \return void
+     *
+     */
+    void print( const char* format, ... ) __attribute__(( format( printf, 2, 3 )));
+    /** \brief Zwraca liczbę komunikatów odrzuconych z powodu pełnego bufora
+     *
+     * \return unsigned long long - liczba komunikatów
+     *
+     */
+    unsigned long long getDroppedCount() const;
+
+    /** \brief Zwraca wspólny dziennik na standardowe wyjście (tworzony przy pierwszym użyciu)
+     *
+     * Dziennik nie jest niszczony przy zakończeniu programu, więc komunikaty dodane
+     * tuż przed zakończeniem mogą nie zostać wypisane.
+     *
+     * \return asyncLog* - dziennik wypisujący na \c stdout
+     *
+     */
+    static asyncLog* getDefault();
+
+private:
+    /** \brief Miejsce na komunikat w buforze */
+    struct line
+    {
+        std::atomic<size_t> sequence;/**< stan miejsca: równy pozycji zapisu - wolne, o 1 większy - zapisany komunikat */
+        int length;/**< długość komunikatu */
+        char text[LINE_SIZE];/**< treść komunikatu */
+    };
+
+    FILE* my_output;/**< strumień wyjściowy */
+    line* my_lines;/**< bufor cykliczny komunikatów */
+    std::atomic<size_t> my_writePosition;/**< pozycja następnego komunikatu (wiele wątków) */
+    size_t my_readPosition;/**< pozycja następnego zapisywanego komunikatu (wątek dziennika) */
+    std::atomic<unsigned long long> my_dropped;/**< liczba odrzuconych komunikatów */
+
+    ArMutex my_mutex;/**< blokada usypiania i budzenia wątku dziennika */
+    std::condition_variable_any my_condition;/**< budzenie wątku dziennika */
+    std::atomic<bool> my_isWriterIdle;/**< wątek dziennika śpi (kolejny komunikat musi go obudzić) */
+    bool my_isRunning;/**< stan wątku dziennika */
+    ArThread my_thread_write;/**< handler wątku dziennika */
+
+    bool writeNext();/**< \brief Zapisuje najstarszy oczekujący komunikat (wątek dziennika); \b False - bufor jest pusty */
+    bool hasNext() const;/**< \brief Sprawdza czy w buforze czeka komunikat (wątek dziennika) */
+
+    // CALLBACKS FUNCTIONS
+    void thread_write(void);/**< wątek zapisu komunikatów */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<asyncLog> my_functor_thread_write;/**< functor do metody \c thread_write() */
+
+    asyncLog( const asyncLog& );
+    asyncLog& operator=( const asyncLog& );
+};
+
+#endif // ASYNCLOG_H_INCLUDED
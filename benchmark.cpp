@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "robotManager.h"
+#include "clientUtil.h"
+#include "laserKernels.h"
+#include "standInServer.h"
+
+// End-to-end benchmark of robotManager against a stand-in server running in a
+// child process (so that the measured CPU time belongs to the client only):
+//   client_benchmark [-port 7373] [-duration 5] [-output benchmark.json]
+// Results are written as JSON, to be compared between releases.
+
+/** \brief Liczniki danych odbieranych przez klienta podczas testu */
+class benchmarkProbe
+{
+public:
+    benchmarkProbe() :
+        scans( 0 ), moveDistAcks( 0 ), cameraAcks( 0 ), configureAcks( 0 ),
+        my_functor_handle_scan(this, &benchmarkProbe::handle_scan),
+        my_functor_handle_moveDistAck(this, &benchmarkProbe::handle_moveDistAck),
+        my_functor_handle_cameraAck(this, &benchmarkProbe::handle_cameraAck),
+        my_functor_handle_configureAck(this, &benchmarkProbe::handle_configureAck)
+    {
+
+    }
+
+    void install( robotManager* rManager )
+    {
+        rManager->client_addHandler( "getSensorCurrent", &my_functor_handle_scan );
+        rManager->client_addHandler( "moveDist", &my_functor_handle_moveDistAck );
+        rManager->client_addHandler( "setCameraRelCamera_1", &my_functor_handle_cameraAck );
+        rManager->client_addHandler( "standInConfigure", &my_functor_handle_configureAck );
+    }
+
+    std::atomic<unsigned long long> scans, moveDistAcks, cameraAcks, configureAcks;/**< liczniki pakietów */
+
+private:
+    void handle_scan( ArNetPacket* packet ) { scans++; }
+    void handle_moveDistAck( ArNetPacket* packet ) { moveDistAcks++; }
+    void handle_cameraAck( ArNetPacket* packet ) { cameraAcks++; }
+    void handle_configureAck( ArNetPacket* packet ) { configureAcks++; }
+
+    ArFunctor1C<benchmarkProbe, ArNetPacket*> my_functor_handle_scan;
+    ArFunctor1C<benchmarkProbe, ArNetPacket*> my_functor_handle_moveDistAck;
+    ArFunctor1C<benchmarkProbe, ArNetPacket*> my_functor_handle_cameraAck;
+    ArFunctor1C<benchmarkProbe, ArNetPacket*> my_functor_handle_configureAck;
+};
+
+static long long processCpuTime_us()
+{
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return ( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) * 1000000LL
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static bool waitForCounter( std::atomic<unsigned long long>& counter, unsigned long long previous, long long timeout_us )
+{
+    long long deadline_us = clientUtil::monotonicTime_us() + timeout_us;
+    while( counter.load() == previous )
+    {
+        if( clientUtil::monotonicTime_us() > deadline_us )
+            return false;
+        sched_yield();
+    }
+    return true;
+}
+
+static void printStats( FILE* output, const char* name, std::vector<long long>& samples )
+{
+    std::sort( samples.begin(), samples.end() );
+    long long sum = 0;
+    for( size_t i = 0; i < samples.size(); i++ )
+        sum += samples[i];
+
+    #define PERCENTILE(p) ( samples.empty() ? 0 : samples[ std::min( samples.size() - 1, (size_t)( samples.size() * (p) ) ) ] )
+    fprintf( output, "\"%s\": { \"count\": %zu, \"mean\": %.1f, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"max\": %lld }",
+             name, samples.size(), samples.empty() ? 0.0 : (double) sum / samples.size(),
+             PERCENTILE( 0.5 ), PERCENTILE( 0.9 ), PERCENTILE( 0.99 ), samples.empty() ? 0 : samples.back() );
+    #undef PERCENTILE
+}
+
+static bool configureServer( robotManager* rManager, benchmarkProbe* probe,
+                             int numbersPeriod_ms, int laserPeriod_ms, int videoPeriod_ms,
+                             int jpegLength, int scanSize )
+{
+    ArNetPacket packet;
+    packet.byte4ToBuf( numbersPeriod_ms );
+    packet.byte4ToBuf( laserPeriod_ms );
+    packet.byte4ToBuf( videoPeriod_ms );
+    packet.byte4ToBuf( 640 );
+    packet.byte4ToBuf( 480 );
+    packet.byte4ToBuf( jpegLength );
+    packet.byte4ToBuf( scanSize );
+    packet.finalizePacket();
+
+    unsigned long long previous = probe->configureAcks.load();
+    rManager->client_requestOnce( "standInConfigure", &packet );
+    bool configured = waitForCounter( probe->configureAcks, previous, 2000000 );
+    // Let packets sent with the previous configuration arrive
+    ArUtil::sleep( 200 );
+    return configured;
+}
+
+int main(int argc, char **argv)
+{
+    int port = 7373;
+    int duration_s = 5;
+    const char* outputName = NULL;
+    for( int i = 1; i + 1 < argc; i += 2 )
+    {
+        if( strcmp( argv[i], "-port" ) == 0 )
+            port = atoi( argv[i + 1] );
+        else if( strcmp( argv[i], "-duration" ) == 0 )
+            duration_s = atoi( argv[i + 1] );
+        else if( strcmp( argv[i], "-output" ) == 0 )
+            outputName = argv[i + 1];
+    }
+
+    // The server is started before any thread of the client exists
+    int ready[2];
+    if( pipe( ready ) != 0 )
+        return 1;
+    pid_t server = fork();
+    if( server == 0 )
+    {
+        close( ready[0] );
+        Aria::init();
+        standInServer standIn;
+        for( int i = 0; i < standInServer::STREAM_COUNT; i++ )
+            standIn.setStreamPeriod( (standInServer::stream) i, -1 );
+        if( !standIn.open( port ) || write( ready[1], "1", 1 ) != 1 )
+            _exit( 1 );
+        while( true )
+            ArUtil::sleep( 1000 );
+    }
+    close( ready[1] );
+    char status;
+    if( server < 0 || read( ready[0], &status, 1 ) != 1 )
+    {
+        fprintf( stderr, "Could not start the stand-in server\n" );
+        return 1;
+    }
+
+    char portArgument[16];
+    snprintf( portArgument, sizeof( portArgument ), "%d", port );
+    char* clientArgv[] = { argv[0], (char*) "-port", portArgument, NULL };
+    int clientArgc = 3;
+    robotManager* rManager = new robotManager( &clientArgc, clientArgv, "localhost" );
+    rManager->disableNativeAriaLogging();
+
+    benchmarkProbe probe;
+    probe.install( rManager );
+
+    bool ready_ok = configureServer( rManager, &probe, -1, -1, -1, 20000, 181 );
+    for( int i = 0; ready_ok && i < 100 && rManager->requests->get_sensorsVector().empty(); i++ )
+        ArUtil::sleep( 20 );
+    if( !ready_ok || !rManager->requests->startReadingLaser() )
+    {
+        fprintf( stderr, "Could not connect to the stand-in server\n" );
+        kill( server, SIGTERM );
+        waitpid( server, NULL, 0 );
+        return 1;
+    }
+
+    FILE* output = outputName != NULL ? fopen( outputName, "w" ) : stdout;
+    if( output == NULL )
+        output = stdout;
+    char date[32];
+    time_t now = time( NULL );
+    strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", localtime( &now ));
+    fprintf( output, "{\n  \"benchmark\": \"robotManager\",\n  \"date\": \"%s\",\n  \"duration_s\": %d,\n", date, duration_s );
+
+    // Idle client - all streams disabled
+    long long start_us = clientUtil::monotonicTime_us();
+    long long startCpu_us = processCpuTime_us();
+    ArUtil::sleep( duration_s * 1000 );
+    fprintf( output, "  \"idle\": { \"cpu_percent\": %.2f },\n",
+             100.0 * ( processCpuTime_us() - startCpu_us ) / ( clientUtil::monotonicTime_us() - start_us ));
+
+    // Camera stream - frames pushed at 100 fps, consumer polling every 1 ms
+    const int jpegLengths[] = { 4000, 16000, 30000 };
+    const int videoPeriod_ms = 10;
+    fprintf( output, "  \"frames\": [\n" );
+    for( size_t size = 0; size < sizeof( jpegLengths ) / sizeof( jpegLengths[0] ); size++ )
+    {
+        frameSubscriber* subscriber = rManager->camera->subscribeFrames( 16, frameSubscriber::DROP_OLDEST );
+        configureServer( rManager, &probe, -1, -1, videoPeriod_ms, jpegLengths[size], 181 );
+        frameHandle frame;
+        while( subscriber->tryPop( frame ) )
+            ;
+        unsigned long long droppedAtStart = subscriber->getDroppedCount();
+
+        std::vector<long long> receiveLatencies, sendLatencies;
+        start_us = clientUtil::monotonicTime_us();
+        startCpu_us = processCpuTime_us();
+        while( clientUtil::monotonicTime_us() - start_us < duration_s * 1000000LL )
+        {
+            if( !subscriber->tryPop( frame ))
+            {
+                ArUtil::sleep( 1 );
+                continue;
+            }
+            long long consumed_us = clientUtil::monotonicTime_us();
+            receiveLatencies.push_back( consumed_us - frame->getTimestamp_us() );
+
+            // Send time from the comment segment written by the stand-in server
+            unsigned long long sequence;
+            long long sent_us;
+            const unsigned char* data = frame->getData();
+            if( frame->getLength() > 6 && data[2] == 0xFF && data[3] == 0xFE &&
+                sscanf( (const char*) data + 6, "standin seq=%llu t=%lld", &sequence, &sent_us ) == 2 )
+                sendLatencies.push_back( consumed_us - sent_us );
+        }
+        long long elapsed_us = clientUtil::monotonicTime_us() - start_us;
+        long long cpu_us = processCpuTime_us() - startCpu_us;
+
+        fprintf( output, "    { \"jpeg_bytes\": %d, \"target_fps\": %d, \"fps\": %.2f, \"dropped\": %llu, \"cpu_percent\": %.2f,\n      ",
+                 jpegLengths[size], 1000 / videoPeriod_ms, receiveLatencies.size() * 1000000.0 / elapsed_us,
+                 subscriber->getDroppedCount() - droppedAtStart, 100.0 * cpu_us / elapsed_us );
+        printStats( output, "receive_to_consumer_us", receiveLatencies );
+        fprintf( output, ",\n      " );
+        printStats( output, "send_to_consumer_us", sendLatencies );
+        fprintf( output, " }%s\n", size + 1 < sizeof( jpegLengths ) / sizeof( jpegLengths[0] ) ? "," : "" );
+        rManager->camera->unsubscribeFrames( subscriber );
+    }
+    fprintf( output, "  ],\n" );
+
+    // Laser - scans pushed every 2 ms
+    const int scanSizes[] = { 181, 361, 721 };
+    fprintf( output, "  \"laser\": [\n" );
+    for( size_t size = 0; size < sizeof( scanSizes ) / sizeof( scanSizes[0] ); size++ )
+    {
+        configureServer( rManager, &probe, -1, 2, -1, 20000, scanSizes[size] );
+        unsigned long long startScans = probe.scans.load();
+        start_us = clientUtil::monotonicTime_us();
+        startCpu_us = processCpuTime_us();
+        ArUtil::sleep( duration_s * 1000 );
+        long long elapsed_us = clientUtil::monotonicTime_us() - start_us;
+        long long cpu_us = processCpuTime_us() - startCpu_us;
+        unsigned long long scans = probe.scans.load() - startScans;
+
+        fprintf( output, "    { \"points\": %d, \"scans_per_s\": %.2f, \"points_per_s\": %.0f, \"cpu_us_per_scan\": %.2f, \"cpu_percent\": %.2f }%s\n",
+                 scanSizes[size], scans * 1000000.0 / elapsed_us, (double) scans * scanSizes[size] * 1000000.0 / elapsed_us,
+                 scans > 0 ? (double) cpu_us / scans : 0.0, 100.0 * cpu_us / elapsed_us,
+                 size + 1 < sizeof( scanSizes ) / sizeof( scanSizes[0] ) ? "," : "" );
+    }
+    fprintf( output, "  ],\n" );
+
+    // Laser kernels - full processing of one scan on a single core, for every supported implementation
+    const char* implementationNames[] = { "scalar", "sse2", "avx2" };
+    laserKernels::implementation selected = laserKernels::getImplementation();
+    const int kernelPoints = 721;
+    std::vector<int> scanX( kernelPoints ), scanY( kernelPoints );
+    for( int i = 0; i < kernelPoints; i++ )
+    {
+        double angle = ( i - kernelPoints / 2 ) * M_PI / ( kernelPoints - 1 );
+        scanX[i] = (int)( ( 2000 + 10 * ( i % 37 )) * cos( angle ));
+        scanY[i] = (int)( ( 2000 + 10 * ( i % 37 )) * sin( angle ));
+    }
+    std::vector<float> range( kernelPoints ), angle( kernelPoints ), worldX( kernelPoints ), worldY( kernelPoints );
+    float nearest[36];
+    fprintf( output, "  \"laser_kernels\": [\n" );
+    bool first = true;
+    for( int type = laserKernels::IMPLEMENTATION_SCALAR; type <= laserKernels::IMPLEMENTATION_AVX2; type++ )
+    {
+        if( !laserKernels::setImplementation( (laserKernels::implementation) type ))
+            continue;
+        int scans = 0;
+        start_us = clientUtil::monotonicTime_us();
+        while( clientUtil::monotonicTime_us() - start_us < 1000000 )
+        {
+            for( int i = 0; i < 100; i++, scans++ )
+            {
+                laserKernels::cartesianToPolar( &scanX[0], &scanY[0], kernelPoints, 100.0, -50.0, 30.0, &range[0], &angle[0] );
+                laserKernels::clipRange( &range[0], kernelPoints, 100.0f, 5000.0f );
+                laserKernels::nearestPerSector( &range[0], &angle[0], kernelPoints, 36, -M_PI, M_PI, nearest );
+                laserKernels::polarToCartesian( &range[0], &angle[0], kernelPoints, &worldX[0], &worldY[0] );
+                laserKernels::transform( &worldX[0], &worldY[0], kernelPoints, 100.0, -50.0, 30.0, &worldX[0], &worldY[0] );
+            }
+        }
+        long long elapsed_us = clientUtil::monotonicTime_us() - start_us;
+        fprintf( output, "%s    { \"implementation\": \"%s\", \"points\": %d, \"ns_per_point\": %.2f, \"scans_per_s\": %.0f }",
+                 first ? "" : ",\n", implementationNames[type], kernelPoints,
+                 elapsed_us * 1000.0 / ( (double) scans * kernelPoints ), scans * 1000000.0 / elapsed_us );
+        first = false;
+    }
+    laserKernels::setImplementation( selected );
+    fprintf( output, "\n  ],\n" );
+
+    // Command round trip - time until the acknowledgement of the stand-in server arrives
+    configureServer( rManager, &probe, -1, -1, -1, 20000, 181 );
+    const int commands = 200;
+    std::vector<long long> moveDistTimes, cameraTimes;
+    int moveDistTimeouts = 0, cameraTimeouts = 0;
+    for( int i = 0; i < commands; i++ )
+    {
+        unsigned long long previous = probe.moveDistAcks.load();
+        long long sent_us = clientUtil::monotonicTime_us();
+        rManager->steering->moveDistance( 0 );
+        if( waitForCounter( probe.moveDistAcks, previous, 1000000 ))
+            moveDistTimes.push_back( clientUtil::monotonicTime_us() - sent_us );
+        else
+            moveDistTimeouts++;
+
+        previous = probe.cameraAcks.load();
+        sent_us = clientUtil::monotonicTime_us();
+        rManager->camera->handle_setCameraRelCamera_1( 0, 0, 0 );
+        if( waitForCounter( probe.cameraAcks, previous, 1000000 ))
+            cameraTimes.push_back( clientUtil::monotonicTime_us() - sent_us );
+        else
+            cameraTimeouts++;
+    }
+    fprintf( output, "  \"commands\": [\n    { \"command\": \"moveDist\", \"timeouts\": %d, ", moveDistTimeouts );
+    printStats( output, "round_trip_us", moveDistTimes );
+    fprintf( output, " },\n    { \"command\": \"setCameraRelCamera_1\", \"timeouts\": %d, ", cameraTimeouts );
+    printStats( output, "round_trip_us", cameraTimes );
+    fprintf( output, " }\n  ]\n}\n" );
+    if( output != stdout )
+        fclose( output );
+
+    kill( server, SIGTERM );
+    waitpid( server, NULL, 0 );
+    delete rManager;
+    return 0;
+}
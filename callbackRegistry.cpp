@@ -0,0 +1,235 @@
+#include "callbackRegistry.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Registry whose invokeAll() runs on this thread - add()/remove() from a
+    // callback must not wait for the iteration they are part of
+    thread_local const callbackRegistry* invokingRegistry = NULL;
+}
+
+callbackRegistry::callbackRegistry() :
+    my_deferredCount( 0 ), my_nextHandle( 1 )
+{
+
+}
+
+callbackRegistry::handle callbackRegistry::add( ArFunctor* func )
+{
+    if( isInvoking() )
+        return addDeferred( func );
+
+    my_indexMutex.lock();
+    std::unordered_map<ArFunctor*, handle>::iterator existing = my_handles.find( func );
+    if( existing != my_handles.end() )
+    {
+        handle callback = existing->second;
+        my_indexMutex.unlock();
+        return callback;
+    }
+
+    entry added = { my_nextHandle++, func };
+    my_entries.modify( [&]( std::vector<entry>& entries )
+    {
+        my_positions[added.callback] = entries.size();
+        entries.push_back( added );
+    } );
+    my_handles[func] = added.callback;
+    my_indexMutex.unlock();
+    return added.callback;
+}
+
+bool callbackRegistry::remove( handle callback )
+{
+    if( isInvoking() )
+        return removeDeferred( callback );
+
+    my_indexMutex.lock();
+    std::unordered_map<handle, size_t>::iterator position = my_positions.find( callback );
+    if( position == my_positions.end() )
+    {
+        my_indexMutex.unlock();
+        return false;
+    }
+
+    size_t removed = position->second;
+    my_positions.erase( position );
+    my_entries.modify( [&]( std::vector<entry>& entries )
+    {
+        my_handles.erase( entries[removed].func );
+        // The last entry takes the free position, so nothing else moves
+        if( removed + 1 != entries.size() )
+        {
+            entries[removed] = entries.back();
+            my_positions[entries[removed].callback] = removed;
+        }
+        entries.pop_back();
+    } );
+    my_indexMutex.unlock();
+    return true;
+}
+
+bool callbackRegistry::remove( ArFunctor* func )
+{
+    handle callback = find( func );
+    return callback != 0 && remove( callback );
+}
+
+callbackRegistry::handle callbackRegistry::find( ArFunctor* func )
+{
+    if( isInvoking() )
+        return findInvoked( func );
+
+    my_indexMutex.lock();
+    std::unordered_map<ArFunctor*, handle>::iterator existing = my_handles.find( func );
+    handle callback = existing != my_handles.end() ? existing->second : 0;
+    my_indexMutex.unlock();
+    return callback;
+}
+
+void callbackRegistry::invokeAll()
+{
+    const callbackRegistry* outer = invokingRegistry;
+    invokingRegistry = this;
+    my_entries.forEach( [this]( const entry& item )
+    {
+        // Removed by an earlier callback of this iteration
+        if( my_deferredCount.load() != 0 && isDeferredRemoval( item.callback ))
+            return;
+        item.func->invoke();
+    } );
+    invokingRegistry = outer;
+
+    if( my_deferredCount.load() != 0 && outer != this )
+        applyDeferred();
+}
+
+bool callbackRegistry::isInvoking() const
+{
+    return invokingRegistry == this;
+}
+
+bool callbackRegistry::isDeferredRemoval( handle callback )
+{
+    my_deferredMutex.lock();
+    bool found = std::find( my_deferredRemovals.begin(), my_deferredRemovals.end(), callback ) !=
+                 my_deferredRemovals.end();
+    my_deferredMutex.unlock();
+    return found;
+}
+
+callbackRegistry::handle callbackRegistry::findInvoked( ArFunctor* func )
+{
+    // A concurrent add() or remove() may hold my_indexMutex while waiting for
+    // this very iteration - the list being iterated is searched instead
+    handle callback = 0;
+    my_entries.forEach( [&]( const entry& item )
+    {
+        if( item.func == func )
+            callback = item.callback;
+    } );
+
+    my_deferredMutex.lock();
+    if( callback != 0 &&
+            std::find( my_deferredRemovals.begin(), my_deferredRemovals.end(), callback ) != my_deferredRemovals.end() )
+        callback = 0;
+    for( std::vector<entry>::iterator it = my_deferredAdds.begin(); it != my_deferredAdds.end(); ++it )
+    {
+        if( it->func == func )
+            callback = it->callback;
+    }
+    my_deferredMutex.unlock();
+    return callback;
+}
+
+callbackRegistry::handle callbackRegistry::addDeferred( ArFunctor* func )
+{
+    handle existing = findInvoked( func );
+    if( existing != 0 )
+        return existing;
+
+    entry added = { my_nextHandle++, func };
+    my_deferredMutex.lock();
+    my_deferredAdds.push_back( added );
+    my_deferredMutex.unlock();
+    my_deferredCount++;
+    return added.callback;
+}
+
+bool callbackRegistry::removeDeferred( handle callback )
+{
+    bool found = false;
+    my_deferredMutex.lock();
+    for( std::vector<entry>::iterator it = my_deferredAdds.begin(); it != my_deferredAdds.end(); ++it )
+    {
+        if( it->callback == callback )
+        {
+            my_deferredAdds.erase( it );
+            my_deferredMutex.unlock();
+            return true;
+        }
+    }
+    my_deferredMutex.unlock();
+
+    my_entries.forEach( [&]( const entry& item )
+    {
+        if( item.callback == callback )
+            found = true;
+    } );
+    if( !found || isDeferredRemoval( callback ))
+        return false;
+
+    // Only marked here - the list is replaced once the iteration ends
+    my_deferredMutex.lock();
+    my_deferredRemovals.push_back( callback );
+    my_deferredMutex.unlock();
+    my_deferredCount++;
+    return true;
+}
+
+void callbackRegistry::applyDeferred()
+{
+    my_indexMutex.lock();
+    my_deferredMutex.lock();
+    std::vector<handle> removals( my_deferredRemovals );
+    std::vector<entry> adds( my_deferredAdds );
+    my_deferredAdds.clear();
+    my_deferredMutex.unlock();
+
+    my_entries.modify( [&]( std::vector<entry>& entries )
+    {
+        for( size_t i = 0; i < removals.size(); i++ )
+        {
+            std::unordered_map<handle, size_t>::iterator position = my_positions.find( removals[i] );
+            // Another thread may have removed it meanwhile
+            if( position == my_positions.end() )
+                continue;
+            size_t removed = position->second;
+            my_positions.erase( position );
+            my_handles.erase( entries[removed].func );
+            if( removed + 1 != entries.size() )
+            {
+                entries[removed] = entries.back();
+                my_positions[entries[removed].callback] = removed;
+            }
+            entries.pop_back();
+        }
+        for( size_t i = 0; i < adds.size(); i++ )
+        {
+            // Another thread may have added the same function meanwhile
+            if( my_handles.count( adds[i].func ) != 0 )
+                continue;
+            my_positions[adds[i].callback] = entries.size();
+            my_handles[adds[i].func] = adds[i].callback;
+            entries.push_back( adds[i] );
+        }
+    } );
+
+    // Readers of the previous list checked the marks until modify() returned
+    my_deferredMutex.lock();
+    my_deferredRemovals.clear();
+    my_deferredMutex.unlock();
+    my_deferredCount = 0;
+    my_indexMutex.unlock();
+}
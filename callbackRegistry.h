@@ -0,0 +1,107 @@
+#ifndef CALLBACKREGISTRY_H_INCLUDED
+#define CALLBACKREGISTRY_H_INCLUDED
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "Aria.h"
+
+#include "rcuList.h"
+
+/** \brief Rejestr funkcji typu \c callback wywoływanych bez blokad
+ *
+ * Funkcje przechowywane są w liście \c rcuList, więc \c invokeAll() (np. w każdym
+ * takcie sterowania) nie zakłada żadnej blokady i nie czeka na wątki, które
+ * w tym samym czasie dodają lub usuwają funkcje. Każda dodana funkcja otrzymuje
+ * uchwyt; pozycja funkcji na liście odnajdywana jest po uchwycie w indeksie
+ * pozycji, a usuwany element zastępowany jest ostatnim elementem kopii listy
+ * (kolejność wywołań nie jest więc zachowywana).
+ *
+ * Po powrocie z \c remove() usunięta funkcja nie jest już wywoływana przez
+ * żaden wątek i może zostać zniszczona. Wyjątkiem są \c add() i \c remove()
+ * wywołane z wnętrza funkcji z rejestru (np. jednorazowy manewr usuwający sam
+ * siebie): czekanie na zakończenie przeglądania listy zablokowałoby wtedy wątek
+ * na zawsze, więc usunięta funkcja jest jedynie oznaczana jako usunięta (nie
+ * zostanie już wywołana), a zmiany publikowane są po zakończeniu \c invokeAll().
+ * Funkcja dodana w ten sposób wywoływana jest od następnego \c invokeAll().
+ */
+class callbackRegistry
+{
+public:
+    typedef unsigned long long handle;/**< uchwyt do funkcji w rejestrze (0 - brak funkcji) */
+
+    /** \brief Konstruktor klasy \c callbackRegistry
+     *
+     *
+     */
+    callbackRegistry();
+
+    /** \brief Dodaje funkcję do rejestru
+     *
+     * \param func ArFunctor* - funkcja typu \c callback
+     * \return handle - uchwyt do funkcji (dla funkcji już obecnej w rejestrze - jej dotychczasowy uchwyt)
+     *
+     */
+    handle add( ArFunctor* func );
+    /** \brief Usuwa funkcję o zadanym uchwycie
+     *
+     * \param callback handle - uchwyt zwrócony przez \c add()
+     * \return bool - \b True, jeśli funkcja znajdowała się w rejestrze
+     *
+     */
+    bool remove( handle callback );
+    /** \brief Usuwa zadaną funkcję
+     *
+     * \param func ArFunctor* - funkcja typu \c callback
+     * \return bool - \b True, jeśli funkcja znajdowała się w rejestrze
+     *
+     */
+    bool remove( ArFunctor* func );
+    /** \brief Zwraca uchwyt do zadanej funkcji
+     *
+     * \param func ArFunctor* - funkcja typu \c callback
+     * \return handle - uchwyt lub 0, jeśli funkcji nie ma w rejestrze
+     *
+     */
+    handle find( ArFunctor* func );
+    /** \brief Wywołuje wszystkie funkcje z rejestru (bez blokad)
+     *
+     * \return void
+     *
+     */
+    void invokeAll();
+
+private:
+    /** \brief Element rejestru */
+    struct entry
+    {
+        handle callback;/**< uchwyt funkcji */
+        ArFunctor* func;/**< funkcja */
+
+        bool operator==( const entry& other ) const { return callback == other.callback; }
+    };
+
+    rcuList<entry> my_entries;/**< funkcje przeglądane bez blokad */
+    std::atomic<int> my_deferredCount;/**< liczba zmian odłożonych do końca \c invokeAll() (szybka ścieżka) */
+    std::vector<handle> my_deferredRemovals;/**< funkcje usunięte z wnętrza \c invokeAll() */
+    std::vector<entry> my_deferredAdds;/**< funkcje dodane z wnętrza \c invokeAll() */
+    ArMutex my_deferredMutex;/**< blokada zmian odłożonych (nie \c my_indexMutex - tę trzyma wątek czekający na koniec przeglądania) */
+
+    ArMutex my_indexMutex;/**< blokada indeksów (tylko dla wątków modyfikujących rejestr) */
+    std::unordered_map<handle, size_t> my_positions;/**< pozycja funkcji na liście dla uchwytu */
+    std::unordered_map<ArFunctor*, handle> my_handles;/**< uchwyt dla funkcji */
+    std::atomic<handle> my_nextHandle;/**< uchwyt następnej dodanej funkcji */
+
+    bool isInvoking() const;/**< \brief Sprawdza czy bieżący wątek wykonuje \c invokeAll() tego rejestru */
+    bool isDeferredRemoval( handle callback );/**< \brief Sprawdza czy funkcję usunięto w trakcie \c invokeAll() */
+    handle findInvoked( ArFunctor* func );/**< \brief Wyszukuje uchwyt funkcji z wnętrza \c invokeAll() (bez \c my_indexMutex) */
+    handle addDeferred( ArFunctor* func );/**< \brief Dodaje funkcję z wnętrza \c invokeAll() */
+    bool removeDeferred( handle callback );/**< \brief Usuwa funkcję z wnętrza \c invokeAll() */
+    void applyDeferred();/**< \brief Publikuje zmiany odłożone w trakcie \c invokeAll() */
+
+    callbackRegistry( const callbackRegistry& );
+    callbackRegistry& operator=( const callbackRegistry& );
+};
+
+#endif // CALLBACKREGISTRY_H_INCLUDED
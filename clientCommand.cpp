@@ -0,0 +1,39 @@
+#include "clientCommand.h"
+
+clientCommand::clientCommand( ArClientBase* client, const char* name ) :
+    my_client( client ), my_name( name ), my_commandId( 0 ), my_missingLogged( false )
+{
+
+}
+
+const std::string& clientCommand::getName() const
+{
+    return my_name;
+}
+
+unsigned int clientCommand::getCommandId()
+{
+    unsigned int commandId = my_commandId.load( std::memory_order_relaxed );
+    if( commandId == 0 )
+    {
+        // dataExists() is a quiet lookup, so sends made before the server's command list
+        // arrives do not log a failed findCommandFromName() each time
+        if( !my_client->dataExists( my_name.c_str() ))
+        {
+            if( my_client->isConnected() && !my_missingLogged.exchange( true ))
+                ArLog::log( ArLog::Normal, "clientCommand: server does not provide command %s", my_name.c_str() );
+            return 0;
+        }
+        commandId = my_client->findCommandFromName( my_name.c_str() );
+        my_commandId.store( commandId, std::memory_order_relaxed );
+    }
+    return commandId;
+}
+
+bool clientCommand::sendOnce( ArNetPacket* packet )
+{
+    unsigned int commandId = getCommandId();
+    if( commandId == 0 )
+        return false;
+    return my_client->requestOnceByCommand( commandId, packet );
+}
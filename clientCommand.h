@@ -0,0 +1,94 @@
+#ifndef CLIENTCOMMAND_H_INCLUDED
+#define CLIENTCOMMAND_H_INCLUDED
+
+#include <atomic>
+#include <string>
+
+#include "Aria.h"
+#include "ArNetworking.h"
+
+/** \brief Polecenie serwera wysyłane bez alokacji pamięci
+ *
+ * Obiekt przechowuje nazwę polecenia, jego numer (wyznaczany raz metodą
+ * \c ArClientBase::findCommandFromName() po odebraniu listy poleceń serwera)
+ * oraz własny pakiet, który jest czyszczony i wypełniany przy każdym wysłaniu.
+ * \c ArClientBase::requestOnceByCommand() kopiuje pakiet do bufora wysyłania, więc po
+ * powrocie z \c sendOnce() pakiet można od razu użyć ponownie, np.:
+ * \code
+ * clientCommand moveDist( &client, "moveDist" );
+ * moveDist.sendOnce( [distance_mm]( ArNetPacket* packet ) { packet->doubleToBuf( distance_mm ); } );
+ * \endcode
+ *
+ * Pakiet chroniony jest blokadą, więc polecenie może być wysyłane z wielu wątków
+ * (np. wątku klawiatury i skryptu misji).
+ */
+class clientCommand
+{
+public:
+    /** \brief Konstruktor klasy \c clientCommand
+     *
+     * \param client ArClientBase* - klient Aria
+     * \param name const char* - nazwa polecenia, np. \c "moveDist"
+     *
+     */
+    clientCommand( ArClientBase* client, const char* name );
+
+    /** \brief Zwraca nazwę polecenia
+     *
+     * \return const std::string& - nazwa polecenia
+     *
+     */
+    const std::string& getName() const;
+    /** \brief Zwraca numer polecenia na liście poleceń serwera
+     *
+     * Do czasu odebrania listy poleceń serwera metoda sprawdza jedynie (bez logowania),
+     * czy polecenie jest już dostępne. Brak polecenia na odebranej liście zgłaszany jest
+     * w logu tylko raz.
+     *
+     * \return unsigned int - numer polecenia lub 0, jeśli lista poleceń nie została
+     * jeszcze odebrana albo serwer nie udostępnia polecenia
+     *
+     */
+    unsigned int getCommandId();
+
+    /** \brief Wypełnia pakiet polecenia i wysyła go jednokrotnie
+     *
+     * \param encode Encode - funkcja \c void(ArNetPacket*) zapisująca argumenty polecenia do pustego pakietu
+     * \return bool - wyjście metody \c ArClientBase::requestOnceByCommand() lub \c false,
+     * jeśli numer polecenia nie jest jeszcze znany
+     *
+     */
+    template<typename Encode>
+    bool sendOnce( Encode encode )
+    {
+        my_mutex.lock();
+        my_packet.empty();
+        encode( &my_packet );
+        my_packet.finalizePacket();
+        bool sent = sendOnce( &my_packet );
+        my_mutex.unlock();
+        return sent;
+    }
+    /** \brief Wysyła jednokrotnie polecenie z przekazanym pakietem
+     *
+     * \param packet ArNetPacket* - gotowy pakiet lub \c NULL dla polecenia bez argumentów
+     * \return bool - wyjście metody \c ArClientBase::requestOnceByCommand() lub \c false,
+     * jeśli numer polecenia nie jest jeszcze znany
+     *
+     */
+    bool sendOnce( ArNetPacket* packet = NULL );
+
+private:
+    ArClientBase* my_client;/**< klient Aria */
+    std::string my_name;/**< nazwa polecenia */
+    std::atomic<unsigned int> my_commandId;/**< numer polecenia (0 - jeszcze nie wyznaczony) */
+    std::atomic<bool> my_missingLogged;/**< czy zgłoszono już brak polecenia na liście poleceń serwera */
+
+    ArNetPacket my_packet;/**< pakiet polecenia używany ponownie przy każdym wysłaniu */
+    ArMutex my_mutex;/**< blokada pakietu polecenia */
+
+    clientCommand( const clientCommand& );
+    clientCommand& operator=( const clientCommand& );
+};
+
+#endif // CLIENTCOMMAND_H_INCLUDED
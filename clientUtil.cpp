@@ -0,0 +1,20 @@
+#include "clientUtil.h"
+
+#include <cerrno>
+#include <time.h>
+
+long long clientUtil::monotonicTime_us()
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (long long) now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+void clientUtil::sleepUntil_us( long long deadline_us )
+{
+    struct timespec deadline;
+    deadline.tv_sec = deadline_us / 1000000;
+    deadline.tv_nsec = ( deadline_us % 1000000 ) * 1000;
+    while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL ) == EINTR )
+        ;
+}
@@ -0,0 +1,33 @@
+#ifndef CLIENTUTIL_H_INCLUDED
+#define CLIENTUTIL_H_INCLUDED
+
+/** \brief Funkcje pomocnicze klienta
+ *
+ * Klasa zbiera statyczne funkcje pomocnicze używane przez pozostałe klasy
+ * klienta (na wzór klasy \c ArUtil z biblioteki Aria).
+ */
+class clientUtil
+{
+public:
+    /** \brief Zwraca czas monotoniczny w mikrosekundach
+     *
+     * Zegar nie cofa się przy zmianie czasu systemowego, więc nadaje się do
+     * oznaczania chwil odbioru danych i mierzenia opóźnień.
+     *
+     * \return long long - czas monotoniczny w \c us
+     *
+     */
+    static long long monotonicTime_us();
+    /** \brief Usypia wątek do zadanej chwili czasu monotonicznego
+     *
+     * Czekanie do bezwzględnego terminu (zamiast przez zadany czas) nie kumuluje
+     * opóźnień przy wywołaniach w pętli.
+     *
+     * \param deadline_us long long - chwila wybudzenia w \c us (patrz \c monotonicTime_us())
+     * \return void
+     *
+     */
+    static void sleepUntil_us( long long deadline_us );
+};
+
+#endif // CLIENTUTIL_H_INCLUDED
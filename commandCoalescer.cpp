@@ -0,0 +1,128 @@
+#include "commandCoalescer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "clientUtil.h"
+
+commandCoalescer::commandCoalescer( ArFunctor1<const double*>* send, int valuesCount, mergeMode mode, int window_ms ) :
+    my_send( send ), my_valuesCount( std::min( std::max( valuesCount, 0 ), (int) MAX_VALUES )),
+    my_mode( mode ), my_window_ms( std::max( window_ms, 0 )),
+    my_hasPending( false ), my_lastSend_us( -1 ), my_submitted( 0 ), my_sent( 0 ),
+    my_isFlushing( false ),
+    my_functor_thread_flush( this, &commandCoalescer::thread_flush )
+{
+    std::fill( my_pending, my_pending + MAX_VALUES, 0.0 );
+}
+
+commandCoalescer::~commandCoalescer()
+{
+    my_mutex.lock();
+    bool isFlushing = my_isFlushing;
+    my_isFlushing = false;
+    my_hasPending = false;
+    my_mutex.unlock();
+    my_condition.notify_all();
+    if( isFlushing )
+        my_thread_flush.join();
+}
+
+void commandCoalescer::submit( const double* values )
+{
+    my_submitted.fetch_add( 1, std::memory_order_relaxed );
+    my_mutex.lock();
+    for( int i = 0; i < my_valuesCount; i++ )
+    {
+        if( my_mode == MERGE_SUM && my_hasPending )
+            my_pending[i] += values[i];
+        else
+            my_pending[i] = values[i];
+    }
+    my_hasPending = true;
+
+    long long now_us = clientUtil::monotonicTime_us();
+    if( now_us >= nextSend_us() )
+        sendPending( now_us );
+    else if( !my_isFlushing )
+    {
+        my_isFlushing = true;
+        my_thread_flush.create( &my_functor_thread_flush );
+    }
+    else
+        my_condition.notify_all();
+    my_mutex.unlock();
+}
+
+void commandCoalescer::flush()
+{
+    my_mutex.lock();
+    if( my_hasPending )
+        sendPending( clientUtil::monotonicTime_us() );
+    my_mutex.unlock();
+}
+
+void commandCoalescer::discard()
+{
+    my_mutex.lock();
+    my_hasPending = false;
+    my_mutex.unlock();
+}
+
+void commandCoalescer::setWindow( int window_ms )
+{
+    my_window_ms = std::max( window_ms, 0 );
+    my_condition.notify_all();
+}
+
+int commandCoalescer::getWindow() const
+{
+    return my_window_ms.load();
+}
+
+unsigned long long commandCoalescer::getSubmittedCount() const
+{
+    return my_submitted.load();
+}
+
+unsigned long long commandCoalescer::getSentCount() const
+{
+    return my_sent.load();
+}
+
+void commandCoalescer::sendPending( long long now_us )
+{
+    my_hasPending = false;
+    my_lastSend_us = now_us;
+    my_sent.fetch_add( 1, std::memory_order_relaxed );
+    if( my_send )
+        my_send->invoke( my_pending );
+}
+
+long long commandCoalescer::nextSend_us() const
+{
+    if( my_lastSend_us < 0 )
+        return 0;
+    return my_lastSend_us + my_window_ms.load() * 1000LL;
+}
+
+void commandCoalescer::thread_flush()
+{
+    my_mutex.lock();
+    while( my_isFlushing )
+    {
+        if( !my_hasPending )
+        {
+            my_condition.wait( my_mutex );
+            continue;
+        }
+
+        // Recomputed on every wakeup, so a window changed meanwhile applies at once
+        long long now_us = clientUtil::monotonicTime_us();
+        long long nextSend = nextSend_us();
+        if( now_us >= nextSend )
+            sendPending( now_us );
+        else
+            my_condition.wait_for( my_mutex, std::chrono::microseconds( nextSend - now_us ));
+    }
+    my_mutex.unlock();
+}
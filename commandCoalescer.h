@@ -0,0 +1,124 @@
+#ifndef COMMANDCOALESCER_H_INCLUDED
+#define COMMANDCOALESCER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+
+#include "Aria.h"
+
+/** \brief Łączenie poleceń i ograniczanie częstotliwości ich wysyłania
+ *
+ * Polecenia zgłaszane metodą \c submit() (np. z autopowtarzania klawisza lub pętli
+ * sterowania) wysyłane są nie częściej niż raz na okno czasowe:
+ * \li pierwsze polecenie po okresie ciszy wysyłane jest od razu (bez opóźnienia),
+ * \li polecenia zgłoszone w trakcie okna są łączone - sumowane (\c MERGE_SUM, np.
+ * względne przestawienia kamery) albo zastępowane najnowszym (\c MERGE_LATEST,
+ * np. zadana prędkość) - i wysyłane jednym poleceniem na końcu okna.
+ *
+ * Polecenie składa się z co najwyżej \c MAX_VALUES liczb, wysyłanych funktorem
+ * przekazanym w konstruktorze. Wysyłanie na końcu okna wykonuje wątek klasy,
+ * uruchamiany przy pierwszym odłożonym poleceniu.
+ */
+class commandCoalescer
+{
+public:
+    /** \brief Sposób łączenia poleceń zgłoszonych w trakcie okna */
+    enum mergeMode
+    {
+        MERGE_SUM,/**< wartości są sumowane (polecenia względne) */
+        MERGE_LATEST/**< zostaje najnowsza wartość (wartości zadane) */
+    };
+
+    static const int MAX_VALUES = 4;/**< największa liczba wartości polecenia */
+
+    /** \brief Konstruktor klasy \c commandCoalescer
+     *
+     * \param send ArFunctor1<const double*>* - funktor wysyłający polecenie (wywoływany z \c valuesCount wartościami)
+     * \param valuesCount int - liczba wartości polecenia (najwyżej \c MAX_VALUES)
+     * \param mode mergeMode - sposób łączenia poleceń
+     * \param window_ms int - okno czasowe w \c ms (0 - polecenia wysyłane są od razu)
+     *
+     */
+    commandCoalescer( ArFunctor1<const double*>* send, int valuesCount, mergeMode mode, int window_ms );
+    /** \brief Destruktor klasy \c commandCoalescer - zatrzymuje wątek, odrzucając niewysłane polecenie
+     *
+     *
+     */
+    ~commandCoalescer();
+
+    /** \brief Zgłasza polecenie
+     *
+     * \param values const double* - \c valuesCount wartości polecenia
+     * \return void
+     *
+     */
+    void submit( const double* values );
+    /** \brief Wysyła od razu polecenie oczekujące na koniec okna (jeśli jest)
+     *
+     * \return void
+     *
+     */
+    void flush();
+    /** \brief Odrzuca polecenie oczekujące na koniec okna (np. przed poleceniem zatrzymania)
+     *
+     * \return void
+     *
+     */
+    void discard();
+
+    /** \brief Ustawia okno czasowe
+     *
+     * \param window_ms int - okno w \c ms (0 - polecenia wysyłane są od razu)
+     * \return void
+     *
+     */
+    void setWindow( int window_ms );
+    /** \brief Zwraca okno czasowe
+     *
+     * \return int - okno w \c ms
+     *
+     */
+    int getWindow() const;
+    /** \brief Zwraca liczbę zgłoszonych poleceń
+     *
+     * \return unsigned long long - liczba wywołań \c submit()
+     *
+     */
+    unsigned long long getSubmittedCount() const;
+    /** \brief Zwraca liczbę wysłanych poleceń
+     *
+     * \return unsigned long long - liczba wywołań funktora wysyłającego
+     *
+     */
+    unsigned long long getSentCount() const;
+
+private:
+    ArFunctor1<const double*>* my_send;/**< funktor wysyłający polecenie */
+    int my_valuesCount;/**< liczba wartości polecenia */
+    mergeMode my_mode;/**< sposób łączenia poleceń */
+    std::atomic<int> my_window_ms;/**< okno czasowe */
+
+    double my_pending[MAX_VALUES];/**< połączone polecenie oczekujące na wysłanie */
+    bool my_hasPending;/**< stan polecenia oczekującego */
+    long long my_lastSend_us;/**< chwila wysłania ostatniego polecenia (-1 - jeszcze nie wysłano) */
+    std::atomic<unsigned long long> my_submitted, my_sent;/**< liczniki poleceń */
+
+    ArMutex my_mutex;/**< blokada stanu polecenia (wysyłanie odbywa się pod blokadą, co zachowuje kolejność poleceń) */
+    std::condition_variable_any my_condition;/**< budzenie wątku wysyłania */
+    ArThread my_thread_flush;/**< handler wątku wysyłania na końcu okna */
+    bool my_isFlushing;/**< stan wątku wysyłania */
+
+    void sendPending( long long now_us );/**< \brief Wysyła oczekujące polecenie (pod blokadą \c my_mutex) */
+    long long nextSend_us() const;/**< \brief Zwraca najwcześniejszą chwilę wysłania kolejnego polecenia (pod blokadą \c my_mutex) */
+
+    // CALLBACKS FUNCTIONS
+    void thread_flush(void);/**< wątek wysyłania poleceń na końcu okna */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<commandCoalescer> my_functor_thread_flush;/**< functor do metody \c thread_flush() */
+
+    commandCoalescer( const commandCoalescer& );
+    commandCoalescer& operator=( const commandCoalescer& );
+};
+
+#endif // COMMANDCOALESCER_H_INCLUDED
@@ -0,0 +1,175 @@
+#ifndef COMMANDTRACKER_H_INCLUDED
+#define COMMANDTRACKER_H_INCLUDED
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <list>
+
+#include "Aria.h"
+
+/** \brief Wynik polecenia śledzonego przez \c commandTracker */
+enum commandStatus
+{
+    COMMAND_COMPLETED,/**< stan robota (kamery) osiągnął cel polecenia */
+    COMMAND_TIMED_OUT,/**< cel nie został osiągnięty w zadanym czasie */
+    COMMAND_CANCELLED/**< śledzenie przerwano (np. zamknięcie klienta) */
+};
+
+/** \brief Śledzenie zakończenia poleceń na podstawie strumienia stanu
+ *
+ * Polecenia wysyłane do serwera (\c requestOnce) nie mają potwierdzenia wykonania.
+ * Obiekt tej klasy przechowuje oczekujące polecenia wraz z warunkiem zakończenia
+ * i zwraca dla każdego z nich \c std::future. Wątek odbierający stan (np. pakiety
+ * \c updateNumbers) przekazuje każdy stan do \c update(), która sprawdza warunki
+ * i ustawia wynik polecenia, np.:
+ * \code
+ * std::future<commandStatus> done = tracker.track(
+ *     [target]( const robotState& state ) { return fabs( state.theta - target ) < 2.0; }, 5000 );
+ * ...
+ * if( done.get() == COMMAND_COMPLETED )
+ *     nextManeuver();
+ * \endcode
+ *
+ * Czas oczekiwania sprawdzany jest przy odbiorze stanu oraz w \c expire(), które
+ * należy wywoływać okresowo (np. zadaniem \c taskScheduler) - polecenie kończy się
+ * z \c COMMAND_TIMED_OUT także wtedy, gdy stan przestał napływać (zatrzymany
+ * strumień, zerwane połączenie).
+ * Gdy nie ma oczekujących poleceń, \c update() to jeden odczyt atomowy.
+ * Polecenia oczekujące w chwili zniszczenia obiektu kończą się z \c COMMAND_CANCELLED.
+ */
+template<class State>
+class commandTracker
+{
+public:
+    typedef std::function<bool( const State& )> completionTest;/**< warunek zakończenia polecenia */
+
+    commandTracker() : my_pendingCount( 0 )
+    {
+
+    }
+    ~commandTracker()
+    {
+        cancelAll();
+    }
+
+    /** \brief Dodaje polecenie do śledzenia
+     *
+     * Warunek wywoływany jest w wątku odbierającym stan, po jednym razie dla każdego stanu.
+     *
+     * \param isComplete completionTest - warunek zakończenia polecenia
+     * \param timeout_ms int - maksymalny czas wykonania polecenia w \c ms (ujemny - bez limitu)
+     * \param now_us long long - chwila wysłania polecenia w \c us (patrz \c clientUtil::monotonicTime_us())
+     * \return std::future<commandStatus> - wynik polecenia
+     *
+     */
+    std::future<commandStatus> track( completionTest isComplete, int timeout_ms, long long now_us )
+    {
+        my_mutex.lock();
+        my_pending.push_back( pendingCommand() );
+        pendingCommand& command = my_pending.back();
+        command.isComplete = isComplete;
+        command.deadline_us = timeout_ms < 0 ? -1 : now_us + (long long) timeout_ms * 1000;
+        std::future<commandStatus> result = command.promise.get_future();
+        my_pendingCount.fetch_add( 1 );
+        my_mutex.unlock();
+        return result;
+    }
+    /** \brief Sprawdza warunki oczekujących poleceń dla nowego stanu (wywoływane przez wątek odbioru)
+     *
+     * \param state const State& - odebrany stan
+     * \param now_us long long - chwila odebrania stanu w \c us
+     * \return void
+     *
+     */
+    void update( const State& state, long long now_us )
+    {
+        if( my_pendingCount.load() == 0 )
+            return;
+
+        my_mutex.lock();
+        typename std::list<pendingCommand>::iterator it = my_pending.begin();
+        while( it != my_pending.end() )
+        {
+            if( it->isComplete( state ))
+                it->promise.set_value( COMMAND_COMPLETED );
+            else if( it->deadline_us >= 0 && now_us >= it->deadline_us )
+                it->promise.set_value( COMMAND_TIMED_OUT );
+            else
+            {
+                ++it;
+                continue;
+            }
+            it = my_pending.erase( it );
+            my_pendingCount.fetch_sub( 1 );
+        }
+        my_mutex.unlock();
+    }
+    /** \brief Kończy z wynikiem \c COMMAND_TIMED_OUT polecenia, których czas minął (bez nowego stanu)
+     *
+     * \param now_us long long - bieżąca chwila w \c us
+     * \return void
+     *
+     */
+    void expire( long long now_us )
+    {
+        if( my_pendingCount.load() == 0 )
+            return;
+
+        my_mutex.lock();
+        typename std::list<pendingCommand>::iterator it = my_pending.begin();
+        while( it != my_pending.end() )
+        {
+            if( it->deadline_us < 0 || now_us < it->deadline_us )
+            {
+                ++it;
+                continue;
+            }
+            it->promise.set_value( COMMAND_TIMED_OUT );
+            it = my_pending.erase( it );
+            my_pendingCount.fetch_sub( 1 );
+        }
+        my_mutex.unlock();
+    }
+    /** \brief Kończy wszystkie oczekujące polecenia z wynikiem \c COMMAND_CANCELLED
+     *
+     * \return void
+     *
+     */
+    void cancelAll()
+    {
+        my_mutex.lock();
+        for( typename std::list<pendingCommand>::iterator it = my_pending.begin(); it != my_pending.end(); ++it )
+            it->promise.set_value( COMMAND_CANCELLED );
+        my_pending.clear();
+        my_pendingCount = 0;
+        my_mutex.unlock();
+    }
+    /** \brief Zwraca liczbę oczekujących poleceń
+     *
+     * \return int - liczba poleceń
+     *
+     */
+    int getPendingCount() const
+    {
+        return my_pendingCount.load();
+    }
+
+private:
+    /** \brief Oczekujące polecenie */
+    struct pendingCommand
+    {
+        completionTest isComplete;/**< warunek zakończenia */
+        long long deadline_us;/**< termin wykonania (-1 - bez limitu) */
+        std::promise<commandStatus> promise;/**< wynik polecenia */
+    };
+
+    std::list<pendingCommand> my_pending;/**< oczekujące polecenia */
+    std::atomic<int> my_pendingCount;/**< liczba oczekujących poleceń (szybka ścieżka \c update()) */
+    ArMutex my_mutex;/**< blokada listy poleceń */
+
+    commandTracker( const commandTracker& );
+    commandTracker& operator=( const commandTracker& );
+};
+
+#endif // COMMANDTRACKER_H_INCLUDED
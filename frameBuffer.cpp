@@ -0,0 +1,168 @@
+#include "frameBuffer.h"
+
+#include <cstddef>
+
+frameBuffer::frameBuffer( framePool* pool, int sizeClass, int capacity ) :
+    my_refCount( 0 ), my_data( new unsigned char[capacity] ),
+    my_capacity( capacity ), my_length( 0 ),
+    my_width( 0 ), my_height( 0 ), my_sequence( 0 ), my_timestamp_us( 0 ),
+    my_pool( pool ), my_sizeClass( sizeClass ), my_next( NULL )
+{
+
+}
+
+frameBuffer::~frameBuffer()
+{
+    delete[] my_data;
+}
+
+const unsigned char* frameBuffer::getData() const
+{
+    return my_data;
+}
+
+int frameBuffer::getLength() const
+{
+    return my_length;
+}
+
+int frameBuffer::getWidth() const
+{
+    return my_width;
+}
+
+int frameBuffer::getHeight() const
+{
+    return my_height;
+}
+
+unsigned long long frameBuffer::getSequence() const
+{
+    return my_sequence;
+}
+
+long long frameBuffer::getTimestamp_us() const
+{
+    return my_timestamp_us;
+}
+
+int frameBuffer::getCapacity() const
+{
+    return my_capacity;
+}
+
+unsigned char* frameBuffer::getWritableData()
+{
+    return my_data;
+}
+
+void frameBuffer::setLength( int length )
+{
+    my_length = length;
+}
+
+void frameBuffer::setFrameInfo( int width, int height, unsigned long long sequence, long long timestamp_us )
+{
+    my_width = width;
+    my_height = height;
+    my_sequence = sequence;
+    my_timestamp_us = timestamp_us;
+}
+
+void frameBuffer::addRef()
+{
+    my_refCount.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void frameBuffer::release()
+{
+    if( my_refCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        my_pool->recycle( this );
+}
+
+framePool::framePool( int maxBufferSize ) :
+    my_maxBufferSize( 0 )
+{
+    for( int i = 0; i < SIZE_CLASSES; i++ )
+        my_freeLists[i].store( NULL );
+    setMaxBufferSize( maxBufferSize );
+}
+
+framePool::~framePool()
+{
+    for( int i = 0; i < SIZE_CLASSES; i++ )
+    {
+        frameBuffer* buffer = my_freeLists[i].exchange( NULL );
+        while( buffer )
+        {
+            frameBuffer* next = buffer->my_next;
+            delete buffer;
+            buffer = next;
+        }
+    }
+}
+
+int framePool::sizeClassOf( int length )
+{
+    int sizeClass = 0;
+    while( ( MIN_BUFFER_SIZE << sizeClass ) < length )
+        sizeClass++;
+    return sizeClass;
+}
+
+void framePool::setMaxBufferSize( int maxBufferSize )
+{
+    int largest = MIN_BUFFER_SIZE << ( SIZE_CLASSES - 1 );
+    if( maxBufferSize > largest )
+        maxBufferSize = largest;
+    my_maxBufferSize.store( maxBufferSize );
+}
+
+int framePool::getMaxBufferSize()
+{
+    return my_maxBufferSize.load();
+}
+
+frameBuffer* framePool::acquire( int length )
+{
+    if( length < 0 || length > my_maxBufferSize.load( std::memory_order_relaxed ) )
+        return NULL;
+
+    int sizeClass = sizeClassOf( length );
+
+    // Take the whole list at once - popping single elements with CAS would be
+    // prone to the ABA problem when several threads acquire buffers.
+    frameBuffer* buffer = my_freeLists[sizeClass].exchange( NULL, std::memory_order_acquire );
+    if( buffer )
+    {
+        if( buffer->my_next )
+            pushChain( sizeClass, buffer->my_next );
+    }
+    else
+        buffer = new frameBuffer( this, sizeClass, MIN_BUFFER_SIZE << sizeClass );
+
+    buffer->my_next = NULL;
+    buffer->my_length = 0;
+    buffer->my_refCount.store( 1, std::memory_order_relaxed );
+    return buffer;
+}
+
+void framePool::recycle( frameBuffer* buffer )
+{
+    buffer->my_next = NULL;
+    pushChain( buffer->my_sizeClass, buffer );
+}
+
+void framePool::pushChain( int sizeClass, frameBuffer* first )
+{
+    frameBuffer* last = first;
+    while( last->my_next )
+        last = last->my_next;
+
+    frameBuffer* head = my_freeLists[sizeClass].load( std::memory_order_relaxed );
+    do
+        last->my_next = head;
+    while( !my_freeLists[sizeClass].compare_exchange_weak( head, first,
+                                                           std::memory_order_release,
+                                                           std::memory_order_relaxed ) );
+}
@@ -0,0 +1,197 @@
+#ifndef FRAMEBUFFER_H_INCLUDED
+#define FRAMEBUFFER_H_INCLUDED
+
+#include <atomic>
+
+#include "sharedRef.h"
+
+class framePool;
+
+/** \brief Bufor pojedynczej klatki obrazu z kamery
+ *
+ * Bufor wypełniany jest jednokrotnie przez producenta (wątek odbierający dane
+ * z serwera), a następnie publikowany i od tej chwili tylko odczytywany.
+ * Bufor zlicza referencje - gdy ostatni uchwyt \c frameHandle zostanie
+ * zwolniony, bufor wraca do puli \c framePool i jest ponownie wykorzystywany.
+ */
+class frameBuffer
+{
+public:
+    /** \brief Zwraca wskaźnik do danych klatki (obraz w formacie JPEG)
+     *
+     * \return const unsigned char* - dane klatki
+     *
+     */
+    const unsigned char* getData() const;
+    /** \brief Zwraca długość danych klatki
+     *
+     * \return int - długość danych w bajtach
+     *
+     */
+    int getLength() const;
+    /** \brief Zwraca szerokość obrazu podaną przez serwer
+     *
+     * \return int - szerokość obrazu w pikselach
+     *
+     */
+    int getWidth() const;
+    /** \brief Zwraca wysokość obrazu podaną przez serwer
+     *
+     * \return int - wysokość obrazu w pikselach
+     *
+     */
+    int getHeight() const;
+    /** \brief Zwraca numer kolejny klatki w strumieniu
+     *
+     * \return unsigned long long - numer klatki (kolejne klatki mają kolejne numery)
+     *
+     */
+    unsigned long long getSequence() const;
+    /** \brief Zwraca chwilę odebrania klatki
+     *
+     * \return long long - czas odbioru w \c us (patrz \c clientUtil::monotonicTime_us())
+     *
+     */
+    long long getTimestamp_us() const;
+    /** \brief Zwraca pojemność bufora
+     *
+     * \return int - maksymalna długość danych w bajtach
+     *
+     */
+    int getCapacity() const;
+
+    /** \brief Zwraca bufor do zapisu (tylko dla producenta, przed publikacją)
+     *
+     * \return unsigned char* - wskaźnik do danych bufora
+     *
+     */
+    unsigned char* getWritableData();
+    /** \brief Ustawia długość zapisanych danych (tylko dla producenta, przed publikacją)
+     *
+     * \param length int - długość danych w bajtach
+     * \return void
+     *
+     */
+    void setLength( int length );
+    /** \brief Ustawia opis klatki (tylko dla producenta, przed publikacją)
+     *
+     * \param width int - szerokość obrazu
+     * \param height int - wysokość obrazu
+     * \param sequence unsigned long long - numer kolejny klatki
+     * \param timestamp_us long long - chwila odebrania klatki w \c us
+     * \return void
+     *
+     */
+    void setFrameInfo( int width, int height, unsigned long long sequence, long long timestamp_us );
+
+    void addRef();/**< \brief Zwiększa licznik referencji */
+    void release();/**< \brief Zmniejsza licznik referencji i zwraca bufor do puli */
+
+private:
+    friend class framePool;
+
+    frameBuffer( framePool* pool, int sizeClass, int capacity );
+    ~frameBuffer();
+
+    std::atomic<int> my_refCount;/**< licznik referencji */
+    unsigned char* my_data;/**< dane klatki */
+    int my_capacity, my_length;/**< pojemność bufora i długość danych */
+    int my_width, my_height;/**< rozmiar obrazu */
+    unsigned long long my_sequence;/**< numer kolejny klatki */
+    long long my_timestamp_us;/**< chwila odebrania klatki */
+
+    framePool* my_pool;/**< pula, do której wraca bufor */
+    int my_sizeClass;/**< klasa rozmiaru bufora w puli */
+    frameBuffer* my_next;/**< następny element listy wolnych buforów */
+
+    frameBuffer( const frameBuffer& );
+    frameBuffer& operator=( const frameBuffer& );
+};
+
+/** \brief Uchwyt do klatki obrazu
+ *
+ * Uchwyt jest widokiem na dane klatki wypełnione raz, bezpośrednio z pakietu
+ * sieciowego - korzystanie z niego nie wymaga kopiowania danych. Dopóki
+ * istnieje uchwyt, dane klatki nie zostaną nadpisane.
+ */
+typedef sharedRef<frameBuffer> frameHandle;
+
+/** \brief Pula buforów klatek obrazu
+ *
+ * Pula przechowuje bufory, które zostały zwolnione przez wszystkich
+ * użytkowników, i wydaje je ponownie producentowi - dzięki temu odbiór kolejnej
+ * klatki nie wymaga alokacji pamięci. Listy wolnych buforów są bezblokadowe:
+ * bufory mogą być zwalniane z dowolnego wątku.
+ *
+ * Bufory podzielone są na klasy rozmiarów będące kolejnymi potęgami dwójki
+ * (od \c MIN_BUFFER_SIZE). Nowy bufor alokowany jest tylko wtedy, gdy w danej
+ * klasie brakuje wolnego bufora, więc pula rośnie do rozmiaru największej
+ * odebranej klatki i dalej jedynie ponownie wykorzystuje bufory. Klatki
+ * większe niż ustawiony limit są odrzucane.
+ *
+ * Wszystkie uchwyty do klatek muszą zostać zwolnione przed zniszczeniem puli.
+ */
+class framePool
+{
+public:
+    enum
+    {
+        MIN_BUFFER_SIZE = 4096,/**< rozmiar najmniejszej klasy buforów */
+        SIZE_CLASSES = 16,/**< liczba klas rozmiarów (największa: 128 MB) */
+        DEFAULT_MAX_BUFFER_SIZE = 1 << 20/**< domyślny limit rozmiaru klatki */
+    };
+
+    /** \brief Konstruktor klasy \c framePool
+     *
+     * \param maxBufferSize int - największy dopuszczalny rozmiar klatki w bajtach
+     *
+     */
+    framePool( int maxBufferSize = DEFAULT_MAX_BUFFER_SIZE );
+    /** \brief Destruktor klasy \c framePool
+     *
+     *
+     */
+    ~framePool();
+
+    /** \brief Pobiera z puli bufor mieszczący zadaną liczbę bajtów
+     *
+     * Nowy bufor alokowany jest tylko wtedy, gdy w odpowiedniej klasie nie ma
+     * wolnego bufora.
+     *
+     * \param length int - wymagana pojemność bufora w bajtach
+     * \return frameBuffer* - bufor z jedną referencją należącą do wywołującego lub
+     * \c NULL, jeśli \c length przekracza limit rozmiaru klatki
+     *
+     */
+    frameBuffer* acquire( int length );
+
+    /** \brief Ustawia największy dopuszczalny rozmiar klatki
+     *
+     * \param maxBufferSize int - limit w bajtach (nie większy niż największa klasa buforów)
+     * \return void
+     *
+     */
+    void setMaxBufferSize( int maxBufferSize );
+    /** \brief Zwraca największy dopuszczalny rozmiar klatki
+     *
+     * \return int - limit w bajtach
+     *
+     */
+    int getMaxBufferSize();
+
+private:
+    friend class frameBuffer;
+
+    std::atomic<int> my_maxBufferSize;/**< największy dopuszczalny rozmiar klatki */
+    std::atomic<frameBuffer*> my_freeLists[SIZE_CLASSES];/**< listy wolnych buforów w poszczególnych klasach */
+
+    static int sizeClassOf( int length );/**< \brief Zwraca klasę rozmiaru mieszczącą \c length bajtów */
+
+    void recycle( frameBuffer* buffer );/**< \brief Zwraca bufor na listę wolnych buforów */
+    void pushChain( int sizeClass, frameBuffer* first );/**< \brief Dołącza łańcuch buforów do listy wolnych buforów */
+
+    framePool( const framePool& );
+    framePool& operator=( const framePool& );
+};
+
+#endif // FRAMEBUFFER_H_INCLUDED
@@ -0,0 +1,264 @@
+#include "frameDecoder.h"
+
+#include <algorithm>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "clientUtil.h"
+
+decodedFrame::decodedFrame( frameDecoder* decoder ) :
+    my_refCount( 1 ), my_sequence( 0 ), my_timestamp_us( 0 ), my_decodeTime_us( 0 ),
+    my_decoder( decoder )
+{
+
+}
+
+const cv::Mat& decodedFrame::getImage() const
+{
+    return my_image;
+}
+
+unsigned long long decodedFrame::getSequence() const
+{
+    return my_sequence;
+}
+
+long long decodedFrame::getTimestamp_us() const
+{
+    return my_timestamp_us;
+}
+
+long long decodedFrame::getDecodeTime_us() const
+{
+    return my_decodeTime_us;
+}
+
+void decodedFrame::addRef()
+{
+    my_refCount.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void decodedFrame::release()
+{
+    if( my_refCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        my_decoder->recycle( this );
+}
+
+frameDecoder::frameDecoder( streamStats* stats ) :
+    my_stats( stats ), my_isRunning( false ), my_workersCount( 0 ), my_imreadFlags( cv::IMREAD_COLOR ),
+    my_isDestroying( false ), my_lastPublished( 0 ),
+    my_decoded( 0 ), my_skipped( 0 ), my_failed( 0 ),
+    my_functor_thread_decode( this, &frameDecoder::thread_decode )
+{
+
+}
+
+frameDecoder::~frameDecoder()
+{
+    stop();
+
+    my_poolMutex.lock();
+    my_isDestroying = true;
+    for( size_t i = 0; i < my_freeFrames.size(); i++ )
+        delete my_freeFrames[i];
+    my_freeFrames.clear();
+    my_poolMutex.unlock();
+}
+
+void frameDecoder::start( int workersCount, colorMode mode, int scale )
+{
+    stop();
+
+    // Reduced sizes are produced by the JPEG decoder's scaled IDCT, not by resizing
+    static const int colorFlags[] = { cv::IMREAD_COLOR, cv::IMREAD_REDUCED_COLOR_2,
+                                      cv::IMREAD_REDUCED_COLOR_4, cv::IMREAD_REDUCED_COLOR_8 };
+    static const int grayscaleFlags[] = { cv::IMREAD_GRAYSCALE, cv::IMREAD_REDUCED_GRAYSCALE_2,
+                                          cv::IMREAD_REDUCED_GRAYSCALE_4, cv::IMREAD_REDUCED_GRAYSCALE_8 };
+    int scaleIndex = scale >= 8 ? 3 : scale >= 4 ? 2 : scale >= 2 ? 1 : 0;
+
+    my_mutex.lock();
+    my_workersCount = std::min( std::max( workersCount, 1 ), (int) MAX_WORKERS );
+    my_imreadFlags = mode == DECODE_GRAYSCALE ? grayscaleFlags[scaleIndex] : colorFlags[scaleIndex];
+    my_isRunning = true;
+    for( int i = 0; i < my_workersCount; i++ )
+        my_threads[i].create( &my_functor_thread_decode );
+    my_mutex.unlock();
+}
+
+void frameDecoder::stop()
+{
+    my_mutex.lock();
+    if( !my_isRunning )
+    {
+        my_mutex.unlock();
+        return;
+    }
+    my_isRunning = false;
+    for( size_t i = 0; i < my_pending.size(); i++ )
+        my_pending[i]->release();
+    my_pending.clear();
+    my_condition.notify_all();
+    my_mutex.unlock();
+
+    for( int i = 0; i < my_workersCount; i++ )
+        my_threads[i].join();
+}
+
+bool frameDecoder::isRunning() const
+{
+    return my_isRunning.load();
+}
+
+void frameDecoder::push( frameBuffer* frame )
+{
+    if( !my_isRunning.load( std::memory_order_relaxed ))
+        return;
+
+    my_mutex.lock();
+    if( my_isRunning )
+    {
+        // At most one waiting frame per worker - older ones would only add latency
+        if( (int) my_pending.size() >= my_workersCount )
+        {
+            my_pending.front()->release();
+            my_pending.pop_front();
+            my_skipped.fetch_add( 1, std::memory_order_relaxed );
+            if( my_stats )
+                my_stats->recordDrops();
+        }
+        frame->addRef();
+        my_pending.push_back( frame );
+        my_condition.notify_one();
+    }
+    my_mutex.unlock();
+}
+
+decodedHandle frameDecoder::getLatest()
+{
+    return my_store.acquire();
+}
+
+decodedHandle frameDecoder::waitForNext( unsigned long long lastSequence, int timeout_ms )
+{
+    decodedHandle frame;
+    if( !my_notifier.waitFor( [&]() { frame = my_store.acquire();
+                                      return !frame.empty() && frame->getSequence() > lastSequence; },
+                              timeout_ms ))
+        return decodedHandle();
+    return frame;
+}
+
+int frameDecoder::getEventFd()
+{
+    return my_notifier.getEventFd();
+}
+
+unsigned long long frameDecoder::getDecodedCount() const
+{
+    return my_decoded.load();
+}
+
+unsigned long long frameDecoder::getSkippedCount() const
+{
+    return my_skipped.load();
+}
+
+unsigned long long frameDecoder::getFailedCount() const
+{
+    return my_failed.load();
+}
+
+decodedFrame* frameDecoder::acquireFrame()
+{
+    decodedFrame* frame = NULL;
+    my_poolMutex.lock();
+    if( !my_freeFrames.empty() )
+    {
+        frame = my_freeFrames.back();
+        my_freeFrames.pop_back();
+    }
+    my_poolMutex.unlock();
+
+    if( frame == NULL )
+        return new decodedFrame( this );
+    frame->my_refCount.store( 1, std::memory_order_relaxed );
+    // A consumer kept a shallow copy of the image - decoding into it would overwrite it
+    if( frame->my_image.u != NULL && frame->my_image.u->refcount > 1 )
+        frame->my_image.release();
+    return frame;
+}
+
+void frameDecoder::recycle( decodedFrame* frame )
+{
+    my_poolMutex.lock();
+    if( my_isDestroying )
+        delete frame;
+    else
+        my_freeFrames.push_back( frame );
+    my_poolMutex.unlock();
+}
+
+void frameDecoder::publish( decodedFrame* frame )
+{
+    my_publishMutex.lock();
+    if( frame->my_sequence > my_lastPublished )
+    {
+        my_lastPublished = frame->my_sequence;
+        my_store.publish( frame );
+        my_publishMutex.unlock();
+        my_notifier.notify();
+        return;
+    }
+    my_publishMutex.unlock();
+
+    // A newer frame finished first
+    my_skipped.fetch_add( 1, std::memory_order_relaxed );
+    if( my_stats )
+        my_stats->recordDrops();
+    frame->release();
+}
+
+void frameDecoder::thread_decode()
+{
+    my_mutex.lock();
+    while( my_isRunning )
+    {
+        if( my_pending.empty() )
+        {
+            my_condition.wait( my_mutex );
+            continue;
+        }
+
+        frameBuffer* source = my_pending.front();
+        my_pending.pop_front();
+        int flags = my_imreadFlags;
+        my_mutex.unlock();
+
+        decodedFrame* frame = acquireFrame();
+        long long start_us = clientUtil::monotonicTime_us();
+        // Decoded straight from the frame buffer into the pooled image, reusing its memory
+        cv::Mat rawData( 1, source->getLength(), CV_8UC1, (void*) source->getData() );
+        cv::imdecode( rawData, flags, &frame->my_image );
+        frame->my_decodeTime_us = clientUtil::monotonicTime_us() - start_us;
+        if( my_stats )
+            my_stats->recordDecode( frame->my_decodeTime_us );
+        frame->my_sequence = source->getSequence();
+        frame->my_timestamp_us = source->getTimestamp_us();
+        source->release();
+
+        if( frame->my_image.empty() )
+        {
+            my_failed.fetch_add( 1, std::memory_order_relaxed );
+            if( my_stats )
+                my_stats->recordDrops();
+            frame->release();
+        }
+        else
+        {
+            my_decoded.fetch_add( 1, std::memory_order_relaxed );
+            publish( frame );
+        }
+        my_mutex.lock();
+    }
+    my_mutex.unlock();
+}
@@ -0,0 +1,236 @@
+#ifndef FRAMEDECODER_H_INCLUDED
+#define FRAMEDECODER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "Aria.h"
+
+#include "frameBuffer.h"
+#include "latestStore.h"
+#include "sharedRef.h"
+#include "streamNotifier.h"
+#include "streamStats.h"
+
+class frameDecoder;
+
+/** \brief Zdekodowana klatka obrazu z kamery
+ *
+ * Klatka dekodowana jest jednokrotnie i współdzielona przez wszystkich odbiorców.
+ * Bufor obrazu pochodzi z puli dekodera - gdy ostatni uchwyt \c decodedHandle
+ * zostanie zwolniony, klatka wraca do puli, a jej obraz jest ponownie używany
+ * przez kolejne dekodowanie. Kopie nagłówka \c cv::Mat zachowane przez odbiorcę
+ * pozostają ważne - bufor, na który wskazują, nie jest wtedy ponownie używany
+ * (kolejne dekodowanie przydziela nowy), więc trzymanie kopii kosztuje jedynie
+ * utratę zysku z puli.
+ */
+class decodedFrame
+{
+public:
+    /** \brief Zwraca zdekodowany obraz
+     *
+     * \return const cv::Mat& - obraz (\c CV_8UC3 w kolejności BGR lub \c CV_8UC1 w odcieniach szarości)
+     *
+     */
+    const cv::Mat& getImage() const;
+    /** \brief Zwraca numer kolejny klatki w strumieniu
+     *
+     * \return unsigned long long - numer klatki źródłowej (patrz \c frameBuffer::getSequence())
+     *
+     */
+    unsigned long long getSequence() const;
+    /** \brief Zwraca chwilę odebrania klatki źródłowej
+     *
+     * \return long long - czas odbioru w \c us (patrz \c clientUtil::monotonicTime_us())
+     *
+     */
+    long long getTimestamp_us() const;
+    /** \brief Zwraca czas dekodowania klatki
+     *
+     * \return long long - czas dekodowania w \c us
+     *
+     */
+    long long getDecodeTime_us() const;
+
+    void addRef();/**< \brief Zwiększa licznik referencji */
+    void release();/**< \brief Zmniejsza licznik referencji i zwraca klatkę do puli dekodera */
+
+private:
+    friend class frameDecoder;
+
+    decodedFrame( frameDecoder* decoder );
+
+    std::atomic<int> my_refCount;/**< licznik referencji */
+    cv::Mat my_image;/**< zdekodowany obraz (bufor ponownie wykorzystywany) */
+    unsigned long long my_sequence;/**< numer kolejny klatki */
+    long long my_timestamp_us;/**< chwila odebrania klatki źródłowej */
+    long long my_decodeTime_us;/**< czas dekodowania */
+
+    frameDecoder* my_decoder;/**< dekoder, do którego puli wraca klatka */
+
+    decodedFrame( const decodedFrame& );
+    decodedFrame& operator=( const decodedFrame& );
+};
+
+/** \brief Uchwyt do zdekodowanej klatki obrazu */
+typedef sharedRef<decodedFrame> decodedHandle;
+
+/** \brief Równoległe dekodowanie klatek JPEG ze strumienia kamery
+ *
+ * Klatki przekazywane metodą \c push() (z wątku odbierającego dane z serwera)
+ * dekodowane są przez pulę wątków, więc dekodowanie nie jest szeregowane
+ * z wyświetlaniem ani przetwarzaniem obrazu, a kolejne klatki mogą być
+ * dekodowane jednocześnie. Gdy wszystkie wątki są zajęte, w kolejce czeka
+ * najwyżej tyle klatek, ile jest wątków - najstarsza oczekująca klatka jest
+ * pomijana, więc opóźnienie nie narasta.
+ *
+ * Dekodowanie może odbywać się w zmniejszonej skali (1/2, 1/4, 1/8 - skalowanie
+ * wykonywane jest przez dekoder JPEG na etapie odwrotnej DCT, więc jest
+ * wielokrotnie szybsze od dekodowania pełnego obrazu) i tylko w odcieniach
+ * szarości. Obrazy dekodowane są do buforów \c cv::Mat z puli, więc
+ * w stanie ustalonym dekodowanie nie alokuje pamięci.
+ *
+ * Odbiorcy pobierają najnowszą zdekodowaną klatkę (\c getLatest()) lub czekają
+ * na kolejną (\c waitForNext()). Klatka zdekodowana później niż nowsza od niej
+ * nie jest publikowana.
+ *
+ * Wszystkie uchwyty do klatek muszą zostać zwolnione przed zniszczeniem dekodera.
+ */
+class frameDecoder
+{
+public:
+    /** \brief Format zdekodowanego obrazu */
+    enum colorMode
+    {
+        DECODE_COLOR,/**< obraz kolorowy BGR */
+        DECODE_GRAYSCALE/**< obraz w odcieniach szarości (szybsze dekodowanie) */
+    };
+
+    static const int MAX_WORKERS = 8;/**< największa liczba wątków dekodujących */
+
+    /** \brief Konstruktor klasy \c frameDecoder
+     *
+     * \param stats streamStats* - statystyki strumienia, do których trafiają czasy dekodowania i pominięte klatki (\c NULL - brak)
+     *
+     */
+    frameDecoder( streamStats* stats = NULL );
+    /** \brief Destruktor klasy \c frameDecoder - zatrzymuje wątki i zwalnia pulę obrazów
+     *
+     *
+     */
+    ~frameDecoder();
+
+    /** \brief Uruchamia dekodowanie (dekodowanie już trwające jest uruchamiane ponownie z nowymi ustawieniami)
+     *
+     * \param workersCount int - liczba wątków dekodujących (najwyżej \c MAX_WORKERS)
+     * \param mode colorMode - format obrazu
+     * \param scale int - dzielnik rozdzielczości obrazu: 1, 2, 4 lub 8
+     * \return void
+     *
+     */
+    void start( int workersCount = 2, colorMode mode = DECODE_COLOR, int scale = 1 );
+    /** \brief Zatrzymuje dekodowanie (oczekujące klatki są pomijane, ostatnia zdekodowana klatka pozostaje dostępna)
+     *
+     * \return void
+     *
+     */
+    void stop();
+    /** \brief Sprawdza czy trwa dekodowanie
+     *
+     * \return bool - \b True, jeśli dekodowanie jest uruchomione
+     *
+     */
+    bool isRunning() const;
+
+    /** \brief Przekazuje klatkę do dekodowania (wywoływane przez producenta; bez działania, gdy dekodowanie nie jest uruchomione)
+     *
+     * Kolejka bierze własną referencję do klatki.
+     *
+     * \param frame frameBuffer* - opublikowana klatka
+     * \return void
+     *
+     */
+    void push( frameBuffer* frame );
+
+    /** \brief Zwraca uchwyt do najnowszej zdekodowanej klatki (bez czekania)
+     *
+     * \return decodedHandle - uchwyt do klatki lub pusty uchwyt, jeśli nic jeszcze nie zdekodowano
+     *
+     */
+    decodedHandle getLatest();
+    /** \brief Czeka na zdekodowaną klatkę nowszą niż \c lastSequence
+     *
+     * \param lastSequence unsigned long long - numer ostatnio przetworzonej klatki (0 - dowolna klatka)
+     * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+     * \return decodedHandle - uchwyt do nowszej klatki lub pusty uchwyt po upływie czasu
+     *
+     */
+    decodedHandle waitForNext( unsigned long long lastSequence, int timeout_ms );
+    /** \brief Zwraca deskryptor \c eventfd sygnalizujący zdekodowanie klatki
+     *
+     * \return int - deskryptor (należy do obiektu) lub -1, jeśli nie udało się go utworzyć
+     *
+     */
+    int getEventFd();
+
+    /** \brief Zwraca liczbę zdekodowanych klatek
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getDecodedCount() const;
+    /** \brief Zwraca liczbę klatek pominiętych (zajęte wątki lub klatka starsza niż już opublikowana)
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getSkippedCount() const;
+    /** \brief Zwraca liczbę klatek, których nie udało się zdekodować
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getFailedCount() const;
+
+private:
+    friend class decodedFrame;
+
+    streamStats* my_stats;/**< statystyki strumienia (\c NULL - brak) */
+    std::atomic<bool> my_isRunning;/**< stan dekodowania */
+    int my_workersCount;/**< liczba wątków dekodujących */
+    int my_imreadFlags;/**< flagi \c cv::imdecode() wynikające z formatu i skali */
+
+    ArMutex my_mutex;/**< blokada kolejki klatek do dekodowania */
+    std::condition_variable_any my_condition;/**< budzenie wątków dekodujących */
+    std::deque<frameBuffer*> my_pending;/**< klatki czekające na dekodowanie */
+    ArThread my_threads[MAX_WORKERS];/**< handlery wątków dekodujących */
+
+    ArMutex my_poolMutex;/**< blokada puli obrazów */
+    std::vector<decodedFrame*> my_freeFrames;/**< wolne klatki z buforami obrazu */
+    bool my_isDestroying;/**< klatki zwalniane w trakcie niszczenia dekodera są usuwane */
+
+    ArMutex my_publishMutex;/**< zapewnia, że klatki publikuje tylko jeden wątek naraz */
+    unsigned long long my_lastPublished;/**< numer ostatnio opublikowanej klatki */
+    std::atomic<unsigned long long> my_decoded, my_skipped, my_failed;/**< statystyki dekodowania */
+    streamNotifier my_notifier;/**< powiadamianie o zdekodowanych klatkach */
+    latestStore<decodedFrame> my_store;/**< ostatnio zdekodowana klatka */
+
+    decodedFrame* acquireFrame();/**< \brief Pobiera klatkę z puli (lub tworzy nową) z jedną referencją */
+    void recycle( decodedFrame* frame );/**< \brief Zwraca klatkę do puli */
+    void publish( decodedFrame* frame );/**< \brief Publikuje zdekodowaną klatkę (przejmuje referencję) */
+
+    // CALLBACKS FUNCTIONS
+    void thread_decode(void);/**< wątek dekodowania klatek */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<frameDecoder> my_functor_thread_decode;/**< functor do metody \c thread_decode() */
+
+    frameDecoder( const frameDecoder& );
+    frameDecoder& operator=( const frameDecoder& );
+};
+
+#endif // FRAMEDECODER_H_INCLUDED
@@ -0,0 +1,425 @@
+#include "frameLog.h"
+#include "clientUtil.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+frameLogWriter::frameLogWriter() :
+    my_file( -1 ), my_segmentNumber( 0 ), my_segmentSize( 0 ), my_writtenSize( 0 ), my_segmentStart_us( -1 ),
+    my_maxSegmentSize( 1024LL * 1024 * 1024 ), my_maxSegmentDuration_us( 0 ),
+    my_lostFrames( 0 )
+{
+    memset( &my_fileHeader, 0, sizeof( my_fileHeader ));
+}
+
+frameLogWriter::~frameLogWriter()
+{
+    close();
+}
+
+bool frameLogWriter::open( const std::string& directory, const std::string& prefix )
+{
+    close();
+
+    my_directory = directory;
+    my_prefix = prefix;
+    my_segmentNumber = 0;
+
+    struct timeval wallClock;
+    gettimeofday( &wallClock, NULL );
+    memcpy( my_fileHeader.magic, FRAME_LOG_MAGIC, sizeof( FRAME_LOG_MAGIC ));
+    my_fileHeader.version = FRAME_LOG_VERSION;
+    my_fileHeader.headerSize = sizeof( frameLogFileHeader );
+    my_fileHeader.wallClockAtStart_us = (int64_t) wallClock.tv_sec * 1000000 + wallClock.tv_usec;
+    my_fileHeader.monotonicAtStart_us = clientUtil::monotonicTime_us();
+
+    return openSegment();
+}
+
+bool frameLogWriter::close()
+{
+    // Ends the session - append() no longer tries to open a segment
+    my_segmentNumber = 0;
+    if( my_file < 0 )
+        return true;
+
+    bool flushed = flush();
+    return closeSegment() && flushed;
+}
+
+bool frameLogWriter::isOpen()
+{
+    return my_file >= 0;
+}
+
+void frameLogWriter::setSegmentLimits( long long maxSegmentSize_bytes, long long maxSegmentDuration_ms )
+{
+    my_maxSegmentSize = maxSegmentSize_bytes;
+    my_maxSegmentDuration_us = maxSegmentDuration_ms * 1000;
+}
+
+bool frameLogWriter::openSegment()
+{
+    char filename[PATH_MAX];
+    snprintf( filename, sizeof( filename ), "%s/%s_%04d.flog",
+              my_directory.c_str(), my_prefix.c_str(), my_segmentNumber );
+
+    my_file = ::open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( my_file < 0 )
+    {
+        printf("frameLogWriter: could not create %s: %s\n", filename, strerror( errno ));
+        fflush(stdout);
+        return false;
+    }
+    my_segmentNumber++;
+    my_segmentStart_us = -1;
+    my_index.clear();
+
+    struct iovec header = { &my_fileHeader, sizeof( my_fileHeader ) };
+    my_segmentSize = sizeof( my_fileHeader );
+    my_writtenSize = 0;
+    if( !writeVector( &header, 1 ))
+    {
+        ::close( my_file );
+        my_file = -1;
+        return false;
+    }
+    my_writtenSize = my_segmentSize;
+    return true;
+}
+
+bool frameLogWriter::closeSegment()
+{
+    frameLogFooter footer;
+    footer.magic = FRAME_LOG_FOOTER_MAGIC;
+    footer.version = FRAME_LOG_VERSION;
+    footer.frameCount = my_index.size();
+    footer.indexOffset = my_segmentSize;
+
+    struct iovec trailer[2] =
+    {
+        { my_index.empty() ? NULL : &my_index[0], my_index.size() * sizeof( frameLogIndexEntry ) },
+        { &footer, sizeof( footer ) }
+    };
+    bool written = writeVector( trailer, 2 );
+
+    ::close( my_file );
+    my_file = -1;
+    my_index.clear();
+    return written;
+}
+
+bool frameLogWriter::append( const frameHandle& frame )
+{
+    if( frame.empty() )
+        return false;
+    // A segment could not be opened earlier - the session goes on as soon as one can
+    if( my_file < 0 && ( my_segmentNumber == 0 || !openSegment() ))
+        return false;
+
+    long long recordSize = sizeof( frameLogRecordHeader ) + frame->getLength();
+    bool segmentUsed = !my_index.empty() || !my_pendingFrames.empty();
+    long long trailerSize = ( my_index.size() + 1 ) * sizeof( frameLogIndexEntry ) + sizeof( frameLogFooter );
+    bool tooLarge = my_maxSegmentSize > 0 && my_segmentSize + recordSize + trailerSize > my_maxSegmentSize;
+    bool tooLong = my_maxSegmentDuration_us > 0 && my_segmentStart_us >= 0 &&
+                   frame->getTimestamp_us() - my_segmentStart_us >= my_maxSegmentDuration_us;
+    if( segmentUsed && ( tooLarge || tooLong ))
+    {
+        // A failed write loses only the pending batch (see takeLostFrames()) -
+        // recording goes on in the next segment
+        flush();
+        closeSegment();
+        if( !openSegment() )
+            return false;
+    }
+
+    frameLogRecordHeader header;
+    header.magic = FRAME_LOG_RECORD_MAGIC;
+    header.length = frame->getLength();
+    header.sequence = frame->getSequence();
+    header.timestamp_us = frame->getTimestamp_us();
+    header.width = frame->getWidth();
+    header.height = frame->getHeight();
+
+    frameLogIndexEntry entry;
+    entry.offset = my_segmentSize;
+    entry.sequence = header.sequence;
+    entry.timestamp_us = header.timestamp_us;
+
+    my_pendingHeaders.push_back( header );
+    my_pendingFrames.push_back( frame );
+    my_index.push_back( entry );
+    my_segmentSize += recordSize;
+    if( my_segmentStart_us < 0 )
+        my_segmentStart_us = header.timestamp_us;
+    return true;
+}
+
+bool frameLogWriter::flush()
+{
+    if( my_pendingFrames.empty() )
+        return true;
+
+    // Built only now - my_pendingHeaders may have been reallocated by append()
+    my_iovecs.clear();
+    for( size_t i = 0; i < my_pendingFrames.size(); i++ )
+    {
+        struct iovec header = { &my_pendingHeaders[i], sizeof( frameLogRecordHeader ) };
+        struct iovec data = { const_cast<unsigned char*>( my_pendingFrames[i]->getData() ),
+                              (size_t) my_pendingFrames[i]->getLength() };
+        my_iovecs.push_back( header );
+        my_iovecs.push_back( data );
+    }
+
+    if( !writeVector( &my_iovecs[0], (int) my_iovecs.size() ))
+    {
+        discardPending();
+        return false;
+    }
+    my_writtenSize = my_segmentSize;
+    my_pendingHeaders.clear();
+    my_pendingFrames.clear();
+    return true;
+}
+
+bool frameLogWriter::discardPending()
+{
+    // The index must describe only what is on disk - later offsets and the footer depend on it
+    my_lostFrames += my_pendingFrames.size();
+    my_index.resize( my_index.size() - my_pendingFrames.size() );
+    my_pendingHeaders.clear();
+    my_pendingFrames.clear();
+    my_segmentSize = my_writtenSize;
+    if( my_index.empty() )
+        my_segmentStart_us = -1;
+
+    // A partial write leaves bytes past the confirmed end
+    if( ftruncate( my_file, my_writtenSize ) == 0 && lseek( my_file, my_writtenSize, SEEK_SET ) == my_writtenSize )
+        return true;
+
+    // The segment cannot be repaired - it is closed without an index (readers scan its records)
+    printf("frameLogWriter: could not truncate segment %d: %s\n", my_segmentNumber - 1, strerror( errno ));
+    fflush(stdout);
+    ::close( my_file );
+    my_file = -1;
+    my_index.clear();
+    return openSegment();
+}
+
+unsigned long long frameLogWriter::takeLostFrames()
+{
+    unsigned long long lost = my_lostFrames;
+    my_lostFrames = 0;
+    return lost;
+}
+
+bool frameLogWriter::sync()
+{
+    return my_file >= 0 && fdatasync( my_file ) == 0;
+}
+
+bool frameLogWriter::writeVector( struct iovec* vectors, int count )
+{
+    while( count > 0 )
+    {
+        int chunk = count < IOV_MAX ? count : IOV_MAX;
+        ssize_t written = writev( my_file, vectors, chunk );
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            return false;
+        }
+        // Skip fully written vectors and adjust a partially written one
+        while( count > 0 && (size_t) written >= vectors->iov_len )
+        {
+            written -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+        if( count > 0 )
+        {
+            vectors->iov_base = (char*) vectors->iov_base + written;
+            vectors->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+frameLogReader::frameLogReader()
+{
+
+}
+
+frameLogReader::~frameLogReader()
+{
+    close();
+}
+
+bool frameLogReader::open( const std::string& path )
+{
+    close();
+
+    const std::string extension( ".flog" );
+    if( path.size() > extension.size() &&
+            path.compare( path.size() - extension.size(), extension.size(), extension ) == 0 )
+        return openSegment( path );
+
+    // Segments of a session are numbered consecutively from 0
+    for( int number = 0; ; number++ )
+    {
+        char filename[PATH_MAX];
+        snprintf( filename, sizeof( filename ), "%s_%04d.flog", path.c_str(), number );
+        if( access( filename, R_OK ) != 0 )
+            break;
+        openSegment( filename );
+    }
+    return !my_segments.empty();
+}
+
+void frameLogReader::close()
+{
+    for( std::vector<segment>::iterator seg = my_segments.begin(); seg != my_segments.end(); ++seg )
+        munmap( const_cast<unsigned char*>( seg->base ), seg->size );
+    my_segments.clear();
+    my_entries.clear();
+}
+
+bool frameLogReader::openSegment( const std::string& filename )
+{
+    int file = ::open( filename.c_str(), O_RDONLY );
+    if( file < 0 )
+        return false;
+
+    struct stat status;
+    if( fstat( file, &status ) != 0 || status.st_size < (off_t) sizeof( frameLogFileHeader ) )
+    {
+        ::close( file );
+        return false;
+    }
+
+    void* base = mmap( NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0 );
+    ::close( file );
+    if( base == MAP_FAILED )
+        return false;
+
+    segment seg;
+    seg.base = (const unsigned char*) base;
+    seg.size = status.st_size;
+    if( memcmp( seg.base, FRAME_LOG_MAGIC, sizeof( FRAME_LOG_MAGIC )) != 0 )
+    {
+        munmap( base, seg.size );
+        return false;
+    }
+    // Frames are read in recording order
+    madvise( base, seg.size, MADV_SEQUENTIAL );
+
+    my_segments.push_back( seg );
+    if( !readIndex( seg ))
+        scanRecords( seg );
+    return true;
+}
+
+bool frameLogReader::readIndex( const segment& seg )
+{
+    if( seg.size < sizeof( frameLogFileHeader ) + sizeof( frameLogFooter ))
+        return false;
+
+    frameLogFooter footer;
+    memcpy( &footer, seg.base + seg.size - sizeof( footer ), sizeof( footer ));
+    if( footer.magic != FRAME_LOG_FOOTER_MAGIC ||
+            footer.frameCount > seg.size / sizeof( frameLogIndexEntry ) || footer.indexOffset > seg.size ||
+            footer.indexOffset + footer.frameCount * sizeof( frameLogIndexEntry ) + sizeof( footer ) != seg.size )
+        return false;
+
+    size_t firstEntry = my_entries.size();
+    for( uint64_t i = 0; i < footer.frameCount; i++ )
+    {
+        frameLogIndexEntry indexEntry;
+        memcpy( &indexEntry, seg.base + footer.indexOffset + i * sizeof( indexEntry ), sizeof( indexEntry ));
+
+        // Every record must lie whole before the index - getFrame() trusts its length
+        frameLogRecordHeader header;
+        bool valid = indexEntry.offset >= sizeof( frameLogFileHeader ) &&
+                     indexEntry.offset + sizeof( header ) <= footer.indexOffset;
+        if( valid )
+        {
+            memcpy( &header, seg.base + indexEntry.offset, sizeof( header ));
+            valid = header.magic == FRAME_LOG_RECORD_MAGIC &&
+                    indexEntry.offset + sizeof( header ) + header.length <= footer.indexOffset;
+        }
+        if( !valid )
+        {
+            // A damaged index is dropped as a whole and the segment is scanned instead
+            my_entries.resize( firstEntry );
+            return false;
+        }
+
+        entry sessionEntry = { seg.base + indexEntry.offset, indexEntry.timestamp_us };
+        my_entries.push_back( sessionEntry );
+    }
+    return true;
+}
+
+void frameLogReader::scanRecords( const segment& seg )
+{
+    size_t offset = sizeof( frameLogFileHeader );
+    while( offset + sizeof( frameLogRecordHeader ) <= seg.size )
+    {
+        frameLogRecordHeader header;
+        memcpy( &header, seg.base + offset, sizeof( header ));
+        if( header.magic != FRAME_LOG_RECORD_MAGIC ||
+                offset + sizeof( header ) + header.length > seg.size )
+            break;
+
+        entry sessionEntry = { seg.base + offset, header.timestamp_us };
+        my_entries.push_back( sessionEntry );
+        offset += sizeof( header ) + header.length;
+    }
+}
+
+int frameLogReader::getFrameCount() const
+{
+    return (int) my_entries.size();
+}
+
+bool frameLogReader::getFrame( int index, frameLogFrame& frame ) const
+{
+    if( index < 0 || index >= (int) my_entries.size() )
+        return false;
+
+    frameLogRecordHeader header;
+    memcpy( &header, my_entries[index].record, sizeof( header ));
+    frame.data = my_entries[index].record + sizeof( header );
+    frame.length = header.length;
+    frame.width = header.width;
+    frame.height = header.height;
+    frame.sequence = header.sequence;
+    frame.timestamp_us = header.timestamp_us;
+    return true;
+}
+
+int frameLogReader::findFrameByTimestamp( long long timestamp_us ) const
+{
+    int low = 0, high = (int) my_entries.size();
+    while( low < high )
+    {
+        int middle = low + ( high - low ) / 2;
+        if( my_entries[middle].timestamp_us <= timestamp_us )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low - 1;
+}
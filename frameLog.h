@@ -0,0 +1,279 @@
+#ifndef FRAMELOG_H_INCLUDED
+#define FRAMELOG_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+#include "frameBuffer.h"
+
+/** \brief Format pliku z zapisem strumienia klatek (dziennik klatek)
+ *
+ * Nagranie (sesja) składa się z kolejnych segmentów o nazwach
+ * \c <prefiks>_<numer>.flog. Każdy segment zawiera:
+ * \li nagłówek pliku \c frameLogFileHeader
+ * \li kolejne klatki: nagłówek \c frameLogRecordHeader, a bezpośrednio za nim dane klatki (JPEG)
+ * \li indeks - tablicę \c frameLogIndexEntry (po jednym wpisie na klatkę)
+ * \li stopkę \c frameLogFooter na samym końcu pliku, wskazującą początek indeksu
+ *
+ * Klatki są jedynie dopisywane na końcu pliku, a indeks zapisywany jest przy
+ * zamykaniu segmentu. Jeżeli segment nie został poprawnie zamknięty (brak
+ * stopki), indeks można odtworzyć, przechodząc kolejno przez nagłówki klatek.
+ * Struktury zapisywane są bezpośrednio z pamięci, więc liczby mają porządek
+ * bajtów komputera nagrywającego (little-endian na x86 i ARM). Układ struktur
+ * nie zawiera wyrównania (sprawdzane przez \c static_assert). W nagraniu z
+ * komputera o innym porządku bajtów nie pasują liczbowe znaczniki \c magic
+ * stopki i klatek, więc nie zostanie odczytana żadna klatka.
+ */
+struct frameLogFileHeader
+{
+    char magic[8];/**< \c "ARFLOG01" */
+    uint32_t version;/**< wersja formatu */
+    uint32_t headerSize;/**< rozmiar nagłówka pliku w bajtach */
+    int64_t wallClockAtStart_us;/**< czas rzeczywisty rozpoczęcia nagrania (od 1970 r.) */
+    int64_t monotonicAtStart_us;/**< czas monotoniczny rozpoczęcia nagrania */
+};
+
+/** \brief Nagłówek pojedynczej klatki w dzienniku klatek */
+struct frameLogRecordHeader
+{
+    uint32_t magic;/**< \c FRAME_LOG_RECORD_MAGIC */
+    uint32_t length;/**< długość danych klatki w bajtach */
+    uint64_t sequence;/**< numer kolejny klatki */
+    int64_t timestamp_us;/**< chwila odebrania klatki (czas monotoniczny) */
+    int32_t width, height;/**< rozmiar obrazu */
+};
+
+/** \brief Wpis indeksu dziennika klatek */
+struct frameLogIndexEntry
+{
+    uint64_t offset;/**< położenie nagłówka klatki w pliku */
+    uint64_t sequence;/**< numer kolejny klatki */
+    int64_t timestamp_us;/**< chwila odebrania klatki */
+};
+
+/** \brief Stopka segmentu dziennika klatek */
+struct frameLogFooter
+{
+    uint32_t magic;/**< \c FRAME_LOG_FOOTER_MAGIC */
+    uint32_t version;/**< wersja formatu */
+    uint64_t frameCount;/**< liczba klatek (wpisów indeksu) */
+    uint64_t indexOffset;/**< położenie indeksu w pliku */
+};
+
+static_assert( sizeof( frameLogFileHeader ) == 32, "frameLogFileHeader layout changed" );
+static_assert( sizeof( frameLogRecordHeader ) == 32, "frameLogRecordHeader layout changed" );
+static_assert( sizeof( frameLogIndexEntry ) == 24, "frameLogIndexEntry layout changed" );
+static_assert( sizeof( frameLogFooter ) == 24, "frameLogFooter layout changed" );
+
+static const char FRAME_LOG_MAGIC[8] = { 'A', 'R', 'F', 'L', 'O', 'G', '0', '1' };
+static const uint32_t FRAME_LOG_VERSION = 1;
+static const uint32_t FRAME_LOG_RECORD_MAGIC = 0x454d5246;/**< \c "FRME" */
+static const uint32_t FRAME_LOG_FOOTER_MAGIC = 0x58444946;/**< \c "FIDX" */
+
+/** \brief Zapis klatek do segmentowanego dziennika klatek
+ *
+ * Klatki dopisywane metodą \c append() trafiają do pliku dopiero po wywołaniu
+ * \c flush(), które zapisuje całą partię jednym wywołaniem \c writev() - do
+ * tego czasu wywołujący musi utrzymywać uchwyty do klatek. Nowy segment
+ * rozpoczynany jest, gdy bieżący przekroczyłby zadany rozmiar lub czas trwania.
+ */
+class frameLogWriter
+{
+public:
+    /** \brief Konstruktor klasy \c frameLogWriter
+     *
+     *
+     */
+    frameLogWriter();
+    /** \brief Destruktor klasy \c frameLogWriter - zamyka bieżący segment
+     *
+     *
+     */
+    ~frameLogWriter();
+
+    /** \brief Rozpoczyna nową sesję nagrania
+     *
+     * \param directory const std::string& - folder, w którym tworzone są segmenty
+     * \param prefix const std::string& - początek nazw plików segmentów
+     * \return bool - \b True, jeśli udało się utworzyć pierwszy segment
+     *
+     */
+    bool open( const std::string& directory, const std::string& prefix );
+    /** \brief Zapisuje oczekujące klatki i zamyka bieżący segment (z indeksem)
+     *
+     * \return bool - \b True, jeśli zapis się powiódł
+     *
+     */
+    bool close();
+    /** \brief Sprawdza czy sesja nagrania jest otwarta
+     *
+     * \return bool - \b True, jeśli sesja jest otwarta
+     *
+     */
+    bool isOpen();
+
+    /** \brief Dodaje klatkę do bieżącej partii
+     *
+     * \param frame const frameHandle& - klatka (uchwyt musi istnieć do wywołania \c flush())
+     * \return bool - \b True, jeśli klatkę dodano (\b False przy błędzie zmiany segmentu)
+     *
+     */
+    bool append( const frameHandle& frame );
+    /** \brief Zapisuje bieżącą partię klatek do pliku
+     *
+     * \return bool - \b True, jeśli zapis się powiódł
+     *
+     */
+    bool flush();
+    /** \brief Synchronizuje bieżący segment z dyskiem (\c fdatasync())
+     *
+     * \return bool - \b True, jeśli synchronizacja się powiodła
+     *
+     */
+    bool sync();
+    /** \brief Zwraca i zeruje liczbę dodanych klatek, których nie udało się zapisać
+     *
+     * Klatki z partii, której zapis się nie powiódł (również przy zmianie segmentu
+     * wewnątrz \c append()), są usuwane z indeksu, a nagrywanie trwa dalej.
+     *
+     * \return unsigned long long - liczba utraconych klatek od poprzedniego wywołania
+     *
+     */
+    unsigned long long takeLostFrames();
+
+    /** \brief Ustawia limity rozmiaru i czasu trwania segmentu
+     *
+     * \param maxSegmentSize_bytes long long - największy rozmiar segmentu (0 - bez limitu)
+     * \param maxSegmentDuration_ms long long - najdłuższy czas trwania segmentu (0 - bez limitu)
+     * \return void
+     *
+     */
+    void setSegmentLimits( long long maxSegmentSize_bytes, long long maxSegmentDuration_ms );
+
+private:
+    std::string my_directory, my_prefix;/**< położenie i nazwy segmentów */
+    int my_file;/**< deskryptor bieżącego segmentu */
+    int my_segmentNumber;/**< numer bieżącego segmentu */
+    long long my_segmentSize;/**< rozmiar bieżącego segmentu (wraz z niezapisaną partią) */
+    long long my_writtenSize;/**< rozmiar bieżącego segmentu potwierdzony zapisem (koniec ostatniej zapisanej klatki) */
+    long long my_segmentStart_us;/**< chwila odebrania pierwszej klatki segmentu */
+    long long my_maxSegmentSize, my_maxSegmentDuration_us;/**< limity segmentu */
+    unsigned long long my_lostFrames;/**< klatki utracone przez nieudany zapis (patrz \c takeLostFrames()) */
+    frameLogFileHeader my_fileHeader;/**< nagłówek zapisywany na początku każdego segmentu */
+
+    std::vector<frameLogIndexEntry> my_index;/**< indeks bieżącego segmentu */
+    std::vector<frameLogRecordHeader> my_pendingHeaders;/**< nagłówki klatek bieżącej partii */
+    std::vector<frameHandle> my_pendingFrames;/**< klatki bieżącej partii */
+    std::vector<struct iovec> my_iovecs;/**< bufor opisów danych dla \c writev() */
+
+    bool openSegment();/**< \brief Tworzy kolejny segment i zapisuje jego nagłówek */
+    bool closeSegment();/**< \brief Zapisuje indeks i stopkę, zamyka segment */
+    bool writeVector( struct iovec* vectors, int count );/**< \brief Zapisuje całą tablicę \c iovec */
+    bool discardPending();/**< \brief Usuwa niezapisaną partię z indeksu i obcina segment do potwierdzonego rozmiaru */
+
+    frameLogWriter( const frameLogWriter& );
+    frameLogWriter& operator=( const frameLogWriter& );
+};
+
+/** \brief Widok pojedynczej klatki z dziennika klatek
+ *
+ * Wskaźnik \c data wskazuje bezpośrednio na dane w pliku odwzorowanym w pamięci
+ * i jest ważny do zamknięcia obiektu \c frameLogReader.
+ */
+struct frameLogFrame
+{
+    const unsigned char* data;/**< dane klatki (JPEG) */
+    int length;/**< długość danych w bajtach */
+    int width, height;/**< rozmiar obrazu */
+    unsigned long long sequence;/**< numer kolejny klatki */
+    long long timestamp_us;/**< chwila odebrania klatki podczas nagrania (czas monotoniczny) */
+};
+
+/** \brief Odczyt nagranej sesji z dziennika klatek
+ *
+ * Wszystkie segmenty sesji odwzorowywane są w pamięci (\c mmap()), a ich
+ * indeksy łączone w jeden indeks sesji - dostęp do klatki o zadanym numerze
+ * zajmuje czas O(1), a wyszukanie klatki po czasie odbioru O(log n). Dane
+ * klatek nie są kopiowane. Segmenty bez stopki (np. po przerwanym nagraniu)
+ * indeksowane są przez przejście po nagłówkach klatek.
+ */
+class frameLogReader
+{
+public:
+    /** \brief Konstruktor klasy \c frameLogReader
+     *
+     *
+     */
+    frameLogReader();
+    /** \brief Destruktor klasy \c frameLogReader - zamyka sesję
+     *
+     *
+     */
+    ~frameLogReader();
+
+    /** \brief Otwiera nagraną sesję
+     *
+     * \param path const std::string& - ścieżka pojedynczego segmentu (\c .flog) lub początek
+     * nazw segmentów sesji (np. \c "video_record/frames_20170315-101500")
+     * \return bool - \b True, jeśli otwarto co najmniej jeden poprawny segment
+     *
+     */
+    bool open( const std::string& path );
+    /** \brief Zamyka sesję i zwalnia odwzorowania plików
+     *
+     * \return void
+     *
+     */
+    void close();
+
+    /** \brief Zwraca liczbę klatek w sesji
+     *
+     * \return int - liczba klatek
+     *
+     */
+    int getFrameCount() const;
+    /** \brief Zwraca klatkę o zadanym numerze (kolejność nagrania)
+     *
+     * \param index int - numer klatki od \c 0 do \c getFrameCount()-1
+     * \param frame frameLogFrame& - widok klatki
+     * \return bool - \b True, jeśli klatka istnieje
+     *
+     */
+    bool getFrame( int index, frameLogFrame& frame ) const;
+    /** \brief Wyszukuje ostatnią klatkę odebraną nie później niż w zadanej chwili
+     *
+     * \param timestamp_us long long - chwila (czas monotoniczny nagrania)
+     * \return int - numer klatki lub \c -1, jeśli wszystkie klatki są późniejsze
+     *
+     */
+    int findFrameByTimestamp( long long timestamp_us ) const;
+
+private:
+    /** \brief Odwzorowany w pamięci segment */
+    struct segment
+    {
+        const unsigned char* base;/**< początek odwzorowania */
+        size_t size;/**< rozmiar pliku */
+    };
+
+    /** \brief Wpis indeksu sesji */
+    struct entry
+    {
+        const unsigned char* record;/**< nagłówek klatki w odwzorowaniu */
+        long long timestamp_us;/**< chwila odebrania klatki */
+    };
+
+    std::vector<segment> my_segments;/**< segmenty sesji */
+    std::vector<entry> my_entries;/**< indeks sesji */
+
+    bool openSegment( const std::string& filename );/**< \brief Odwzorowuje segment i dołącza jego indeks */
+    bool readIndex( const segment& seg );/**< \brief Odczytuje indeks zapisany w segmencie */
+    void scanRecords( const segment& seg );/**< \brief Odtwarza indeks segmentu z nagłówków klatek */
+
+    frameLogReader( const frameLogReader& );
+    frameLogReader& operator=( const frameLogReader& );
+};
+
+#endif // FRAMELOG_H_INCLUDED
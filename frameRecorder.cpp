@@ -0,0 +1,298 @@
+#include "frameRecorder.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool writeAll( int file, const unsigned char* data, size_t length )
+{
+    while( length > 0 )
+    {
+        ssize_t written = write( file, data, length );
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+frameRecorder::frameRecorder( rcuList<frameSubscriber*>* source ) :
+    my_source( source ), my_subscriber( NULL ),
+    my_directory( "video_record" ), my_queueCapacity( 64 ), my_batchInterval_ms( 50 ),
+    my_syncPolicy( SYNC_NONE ), my_recordMode( MODE_JPEG_FILES ), my_frameNumber( 0 ), my_lastDroppedCount( 0 ),
+    my_alignedBuffer( NULL ), my_alignedBufferSize( 0 ),
+    my_isRecording( false ), my_writtenFrames( 0 ), my_droppedFrames( 0 ), my_writeErrors( 0 ),
+    my_functor_thread_write( this, &frameRecorder::thread_write )
+{
+
+}
+
+frameRecorder::~frameRecorder()
+{
+    stop();
+    free( my_alignedBuffer );
+}
+
+bool frameRecorder::start()
+{
+    if( my_isRecording )
+        return true;
+    if( !prepareDirectory() )
+        return false;
+    if( my_recordMode == MODE_FRAME_LOG )
+    {
+        char prefix[64];
+        time_t now = time( NULL );
+        strftime( prefix, sizeof( prefix ), "frames_%Y%m%d-%H%M%S", localtime( &now ));
+        if( !my_frameLog.open( my_directory, prefix ))
+            return false;
+    }
+
+    my_subscriber = new frameSubscriber( my_queueCapacity, frameSubscriber::DROP_NEWEST );
+    my_lastDroppedCount = 0;
+    my_batch.reserve( my_queueCapacity );
+    my_isRecording = true;
+    my_thread_write.create( &my_functor_thread_write );
+    my_source->add( my_subscriber );
+    return true;
+}
+
+void frameRecorder::stop()
+{
+    if( !my_isRecording )
+        return;
+
+    // Detach from the stream first, then let the writer flush what is queued
+    my_source->remove( my_subscriber );
+    my_isRecording = false;
+    my_thread_write.join();
+
+    delete my_subscriber;
+    my_subscriber = NULL;
+}
+
+bool frameRecorder::isRecording()
+{
+    return my_isRecording;
+}
+
+bool frameRecorder::prepareDirectory()
+{
+    // Create every missing component of the path
+    for( size_t i = 1; i <= my_directory.size(); i++ )
+    {
+        if( i < my_directory.size() && my_directory[i] != '/' )
+            continue;
+        std::string component = my_directory.substr( 0, i );
+        if( mkdir( component.c_str(), 0755 ) != 0 && errno != EEXIST )
+        {
+            printf("frameRecorder: could not create directory %s: %s\n",
+                   component.c_str(), strerror( errno ));
+            fflush(stdout);
+            return false;
+        }
+    }
+
+    // Continue numbering after the frames already present in the directory
+    DIR* directory = opendir( my_directory.c_str() );
+    if( directory == NULL )
+        return false;
+
+    my_frameNumber = 0;
+    struct dirent* entry;
+    while( ( entry = readdir( directory ) ) != NULL )
+    {
+        char* end;
+        long number = strtol( entry->d_name, &end, 10 );
+        if( end != entry->d_name && strcmp( end, ".jpg" ) == 0 && number >= my_frameNumber )
+            my_frameNumber = (int) number + 1;
+    }
+    closedir( directory );
+    return true;
+}
+
+void frameRecorder::thread_write()
+{
+    while( my_isRecording )
+    {
+        writeBatch();
+        ArUtil::sleep( my_batchInterval_ms );
+    }
+    // Flush the frames queued before the recorder was detached
+    writeBatch();
+    if( my_frameLog.isOpen() && !my_frameLog.close() )
+        my_writeErrors++;
+}
+
+void frameRecorder::writeBatch()
+{
+    frameHandle frame;
+    while( my_subscriber->tryPop( frame ) )
+        my_batch.push_back( frame );
+
+    if( my_recordMode == MODE_FRAME_LOG )
+        writeBatchToLog();
+
+    for( std::vector<frameHandle>::iterator it = my_batch.begin(); it != my_batch.end(); ++it )
+    {
+        if( !writeFrame( *it ) )
+            my_writeErrors++;
+        else if( my_syncPolicy == SYNC_NONE )
+            my_writtenFrames++;
+    }
+    my_batch.clear();
+
+    // One file per frame - a frame counts as written only once its file reached the disk
+    for( std::vector<int>::iterator file = my_openFiles.begin(); file != my_openFiles.end(); ++file )
+    {
+        bool synced = fdatasync( *file ) == 0;
+        if( close( *file ) == 0 && synced )
+            my_writtenFrames++;
+        else
+            my_writeErrors++;
+    }
+    my_openFiles.clear();
+
+    unsigned long long dropped = my_subscriber->getDroppedCount();
+    my_droppedFrames += dropped - my_lastDroppedCount;
+    my_lastDroppedCount = dropped;
+}
+
+void frameRecorder::writeBatchToLog()
+{
+    if( my_batch.empty() )
+        return;
+
+    unsigned long long appended = 0;
+    for( std::vector<frameHandle>::iterator it = my_batch.begin(); it != my_batch.end(); ++it )
+    {
+        if( my_frameLog.append( *it ))
+            appended++;
+    }
+    bool written = my_frameLog.flush();
+    if( written && my_syncPolicy != SYNC_NONE )
+        written = my_frameLog.sync();
+
+    // Frames appended before a failed write inside append() (segment change) are lost too
+    unsigned long long lost = my_frameLog.takeLostFrames();
+    if( written )
+    {
+        my_writtenFrames += appended - lost;
+        my_writeErrors += my_batch.size() - appended + lost;
+    }
+    else
+        my_writeErrors += my_batch.size();
+    my_batch.clear();
+}
+
+bool frameRecorder::writeFrame( const frameHandle& frame )
+{
+    char filename[4096];
+    snprintf( filename, sizeof( filename ), "%s/%010d.jpg", my_directory.c_str(), my_frameNumber );
+
+    bool direct = false;
+    int file = -1;
+    if( my_syncPolicy == SYNC_DIRECT )
+    {
+        file = open( filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644 );
+        direct = file >= 0;
+    }
+    // Some file systems (e.g. tmpfs) do not support O_DIRECT
+    if( file < 0 )
+        file = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( file < 0 )
+        return false;
+    my_frameNumber++;
+
+    bool written = direct ? writeDirect( file, frame )
+                          : writeAll( file, frame->getData(), frame->getLength() );
+
+    if( !written || my_syncPolicy == SYNC_NONE )
+    {
+        bool closed = close( file ) == 0;
+        return written && closed;
+    }
+    // Counted by writeBatch() after fdatasync()
+    my_openFiles.push_back( file );
+    return true;
+}
+
+bool frameRecorder::writeDirect( int file, const frameHandle& frame )
+{
+    // O_DIRECT requires block-aligned buffers and lengths - write a padded
+    // copy and cut the file back to the real length afterwards.
+    const int ALIGNMENT = 4096;
+    int length = frame->getLength();
+    int paddedLength = ( length + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT;
+    if( paddedLength > my_alignedBufferSize )
+    {
+        free( my_alignedBuffer );
+        my_alignedBuffer = NULL;
+        my_alignedBufferSize = 0;
+        void* buffer;
+        if( posix_memalign( &buffer, ALIGNMENT, paddedLength ) != 0 )
+            return false;
+        my_alignedBuffer = (unsigned char*) buffer;
+        my_alignedBufferSize = paddedLength;
+    }
+    memcpy( my_alignedBuffer, frame->getData(), length );
+    memset( my_alignedBuffer + length, 0, paddedLength - length );
+
+    return writeAll( file, my_alignedBuffer, paddedLength ) && ftruncate( file, length ) == 0;
+}
+
+void frameRecorder::setDirectory( const std::string& directory )
+{
+    my_directory = directory;
+}
+
+void frameRecorder::setRecordMode( recordMode mode )
+{
+    my_recordMode = mode;
+}
+
+void frameRecorder::setSegmentLimits( long long maxSegmentSize_bytes, long long maxSegmentDuration_ms )
+{
+    my_frameLog.setSegmentLimits( maxSegmentSize_bytes, maxSegmentDuration_ms );
+}
+
+void frameRecorder::setQueueCapacity( int capacity )
+{
+    my_queueCapacity = capacity;
+}
+
+void frameRecorder::setSyncPolicy( syncPolicy policy )
+{
+    my_syncPolicy = policy;
+}
+
+void frameRecorder::setBatchInterval( int interval_ms )
+{
+    my_batchInterval_ms = interval_ms;
+}
+
+unsigned long long frameRecorder::getWrittenFramesCount()
+{
+    return my_writtenFrames.load();
+}
+
+unsigned long long frameRecorder::getDroppedFramesCount()
+{
+    return my_droppedFrames.load();
+}
+
+unsigned long long frameRecorder::getWriteErrorsCount()
+{
+    return my_writeErrors.load();
+}
@@ -0,0 +1,187 @@
+#ifndef FRAMERECORDER_H_INCLUDED
+#define FRAMERECORDER_H_INCLUDED
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Aria.h"
+
+#include "frameLog.h"
+#include "frameSubscriber.h"
+#include "rcuList.h"
+
+/** \brief Zapis strumienia klatek z kamery na dysk w osobnym wątku
+ *
+ * Rejestrator subskrybuje strumień klatek (kolejka z polityką
+ * \c frameSubscriber::DROP_NEWEST), więc wątek odbierający dane z serwera
+ * jedynie przekazuje uchwyt do klatki. Zapis odbywa się we własnym wątku,
+ * partiami - wszystkie klatki zgromadzone w kolejce zapisywane są w jednym
+ * przebiegu, a ewentualna synchronizacja z dyskiem wykonywana jest raz na
+ * partię. Gdy dysk nie nadąża, nowe klatki są odrzucane i zliczane.
+ *
+ * Rejestrator działa w jednym z dwóch trybów:
+ * \li \c MODE_JPEG_FILES - każda klatka zapisywana jest do osobnego pliku \c .jpg;
+ * numeracja plików kontynuuje numerację plików już znajdujących się w folderze
+ * \li \c MODE_FRAME_LOG - klatki dopisywane są do segmentowanego dziennika klatek
+ * (patrz \c frameLogWriter) - jeden plik na segment zamiast tysięcy małych plików
+ *
+ * Pliki zapisywane są w zadanym folderze (domyślnie \c "video_record/"), który
+ * jest tworzony, jeśli nie istnieje.
+ *
+ * Ustawienia rejestratora można zmieniać tylko wtedy, gdy nie trwa nagrywanie.
+ */
+class frameRecorder
+{
+public:
+    /** \brief Sposób synchronizacji zapisu z dyskiem */
+    enum syncPolicy
+    {
+        SYNC_NONE,/**< bez synchronizacji - dane trafiają na dysk w tempie systemu operacyjnego */
+        SYNC_BATCH,/**< \c fdatasync() po każdej partii klatek */
+        SYNC_DIRECT/**< zapis z pominięciem pamięci podręcznej (\c O_DIRECT) oraz \c fdatasync() po każdej partii;
+                         w trybie \c MODE_FRAME_LOG równoważne \c SYNC_BATCH */
+    };
+
+    /** \brief Sposób zapisu klatek */
+    enum recordMode
+    {
+        MODE_JPEG_FILES,/**< każda klatka w osobnym pliku \c .jpg */
+        MODE_FRAME_LOG/**< klatki w segmentowanym dzienniku klatek (pliki \c .flog) */
+    };
+
+    /** \brief Konstruktor klasy \c frameRecorder
+     *
+     * \param source rcuList<frameSubscriber*>* - lista subskrybentów strumienia klatek, do której dołącza się rejestrator
+     *
+     */
+    frameRecorder( rcuList<frameSubscriber*>* source );
+    /** \brief Destruktor klasy \c frameRecorder - kończy nagrywanie
+     *
+     *
+     */
+    ~frameRecorder();
+
+    /** \brief Rozpoczyna nagrywanie
+     *
+     * \return bool - \b True, jeśli nagrywanie rozpoczęto (\b False, gdy nie udało się utworzyć folderu)
+     *
+     */
+    bool start();
+    /** \brief Kończy nagrywanie - zapisuje klatki pozostałe w kolejce i zatrzymuje wątek zapisu
+     *
+     * \return void
+     *
+     */
+    void stop();
+    /** \brief Sprawdza czy trwa nagrywanie
+     *
+     * \return bool - \b True, jeśli trwa nagrywanie
+     *
+     */
+    bool isRecording();
+
+    /** \brief Ustawia folder, do którego zapisywane są klatki
+     *
+     * \param directory const std::string& - ścieżka folderu
+     * \return void
+     *
+     */
+    void setDirectory( const std::string& directory );
+    /** \brief Ustawia sposób zapisu klatek
+     *
+     * \param mode recordMode - sposób zapisu
+     * \return void
+     *
+     */
+    void setRecordMode( recordMode mode );
+    /** \brief Ustawia limity segmentu dziennika klatek (tryb \c MODE_FRAME_LOG)
+     *
+     * Po przekroczeniu któregokolwiek z limitów rozpoczynany jest nowy segment.
+     *
+     * \param maxSegmentSize_bytes long long - największy rozmiar segmentu (0 - bez limitu, domyślnie 1 GB)
+     * \param maxSegmentDuration_ms long long - najdłuższy czas trwania segmentu (0 - bez limitu)
+     * \return void
+     *
+     */
+    void setSegmentLimits( long long maxSegmentSize_bytes, long long maxSegmentDuration_ms );
+    /** \brief Ustawia pojemność kolejki klatek oczekujących na zapis
+     *
+     * \param capacity int - liczba klatek
+     * \return void
+     *
+     */
+    void setQueueCapacity( int capacity );
+    /** \brief Ustawia sposób synchronizacji zapisu z dyskiem
+     *
+     * \param policy syncPolicy - sposób synchronizacji
+     * \return void
+     *
+     */
+    void setSyncPolicy( syncPolicy policy );
+    /** \brief Ustawia odstęp czasowy pomiędzy kolejnymi partiami zapisu
+     *
+     * \param interval_ms int - odstęp w \c ms
+     * \return void
+     *
+     */
+    void setBatchInterval( int interval_ms );
+
+    /** \brief Zwraca liczbę zapisanych klatek
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getWrittenFramesCount();
+    /** \brief Zwraca liczbę klatek odrzuconych, bo zapis nie nadążał
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getDroppedFramesCount();
+    /** \brief Zwraca liczbę klatek, których zapis się nie powiódł
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getWriteErrorsCount();
+
+private:
+    rcuList<frameSubscriber*>* my_source;/**< lista subskrybentów strumienia klatek */
+    frameSubscriber* my_subscriber;/**< kolejka klatek oczekujących na zapis */
+
+    std::string my_directory;/**< folder, do którego zapisywane są klatki */
+    int my_queueCapacity, my_batchInterval_ms;/**< ustawienia kolejki i zapisu */
+    syncPolicy my_syncPolicy;/**< sposób synchronizacji zapisu z dyskiem */
+    recordMode my_recordMode;/**< sposób zapisu klatek */
+    frameLogWriter my_frameLog;/**< dziennik klatek (tryb \c MODE_FRAME_LOG) */
+
+    int my_frameNumber;/**< numer kolejnego pliku */
+    unsigned long long my_lastDroppedCount;/**< liczba odrzuconych klatek przy poprzedniej partii */
+    std::vector<frameHandle> my_batch;/**< bieżąca partia klatek */
+    std::vector<int> my_openFiles;/**< pliki bieżącej partii czekające na synchronizację */
+    unsigned char* my_alignedBuffer;/**< bufor wyrównany do zapisu z \c O_DIRECT */
+    int my_alignedBufferSize;/**< rozmiar bufora \c my_alignedBuffer */
+
+    std::atomic<bool> my_isRecording;/**< stan nagrywania */
+    std::atomic<unsigned long long> my_writtenFrames, my_droppedFrames, my_writeErrors;/**< statystyki zapisu */
+
+    ArThread my_thread_write;/**< handler wątku zapisu */
+
+    bool prepareDirectory();/**< \brief Tworzy folder i wyznacza numer pierwszego pliku */
+    void writeBatch();/**< \brief Zapisuje wszystkie klatki z kolejki */
+    void writeBatchToLog();/**< \brief Dopisuje bieżącą partię do dziennika klatek */
+    bool writeFrame( const frameHandle& frame );/**< \brief Zapisuje pojedynczą klatkę do pliku (przy synchronizacji plik czeka w \c my_openFiles) */
+    bool writeDirect( int file, const frameHandle& frame );/**< \brief Zapisuje klatkę z użyciem \c O_DIRECT */
+
+    // CALLBACKS FUNCTIONS
+    void thread_write(void);/**< wątek zapisu */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<frameRecorder> my_functor_thread_write;/**< functor do metody \c thread_write() */
+
+    frameRecorder( const frameRecorder& );
+    frameRecorder& operator=( const frameRecorder& );
+};
+
+#endif // FRAMERECORDER_H_INCLUDED
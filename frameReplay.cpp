@@ -0,0 +1,93 @@
+#include "frameReplay.h"
+#include "clientUtil.h"
+
+frameReplay::frameReplay( ArFunctor1<const frameLogFrame*>* sink ) :
+    my_sink( sink ), my_pace( PACE_REALTIME ), my_loop( false ), my_speed( 1.0 ),
+    my_threadStarted( false ), my_isRunning( false ), my_stopRequested( false ), my_replayedFrames( 0 ),
+    my_functor_thread_replay( this, &frameReplay::thread_replay )
+{
+
+}
+
+frameReplay::~frameReplay()
+{
+    stop();
+}
+
+bool frameReplay::start( const std::string& path, pace replayPace, bool loop, double speed )
+{
+    stop();
+    if( !my_reader.open( path ) || my_reader.getFrameCount() == 0 )
+        return false;
+
+    my_pace = replayPace;
+    my_loop = loop;
+    my_speed = speed > 0 ? speed : 1.0;
+    my_stopRequested = false;
+    my_isRunning = true;
+    my_threadStarted = true;
+    my_thread_replay.create( &my_functor_thread_replay );
+    return true;
+}
+
+void frameReplay::stop()
+{
+    if( !my_threadStarted )
+        return;
+
+    my_stopRequested = true;
+    my_thread_replay.join();
+    my_threadStarted = false;
+    my_isRunning = false;
+    my_reader.close();
+}
+
+bool frameReplay::isRunning()
+{
+    return my_isRunning;
+}
+
+unsigned long long frameReplay::getReplayedFramesCount()
+{
+    return my_replayedFrames.load();
+}
+
+void frameReplay::thread_replay()
+{
+    frameLogFrame frame;
+    do
+    {
+        my_reader.getFrame( 0, frame );
+        long long firstTimestamp_us = frame.timestamp_us;
+        long long start_us = clientUtil::monotonicTime_us();
+
+        for( int i = 0; i < my_reader.getFrameCount() && !my_stopRequested; i++ )
+        {
+            my_reader.getFrame( i, frame );
+            if( my_pace == PACE_REALTIME &&
+                    !waitUntil( start_us + (long long) (( frame.timestamp_us - firstTimestamp_us ) / my_speed )))
+                break;
+            my_sink->invoke( &frame );
+            my_replayedFrames++;
+        }
+    }
+    while( my_loop && !my_stopRequested );
+
+    my_isRunning = false;
+}
+
+bool frameReplay::waitUntil( long long deadline_us )
+{
+    // Sleep in short slices so that stop() does not wait for long gaps in
+    // the recording
+    const long long SLICE_us = 100000;
+    long long now_us = clientUtil::monotonicTime_us();
+    while( now_us < deadline_us )
+    {
+        if( my_stopRequested )
+            return false;
+        clientUtil::sleepUntil_us( deadline_us - now_us > SLICE_us ? now_us + SLICE_us : deadline_us );
+        now_us = clientUtil::monotonicTime_us();
+    }
+    return true;
+}
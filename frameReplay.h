@@ -0,0 +1,97 @@
+#ifndef FRAMEREPLAY_H_INCLUDED
+#define FRAMEREPLAY_H_INCLUDED
+
+#include <atomic>
+#include <string>
+
+#include "Aria.h"
+
+#include "frameLog.h"
+
+/** \brief Odtwarzanie nagranej sesji z dziennika klatek
+ *
+ * Klasa odczytuje nagranie (patrz \c frameLogReader) i we własnym wątku
+ * przekazuje kolejne klatki do zadanego odbiorcy (\c functor z argumentem
+ * \c const \c frameLogFrame*). Klatki mogą być odtwarzane w tempie nagrania
+ * (opcjonalnie przyspieszonym) lub tak szybko, jak odbiorca je przyjmuje, co
+ * pozwala testować i porównywać algorytmy wizyjne bez robota i bez sieci.
+ */
+class frameReplay
+{
+public:
+    /** \brief Tempo odtwarzania */
+    enum pace
+    {
+        PACE_REALTIME,/**< odstępy pomiędzy klatkami takie jak podczas nagrania (podzielone przez \c speed) */
+        PACE_AS_FAST_AS_POSSIBLE/**< kolejna klatka zaraz po przekazaniu poprzedniej */
+    };
+
+    /** \brief Konstruktor klasy \c frameReplay
+     *
+     * \param sink ArFunctor1<const frameLogFrame*>* - odbiorca odtwarzanych klatek
+     *
+     */
+    frameReplay( ArFunctor1<const frameLogFrame*>* sink );
+    /** \brief Destruktor klasy \c frameReplay - zatrzymuje odtwarzanie
+     *
+     *
+     */
+    ~frameReplay();
+
+    /** \brief Rozpoczyna odtwarzanie nagrania
+     *
+     * \param path const std::string& - nagranie (patrz \c frameLogReader::open())
+     * \param replayPace pace - tempo odtwarzania
+     * \param loop bool - \b True, jeśli po ostatniej klatce odtwarzanie ma zacząć się od początku
+     * \param speed double - mnożnik tempa dla \c PACE_REALTIME
+     * \return bool - \b True, jeśli udało się otworzyć nagranie
+     *
+     */
+    bool start( const std::string& path, pace replayPace = PACE_REALTIME,
+                bool loop = false, double speed = 1.0 );
+    /** \brief Zatrzymuje odtwarzanie
+     *
+     * \return void
+     *
+     */
+    void stop();
+    /** \brief Sprawdza czy trwa odtwarzanie
+     *
+     * \return bool - \b True, jeśli wątek odtwarzania przekazuje klatki
+     *
+     */
+    bool isRunning();
+    /** \brief Zwraca liczbę klatek przekazanych odbiorcy
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getReplayedFramesCount();
+
+private:
+    ArFunctor1<const frameLogFrame*>* my_sink;/**< odbiorca klatek */
+    frameLogReader my_reader;/**< odtwarzane nagranie */
+
+    pace my_pace;/**< tempo odtwarzania */
+    bool my_loop;/**< odtwarzanie w pętli */
+    double my_speed;/**< mnożnik tempa */
+
+    bool my_threadStarted;/**< wątek odtwarzania został uruchomiony i nie został jeszcze dołączony */
+    std::atomic<bool> my_isRunning, my_stopRequested;/**< stan odtwarzania */
+    std::atomic<unsigned long long> my_replayedFrames;/**< liczba przekazanych klatek */
+
+    ArThread my_thread_replay;/**< handler wątku odtwarzania */
+
+    bool waitUntil( long long deadline_us );/**< \brief Czeka do zadanej chwili; \b False, gdy zażądano zatrzymania */
+
+    // CALLBACKS FUNCTIONS
+    void thread_replay(void);/**< wątek odtwarzania */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<frameReplay> my_functor_thread_replay;/**< functor do metody \c thread_replay() */
+
+    frameReplay( const frameReplay& );
+    frameReplay& operator=( const frameReplay& );
+};
+
+#endif // FRAMEREPLAY_H_INCLUDED
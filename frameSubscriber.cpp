@@ -0,0 +1,120 @@
+#include "frameSubscriber.h"
+#include "clientUtil.h"
+
+#include "Aria.h"
+
+frameSubscriber::frameSubscriber( int capacity, dropPolicy policy, int decimation ) :
+    my_capacity( capacity > 0 ? capacity : 1 ), my_policy( policy ),
+    my_decimation( decimation > 0 ? decimation : 1 ), my_blockTimeout_ms( 100 ),
+    my_slots( new std::atomic<frameBuffer*>[my_capacity] ),
+    my_head( 0 ), my_tail( 0 ), my_offeredCount( 0 ),
+    my_deliveredCount( 0 ), my_droppedCount( 0 )
+{
+    for( int i = 0; i < my_capacity; i++ )
+        my_slots[i].store( NULL );
+}
+
+frameSubscriber::~frameSubscriber()
+{
+    frameHandle frame;
+    while( tryPop( frame ) )
+        frame.reset();
+    delete[] my_slots;
+}
+
+bool frameSubscriber::push( frameBuffer* frame, bool mayWait )
+{
+    if( my_offeredCount++ % my_decimation != 0 )
+        return false;
+
+    unsigned long long head = my_head.load( std::memory_order_relaxed );
+    unsigned long long tail = my_tail.load( std::memory_order_acquire );
+    if( head - tail >= (unsigned long long) my_capacity )
+    {
+        switch( my_policy )
+        {
+        case DROP_OLDEST:
+            // Advance the consumer's index ourselves - if the consumer wins the
+            // race instead, a slot has been freed anyway.
+            if( my_tail.compare_exchange_strong( tail, tail + 1, std::memory_order_acq_rel ) )
+            {
+                my_slots[tail % my_capacity].load( std::memory_order_relaxed )->release();
+                my_droppedCount++;
+            }
+            break;
+
+        case BLOCK:
+            if( mayWait && waitForSpace( head ) )
+                break;
+            // fall through - timed out or not allowed to wait
+
+        case DROP_NEWEST:
+        default:
+            my_droppedCount++;
+            return false;
+        }
+    }
+
+    frame->addRef();
+    my_slots[head % my_capacity].store( frame, std::memory_order_relaxed );
+    my_head.store( head + 1, std::memory_order_release );
+    my_deliveredCount++;
+    return true;
+}
+
+bool frameSubscriber::waitForSpace( unsigned long long head )
+{
+    long long deadline_us = clientUtil::monotonicTime_us() + my_blockTimeout_ms.load() * 1000LL;
+    while( head - my_tail.load( std::memory_order_acquire ) >= (unsigned long long) my_capacity )
+    {
+        if( clientUtil::monotonicTime_us() >= deadline_us )
+            return false;
+        ArUtil::sleep( 1 );
+    }
+    return true;
+}
+
+bool frameSubscriber::tryPop( frameHandle& frame )
+{
+    while( true )
+    {
+        unsigned long long tail = my_tail.load( std::memory_order_acquire );
+        if( tail == my_head.load( std::memory_order_acquire ) )
+            return false;
+
+        frameBuffer* item = my_slots[tail % my_capacity].load( std::memory_order_relaxed );
+        // The producer may have dropped this frame meanwhile (DROP_OLDEST) -
+        // the slot belongs to us only if we are the ones to advance the index.
+        if( my_tail.compare_exchange_strong( tail, tail + 1, std::memory_order_acq_rel ) )
+        {
+            frame = frameHandle( item, false );
+            return true;
+        }
+    }
+}
+
+void frameSubscriber::setBlockTimeout( int timeout_ms )
+{
+    my_blockTimeout_ms.store( timeout_ms );
+}
+
+int frameSubscriber::getBlockTimeout()
+{
+    return my_blockTimeout_ms.load();
+}
+
+int frameSubscriber::getQueueLength()
+{
+    unsigned long long tail = my_tail.load();
+    return (int) ( my_head.load() - tail );
+}
+
+unsigned long long frameSubscriber::getDeliveredCount()
+{
+    return my_deliveredCount.load();
+}
+
+unsigned long long frameSubscriber::getDroppedCount()
+{
+    return my_droppedCount.load();
+}
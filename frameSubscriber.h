@@ -0,0 +1,126 @@
+#ifndef FRAMESUBSCRIBER_H_INCLUDED
+#define FRAMESUBSCRIBER_H_INCLUDED
+
+#include <atomic>
+
+#include "frameBuffer.h"
+
+/** \brief Subskrypcja strumienia klatek z kamery
+ *
+ * Każdy subskrybent ma własną, ograniczoną kolejkę klatek (jeden producent -
+ * wątek odbierający dane z serwera, jeden konsument - wątek użytkownika).
+ * Dzięki temu kilku odbiorców (np. detekcja, nagrywanie, podgląd) może
+ * odbierać klatki we własnym tempie, a wolny odbiorca nie wstrzymuje odbioru
+ * danych z serwera.
+ *
+ * Gdy kolejka jest pełna, zachowanie zależy od wybranej polityki:
+ * \li \c DROP_OLDEST - najstarsza klatka w kolejce jest odrzucana
+ * \li \c DROP_NEWEST - nowa klatka jest odrzucana
+ * \li \c BLOCK - producent czeka na miejsce w kolejce, najwyżej
+ * \c getBlockTimeout() ms (potem klatka jest odrzucana); polityka przeznaczona
+ * dla odbiorców, którzy nie mogą tracić klatek. Czekają tylko producenci, którym
+ * na to pozwolono (np. odtwarzanie nagrania) - wątek odbierający dane z serwera
+ * nigdy nie czeka, bo wstrzymałby wszystkie strumienie połączenia, a przy pełnej
+ * kolejce klatka jest od razu odrzucana
+ *
+ * Subskrybent może też otrzymywać co \c n-tą klatkę strumienia (decymacja).
+ * Obiekty tej klasy tworzy i niszczy \c robotManager::cameraManager.
+ */
+class frameSubscriber
+{
+public:
+    /** \brief Zachowanie przy pełnej kolejce */
+    enum dropPolicy
+    {
+        DROP_OLDEST,/**< odrzucenie najstarszej klatki w kolejce */
+        DROP_NEWEST,/**< odrzucenie nowej klatki */
+        BLOCK/**< oczekiwanie na miejsce w kolejce */
+    };
+
+    /** \brief Konstruktor klasy \c frameSubscriber
+     *
+     * \param capacity int - pojemność kolejki (liczba klatek)
+     * \param policy dropPolicy - zachowanie przy pełnej kolejce
+     * \param decimation int - co która klatka strumienia trafia do kolejki
+     *
+     */
+    frameSubscriber( int capacity, dropPolicy policy, int decimation = 1 );
+    /** \brief Destruktor klasy \c frameSubscriber - zwalnia klatki pozostałe w kolejce
+     *
+     *
+     */
+    ~frameSubscriber();
+
+    /** \brief Pobiera najstarszą klatkę z kolejki (bez czekania)
+     *
+     * \param frame frameHandle& - uchwyt, do którego trafia pobrana klatka
+     * \return bool - \b True, jeśli pobrano klatkę; \b False, gdy kolejka jest pusta
+     *
+     */
+    bool tryPop( frameHandle& frame );
+
+    /** \brief Przekazuje klatkę do kolejki (wywoływane przez producenta)
+     *
+     * Kolejka bierze własną referencję do klatki.
+     *
+     * \param frame frameBuffer* - opublikowana klatka
+     * \param mayWait bool - \b True, jeśli producent może czekać na miejsce (polityka \c BLOCK);
+     * \b False dla wątku odbierającego dane z serwera
+     * \return bool - \b True, jeśli klatka trafiła do kolejki
+     *
+     */
+    bool push( frameBuffer* frame, bool mayWait = false );
+
+    /** \brief Ustawia maksymalny czas oczekiwania producenta przy polityce \c BLOCK
+     *
+     * \param timeout_ms int - czas w \c ms
+     * \return void
+     *
+     */
+    void setBlockTimeout( int timeout_ms );
+    /** \brief Zwraca maksymalny czas oczekiwania producenta przy polityce \c BLOCK
+     *
+     * \return int - czas w \c ms
+     *
+     */
+    int getBlockTimeout();
+
+    /** \brief Zwraca liczbę klatek oczekujących w kolejce
+     *
+     * \return int - liczba klatek
+     *
+     */
+    int getQueueLength();
+    /** \brief Zwraca liczbę klatek przekazanych do kolejki
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getDeliveredCount();
+    /** \brief Zwraca liczbę klatek odrzuconych z powodu pełnej kolejki
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getDroppedCount();
+
+private:
+    const int my_capacity;/**< pojemność kolejki */
+    const dropPolicy my_policy;/**< zachowanie przy pełnej kolejce */
+    const int my_decimation;/**< co która klatka trafia do kolejki */
+    std::atomic<int> my_blockTimeout_ms;/**< czas oczekiwania producenta przy polityce \c BLOCK */
+
+    std::atomic<frameBuffer*>* my_slots;/**< bufor cykliczny kolejki */
+    std::atomic<unsigned long long> my_head;/**< indeks zapisu (producent) */
+    std::atomic<unsigned long long> my_tail;/**< indeks odczytu (konsument; producent przy \c DROP_OLDEST) */
+
+    unsigned long long my_offeredCount;/**< liczba klatek zaproponowanych przez producenta */
+    std::atomic<unsigned long long> my_deliveredCount, my_droppedCount;/**< statystyki kolejki */
+
+    bool waitForSpace( unsigned long long head );/**< \brief Czeka na miejsce w kolejce (polityka \c BLOCK) */
+
+    frameSubscriber( const frameSubscriber& );
+    frameSubscriber& operator=( const frameSubscriber& );
+};
+
+#endif // FRAMESUBSCRIBER_H_INCLUDED
@@ -0,0 +1,111 @@
+#include "hdrHistogram.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+hdrHistogram::hdrHistogram()
+{
+    reset();
+}
+
+void hdrHistogram::record( long long value )
+{
+    if( value < 0 )
+        value = 0;
+
+    my_buckets[bucketOf( value )].fetch_add( 1, std::memory_order_relaxed );
+    my_count.fetch_add( 1, std::memory_order_relaxed );
+    my_sum.fetch_add( value, std::memory_order_relaxed );
+
+    long long current = my_min.load( std::memory_order_relaxed );
+    while( value < current && !my_min.compare_exchange_weak( current, value, std::memory_order_relaxed ))
+        ;
+    current = my_max.load( std::memory_order_relaxed );
+    while( value > current && !my_max.compare_exchange_weak( current, value, std::memory_order_relaxed ))
+        ;
+}
+
+void hdrHistogram::reset()
+{
+    for( int i = 0; i < BUCKETS; i++ )
+        my_buckets[i].store( 0, std::memory_order_relaxed );
+    my_count.store( 0, std::memory_order_relaxed );
+    my_sum.store( 0, std::memory_order_relaxed );
+    my_min.store( LLONG_MAX, std::memory_order_relaxed );
+    my_max.store( 0, std::memory_order_relaxed );
+}
+
+unsigned long long hdrHistogram::getCount() const
+{
+    return my_count.load();
+}
+
+long long hdrHistogram::getMin() const
+{
+    long long min = my_min.load();
+    return min == LLONG_MAX ? 0 : min;
+}
+
+long long hdrHistogram::getMax() const
+{
+    return my_max.load();
+}
+
+double hdrHistogram::getMean() const
+{
+    unsigned long long count = my_count.load();
+    return count == 0 ? 0.0 : (double) my_sum.load() / count;
+}
+
+long long hdrHistogram::getPercentile( double percentile ) const
+{
+    // Counted from the buckets themselves, so a concurrent record() cannot push the rank past the end
+    unsigned long long counts[BUCKETS];
+    unsigned long long total = 0;
+    for( int i = 0; i < BUCKETS; i++ )
+    {
+        counts[i] = my_buckets[i].load( std::memory_order_relaxed );
+        total += counts[i];
+    }
+    if( total == 0 )
+        return 0;
+
+    percentile = std::min( std::max( percentile, 0.0 ), 100.0 );
+    unsigned long long rank = (unsigned long long) std::ceil( percentile / 100.0 * total );
+    rank = std::max( rank, 1ULL );
+
+    unsigned long long seen = 0;
+    for( int i = 0; i < BUCKETS; i++ )
+    {
+        seen += counts[i];
+        if( seen >= rank )
+            return std::min( bucketUpperBound( i ), getMax() );
+    }
+    return getMax();
+}
+
+int hdrHistogram::bucketOf( long long value )
+{
+    if( value < SUB_BUCKETS )
+        return (int) value;
+
+    int exponent = 63 - __builtin_clzll( (unsigned long long) value );
+    if( exponent >= MAX_VALUE_BITS )
+        return BUCKETS - 1;
+    int subBucket = (int) (( value >> ( exponent - SUB_BUCKET_BITS )) & ( SUB_BUCKETS - 1 ));
+    return SUB_BUCKETS + ( exponent - SUB_BUCKET_BITS ) * SUB_BUCKETS + subBucket;
+}
+
+long long hdrHistogram::bucketUpperBound( int bucket )
+{
+    if( bucket < SUB_BUCKETS )
+        return bucket;
+    if( bucket == BUCKETS - 1 )
+        return LLONG_MAX;
+
+    int exponent = ( bucket - SUB_BUCKETS ) / SUB_BUCKETS + SUB_BUCKET_BITS;
+    long long subBucket = ( bucket - SUB_BUCKETS ) % SUB_BUCKETS;
+    long long width = 1LL << ( exponent - SUB_BUCKET_BITS );
+    return ( 1LL << exponent ) + ( subBucket + 1 ) * width - 1;
+}
@@ -0,0 +1,95 @@
+#ifndef HDRHISTOGRAM_H_INCLUDED
+#define HDRHISTOGRAM_H_INCLUDED
+
+#include <atomic>
+
+/** \brief Bezblokadowy histogram o stałej względnej dokładności (w stylu HDR)
+ *
+ * Wartości od 0 do \c SUB_BUCKETS - 1 zliczane są dokładnie, a każdy kolejny
+ * przedział [2^n, 2^(n+1)) dzielony jest na \c SUB_BUCKETS równych przegródek,
+ * więc błąd względny odczytanych percentyli nie przekracza 1/\c SUB_BUCKETS
+ * (ok. 6%) w całym zakresie - od mikrosekund do godzin lub od bajtów do
+ * gigabajtów - przy stałym rozmiarze histogramu.
+ *
+ * Zapis (\c record()) to kilka operacji atomowych bez blokad, więc histogram
+ * może być wypełniany z wątku odbierającego dane i z wielu wątków jednocześnie,
+ * a odczytywany w dowolnej chwili (odczyt w trakcie zapisu może nie uwzględniać
+ * wartości zapisywanych w tej samej chwili).
+ */
+class hdrHistogram
+{
+public:
+    enum
+    {
+        SUB_BUCKET_BITS = 4,/**< liczba bitów przegródek w przedziale potęgi dwójki */
+        SUB_BUCKETS = 1 << SUB_BUCKET_BITS,/**< liczba przegródek w przedziale potęgi dwójki */
+        MAX_VALUE_BITS = 48,/**< wartości nie mniejsze niż 2^48 trafiają do ostatniej przegródki */
+        BUCKETS = SUB_BUCKETS + ( MAX_VALUE_BITS - SUB_BUCKET_BITS ) * SUB_BUCKETS/**< liczba przegródek */
+    };
+
+    /** \brief Konstruktor klasy \c hdrHistogram
+     *
+     *
+     */
+    hdrHistogram();
+
+    /** \brief Zapisuje wartość (wartości ujemne zapisywane są jako 0)
+     *
+     * \param value long long - wartość
+     * \return void
+     *
+     */
+    void record( long long value );
+    /** \brief Zeruje histogram
+     *
+     * \return void
+     *
+     */
+    void reset();
+
+    /** \brief Zwraca liczbę zapisanych wartości
+     *
+     * \return unsigned long long - liczba wartości
+     *
+     */
+    unsigned long long getCount() const;
+    /** \brief Zwraca najmniejszą zapisaną wartość
+     *
+     * \return long long - wartość (0, jeśli histogram jest pusty)
+     *
+     */
+    long long getMin() const;
+    /** \brief Zwraca największą zapisaną wartość
+     *
+     * \return long long - wartość (0, jeśli histogram jest pusty)
+     *
+     */
+    long long getMax() const;
+    /** \brief Zwraca średnią zapisanych wartości
+     *
+     * \return double - średnia (0, jeśli histogram jest pusty)
+     *
+     */
+    double getMean() const;
+    /** \brief Zwraca percentyl zapisanych wartości
+     *
+     * \param percentile double - percentyl z zakresu [0, 100], np. 99.9
+     * \return long long - górna granica przegródki zawierającej percentyl (0, jeśli histogram jest pusty)
+     *
+     */
+    long long getPercentile( double percentile ) const;
+
+private:
+    std::atomic<unsigned long long> my_buckets[BUCKETS];/**< liczniki przegródek */
+    std::atomic<unsigned long long> my_count;/**< liczba wartości */
+    std::atomic<long long> my_sum;/**< suma wartości */
+    std::atomic<long long> my_min, my_max;/**< skrajne wartości */
+
+    static int bucketOf( long long value );/**< \brief Zwraca przegródkę wartości */
+    static long long bucketUpperBound( int bucket );/**< \brief Zwraca największą wartość przegródki */
+
+    hdrHistogram( const hdrHistogram& );
+    hdrHistogram& operator=( const hdrHistogram& );
+};
+
+#endif // HDRHISTOGRAM_H_INCLUDED
@@ -0,0 +1,550 @@
+#include "laserKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LASERKERNELS_X86
+#include <immintrin.h>
+#endif
+
+// Every implementation performs the same float operations in the same order,
+// so the results do not depend on the one selected. Fused multiply-add would
+// break that when building with -march supporting FMA.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize ("fp-contract=off")
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+static const float PI_F = 3.14159265358979f;
+static const float HALF_PI_F = 1.57079632679490f;
+static const float TWO_PI_F = 6.28318530717959f;
+
+// atan(a) for a in [0, 1], |error| < 1e-5 rad
+static const float ATAN_C1 = 0.99997726f, ATAN_C3 = -0.33262347f, ATAN_C5 = 0.19354346f,
+                   ATAN_C7 = -0.11643287f, ATAN_C9 = 0.05265332f, ATAN_C11 = -0.01172120f;
+
+// sin / cos on [-pi/4, pi/4] after reduction by multiples of pi/2 (pi/2 split in three parts)
+static const float TWO_OVER_PI = 0.636619772367581f;
+static const float REDUCE_1 = 1.5703125f, REDUCE_2 = 4.837512969970703125e-4f, REDUCE_3 = 7.54978995489188216e-8f;
+static const float SIN_C1 = -1.9515295891e-4f, SIN_C2 = 8.3321608736e-3f, SIN_C3 = -1.6666654611e-1f;
+static const float COS_C1 = 2.443315711809948e-5f, COS_C2 = -1.388731625493765e-3f, COS_C3 = 4.166664568298827e-2f;
+
+/** \brief Zestaw funkcji jednej wersji */
+struct kernelTable
+{
+    laserKernels::implementation type;
+    void (*cartesianToPolar)( const int*, const int*, int, float, float, float, float*, float* );
+    void (*polarToCartesian)( const float*, const float*, int, float*, float* );
+    void (*transform)( const float*, const float*, int, float, float, float, float, float*, float* );
+    int (*clipRange)( float*, int, float, float );
+    void (*sectorIndices)( const float*, const float*, int, int, float, float, float, int* );
+};
+
+// SCALAR
+
+static inline float atan2Scalar( float y, float x )
+{
+    float ax = fabsf( x ), ay = fabsf( y );
+    float a = std::min( ax, ay ) / std::max( std::max( ax, ay ), FLT_MIN );
+    float s = a * a;
+    float r = ( ( ( ( ( ATAN_C11 * s + ATAN_C9 ) * s + ATAN_C7 ) * s + ATAN_C5 ) * s + ATAN_C3 ) * s + ATAN_C1 ) * a;
+    if( ay > ax )
+        r = HALF_PI_F - r;
+    if( x < 0.0f )
+        r = PI_F - r;
+    return std::signbit( y ) ? -r : r;
+}
+
+static inline float wrapAngle( float angle )
+{
+    if( angle > PI_F )
+        angle -= TWO_PI_F;
+    if( angle <= -PI_F )
+        angle += TWO_PI_F;
+    return angle;
+}
+
+static inline void sinCosScalar( float angle, float* sine, float* cosine )
+{
+    int quadrant = (int) lrintf( angle * TWO_OVER_PI );
+    float q = (float) quadrant;
+    float r = ( ( angle - q * REDUCE_1 ) - q * REDUCE_2 ) - q * REDUCE_3;
+    float z = r * r;
+    float sinPoly = ( ( ( SIN_C1 * z + SIN_C2 ) * z + SIN_C3 ) * z ) * r + r;
+    float cosPoly = ( ( ( ( COS_C1 * z + COS_C2 ) * z + COS_C3 ) * z ) * z - 0.5f * z ) + 1.0f;
+
+    float s = ( quadrant & 1 ) ? cosPoly : sinPoly;
+    float c = ( quadrant & 1 ) ? sinPoly : cosPoly;
+    *sine = ( quadrant & 2 ) ? -s : s;
+    *cosine = ( ( quadrant + 1 ) & 2 ) ? -c : c;
+}
+
+static void cartesianToPolarScalar( const int* x, const int* y, int count,
+                                    float originX, float originY, float theta,
+                                    float* range, float* angle )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        float dx = (float) x[i] - originX;
+        float dy = (float) y[i] - originY;
+        range[i] = sqrtf( dx * dx + dy * dy );
+        angle[i] = wrapAngle( atan2Scalar( dy, dx ) - theta );
+    }
+}
+
+static void polarToCartesianScalar( const float* range, const float* angle, int count, float* x, float* y )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        float sine, cosine;
+        sinCosScalar( angle[i], &sine, &cosine );
+        float r = range[i];
+        x[i] = r * cosine;
+        y[i] = r * sine;
+    }
+}
+
+static void transformScalar( const float* x, const float* y, int count,
+                             float translationX, float translationY, float sine, float cosine,
+                             float* outX, float* outY )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        float px = x[i], py = y[i];
+        outX[i] = ( cosine * px - sine * py ) + translationX;
+        outY[i] = ( sine * px + cosine * py ) + translationY;
+    }
+}
+
+static int clipRangeScalar( float* range, int count, float minRange, float maxRange )
+{
+    int valid = 0;
+    for( int i = 0; i < count; i++ )
+    {
+        if( range[i] >= minRange && range[i] <= maxRange )
+            valid++;
+        else
+            range[i] = 0.0f;
+    }
+    return valid;
+}
+
+static void sectorIndicesScalar( const float* range, const float* angle, int count, int sectors,
+                                 float minAngle, float maxAngle, float scale, int* indices )
+{
+    for( int i = 0; i < count; i++ )
+    {
+        bool valid = range[i] > 0.0f && angle[i] >= minAngle && angle[i] < maxAngle;
+        indices[i] = valid ? std::min( (int)( ( angle[i] - minAngle ) * scale ), sectors - 1 ) : -1;
+    }
+}
+
+static const kernelTable scalarKernels =
+{
+    laserKernels::IMPLEMENTATION_SCALAR,
+    cartesianToPolarScalar, polarToCartesianScalar, transformScalar, clipRangeScalar, sectorIndicesScalar
+};
+
+#ifdef LASERKERNELS_X86
+
+// SSE2
+
+static inline __m128 atan2Sse2( __m128 y, __m128 x )
+{
+    const __m128 signMask = _mm_set1_ps( -0.0f );
+    __m128 ax = _mm_andnot_ps( signMask, x ), ay = _mm_andnot_ps( signMask, y );
+    __m128 a = _mm_div_ps( _mm_min_ps( ax, ay ), _mm_max_ps( _mm_max_ps( ax, ay ), _mm_set1_ps( FLT_MIN )));
+    __m128 s = _mm_mul_ps( a, a );
+    __m128 r = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( ATAN_C11 ), s ), _mm_set1_ps( ATAN_C9 ));
+    r = _mm_add_ps( _mm_mul_ps( r, s ), _mm_set1_ps( ATAN_C7 ));
+    r = _mm_add_ps( _mm_mul_ps( r, s ), _mm_set1_ps( ATAN_C5 ));
+    r = _mm_add_ps( _mm_mul_ps( r, s ), _mm_set1_ps( ATAN_C3 ));
+    r = _mm_add_ps( _mm_mul_ps( r, s ), _mm_set1_ps( ATAN_C1 ));
+    r = _mm_mul_ps( r, a );
+
+    __m128 swapped = _mm_cmpgt_ps( ay, ax );
+    r = _mm_or_ps( _mm_and_ps( swapped, _mm_sub_ps( _mm_set1_ps( HALF_PI_F ), r )), _mm_andnot_ps( swapped, r ));
+    __m128 negativeX = _mm_cmplt_ps( x, _mm_setzero_ps() );
+    r = _mm_or_ps( _mm_and_ps( negativeX, _mm_sub_ps( _mm_set1_ps( PI_F ), r )), _mm_andnot_ps( negativeX, r ));
+    return _mm_xor_ps( r, _mm_and_ps( y, signMask ));
+}
+
+static inline __m128 wrapAngleSse2( __m128 angle )
+{
+    __m128 above = _mm_cmpgt_ps( angle, _mm_set1_ps( PI_F ));
+    angle = _mm_sub_ps( angle, _mm_and_ps( above, _mm_set1_ps( TWO_PI_F )));
+    __m128 below = _mm_cmple_ps( angle, _mm_set1_ps( -PI_F ));
+    return _mm_add_ps( angle, _mm_and_ps( below, _mm_set1_ps( TWO_PI_F )));
+}
+
+static void cartesianToPolarSse2( const int* x, const int* y, int count,
+                                  float originX, float originY, float theta,
+                                  float* range, float* angle )
+{
+    int i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 dx = _mm_sub_ps( _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i*)( x + i ))), _mm_set1_ps( originX ));
+        __m128 dy = _mm_sub_ps( _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i*)( y + i ))), _mm_set1_ps( originY ));
+        _mm_storeu_ps( range + i, _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ))));
+        _mm_storeu_ps( angle + i, wrapAngleSse2( _mm_sub_ps( atan2Sse2( dy, dx ), _mm_set1_ps( theta ))));
+    }
+    cartesianToPolarScalar( x + i, y + i, count - i, originX, originY, theta, range + i, angle + i );
+}
+
+static inline void sinCosSse2( __m128 angle, __m128* sine, __m128* cosine )
+{
+    const __m128 signMask = _mm_set1_ps( -0.0f );
+    __m128i quadrant = _mm_cvtps_epi32( _mm_mul_ps( angle, _mm_set1_ps( TWO_OVER_PI )));
+    __m128 q = _mm_cvtepi32_ps( quadrant );
+    __m128 r = _mm_sub_ps( angle, _mm_mul_ps( q, _mm_set1_ps( REDUCE_1 )));
+    r = _mm_sub_ps( r, _mm_mul_ps( q, _mm_set1_ps( REDUCE_2 )));
+    r = _mm_sub_ps( r, _mm_mul_ps( q, _mm_set1_ps( REDUCE_3 )));
+    __m128 z = _mm_mul_ps( r, r );
+
+    __m128 sinPoly = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( SIN_C1 ), z ), _mm_set1_ps( SIN_C2 ));
+    sinPoly = _mm_add_ps( _mm_mul_ps( sinPoly, z ), _mm_set1_ps( SIN_C3 ));
+    sinPoly = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( sinPoly, z ), r ), r );
+    __m128 cosPoly = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( COS_C1 ), z ), _mm_set1_ps( COS_C2 ));
+    cosPoly = _mm_add_ps( _mm_mul_ps( cosPoly, z ), _mm_set1_ps( COS_C3 ));
+    cosPoly = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( cosPoly, z ), z ), _mm_mul_ps( _mm_set1_ps( 0.5f ), z ));
+    cosPoly = _mm_add_ps( cosPoly, _mm_set1_ps( 1.0f ));
+
+    const __m128i one = _mm_set1_epi32( 1 ), two = _mm_set1_epi32( 2 );
+    __m128 swap = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( quadrant, one ), one ));
+    __m128 s = _mm_or_ps( _mm_and_ps( swap, cosPoly ), _mm_andnot_ps( swap, sinPoly ));
+    __m128 c = _mm_or_ps( _mm_and_ps( swap, sinPoly ), _mm_andnot_ps( swap, cosPoly ));
+    __m128 sinSign = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( quadrant, two ), 30 ));
+    __m128 cosSign = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( _mm_add_epi32( quadrant, one ), two ), 30 ));
+    *sine = _mm_xor_ps( s, _mm_and_ps( sinSign, signMask ));
+    *cosine = _mm_xor_ps( c, _mm_and_ps( cosSign, signMask ));
+}
+
+static void polarToCartesianSse2( const float* range, const float* angle, int count, float* x, float* y )
+{
+    int i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 sine, cosine;
+        sinCosSse2( _mm_loadu_ps( angle + i ), &sine, &cosine );
+        __m128 r = _mm_loadu_ps( range + i );
+        _mm_storeu_ps( x + i, _mm_mul_ps( r, cosine ));
+        _mm_storeu_ps( y + i, _mm_mul_ps( r, sine ));
+    }
+    polarToCartesianScalar( range + i, angle + i, count - i, x + i, y + i );
+}
+
+static void transformSse2( const float* x, const float* y, int count,
+                           float translationX, float translationY, float sine, float cosine,
+                           float* outX, float* outY )
+{
+    const __m128 s = _mm_set1_ps( sine ), c = _mm_set1_ps( cosine );
+    int i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 px = _mm_loadu_ps( x + i ), py = _mm_loadu_ps( y + i );
+        __m128 rx = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( c, px ), _mm_mul_ps( s, py )), _mm_set1_ps( translationX ));
+        __m128 ry = _mm_add_ps( _mm_add_ps( _mm_mul_ps( s, px ), _mm_mul_ps( c, py )), _mm_set1_ps( translationY ));
+        _mm_storeu_ps( outX + i, rx );
+        _mm_storeu_ps( outY + i, ry );
+    }
+    transformScalar( x + i, y + i, count - i, translationX, translationY, sine, cosine, outX + i, outY + i );
+}
+
+static int clipRangeSse2( float* range, int count, float minRange, float maxRange )
+{
+    int valid = 0;
+    int i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 r = _mm_loadu_ps( range + i );
+        __m128 inside = _mm_and_ps( _mm_cmpge_ps( r, _mm_set1_ps( minRange )), _mm_cmple_ps( r, _mm_set1_ps( maxRange )));
+        _mm_storeu_ps( range + i, _mm_and_ps( inside, r ));
+        valid += __builtin_popcount( _mm_movemask_ps( inside ));
+    }
+    return valid + clipRangeScalar( range + i, count - i, minRange, maxRange );
+}
+
+static void sectorIndicesSse2( const float* range, const float* angle, int count, int sectors,
+                               float minAngle, float maxAngle, float scale, int* indices )
+{
+    int i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 a = _mm_loadu_ps( angle + i );
+        __m128 valid = _mm_and_ps( _mm_cmpgt_ps( _mm_loadu_ps( range + i ), _mm_setzero_ps() ),
+                                   _mm_and_ps( _mm_cmpge_ps( a, _mm_set1_ps( minAngle )), _mm_cmplt_ps( a, _mm_set1_ps( maxAngle ))));
+        __m128i index = _mm_cvttps_epi32( _mm_mul_ps( _mm_sub_ps( a, _mm_set1_ps( minAngle )), _mm_set1_ps( scale )));
+        // min( index, sectors - 1 ) without SSE4.1
+        __m128i last = _mm_set1_epi32( sectors - 1 );
+        __m128i over = _mm_cmpgt_epi32( index, last );
+        index = _mm_or_si128( _mm_and_si128( over, last ), _mm_andnot_si128( over, index ));
+        __m128i validMask = _mm_castps_si128( valid );
+        index = _mm_or_si128( _mm_and_si128( validMask, index ), _mm_andnot_si128( validMask, _mm_set1_epi32( -1 )));
+        _mm_storeu_si128( (__m128i*)( indices + i ), index );
+    }
+    sectorIndicesScalar( range + i, angle + i, count - i, sectors, minAngle, maxAngle, scale, indices + i );
+}
+
+static const kernelTable sse2Kernels =
+{
+    laserKernels::IMPLEMENTATION_SSE2,
+    cartesianToPolarSse2, polarToCartesianSse2, transformSse2, clipRangeSse2, sectorIndicesSse2
+};
+
+// AVX2
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET static inline __m256 atan2Avx2( __m256 y, __m256 x )
+{
+    const __m256 signMask = _mm256_set1_ps( -0.0f );
+    __m256 ax = _mm256_andnot_ps( signMask, x ), ay = _mm256_andnot_ps( signMask, y );
+    __m256 a = _mm256_div_ps( _mm256_min_ps( ax, ay ), _mm256_max_ps( _mm256_max_ps( ax, ay ), _mm256_set1_ps( FLT_MIN )));
+    __m256 s = _mm256_mul_ps( a, a );
+    __m256 r = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( ATAN_C11 ), s ), _mm256_set1_ps( ATAN_C9 ));
+    r = _mm256_add_ps( _mm256_mul_ps( r, s ), _mm256_set1_ps( ATAN_C7 ));
+    r = _mm256_add_ps( _mm256_mul_ps( r, s ), _mm256_set1_ps( ATAN_C5 ));
+    r = _mm256_add_ps( _mm256_mul_ps( r, s ), _mm256_set1_ps( ATAN_C3 ));
+    r = _mm256_add_ps( _mm256_mul_ps( r, s ), _mm256_set1_ps( ATAN_C1 ));
+    r = _mm256_mul_ps( r, a );
+
+    r = _mm256_blendv_ps( r, _mm256_sub_ps( _mm256_set1_ps( HALF_PI_F ), r ), _mm256_cmp_ps( ay, ax, _CMP_GT_OQ ));
+    r = _mm256_blendv_ps( r, _mm256_sub_ps( _mm256_set1_ps( PI_F ), r ), _mm256_cmp_ps( x, _mm256_setzero_ps(), _CMP_LT_OQ ));
+    return _mm256_xor_ps( r, _mm256_and_ps( y, signMask ));
+}
+
+AVX2_TARGET static inline __m256 wrapAngleAvx2( __m256 angle )
+{
+    __m256 above = _mm256_cmp_ps( angle, _mm256_set1_ps( PI_F ), _CMP_GT_OQ );
+    angle = _mm256_sub_ps( angle, _mm256_and_ps( above, _mm256_set1_ps( TWO_PI_F )));
+    __m256 below = _mm256_cmp_ps( angle, _mm256_set1_ps( -PI_F ), _CMP_LE_OQ );
+    return _mm256_add_ps( angle, _mm256_and_ps( below, _mm256_set1_ps( TWO_PI_F )));
+}
+
+AVX2_TARGET static void cartesianToPolarAvx2( const int* x, const int* y, int count,
+                                              float originX, float originY, float theta,
+                                              float* range, float* angle )
+{
+    int i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256 dx = _mm256_sub_ps( _mm256_cvtepi32_ps( _mm256_loadu_si256( (const __m256i*)( x + i ))), _mm256_set1_ps( originX ));
+        __m256 dy = _mm256_sub_ps( _mm256_cvtepi32_ps( _mm256_loadu_si256( (const __m256i*)( y + i ))), _mm256_set1_ps( originY ));
+        _mm256_storeu_ps( range + i, _mm256_sqrt_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ))));
+        _mm256_storeu_ps( angle + i, wrapAngleAvx2( _mm256_sub_ps( atan2Avx2( dy, dx ), _mm256_set1_ps( theta ))));
+    }
+    cartesianToPolarScalar( x + i, y + i, count - i, originX, originY, theta, range + i, angle + i );
+}
+
+AVX2_TARGET static inline void sinCosAvx2( __m256 angle, __m256* sine, __m256* cosine )
+{
+    const __m256 signMask = _mm256_set1_ps( -0.0f );
+    __m256i quadrant = _mm256_cvtps_epi32( _mm256_mul_ps( angle, _mm256_set1_ps( TWO_OVER_PI )));
+    __m256 q = _mm256_cvtepi32_ps( quadrant );
+    __m256 r = _mm256_sub_ps( angle, _mm256_mul_ps( q, _mm256_set1_ps( REDUCE_1 )));
+    r = _mm256_sub_ps( r, _mm256_mul_ps( q, _mm256_set1_ps( REDUCE_2 )));
+    r = _mm256_sub_ps( r, _mm256_mul_ps( q, _mm256_set1_ps( REDUCE_3 )));
+    __m256 z = _mm256_mul_ps( r, r );
+
+    __m256 sinPoly = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( SIN_C1 ), z ), _mm256_set1_ps( SIN_C2 ));
+    sinPoly = _mm256_add_ps( _mm256_mul_ps( sinPoly, z ), _mm256_set1_ps( SIN_C3 ));
+    sinPoly = _mm256_add_ps( _mm256_mul_ps( _mm256_mul_ps( sinPoly, z ), r ), r );
+    __m256 cosPoly = _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( COS_C1 ), z ), _mm256_set1_ps( COS_C2 ));
+    cosPoly = _mm256_add_ps( _mm256_mul_ps( cosPoly, z ), _mm256_set1_ps( COS_C3 ));
+    cosPoly = _mm256_sub_ps( _mm256_mul_ps( _mm256_mul_ps( cosPoly, z ), z ), _mm256_mul_ps( _mm256_set1_ps( 0.5f ), z ));
+    cosPoly = _mm256_add_ps( cosPoly, _mm256_set1_ps( 1.0f ));
+
+    const __m256i one = _mm256_set1_epi32( 1 ), two = _mm256_set1_epi32( 2 );
+    __m256 swap = _mm256_castsi256_ps( _mm256_cmpeq_epi32( _mm256_and_si256( quadrant, one ), one ));
+    __m256 s = _mm256_blendv_ps( sinPoly, cosPoly, swap );
+    __m256 c = _mm256_blendv_ps( cosPoly, sinPoly, swap );
+    __m256 sinSign = _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_and_si256( quadrant, two ), 30 ));
+    __m256 cosSign = _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_and_si256( _mm256_add_epi32( quadrant, one ), two ), 30 ));
+    *sine = _mm256_xor_ps( s, _mm256_and_ps( sinSign, signMask ));
+    *cosine = _mm256_xor_ps( c, _mm256_and_ps( cosSign, signMask ));
+}
+
+AVX2_TARGET static void polarToCartesianAvx2( const float* range, const float* angle, int count, float* x, float* y )
+{
+    int i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256 sine, cosine;
+        sinCosAvx2( _mm256_loadu_ps( angle + i ), &sine, &cosine );
+        __m256 r = _mm256_loadu_ps( range + i );
+        _mm256_storeu_ps( x + i, _mm256_mul_ps( r, cosine ));
+        _mm256_storeu_ps( y + i, _mm256_mul_ps( r, sine ));
+    }
+    polarToCartesianScalar( range + i, angle + i, count - i, x + i, y + i );
+}
+
+AVX2_TARGET static void transformAvx2( const float* x, const float* y, int count,
+                                       float translationX, float translationY, float sine, float cosine,
+                                       float* outX, float* outY )
+{
+    const __m256 s = _mm256_set1_ps( sine ), c = _mm256_set1_ps( cosine );
+    int i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256 px = _mm256_loadu_ps( x + i ), py = _mm256_loadu_ps( y + i );
+        __m256 rx = _mm256_add_ps( _mm256_sub_ps( _mm256_mul_ps( c, px ), _mm256_mul_ps( s, py )), _mm256_set1_ps( translationX ));
+        __m256 ry = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( s, px ), _mm256_mul_ps( c, py )), _mm256_set1_ps( translationY ));
+        _mm256_storeu_ps( outX + i, rx );
+        _mm256_storeu_ps( outY + i, ry );
+    }
+    transformScalar( x + i, y + i, count - i, translationX, translationY, sine, cosine, outX + i, outY + i );
+}
+
+AVX2_TARGET static int clipRangeAvx2( float* range, int count, float minRange, float maxRange )
+{
+    int valid = 0;
+    int i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256 r = _mm256_loadu_ps( range + i );
+        __m256 inside = _mm256_and_ps( _mm256_cmp_ps( r, _mm256_set1_ps( minRange ), _CMP_GE_OQ ),
+                                       _mm256_cmp_ps( r, _mm256_set1_ps( maxRange ), _CMP_LE_OQ ));
+        _mm256_storeu_ps( range + i, _mm256_and_ps( inside, r ));
+        valid += __builtin_popcount( _mm256_movemask_ps( inside ));
+    }
+    return valid + clipRangeScalar( range + i, count - i, minRange, maxRange );
+}
+
+AVX2_TARGET static void sectorIndicesAvx2( const float* range, const float* angle, int count, int sectors,
+                                           float minAngle, float maxAngle, float scale, int* indices )
+{
+    int i = 0;
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256 a = _mm256_loadu_ps( angle + i );
+        __m256 valid = _mm256_and_ps( _mm256_cmp_ps( _mm256_loadu_ps( range + i ), _mm256_setzero_ps(), _CMP_GT_OQ ),
+                                      _mm256_and_ps( _mm256_cmp_ps( a, _mm256_set1_ps( minAngle ), _CMP_GE_OQ ),
+                                                     _mm256_cmp_ps( a, _mm256_set1_ps( maxAngle ), _CMP_LT_OQ )));
+        __m256i index = _mm256_cvttps_epi32( _mm256_mul_ps( _mm256_sub_ps( a, _mm256_set1_ps( minAngle )), _mm256_set1_ps( scale )));
+        index = _mm256_min_epi32( index, _mm256_set1_epi32( sectors - 1 ));
+        index = _mm256_blendv_epi8( _mm256_set1_epi32( -1 ), index, _mm256_castps_si256( valid ));
+        _mm256_storeu_si256( (__m256i*)( indices + i ), index );
+    }
+    sectorIndicesScalar( range + i, angle + i, count - i, sectors, minAngle, maxAngle, scale, indices + i );
+}
+
+static const kernelTable avx2Kernels =
+{
+    laserKernels::IMPLEMENTATION_AVX2,
+    cartesianToPolarAvx2, polarToCartesianAvx2, transformAvx2, clipRangeAvx2, sectorIndicesAvx2
+};
+
+#endif // LASERKERNELS_X86
+
+static std::atomic<const kernelTable*> activeKernels( NULL );
+
+static const kernelTable* tableOf( laserKernels::implementation type )
+{
+#ifdef LASERKERNELS_X86
+    __builtin_cpu_init();
+    if( type == laserKernels::IMPLEMENTATION_AVX2 && __builtin_cpu_supports( "avx2" ))
+        return &avx2Kernels;
+    if( type == laserKernels::IMPLEMENTATION_SSE2 && __builtin_cpu_supports( "sse2" ))
+        return &sse2Kernels;
+#endif
+    if( type == laserKernels::IMPLEMENTATION_SCALAR )
+        return &scalarKernels;
+    return NULL;
+}
+
+static const kernelTable* kernels()
+{
+    const kernelTable* table = activeKernels.load( std::memory_order_acquire );
+    if( table == NULL )
+    {
+        // Select the widest supported implementation (the same one in every thread)
+        table = tableOf( laserKernels::IMPLEMENTATION_AVX2 );
+        if( table == NULL )
+            table = tableOf( laserKernels::IMPLEMENTATION_SSE2 );
+        if( table == NULL )
+            table = &scalarKernels;
+        const kernelTable* expected = NULL;
+        if( !activeKernels.compare_exchange_strong( expected, table ))
+            table = expected;
+    }
+    return table;
+}
+
+laserKernels::implementation laserKernels::getImplementation()
+{
+    return kernels()->type;
+}
+
+bool laserKernels::setImplementation( implementation selected )
+{
+    const kernelTable* table = tableOf( selected );
+    if( table == NULL )
+        return false;
+    activeKernels.store( table, std::memory_order_release );
+    return true;
+}
+
+void laserKernels::cartesianToPolar( const int* x, const int* y, int count,
+                                     double originX, double originY, double originTheta_deg,
+                                     float* range, float* angle_rad )
+{
+    kernels()->cartesianToPolar( x, y, count, (float) originX, (float) originY,
+                                 (float)( originTheta_deg * M_PI / 180.0 ), range, angle_rad );
+}
+
+void laserKernels::polarToCartesian( const float* range, const float* angle_rad, int count,
+                                     float* x, float* y )
+{
+    kernels()->polarToCartesian( range, angle_rad, count, x, y );
+}
+
+void laserKernels::transform( const float* x, const float* y, int count,
+                              double translationX, double translationY, double theta_deg,
+                              float* outX, float* outY )
+{
+    double theta = theta_deg * M_PI / 180.0;
+    kernels()->transform( x, y, count, (float) translationX, (float) translationY,
+                          (float) sin( theta ), (float) cos( theta ), outX, outY );
+}
+
+int laserKernels::clipRange( float* range, int count, float minRange, float maxRange )
+{
+    return kernels()->clipRange( range, count, minRange, maxRange );
+}
+
+void laserKernels::nearestPerSector( const float* range, const float* angle_rad, int count, int sectors,
+                                     float minAngle_rad, float maxAngle_rad, float* nearest )
+{
+    if( sectors <= 0 )
+        return;
+    for( int i = 0; i < sectors; i++ )
+        nearest[i] = FLT_MAX;
+
+    // Sector indices are computed in vectors, the scattered minimum in blocks
+    const kernelTable* table = kernels();
+    const int BLOCK = 256;
+    int indices[BLOCK];
+    float scale = sectors / ( maxAngle_rad - minAngle_rad );
+    for( int start = 0; start < count; start += BLOCK )
+    {
+        int length = std::min( BLOCK, count - start );
+        table->sectorIndices( range + start, angle_rad + start, length, sectors,
+                              minAngle_rad, maxAngle_rad, scale, indices );
+        for( int i = 0; i < length; i++ )
+        {
+            if( indices[i] >= 0 && range[start + i] < nearest[indices[i]] )
+                nearest[indices[i]] = range[start + i];
+        }
+    }
+
+    for( int i = 0; i < sectors; i++ )
+    {
+        if( nearest[i] == FLT_MAX )
+            nearest[i] = 0.0f;
+    }
+}
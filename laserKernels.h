@@ -0,0 +1,133 @@
+#ifndef LASERKERNELS_H_INCLUDED
+#define LASERKERNELS_H_INCLUDED
+
+/** \brief Przetwarzanie pomiarów z dalmierza laserowego
+ *
+ * Klasa zbiera statyczne funkcje przetwarzające całe tablice punktów pomiaru
+ * (patrz \c laserScan). Każda funkcja ma wersję skalarną oraz wersje
+ * wektorowe (SSE2, AVX2) - przy pierwszym użyciu wybierana jest najszybsza
+ * wersja obsługiwana przez procesor. Wszystkie wersje wykonują te same
+ * działania na liczbach \c float, więc dają takie same wyniki.
+ *
+ * Funkcje trygonometryczne liczone są przybliżeniami wielomianowymi: błąd
+ * kąta z \c cartesianToPolar() nie przekracza 1e-5 rad, a błąd sinusa i
+ * cosinusa w \c polarToCartesian() - 1e-6 (dla kątów z zakresu +-1000 rad).
+ *
+ * Przykład - odległość i kierunek przeszkód względem robota:
+ * \code
+ * scanHandle scan = rManager.requests->get_laserScan();
+ * std::vector<float> range( scan->getSize() ), angle( scan->getSize() );
+ * laserKernels::cartesianToPolar( scan->getX(), scan->getY(), scan->getSize(),
+ *                                 rManager.requests->get_xPosition(), rManager.requests->get_yPosition(),
+ *                                 rManager.requests->get_theta(), &range[0], &angle[0] );
+ * laserKernels::clipRange( &range[0], scan->getSize(), 100.0f, 5000.0f );
+ * float nearest[8];
+ * laserKernels::nearestPerSector( &range[0], &angle[0], scan->getSize(), 8, -M_PI / 2, M_PI / 2, nearest );
+ * \endcode
+ */
+class laserKernels
+{
+public:
+    /** \brief Wersja funkcji */
+    enum implementation
+    {
+        IMPLEMENTATION_SCALAR,/**< bez instrukcji wektorowych */
+        IMPLEMENTATION_SSE2,/**< 4 punkty naraz */
+        IMPLEMENTATION_AVX2/**< 8 punktów naraz */
+    };
+
+    /** \brief Zwraca używaną wersję funkcji
+     *
+     * \return implementation - wersja funkcji
+     *
+     */
+    static implementation getImplementation();
+    /** \brief Wymusza użycie danej wersji funkcji (np. w celu porównania wydajności)
+     *
+     * \param selected implementation - wersja funkcji
+     * \return bool - \b False, jeśli procesor nie obsługuje danej wersji (wersja nie zostaje zmieniona)
+     *
+     */
+    static bool setImplementation( implementation selected );
+
+    /** \brief Przelicza punkty na współrzędne biegunowe względem zadanego położenia
+     *
+     * \param x const int* - współrzędne \c x punktów w \c mm
+     * \param y const int* - współrzędne \c y punktów w \c mm
+     * \param count int - liczba punktów
+     * \param originX double - współrzędna \c x początku układu (np. położenia robota)
+     * \param originY double - współrzędna \c y początku układu
+     * \param originTheta_deg double - kąt obrotu układu w stopniach (np. kąt obrotu robota)
+     * \param range float* - wynikowe odległości w \c mm
+     * \param angle_rad float* - wynikowe kąty w radianach, w zakresie (-pi, pi]
+     * \return void
+     *
+     */
+    static void cartesianToPolar( const int* x, const int* y, int count,
+                                  double originX, double originY, double originTheta_deg,
+                                  float* range, float* angle_rad );
+    /** \brief Przelicza współrzędne biegunowe na kartezjańskie
+     *
+     * \param range const float* - odległości
+     * \param angle_rad const float* - kąty w radianach
+     * \param count int - liczba punktów
+     * \param x float* - wynikowe współrzędne \c x
+     * \param y float* - wynikowe współrzędne \c y
+     * \return void
+     *
+     */
+    static void polarToCartesian( const float* range, const float* angle_rad, int count,
+                                  float* x, float* y );
+    /** \brief Przekształca punkty z układu robota do układu świata
+     *
+     * Punkty są obracane o kąt \c theta_deg i przesuwane o (\c translationX, \c translationY) -
+     * dla położenia z \c updateNumbers daje to współrzędne punktów w układzie świata.
+     * Tablice wynikowe mogą być tymi samymi tablicami co wejściowe.
+     *
+     * \param x const float* - współrzędne \c x punktów
+     * \param y const float* - współrzędne \c y punktów
+     * \param count int - liczba punktów
+     * \param translationX double - przesunięcie w osi \c x (np. położenie robota)
+     * \param translationY double - przesunięcie w osi \c y
+     * \param theta_deg double - kąt obrotu w stopniach
+     * \param outX float* - wynikowe współrzędne \c x
+     * \param outY float* - wynikowe współrzędne \c y
+     * \return void
+     *
+     */
+    static void transform( const float* x, const float* y, int count,
+                           double translationX, double translationY, double theta_deg,
+                           float* outX, float* outY );
+    /** \brief Odrzuca odległości spoza zadanego zakresu
+     *
+     * Odległości mniejsze niż \c minRange lub większe niż \c maxRange zastępowane są
+     * zerem (brak pomiaru).
+     *
+     * \param range float* - odległości (modyfikowane w miejscu)
+     * \param count int - liczba punktów
+     * \param minRange float - najmniejsza poprawna odległość
+     * \param maxRange float - największa poprawna odległość
+     * \return int - liczba poprawnych odległości
+     *
+     */
+    static int clipRange( float* range, int count, float minRange, float maxRange );
+    /** \brief Wyznacza najbliższą przeszkodę w każdym z sektorów kątowych
+     *
+     * Zakres kątów [\c minAngle_rad, \c maxAngle_rad) dzielony jest na \c sectors równych
+     * sektorów. Odległości równe zero (brak pomiaru) są pomijane.
+     *
+     * \param range const float* - odległości
+     * \param angle_rad const float* - kąty w radianach
+     * \param count int - liczba punktów
+     * \param sectors int - liczba sektorów
+     * \param minAngle_rad float - początek zakresu kątów
+     * \param maxAngle_rad float - koniec zakresu kątów
+     * \param nearest float* - wynikowe najmniejsze odległości w sektorach (zero dla sektora bez pomiarów)
+     * \return void
+     *
+     */
+    static void nearestPerSector( const float* range, const float* angle_rad, int count, int sectors,
+                                  float minAngle_rad, float maxAngle_rad, float* nearest );
+};
+
+#endif // LASERKERNELS_H_INCLUDED
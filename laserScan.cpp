@@ -0,0 +1,169 @@
+#include "laserScan.h"
+
+#include <cstddef>
+#include <cstdlib>
+
+laserScan::laserScan( laserScanPool* pool ) :
+    my_refCount( 0 ), my_points( NULL ), my_capacity( 0 ), my_size( 0 ),
+    my_sequence( 0 ), my_timestamp_us( 0 ),
+    my_pool( pool ), my_next( NULL )
+{
+
+}
+
+laserScan::~laserScan()
+{
+    free( my_points );
+}
+
+bool laserScan::reserve( int points )
+{
+    if( points <= my_capacity )
+        return true;
+
+    // Round up to whole 32-byte vectors so that both arrays stay aligned
+    int capacity = ( points + 7 ) / 8 * 8;
+    void* block;
+    if( posix_memalign( &block, 32, 2 * capacity * sizeof( int )) != 0 )
+        return false;
+    free( my_points );
+    my_points = (int*) block;
+    my_capacity = capacity;
+    return true;
+}
+
+int laserScan::getSize() const
+{
+    return my_size;
+}
+
+const int* laserScan::getX() const
+{
+    return my_points;
+}
+
+const int* laserScan::getY() const
+{
+    return my_points + my_capacity;
+}
+
+int laserScan::getFirstIndex() const
+{
+    return -( my_size - 1 ) / 2;
+}
+
+unsigned long long laserScan::getSequence() const
+{
+    return my_sequence;
+}
+
+long long laserScan::getTimestamp_us() const
+{
+    return my_timestamp_us;
+}
+
+int* laserScan::getWritableX()
+{
+    return my_points;
+}
+
+int* laserScan::getWritableY()
+{
+    return my_points + my_capacity;
+}
+
+void laserScan::setScanInfo( unsigned long long sequence, long long timestamp_us )
+{
+    my_sequence = sequence;
+    my_timestamp_us = timestamp_us;
+}
+
+void laserScan::addRef()
+{
+    my_refCount.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void laserScan::release()
+{
+    if( my_refCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        my_pool->recycle( this );
+}
+
+laserScanPool::laserScanPool() :
+    my_freeList( NULL )
+{
+
+}
+
+laserScanPool::~laserScanPool()
+{
+    laserScan* scan = my_freeList.exchange( NULL );
+    while( scan )
+    {
+        laserScan* next = scan->my_next;
+        delete scan;
+        scan = next;
+    }
+}
+
+laserScan* laserScanPool::acquire( int points )
+{
+    if( points < 0 )
+        return NULL;
+
+    // Take the whole list at once - see framePool::acquire()
+    laserScan* scan = my_freeList.exchange( NULL, std::memory_order_acquire );
+    if( scan )
+    {
+        if( scan->my_next )
+            pushChain( scan->my_next );
+    }
+    else
+        scan = new laserScan( this );
+
+    scan->my_next = NULL;
+    if( !scan->reserve( points ))
+    {
+        recycle( scan );
+        return NULL;
+    }
+    scan->my_size = points;
+    scan->my_refCount.store( 1, std::memory_order_relaxed );
+    return scan;
+}
+
+bool laserScanPool::preallocate( int scans, int points )
+{
+    laserScan* first = NULL;
+    bool allocated = true;
+    for( int i = 0; i < scans && allocated; i++ )
+    {
+        laserScan* scan = new laserScan( this );
+        allocated = scan->reserve( points );
+        scan->my_next = first;
+        first = scan;
+    }
+    if( first )
+        pushChain( first );
+    return allocated;
+}
+
+void laserScanPool::recycle( laserScan* scan )
+{
+    scan->my_next = NULL;
+    pushChain( scan );
+}
+
+void laserScanPool::pushChain( laserScan* first )
+{
+    laserScan* last = first;
+    while( last->my_next )
+        last = last->my_next;
+
+    laserScan* head = my_freeList.load( std::memory_order_relaxed );
+    do
+        last->my_next = head;
+    while( !my_freeList.compare_exchange_weak( head, first,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed ) );
+}
@@ -0,0 +1,163 @@
+#ifndef LASERSCAN_H_INCLUDED
+#define LASERSCAN_H_INCLUDED
+
+#include <atomic>
+
+#include "sharedRef.h"
+
+class laserScanPool;
+
+/** \brief Pojedynczy pomiar z dalmierza laserowego
+ *
+ * Współrzędne punktów pomiaru przechowywane są w dwóch ciągłych tablicach
+ * (\c getX() oraz \c getY()), umieszczonych w jednym bloku pamięci wyrównanym
+ * do 32 bajtów, co pozwala przetwarzać pomiar prostymi, wektoryzowalnymi pętlami.
+ * Punkt \c i odpowiada indeksowi \c getFirstIndex() \c + \c i w postaci \c RAW
+ * zwracanej przez \c get_laserReading().
+ *
+ * Pomiar wypełniany jest jednokrotnie przez producenta, a po publikacji tylko
+ * odczytywany. Pomiar zlicza referencje - gdy ostatni uchwyt \c scanHandle
+ * zostanie zwolniony, pomiar wraca do puli \c laserScanPool razem ze swoimi
+ * tablicami.
+ */
+class laserScan
+{
+public:
+    /** \brief Zwraca liczbę punktów pomiaru
+     *
+     * \return int - liczba punktów
+     *
+     */
+    int getSize() const;
+    /** \brief Zwraca współrzędne \c x punktów pomiaru
+     *
+     * \return const int* - tablica \c getSize() współrzędnych
+     *
+     */
+    const int* getX() const;
+    /** \brief Zwraca współrzędne \c y punktów pomiaru
+     *
+     * \return const int* - tablica \c getSize() współrzędnych
+     *
+     */
+    const int* getY() const;
+    /** \brief Zwraca indeks pierwszego punktu w postaci \c RAW
+     *
+     * \return int - indeks pierwszego punktu (\c -(n-1)/2)
+     *
+     */
+    int getFirstIndex() const;
+    /** \brief Zwraca numer kolejny pomiaru
+     *
+     * \return unsigned long long - numer pomiaru (kolejne pomiary mają kolejne numery)
+     *
+     */
+    unsigned long long getSequence() const;
+    /** \brief Zwraca chwilę odebrania pomiaru
+     *
+     * \return long long - czas odbioru w \c us (patrz \c clientUtil::monotonicTime_us())
+     *
+     */
+    long long getTimestamp_us() const;
+
+    /** \brief Zwraca tablicę współrzędnych \c x do zapisu (tylko dla producenta, przed publikacją)
+     *
+     * \return int* - tablica \c getSize() współrzędnych
+     *
+     */
+    int* getWritableX();
+    /** \brief Zwraca tablicę współrzędnych \c y do zapisu (tylko dla producenta, przed publikacją)
+     *
+     * \return int* - tablica \c getSize() współrzędnych
+     *
+     */
+    int* getWritableY();
+    /** \brief Ustawia opis pomiaru (tylko dla producenta, przed publikacją)
+     *
+     * \param sequence unsigned long long - numer kolejny pomiaru
+     * \param timestamp_us long long - chwila odebrania pomiaru w \c us
+     * \return void
+     *
+     */
+    void setScanInfo( unsigned long long sequence, long long timestamp_us );
+
+    void addRef();/**< \brief Zwiększa licznik referencji */
+    void release();/**< \brief Zmniejsza licznik referencji i zwraca pomiar do puli */
+
+private:
+    friend class laserScanPool;
+
+    laserScan( laserScanPool* pool );
+    ~laserScan();
+
+    std::atomic<int> my_refCount;/**< licznik referencji */
+    int* my_points;/**< blok pamięci z tablicami \c x i \c y */
+    int my_capacity, my_size;/**< pojemność tablic i liczba punktów */
+    unsigned long long my_sequence;/**< numer kolejny pomiaru */
+    long long my_timestamp_us;/**< chwila odebrania pomiaru */
+
+    laserScanPool* my_pool;/**< pula, do której wraca pomiar */
+    laserScan* my_next;/**< następny element listy wolnych pomiarów */
+
+    bool reserve( int points );/**< \brief Zapewnia miejsce na \c points punktów */
+
+    laserScan( const laserScan& );
+    laserScan& operator=( const laserScan& );
+};
+
+/** \brief Uchwyt do pomiaru z dalmierza laserowego */
+typedef sharedRef<laserScan> scanHandle;
+
+/** \brief Pula pomiarów z dalmierza laserowego
+ *
+ * Pula działa jak \c framePool: zwolnione pomiary (wraz z tablicami punktów)
+ * trafiają na bezblokadową listę i są wydawane ponownie producentowi, więc
+ * odbiór kolejnego pomiaru nie wymaga alokacji pamięci. Tablice są powiększane
+ * tylko wtedy, gdy pomiar ma więcej punktów niż dotychczasowe.
+ *
+ * Wszystkie uchwyty do pomiarów muszą zostać zwolnione przed zniszczeniem puli.
+ */
+class laserScanPool
+{
+public:
+    /** \brief Konstruktor klasy \c laserScanPool
+     *
+     *
+     */
+    laserScanPool();
+    /** \brief Destruktor klasy \c laserScanPool
+     *
+     *
+     */
+    ~laserScanPool();
+
+    /** \brief Pobiera z puli pomiar o zadanej liczbie punktów
+     *
+     * \param points int - liczba punktów
+     * \return laserScan* - pomiar z jedną referencją należącą do wywołującego lub
+     * \c NULL, jeśli nie udało się przydzielić pamięci
+     *
+     */
+    laserScan* acquire( int points );
+    /** \brief Tworzy z góry pomiary, aby pierwsze odbiory nie alokowały pamięci
+     *
+     * \param scans int - liczba pomiarów
+     * \param points int - liczba punktów, na którą rezerwowane są tablice
+     * \return bool - \b False, jeśli nie udało się przydzielić pamięci
+     *
+     */
+    bool preallocate( int scans, int points );
+
+private:
+    friend class laserScan;
+
+    std::atomic<laserScan*> my_freeList;/**< lista wolnych pomiarów */
+
+    void recycle( laserScan* scan );/**< \brief Zwraca pomiar na listę wolnych pomiarów */
+    void pushChain( laserScan* first );/**< \brief Dołącza łańcuch pomiarów do listy wolnych pomiarów */
+
+    laserScanPool( const laserScanPool& );
+    laserScanPool& operator=( const laserScanPool& );
+};
+
+#endif // LASERSCAN_H_INCLUDED
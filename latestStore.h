@@ -0,0 +1,103 @@
+#ifndef LATESTSTORE_H_INCLUDED
+#define LATESTSTORE_H_INCLUDED
+
+#include <atomic>
+#include <sched.h>
+
+#include "sharedRef.h"
+
+/** \brief Bezblokadowy magazyn ostatnio opublikowanego obiektu
+ *
+ * Magazyn przechowuje wskaźnik do najnowszego kompletnego obiektu (np. klatki
+ * obrazu). Jeden wątek producenta publikuje kolejne obiekty metodą
+ * \c publish(), a dowolna liczba wątków czytelników pobiera najnowszy obiekt
+ * metodą \c acquire() w czasie O(1), bez blokad i bez usypiania.
+ *
+ * Obiekty po opublikowaniu nie są już modyfikowane, a czytelnik dostaje
+ * uchwyt \c sharedRef<T>, więc nigdy nie zobaczy obiektu w połowie zapisu.
+ * Obiekt zastąpiony nowszym trafia na listę oczekujących i jest zwalniany
+ * przez producenta dopiero wtedy, gdy żaden czytelnik nie jest w trakcie
+ * pobierania wskaźnika (licznik \c my_readers równy zero).
+ *
+ * Typ \c T musi udostępniać metody \c addRef() oraz \c release().
+ */
+template<class T>
+class latestStore
+{
+public:
+    latestStore() : my_latest( NULL ), my_readers( 0 ), my_retiredCount( 0 ) {}
+    /** \brief Destruktor - zwalnia wszystkie przechowywane obiekty
+     *
+     * W chwili niszczenia magazynu żaden wątek nie może wywoływać \c acquire().
+     */
+    ~latestStore()
+    {
+        T* latest = my_latest.exchange( NULL );
+        if( latest )
+            latest->release();
+        for( int i = 0; i < my_retiredCount; i++ )
+            my_retired[i]->release();
+    }
+
+    /** \brief Publikuje nowy obiekt (wywoływane tylko z wątku producenta)
+     *
+     * Magazyn przejmuje referencję trzymaną przez producenta.
+     *
+     * \param item T* - kompletny obiekt, który nie będzie już modyfikowany
+     * \return void
+     *
+     */
+    void publish( T* item )
+    {
+        T* old = my_latest.exchange( item );
+        if( old )
+        {
+            // Retired list is full only when readers never leave the acquire
+            // window between publications - wait for a quiescent moment.
+            while( my_retiredCount == RETIRED_CAPACITY && !collect() )
+                sched_yield();
+            my_retired[my_retiredCount++] = old;
+        }
+        collect();
+    }
+
+    /** \brief Zwraca uchwyt do najnowszego opublikowanego obiektu
+     *
+     * \return sharedRef<T> - uchwyt do obiektu lub pusty uchwyt, jeśli nic nie opublikowano
+     *
+     */
+    sharedRef<T> acquire()
+    {
+        my_readers.fetch_add( 1 );
+        T* item = my_latest.load();
+        if( item )
+            item->addRef();
+        my_readers.fetch_sub( 1 );
+        return sharedRef<T>( item, false );
+    }
+
+private:
+    enum { RETIRED_CAPACITY = 16 };
+
+    std::atomic<T*> my_latest;/**< ostatnio opublikowany obiekt */
+    std::atomic<int> my_readers;/**< liczba czytelników w trakcie pobierania wskaźnika */
+
+    T* my_retired[RETIRED_CAPACITY];/**< obiekty zastąpione nowszymi, czekające na zwolnienie */
+    int my_retiredCount;/**< liczba elementów w \c my_retired[] */
+
+    /** \brief Zwalnia zastąpione obiekty, jeśli żaden czytelnik nie może ich właśnie pobierać */
+    bool collect()
+    {
+        if( my_readers.load() != 0 )
+            return false;
+        for( int i = 0; i < my_retiredCount; i++ )
+            my_retired[i]->release();
+        my_retiredCount = 0;
+        return true;
+    }
+
+    latestStore( const latestStore& );
+    latestStore& operator=( const latestStore& );
+};
+
+#endif // LATESTSTORE_H_INCLUDED
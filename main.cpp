@@ -3,6 +3,7 @@
 #include <string>
 #include <cstdio>
 
+#include "clientUtil.h"
 #include "robotManager.h"
 
 // DEVELOPMENT LIBRARIES
@@ -31,18 +32,29 @@ int main(int argc, char **argv)
 
     _robotManager.camera->activateCameraSteering();
 
+    // Frames are decoded once, in the background, by a pool of threads
+    _robotManager.camera->startDecoding( 2 );
+    // _robotManager.camera->startDecoding( 2, frameDecoder::DECODE_GRAYSCALE );
+
+    // Print statistics of all data streams every 5 s
+    _robotManager.startStatsDump( 5000 );
+
     cv::namedWindow( "Stream", CV_WINDOW_AUTOSIZE );
-    std::pair<unsigned char*, int> imageData;
+    unsigned long long lastSequence = 0;
     while( _robotManager.client_getRunningWithLock() )
     {
-        imageData = _robotManager.camera->getSendVideoFrame();
-        std::vector<unsigned char> buffer( imageData.first, imageData.first + imageData.second );
-        cv::Mat image = imdecode(buffer, cv::IMREAD_ANYCOLOR);
-        // cv::Mat image = imdecode(buffer, cv::IMREAD_GRAYSCALE);
-        if(image.empty())
-            return 0;
-        cv::imshow("Stream", image);
-        cv::waitKey( _robotManager.camera->getSynchroTime_ums() / 1000 );
+        // Sleep until a new frame is decoded; the timeout keeps the window responsive
+        decodedHandle frame = _robotManager.camera->waitForNextDecodedFrame( lastSequence, 100 );
+        if( frame.empty() )
+        {
+            cv::waitKey( 1 );
+            continue;
+        }
+        lastSequence = frame->getSequence();
+
+        cv::imshow("Stream", frame->getImage());
+        cv::waitKey( 1 );
+        _robotManager.camera->getVideoRate()->reportConsumerLag( clientUtil::monotonicTime_us() - frame->getTimestamp_us() );
     }
     return 0;
 }
@@ -0,0 +1,152 @@
+#include "poseHistory.h"
+
+#include <cmath>
+
+static double wrapAngle_deg( double angle )
+{
+    angle = fmod( angle, 360.0 );
+    if( angle > 180.0 )
+        angle -= 360.0;
+    else if( angle <= -180.0 )
+        angle += 360.0;
+    return angle;
+}
+
+poseHistory::poseHistory( int capacity ) :
+    my_written( 0 ), my_maxExtrapolation_us( 1000000 )
+{
+    unsigned long long size = 2;
+    while( size < (unsigned long long) capacity )
+        size *= 2;
+    my_slots = new slot[size];
+    my_mask = size - 1;
+    for( unsigned long long i = 0; i < size; i++ )
+        my_slots[i].sequence.store( 0, std::memory_order_relaxed );
+}
+
+poseHistory::~poseHistory()
+{
+    delete[] my_slots;
+}
+
+void poseHistory::push( const timedPose& pose )
+{
+    unsigned long long number = my_written.load( std::memory_order_relaxed );
+    slot& target = my_slots[number & my_mask];
+
+    target.sequence.store( 2 * number + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    target.timestamp_us.store( pose.timestamp_us, std::memory_order_relaxed );
+    target.xPosition.store( pose.xPosition, std::memory_order_relaxed );
+    target.yPosition.store( pose.yPosition, std::memory_order_relaxed );
+    target.theta.store( pose.theta, std::memory_order_relaxed );
+    target.velocity.store( pose.velocity, std::memory_order_relaxed );
+    target.rotationalVelocity.store( pose.rotationalVelocity, std::memory_order_relaxed );
+    target.sequence.store( 2 * ( number + 1 ), std::memory_order_release );
+
+    my_written.store( number + 1, std::memory_order_release );
+}
+
+bool poseHistory::readSlot( unsigned long long number, timedPose* pose ) const
+{
+    const slot& source = my_slots[number & my_mask];
+    if( source.sequence.load( std::memory_order_acquire ) != 2 * ( number + 1 ))
+        return false;
+    pose->timestamp_us = source.timestamp_us.load( std::memory_order_relaxed );
+    pose->xPosition = source.xPosition.load( std::memory_order_relaxed );
+    pose->yPosition = source.yPosition.load( std::memory_order_relaxed );
+    pose->theta = source.theta.load( std::memory_order_relaxed );
+    pose->velocity = source.velocity.load( std::memory_order_relaxed );
+    pose->rotationalVelocity = source.rotationalVelocity.load( std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return source.sequence.load( std::memory_order_relaxed ) == 2 * ( number + 1 );
+}
+
+bool poseHistory::getLatest( timedPose* pose ) const
+{
+    while( true )
+    {
+        unsigned long long written = my_written.load( std::memory_order_acquire );
+        if( written == 0 )
+            return false;
+        if( readSlot( written - 1, pose ))
+            return true;
+    }
+}
+
+bool poseHistory::getPoseAt( long long timestamp_us, timedPose* pose ) const
+{
+    int found;
+    while( ( found = tryPoseAt( timestamp_us, pose )) < 0 )
+        ;
+    return found > 0;
+}
+
+int poseHistory::tryPoseAt( long long timestamp_us, timedPose* pose ) const
+{
+    unsigned long long written = my_written.load( std::memory_order_acquire );
+    if( written == 0 )
+        return 0;
+
+    timedPose before, after;
+    unsigned long long newest = written - 1;
+    if( !readSlot( newest, &before ))
+        return -1;
+
+    if( timestamp_us >= before.timestamp_us )
+    {
+        // Extrapolate with the last known velocities (heading at the middle of the arc)
+        long long elapsed_us = timestamp_us - before.timestamp_us;
+        if( elapsed_us > my_maxExtrapolation_us.load( std::memory_order_relaxed ))
+            return 0;
+        double elapsed_s = elapsed_us * 1e-6;
+        double heading = ( before.theta + 0.5 * before.rotationalVelocity * elapsed_s ) * M_PI / 180.0;
+        *pose = before;
+        pose->timestamp_us = timestamp_us;
+        pose->xPosition += before.velocity * elapsed_s * cos( heading );
+        pose->yPosition += before.velocity * elapsed_s * sin( heading );
+        pose->theta = wrapAngle_deg( before.theta + before.rotationalVelocity * elapsed_s );
+        return 1;
+    }
+
+    // Last pose not later than the requested time
+    unsigned long long low = written > my_mask + 1 ? written - ( my_mask + 1 ) : 0;
+    unsigned long long high = newest;
+    after = before;
+    if( !readSlot( low, &before ))
+        return -1;
+    if( timestamp_us < before.timestamp_us )
+        return 0;
+    while( high - low > 1 )
+    {
+        unsigned long long middle = low + ( high - low ) / 2;
+        timedPose candidate;
+        if( !readSlot( middle, &candidate ))
+            return -1;
+        if( candidate.timestamp_us <= timestamp_us )
+        {
+            low = middle;
+            before = candidate;
+        }
+        else
+        {
+            high = middle;
+            after = candidate;
+        }
+    }
+
+    double ratio = after.timestamp_us > before.timestamp_us ?
+                   (double)( timestamp_us - before.timestamp_us ) / ( after.timestamp_us - before.timestamp_us ) : 0.0;
+    pose->timestamp_us = timestamp_us;
+    pose->xPosition = before.xPosition + ratio * ( after.xPosition - before.xPosition );
+    pose->yPosition = before.yPosition + ratio * ( after.yPosition - before.yPosition );
+    pose->theta = wrapAngle_deg( before.theta + ratio * wrapAngle_deg( after.theta - before.theta ));
+    pose->velocity = before.velocity + ratio * ( after.velocity - before.velocity );
+    pose->rotationalVelocity = before.rotationalVelocity + ratio * ( after.rotationalVelocity - before.rotationalVelocity );
+    return 1;
+}
+
+void poseHistory::setMaxExtrapolation( long long maxExtrapolation_us )
+{
+    my_maxExtrapolation_us.store( maxExtrapolation_us );
+}
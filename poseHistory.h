@@ -0,0 +1,103 @@
+#ifndef POSEHISTORY_H_INCLUDED
+#define POSEHISTORY_H_INCLUDED
+
+#include <atomic>
+
+/** \brief Położenie robota w danej chwili */
+struct timedPose
+{
+    long long timestamp_us;/**< chwila odebrania położenia w \c us (patrz \c clientUtil::monotonicTime_us()) */
+    double xPosition, yPosition;/**< położenie robota w \c mm */
+    double theta;/**< kąt obrotu robota w stopniach, w zakresie (-180, 180] */
+    double velocity;/**< prędkość translacyjna w \c mm/s */
+    double rotationalVelocity;/**< prędkość kątowa w stopniach/s */
+};
+
+/** \brief Historia położeń robota z interpolacją
+ *
+ * Bufor pierścieniowy ostatnich położeń (z \c updateNumbers) oznaczonych
+ * chwilą odbioru. Jeden wątek dopisuje położenia metodą \c push(), a dowolna
+ * liczba wątków wyznacza bez blokad położenie w zadanej chwili - np. w chwili
+ * odebrania pomiaru lasera lub klatki obrazu:
+ * \code
+ * scanHandle scan = rManager.requests->get_laserScan();
+ * timedPose pose;
+ * if( !scan.empty() && rManager.requests->get_poseAt( scan->getTimestamp_us(), &pose ) )
+ *     process( scan, pose );
+ * \endcode
+ *
+ * Między zapisanymi położeniami położenie jest interpolowane liniowo (kąt
+ * najkrótszą drogą), a za ostatnim - ekstrapolowane z prędkości, lecz nie
+ * dalej niż o \c setMaxExtrapolation().
+ *
+ * Każdy element bufora chroniony jest licznikiem sekwencji (seqlock):
+ * czytelnik powtarza odczyt, jeśli element został w tym czasie nadpisany.
+ */
+class poseHistory
+{
+public:
+    /** \brief Konstruktor klasy \c poseHistory
+     *
+     * \param capacity int - liczba pamiętanych położeń (zaokrąglana w górę do potęgi dwójki)
+     *
+     */
+    poseHistory( int capacity = 256 );
+    /** \brief Destruktor klasy \c poseHistory
+     *
+     *
+     */
+    ~poseHistory();
+
+    /** \brief Dopisuje położenie (tylko z jednego wątku, chwile muszą rosnąć)
+     *
+     * \param pose const timedPose& - położenie
+     * \return void
+     *
+     */
+    void push( const timedPose& pose );
+    /** \brief Wyznacza położenie robota w zadanej chwili
+     *
+     * \param timestamp_us long long - chwila w \c us
+     * \param pose timedPose* - wynikowe położenie (z \c timestamp_us równym zadanej chwili)
+     * \return bool - \b False, jeśli chwila jest wcześniejsza niż najstarsze pamiętane
+     * położenie lub późniejsza niż ostatnie położenie o więcej niż dopuszczalna ekstrapolacja
+     *
+     */
+    bool getPoseAt( long long timestamp_us, timedPose* pose ) const;
+    /** \brief Zwraca ostatnie położenie
+     *
+     * \param pose timedPose* - wynikowe położenie
+     * \return bool - \b False, jeśli nie zapisano jeszcze żadnego położenia
+     *
+     */
+    bool getLatest( timedPose* pose ) const;
+    /** \brief Ustawia dopuszczalny czas ekstrapolacji za ostatnim położeniem
+     *
+     * \param maxExtrapolation_us long long - czas w \c us (domyślnie 1 s - okres \c updateNumbers)
+     * \return void
+     *
+     */
+    void setMaxExtrapolation( long long maxExtrapolation_us );
+
+private:
+    /** \brief Element bufora */
+    struct slot
+    {
+        std::atomic<unsigned long long> sequence;/**< 2 * (numer położenia + 1), nieparzysty w trakcie zapisu */
+        std::atomic<long long> timestamp_us;
+        std::atomic<double> xPosition, yPosition, theta, velocity, rotationalVelocity;
+    };
+
+    slot* my_slots;/**< bufor położeń */
+    unsigned long long my_mask;/**< rozmiar bufora - 1 */
+    std::atomic<unsigned long long> my_written;/**< liczba zapisanych położeń */
+    std::atomic<long long> my_maxExtrapolation_us;/**< dopuszczalny czas ekstrapolacji */
+
+    bool readSlot( unsigned long long number, timedPose* pose ) const;/**< \brief Odczytuje położenie o zadanym numerze (\b False, jeśli zostało nadpisane) */
+    int tryPoseAt( long long timestamp_us, timedPose* pose ) const;/**< \brief Jedna próba \c getPoseAt() (-1 - bufor nadpisany w trakcie odczytu) */
+
+    poseHistory( const poseHistory& );
+    poseHistory& operator=( const poseHistory& );
+};
+
+#endif // POSEHISTORY_H_INCLUDED
@@ -0,0 +1,156 @@
+#include "rateController.h"
+
+#include <algorithm>
+#include <cmath>
+
+rateController::rateController( ArFunctor1<int>* applyPeriod, int period_ms ) :
+    my_applyPeriod( applyPeriod ),
+    my_requestedPeriod_ms( period_ms ), my_period_ms( period_ms ), my_maxPeriod_ms( period_ms ),
+    my_isAdaptive( false ), my_targetLag_us( 200000 ), my_controlInterval_us( 1000000 ),
+    my_windowStart_us( 0 ), my_arrivals( 0 ), my_bytes( 0 ), my_maxLag_us( 0 ),
+    my_drops( 0 ), my_throughput( 0.0 ), my_stats( NULL )
+{
+
+}
+
+void rateController::setPeriod( int period_ms )
+{
+    period_ms = std::max( period_ms, 0 );
+    my_mutex.lock();
+    my_requestedPeriod_ms = period_ms;
+    my_maxPeriod_ms = std::max( my_maxPeriod_ms.load(), period_ms );
+    apply( period_ms );
+    my_windowStart_us = 0;
+    my_mutex.unlock();
+}
+
+int rateController::getRequestedPeriod() const
+{
+    return my_requestedPeriod_ms.load();
+}
+
+int rateController::getPeriod() const
+{
+    return my_period_ms.load();
+}
+
+void rateController::enableAdaptive( int maxPeriod_ms )
+{
+    my_mutex.lock();
+    my_maxPeriod_ms = std::max( maxPeriod_ms, my_requestedPeriod_ms.load() );
+    my_isAdaptive = true;
+    my_windowStart_us = 0;
+    my_mutex.unlock();
+}
+
+void rateController::disableAdaptive()
+{
+    my_mutex.lock();
+    my_isAdaptive = false;
+    if( my_period_ms != my_requestedPeriod_ms )
+        apply( my_requestedPeriod_ms );
+    my_mutex.unlock();
+}
+
+bool rateController::isAdaptive() const
+{
+    return my_isAdaptive.load();
+}
+
+void rateController::setTargetLag( long long lag_us )
+{
+    my_targetLag_us = lag_us;
+}
+
+void rateController::setControlInterval( long long interval_us )
+{
+    my_controlInterval_us = interval_us;
+}
+
+void rateController::setStats( streamStats* stats )
+{
+    my_stats = stats;
+}
+
+void rateController::reportConsumerLag( long long lag_us )
+{
+    streamStats* stats = my_stats.load( std::memory_order_relaxed );
+    if( stats )
+        stats->recordConsumerLag( lag_us );
+
+    long long current = my_maxLag_us.load( std::memory_order_relaxed );
+    while( lag_us > current && !my_maxLag_us.compare_exchange_weak( current, lag_us, std::memory_order_relaxed ))
+        ;
+}
+
+void rateController::recordArrival( long long now_us, int bytes, unsigned long long newDrops )
+{
+    long long windowStart_us = my_windowStart_us.load( std::memory_order_relaxed );
+    if( windowStart_us == 0 )
+    {
+        // The window starts with the first arrival (after a period change)
+        resetWindow( now_us );
+        return;
+    }
+
+    my_arrivals.fetch_add( 1, std::memory_order_relaxed );
+    my_drops.fetch_add( newDrops, std::memory_order_relaxed );
+    my_bytes.fetch_add( bytes, std::memory_order_relaxed );
+    if( now_us - windowStart_us < my_controlInterval_us.load( std::memory_order_relaxed ))
+        return;
+
+    // A period being changed by the user - evaluate at the next arrival
+    if( my_mutex.tryLock() != 0 )
+        return;
+    evaluate( now_us );
+    my_mutex.unlock();
+}
+
+double rateController::getThroughput() const
+{
+    return my_throughput.load();
+}
+
+void rateController::evaluate( long long now_us )
+{
+    double elapsed_s = ( now_us - my_windowStart_us.load() ) * 1e-6;
+    double achievedRate = my_arrivals.load() / elapsed_s;
+    my_throughput = my_bytes.load() / elapsed_s;
+    unsigned long long drops = my_drops.load();
+    long long lag_us = my_maxLag_us.load();
+    int period_ms = my_period_ms.load();
+    int requestedPeriod_ms = my_requestedPeriod_ms.load();
+    resetWindow( now_us );
+
+    if( !my_isAdaptive || period_ms <= 0 || requestedPeriod_ms <= 0 )
+        return;
+
+    // AIMD on the rate: halve it when congested, otherwise add 1/10 of the requested rate
+    double rate = 1000.0 / period_ms;
+    bool congested = achievedRate < 0.8 * rate || drops > 0 || lag_us > my_targetLag_us;
+    if( congested )
+        rate /= 2.0;
+    else
+        rate += 0.1 * 1000.0 / requestedPeriod_ms;
+
+    int newPeriod_ms = (int) lround( 1000.0 / rate );
+    newPeriod_ms = std::max( requestedPeriod_ms, std::min( newPeriod_ms, my_maxPeriod_ms.load() ));
+    if( newPeriod_ms != period_ms )
+        apply( newPeriod_ms );
+}
+
+void rateController::apply( int period_ms )
+{
+    my_period_ms = period_ms;
+    if( my_applyPeriod )
+        my_applyPeriod->invoke( period_ms );
+}
+
+void rateController::resetWindow( long long now_us )
+{
+    my_arrivals = 0;
+    my_bytes = 0;
+    my_drops = 0;
+    my_maxLag_us = 0;
+    my_windowStart_us = now_us;
+}
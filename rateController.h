@@ -0,0 +1,155 @@
+#ifndef RATECONTROLLER_H_INCLUDED
+#define RATECONTROLLER_H_INCLUDED
+
+#include <atomic>
+
+#include "Aria.h"
+
+#include "streamStats.h"
+
+/** \brief Okres odpytywania strumienia danych (klatek, pomiarów) z opcjonalną adaptacją
+ *
+ * Obiekt przechowuje okres zapytań jednego strumienia i przekazuje każdą jego
+ * zmianę do funkcji \c applyPeriod (która np. ponawia \c ArClientBase::request()).
+ * Okres zadany przez użytkownika (\c setPeriod()) jest zarazem najkrótszym okresem
+ * trybu adaptacyjnego.
+ *
+ * W trybie adaptacyjnym (\c enableAdaptive()) co \c setControlInterval() oceniane jest
+ * ostatnie okno pomiarowe. Strumień uznawany jest za przeciążony, gdy:
+ * \li odebrano mniej niż 80% oczekiwanych danych (łącze nie nadąża),
+ * \li odbiorcy odrzucili dane (\c recordArrival() z licznikiem odrzuceń),
+ * \li opóźnienie zgłoszone przez odbiorców (\c reportConsumerLag()) przekroczyło \c setTargetLag().
+ *
+ * Częstotliwość zmieniana jest według AIMD: przy przeciążeniu jest dzielona przez dwa
+ * (okres nie dłuższy niż maksymalny), w przeciwnym razie zwiększana o 1/10 częstotliwości
+ * zadanej. Dzięki temu przy pogorszeniu łącza opóźnienie pozostaje ograniczone, zamiast
+ * rosnąć przez kolejkowanie nieaktualnych danych.
+ *
+ * Ocena wykonywana jest w wątku odbioru, przy pierwszym odbiorze po upływie okna, więc
+ * nie wymaga osobnego wątku.
+ */
+class rateController
+{
+public:
+    /** \brief Konstruktor klasy \c rateController
+     *
+     * \param applyPeriod ArFunctor1<int>* - funkcja ustawiająca nowy okres strumienia w \c ms (0 - zatrzymanie)
+     * \param period_ms int - początkowy okres (nie jest przekazywany do \c applyPeriod)
+     *
+     */
+    rateController( ArFunctor1<int>* applyPeriod, int period_ms );
+
+    /** \brief Ustawia zadany okres strumienia i przekazuje go do \c applyPeriod
+     *
+     * \param period_ms int - okres w \c ms (0 - zatrzymanie strumienia)
+     * \return void
+     *
+     */
+    void setPeriod( int period_ms );
+    /** \brief Zwraca zadany okres strumienia
+     *
+     * \return int - okres w \c ms
+     *
+     */
+    int getRequestedPeriod() const;
+    /** \brief Zwraca aktualnie używany okres strumienia (w trybie adaptacyjnym może być dłuższy od zadanego)
+     *
+     * \return int - okres w \c ms
+     *
+     */
+    int getPeriod() const;
+
+    /** \brief Włącza adaptację okresu
+     *
+     * \param maxPeriod_ms int - najdłuższy dopuszczalny okres w \c ms
+     * \return void
+     *
+     */
+    void enableAdaptive( int maxPeriod_ms );
+    /** \brief Wyłącza adaptację i przywraca zadany okres
+     *
+     * \return void
+     *
+     */
+    void disableAdaptive();
+    /** \brief Zwraca stan adaptacji okresu
+     *
+     * \return bool - \b True, jeśli adaptacja jest włączona
+     *
+     */
+    bool isAdaptive() const;
+    /** \brief Ustawia dopuszczalne opóźnienie odbiorców
+     *
+     * \param lag_us long long - opóźnienie w \c us (domyślnie 200 ms)
+     * \return void
+     *
+     */
+    void setTargetLag( long long lag_us );
+    /** \brief Ustawia długość okna oceny przeciążenia
+     *
+     * \param interval_us long long - długość okna w \c us (domyślnie 1 s)
+     * \return void
+     *
+     */
+    void setControlInterval( long long interval_us );
+    /** \brief Ustawia statystyki strumienia, do których trafiają też zgłoszone opóźnienia odbiorców
+     *
+     * \param stats streamStats* - statystyki strumienia (\c NULL - brak)
+     * \return void
+     *
+     */
+    void setStats( streamStats* stats );
+
+    /** \brief Zgłasza opóźnienie odbiorcy (dowolny wątek)
+     *
+     * Odbiorca zgłasza np. różnicę między chwilą przetworzenia danych a chwilą ich odebrania.
+     *
+     * \param lag_us long long - opóźnienie w \c us
+     * \return void
+     *
+     */
+    void reportConsumerLag( long long lag_us );
+    /** \brief Rejestruje odebrane dane (tylko z wątku odbioru)
+     *
+     * \param now_us long long - chwila odbioru w \c us (patrz \c clientUtil::monotonicTime_us())
+     * \param bytes int - rozmiar danych
+     * \param newDrops unsigned long long - liczba danych odrzuconych przez odbiorców od poprzedniego wywołania
+     * \return void
+     *
+     */
+    void recordArrival( long long now_us, int bytes, unsigned long long newDrops = 0 );
+    /** \brief Zwraca przepustowość strumienia zmierzoną w ostatnim oknie
+     *
+     * \return double - przepustowość w bajtach na sekundę
+     *
+     */
+    double getThroughput() const;
+
+private:
+    ArFunctor1<int>* my_applyPeriod;/**< funkcja ustawiająca okres strumienia */
+    ArMutex my_mutex;/**< blokada zmian okresu */
+
+    std::atomic<int> my_requestedPeriod_ms;/**< okres zadany przez użytkownika */
+    std::atomic<int> my_period_ms;/**< okres aktualnie używany */
+    std::atomic<int> my_maxPeriod_ms;/**< najdłuższy okres w trybie adaptacyjnym */
+    std::atomic<bool> my_isAdaptive;/**< stan adaptacji */
+    std::atomic<long long> my_targetLag_us;/**< dopuszczalne opóźnienie odbiorców */
+    std::atomic<long long> my_controlInterval_us;/**< długość okna oceny */
+
+    std::atomic<long long> my_windowStart_us;/**< początek bieżącego okna (0 - okno nie rozpoczęte) */
+    std::atomic<unsigned long long> my_arrivals;/**< liczba odbiorów w oknie */
+    std::atomic<unsigned long long> my_bytes;/**< liczba bajtów w oknie */
+    std::atomic<long long> my_maxLag_us;/**< największe zgłoszone opóźnienie w oknie */
+    std::atomic<unsigned long long> my_drops;/**< liczba odrzuceń w oknie */
+    std::atomic<double> my_throughput;/**< przepustowość z ostatniego okna */
+    std::atomic<streamStats*> my_stats;/**< statystyki strumienia (opóźnienia odbiorców) */
+
+    void evaluate( long long now_us );/**< \brief Ocenia okno i zmienia okres (pod blokadą \c my_mutex) */
+    void apply( int period_ms );/**< \brief Ustawia okres i przekazuje go do \c applyPeriod (pod blokadą \c my_mutex) */
+    void resetWindow( long long now_us );/**< \brief Rozpoczyna nowe okno */
+
+    rateController( const rateController& );
+    rateController& operator=( const rateController& );
+};
+
+#endif // RATECONTROLLER_H_INCLUDED
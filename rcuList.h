@@ -0,0 +1,184 @@
+#ifndef RCULIST_H_INCLUDED
+#define RCULIST_H_INCLUDED
+
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <sched.h>
+
+#include "Aria.h"
+
+/** \brief Lista elementów z bezblokadowym odczytem (copy-on-write)
+ *
+ * Lista przeznaczona jest do sytuacji, w których jeden wątek często przegląda
+ * elementy (np. wątek odbierający dane z serwera przekazuje klatki
+ * subskrybentom), a inne wątki rzadko je dodają lub usuwają.
+ *
+ * Odczyt (\c forEach()) nie zakłada żadnej blokady - pobiera wskaźnik do
+ * aktualnej, niezmiennej kopii listy. Modyfikacja tworzy nową kopię, publikuje
+ * ją atomowo i czeka, aż wszyscy czytelnicy poprzedniej kopii zakończą jej
+ * przeglądanie. Po powrocie z \c remove() usunięty element nie jest już
+ * używany przez żadnego czytelnika i może zostać bezpiecznie zniszczony.
+ *
+ * Czytelnicy dzieleni są na dwie epoki, więc modyfikujący wątek czeka tylko
+ * na czytelników, którzy zaczęli przed publikacją nowej kopii.
+ */
+template<class T>
+class rcuList
+{
+public:
+    rcuList() : my_current( new std::vector<T>() ), my_epoch( 0 )
+    {
+        my_readers[0].store( 0 );
+        my_readers[1].store( 0 );
+    }
+    ~rcuList()
+    {
+        delete my_current.load();
+    }
+
+    /** \brief Dodaje element na koniec listy
+     *
+     * \param item const T& - dodawany element
+     * \return void
+     *
+     */
+    void add( const T& item )
+    {
+        my_writeMutex.lock();
+        std::vector<T>* updated = new std::vector<T>( *my_current.load() );
+        updated->push_back( item );
+        replace( updated );
+        my_writeMutex.unlock();
+    }
+
+    /** \brief Usuwa element z listy
+     *
+     * Metoda wraca dopiero wtedy, gdy żaden czytelnik nie korzysta już z elementu.
+     *
+     * \param item const T& - usuwany element
+     * \return bool - \b True, jeśli element znajdował się na liście
+     *
+     */
+    bool remove( const T& item )
+    {
+        my_writeMutex.lock();
+        std::vector<T>* current = my_current.load();
+        typename std::vector<T>::iterator found = std::find( current->begin(), current->end(), item );
+        if( found == current->end() )
+        {
+            my_writeMutex.unlock();
+            return false;
+        }
+        std::vector<T>* updated = new std::vector<T>( *current );
+        updated->erase( updated->begin() + ( found - current->begin() ) );
+        replace( updated );
+        my_writeMutex.unlock();
+        return true;
+    }
+
+    /** \brief Modyfikuje listę dowolną operacją na jej kopii
+     *
+     * Funkcja \c func otrzymuje nową kopię listy (pod blokadą modyfikacji) i może ją
+     * dowolnie zmienić. Metoda wraca, gdy żaden czytelnik nie korzysta już z poprzedniej kopii.
+     *
+     * \param func F - obiekt wywoływany z argumentem \c std::vector<T>&
+     * \return void
+     *
+     */
+    template<class F>
+    void modify( F func )
+    {
+        my_writeMutex.lock();
+        std::vector<T>* updated = new std::vector<T>( *my_current.load() );
+        func( *updated );
+        replace( updated );
+        my_writeMutex.unlock();
+    }
+
+    /** \brief Sprawdza czy element znajduje się na liście
+     *
+     * \param item const T& - szukany element
+     * \return bool - \b True, jeśli element znajduje się na liście
+     *
+     */
+    bool contains( const T& item )
+    {
+        bool found = false;
+        int epoch = enter();
+        std::vector<T>* current = my_current.load();
+        found = std::find( current->begin(), current->end(), item ) != current->end();
+        leave( epoch );
+        return found;
+    }
+
+    /** \brief Wywołuje \c func dla każdego elementu listy (bez blokad)
+     *
+     * \param func F - obiekt wywoływany z argumentem \c const T&
+     * \return void
+     *
+     */
+    template<class F>
+    void forEach( F func )
+    {
+        int epoch = enter();
+        std::vector<T>* current = my_current.load();
+        for( typename std::vector<T>::const_iterator it = current->begin(); it != current->end(); ++it )
+            func( *it );
+        leave( epoch );
+    }
+
+    /** \brief Sprawdza czy lista jest pusta
+     *
+     * \return bool - \b True, jeśli lista nie zawiera elementów
+     *
+     */
+    bool empty()
+    {
+        int epoch = enter();
+        bool isEmpty = my_current.load()->empty();
+        leave( epoch );
+        return isEmpty;
+    }
+
+private:
+    std::atomic<std::vector<T>*> my_current;/**< aktualna kopia listy */
+    std::atomic<int> my_epoch;/**< numer bieżącej epoki czytelników */
+    std::atomic<int> my_readers[2];/**< liczba czytelników w każdej z dwóch epok */
+    ArMutex my_writeMutex;/**< szereguje modyfikacje listy */
+
+    int enter()
+    {
+        // A reader counts as a member of the epoch only if the epoch did not
+        // change while it was registering - otherwise a writer might have
+        // already stopped waiting for that counter.
+        while( true )
+        {
+            int epoch = my_epoch.load();
+            my_readers[epoch & 1].fetch_add( 1 );
+            if( my_epoch.load() == epoch )
+                return epoch & 1;
+            my_readers[epoch & 1].fetch_sub( 1 );
+        }
+    }
+
+    void leave( int epoch )
+    {
+        my_readers[epoch].fetch_sub( 1 );
+    }
+
+    /** \brief Publikuje nową kopię listy i zwalnia poprzednią po zakończeniu odczytów */
+    void replace( std::vector<T>* updated )
+    {
+        std::vector<T>* old = my_current.exchange( updated );
+        int oldEpoch = my_epoch.fetch_add( 1 ) & 1;
+        while( my_readers[oldEpoch].load() != 0 )
+            sched_yield();
+        delete old;
+    }
+
+    rcuList( const rcuList& );
+    rcuList& operator=( const rcuList& );
+};
+
+#endif // RCULIST_H_INCLUDED
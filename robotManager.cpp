@@ -1,14 +1,30 @@
 #include "robotManager.h"
+#include "clientUtil.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 #include <string>
-#include <sstream>
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 robotManager::robotManager( int* argc, char** argv, std::string ipAddress) :
-    parser( argc, argv ), clientConnector( &parser )
+    parser( argc, argv ), clientConnector( &parser ),
+    my_statsDumpTask( 0 ), my_statsOutput( stdout ),
+    my_commandExpiryTask( 0 ),
+    my_functor_handle_dumpStats( this, &robotManager::handle_dumpStats ),
+    my_functor_handle_expireCommands( this, &robotManager::handle_expireCommands ),
+    my_functor_handle_disconnected( this, &robotManager::handle_disconnected )
 {
     this->keyHandler = new keyHandlerMaster();
+    this->telemetry = new telemetryRecorder();
+    this->scheduler = new taskScheduler();
     Aria::init();
 
     parser.addDefaultArgument( ("-host " + ipAddress).c_str() );
@@ -34,9 +50,14 @@ robotManager::robotManager( int* argc, char** argv, std::string ipAddress) :
     }
 
     // Prepare nested-classes managers
-    requests = new requestsHandler( &client );
-    steering = new steeringManager( &client, keyHandler );
-    camera = new cameraManager( &client, keyHandler );
+    requests = new requestsHandler( &client, telemetry );
+    steering = new steeringManager( &client, keyHandler, requests );
+    camera = new cameraManager( &client, keyHandler, telemetry );
+
+    // Command timeouts must fire even when no state arrives (stopped stream, lost link)
+    my_commandExpiryTask = scheduler->addTask( &my_functor_handle_expireCommands, 50000 );
+    client.addDisconnectOnErrorCB( &my_functor_handle_disconnected );
+    client.addServerShutdownCB( &my_functor_handle_disconnected );
 
     // Run the client
     client.runAsync();
@@ -54,6 +75,13 @@ robotManager::robotManager( int* argc, char** argv, std::string ipAddress) :
 robotManager::~robotManager()
 {
     my_isClienRunning = false;
+    scheduler->stop();
+    telemetry->stop();
+    requests->stopReadingSensors();
+    // Aria::exit() ends the process - queued frames must be written and the frame log closed first
+    camera->stopReplay();
+    camera->stopRecording();
+    camera->stopDecoding();
     client.disconnect();
     Aria::exit();
 }
@@ -63,6 +91,16 @@ bool robotManager::client_getRunningWithLock()
     return client.getRunningWithLock();
 }
 
+bool robotManager::client_addHandler( const char* name, ArFunctor1<ArNetPacket*>* functor )
+{
+    return client.addHandler( name, functor );
+}
+
+bool robotManager::client_requestOnce( const char* name, ArNetPacket* packet )
+{
+    return client.requestOnce( name, packet );
+}
+
 bool robotManager::isClientRunning()
 {
     return my_isClienRunning;
@@ -73,9 +111,75 @@ void robotManager::disableNativeAriaLogging()
     ArLog::setLogLevel( ArLog::Terse );
 }
 
-robotManager::requestsHandler::requestsHandler( ArClientBase* _client) :
-    my_client( _client ),
-    my_verboseMode( false ),
+std::vector<streamStats*> robotManager::getStreamStats()
+{
+    std::vector<streamStats*> stats = requests->get_streamStats();
+    stats.push_back( camera->getVideoStats() );
+    return stats;
+}
+
+void robotManager::printStreamStats( FILE* output )
+{
+    std::vector<streamStats*> stats = getStreamStats();
+    for( size_t i = 0; i < stats.size(); i++ )
+        stats[i]->print( output );
+    fflush( output );
+}
+
+void robotManager::startStatsDump( int period_ms, FILE* output )
+{
+    my_statsDumpMutex.lock();
+    taskScheduler::taskHandle previous = my_statsDumpTask;
+    my_statsOutput = output;
+    my_statsDumpTask = scheduler->addTask( &my_functor_handle_dumpStats, period_ms * 1000LL );
+    my_statsDumpMutex.unlock();
+
+    // Outside the lock - removeTask() waits for a running dump, which takes the lock
+    if( previous != 0 )
+        scheduler->removeTask( previous );
+}
+
+void robotManager::stopStatsDump()
+{
+    my_statsDumpMutex.lock();
+    taskScheduler::taskHandle previous = my_statsDumpTask;
+    my_statsDumpTask = 0;
+    my_statsDumpMutex.unlock();
+
+    if( previous != 0 )
+        scheduler->removeTask( previous );
+}
+
+void robotManager::handle_expireCommands()
+{
+    long long now_us = clientUtil::monotonicTime_us();
+    requests->get_motionTracker()->expire( now_us );
+    camera->expireCommands( now_us );
+}
+
+void robotManager::handle_disconnected()
+{
+    // No state will arrive any more
+    requests->get_motionTracker()->cancelAll();
+    camera->cancelCommands();
+}
+
+void robotManager::handle_dumpStats()
+{
+    my_statsDumpMutex.lock();
+    FILE* output = my_statsOutput;
+    my_statsDumpMutex.unlock();
+
+    fprintf( output, "## Stream stats (%.1f s)\n", clientUtil::monotonicTime_us() * 1e-6 );
+    printStreamStats( output );
+}
+
+robotManager::requestsHandler::requestsHandler( ArClientBase* _client, telemetryRecorder* _telemetry ) :
+    my_updateNumbersRate( &my_functor_handle_applyUpdateNumbersPeriod, 0 ), my_updateNumbersStats( "updateNumbers" ),
+    my_client( _client ), my_telemetry( _telemetry ), my_command_getSensorCurrent( _client, "getSensorCurrent" ),
+    my_verboseMode( false ), my_sensors( NULL ), my_isRequestingSensors( false ),
+    my_functor_handle_applyUpdateNumbersPeriod(this, &robotManager::requestsHandler::handle_applyUpdateNumbersPeriod),
+    my_functor_thread_requestSensors(this, &robotManager::requestsHandler::thread_requestSensors),
     my_functor_handle_updateNumbers(this, &robotManager::requestsHandler::handle_updateNumbers),
     my_functor_handle_getSensorList(this, &robotManager::requestsHandler::handle_getSensorList),
     my_functor_handle_getSensorCurrent(this, &robotManager::requestsHandler::handle_getSensorCurrent)
@@ -83,52 +187,101 @@ robotManager::requestsHandler::requestsHandler( ArClientBase* _client) :
     // Handlers installation
     my_client->addHandler("getSensorCurrent", &my_functor_handle_getSensorCurrent);
 
-    // Add "updateNumers" requests routine (1000 ms)
+    // Add "updateNumers" requests routine (1000 ms, see get_updateNumbersRate())
+    my_updateNumbersRate.setStats( &my_updateNumbersStats );
     my_client->addHandler("updateNumbers", &my_functor_handle_updateNumbers);
-    my_client->request("updateNumbers", 1000);
+    my_updateNumbersRate.setPeriod( 1000 );
 
     my_client->addHandler("getSensorList", &my_functor_handle_getSensorList);
     my_client->requestOnce("getSensorList");
 }
 
+robotManager::requestsHandler::~requestsHandler()
+{
+    stopReadingSensors();
+    delete my_sensors.exchange( NULL );
+}
+
 void robotManager::requestsHandler::handle_updateNumbers(ArNetPacket* packet)
 {
-    my_batteryVoltage = (double) packet->bufToByte2();
-    my_xPosition = (double) packet->bufToByte4();
-    my_yPosition = (double) packet->bufToByte4();
-    my_theta = (double) packet->bufToByte2();
-    my_velocity = (double) packet->bufToByte2();
-    my_rotationalVelocity = (double) packet->bufToByte2();
+    long long receiveTime_us = clientUtil::monotonicTime_us();
+    robotState state;
+    state.sequence = 0;
+    state.timestamp_us = receiveTime_us;
+    state.batteryVoltage = (double) packet->bufToByte2();
+    state.xPosition = (double) packet->bufToByte4();
+    state.yPosition = (double) packet->bufToByte4();
+    state.theta = (double) packet->bufToByte2();
+    state.velocity = (double) packet->bufToByte2();
+    state.rotationalVelocity = (double) packet->bufToByte2();
     packet->bufToByte2(); // Skip lateralVelocity
-    my_temperatur = (double) packet->bufToByte();
+    state.temperature = (double) packet->bufToByte();
+    my_updateNumbersRate.recordArrival( receiveTime_us, (int) packet->getLength() );
+    my_updateNumbersStats.recordArrival( receiveTime_us, (int) packet->getLength() );
+
+    robotState previous;
+    state.sequence = my_state.load( &previous ) + 1;
+    my_state.store( state );
+    my_stateNotifier.notify();
+    my_motionTracker.update( state, receiveTime_us );
+
+    timedPose timed = { receiveTime_us, state.xPosition, state.yPosition, state.theta,
+                        state.velocity, state.rotationalVelocity };
+    my_poseHistory.push( timed );
+
+    if( my_telemetry->isRecording() )
+    {
+        telemetryPose pose = { receiveTime_us, state.batteryVoltage, state.xPosition, state.yPosition,
+                               state.theta, state.velocity, state.rotationalVelocity, state.temperature };
+        my_telemetry->recordPose( pose );
+    }
 
     if (my_verboseMode)
     {
-        printf("%3.2f|%6.2f|%6.2f|%6.2f|%6.2f|%6.2f|%6.2f\n", my_batteryVoltage, my_xPosition,
-               my_yPosition, my_theta, my_velocity, my_rotationalVelocity,
-               my_temperatur);
-        fflush(stdout);
+        asyncLog::getDefault()->print("%3.2f|%6.2f|%6.2f|%6.2f|%6.2f|%6.2f|%6.2f\n", state.batteryVoltage, state.xPosition,
+                                      state.yPosition, state.theta, state.velocity, state.rotationalVelocity,
+                                      state.temperature);
     }
 }
 
+void robotManager::requestsHandler::handle_applyUpdateNumbersPeriod( int period_ms )
+{
+    if( period_ms > 0 )
+        my_client->request("updateNumbers", period_ms);
+    else
+        my_client->requestStop("updateNumbers");
+}
+
 void robotManager::requestsHandler::handle_getSensorList( ArNetPacket* packet )
 {
+    // The list does not change while connected - the table is built once
+    if( my_sensors.load() != NULL )
+        return;
+
     int numberOfSensors = (int) packet->bufToByte2();
     char sensorName[255];
+    std::vector<std::string> sensorsVector;
 
     for( int i = 0; i < numberOfSensors; i++ )
     {
         memset(sensorName, 0, sizeof(sensorName));
         packet->bufToStr( sensorName, sizeof( sensorName ));
-        my_sensorsVector.push_back( std::string( sensorName ) );
+        sensorsVector.push_back( std::string( sensorName ) );
+    }
+
+    sensorTable* sensors = new sensorTable( sensorsVector );
+    sensorTable* expected = NULL;
+    if( !my_sensors.compare_exchange_strong( expected, sensors ))
+    {
+        delete sensors;
+        return;
     }
 
     if (my_verboseMode)
     {
-        printf("SENSORS AVAILABLE:\n");
-        for( std::vector<std::string>::iterator i = my_sensorsVector.begin(); i != my_sensorsVector.end(); ++i)
-            printf("\t* %s\n", (*i).c_str() );
-        fflush(stdout);
+        asyncLog::getDefault()->print("SENSORS AVAILABLE:\n");
+        for( int i = 0; i < sensors->getCount(); i++ )
+            asyncLog::getDefault()->print("\t* %s\n", sensors->get( i )->getName().c_str() );
     }
 }
 
@@ -136,53 +289,190 @@ bool robotManager::requestsHandler::startReadingLaser()
 {
     // Start reading data from laser reading (or the first radar recognized).
     // We assume here that laser is shown as the first radar.
-    if( my_sensorsVector.size() > 0 )
-    {
-        ArNetPacket* request_name_packet = new ArNetPacket();
-        request_name_packet->strToBuf( my_sensorsVector[0].c_str() );
-        request_name_packet->finalizePacket();
+    sensorTable* sensors = my_sensors.load();
+    if( sensors == NULL || sensors->getCount() == 0 )
+        return false;
+    return startReadingSensor( sensors->get( 0 )->getName(), 100 );
+}
+
+bool robotManager::requestsHandler::startReadingSensor( const std::string& name, int period_ms )
+{
+    sensorTable* sensors = my_sensors.load();
+    sensorStream* sensor = sensors != NULL ? sensors->find( name.c_str() ) : NULL;
+    if( sensor == NULL || period_ms <= 0 )
+        return false;
 
-        my_client->request("getSensorCurrent", 100, request_name_packet);
-        return true;
+    sensor->setPeriod( period_ms );
+    my_requestSensorsMutex.lock();
+    if( !my_isRequestingSensors )
+    {
+        my_isRequestingSensors = true;
+        my_thread_requestSensors.create( &my_functor_thread_requestSensors );
     }
-    else
+    my_requestSensorsMutex.unlock();
+    return true;
+}
+
+bool robotManager::requestsHandler::stopReadingSensor( const std::string& name )
+{
+    sensorTable* sensors = my_sensors.load();
+    sensorStream* sensor = sensors != NULL ? sensors->find( name.c_str() ) : NULL;
+    if( sensor == NULL )
         return false;
+
+    sensor->setPeriod( 0 );
+    return true;
+}
+
+void robotManager::requestsHandler::stopReadingSensors()
+{
+    sensorTable* sensors = my_sensors.load();
+    for( int i = 0; sensors != NULL && i < sensors->getCount(); i++ )
+        sensors->get( i )->setPeriod( 0 );
+
+    my_requestSensorsMutex.lock();
+    if( my_isRequestingSensors )
+    {
+        my_isRequestingSensors = false;
+        my_thread_requestSensors.join();
+    }
+    my_requestSensorsMutex.unlock();
+}
+
+void robotManager::requestsHandler::thread_requestSensors()
+{
+    // Every sensor is requested with its own period (one periodic request per
+    // command name is possible in ArClientBase, so they are sent from here)
+    const long long IDLE_PERIOD_us = 50000;
+    sensorTable* sensors = my_sensors.load();
+    while( my_isRequestingSensors )
+    {
+        long long now_us = clientUtil::monotonicTime_us();
+        long long wakeUp_us = now_us + IDLE_PERIOD_us;
+        for( int i = 0; i < sensors->getCount(); i++ )
+        {
+            sensorStream* sensor = sensors->get( i );
+            int period_ms = sensor->getPeriod();
+            if( period_ms <= 0 )
+            {
+                sensor->setNextRequest_us( 0 );
+                continue;
+            }
+
+            long long nextRequest_us = sensor->getNextRequest_us();
+            if( nextRequest_us <= now_us )
+            {
+                my_command_getSensorCurrent.sendOnce( sensor->getRequestPacket() );
+                // Keep the rate, but do not send a burst after a stall
+                nextRequest_us = std::max( nextRequest_us + period_ms * 1000LL, now_us );
+                sensor->setNextRequest_us( nextRequest_us );
+            }
+            wakeUp_us = std::min( wakeUp_us, nextRequest_us );
+        }
+        clientUtil::sleepUntil_us( wakeUp_us );
+    }
 }
 
 void robotManager::requestsHandler::handle_getSensorCurrent( ArNetPacket* packet )
 {
+    long long receiveTime_us = clientUtil::monotonicTime_us();
     int numberOfReadings = (int) packet->bufToByte2();
     if( numberOfReadings < 0 )
         return;
 
-    char sensorName[255];
-    memset(sensorName, 0, sizeof(sensorName));
-    packet->bufToStr( sensorName, sizeof( sensorName ));
+    sensorTable* sensors = my_sensors.load();
+    sensorStream* sensor = sensors != NULL ? sensors->findInPacket( packet ) : NULL;
+    if( sensor == NULL )
+        return;
 
-    if( std::string( sensorName ) == my_sensorsVector[0] )
+    laserScan* scan = sensor->acquireScan( numberOfReadings );
+    if( scan == NULL )
     {
-        // Assuming that laser is at [0]
+        sensor->getStats()->recordDrops();
+        return;
+    }
 
-        for( int i = -(numberOfReadings - 1)/ 2; i <= (numberOfReadings - 1)/ 2; i++ )
-        {
-            my_laserReading[i] = std::make_pair( packet->bufToByte4(), packet->bufToByte4());
-        }
-        if( my_verboseMode )
-        {
-            printf("LASER READING (%d): (%6d, %6d)\n", 0, my_laserReading[-(numberOfReadings - 1)/ 2].first, my_laserReading[0].second);
-            fflush(stdout);
-        }
+    int* x = scan->getWritableX();
+    int* y = scan->getWritableY();
+    for( int i = 0; i < numberOfReadings; i++ )
+    {
+        x[i] = packet->bufToByte4();
+        y[i] = packet->bufToByte4();
+    }
+    sensor->getRate()->recordArrival( receiveTime_us, (int) packet->getLength() );
+    sensor->getStats()->recordArrival( receiveTime_us, (int) packet->getLength() );
+
+    // Telemetry holds the laser stream only (the first sensor)
+    if( sensor->getIndex() == 0 && my_telemetry->isRecording() && numberOfReadings > 0 )
+        my_telemetry->recordLaser( receiveTime_us, x, y, numberOfReadings );
+    if( my_verboseMode && numberOfReadings > 0 )
+    {
+        asyncLog::getDefault()->print("%s READING (%d): (%6d, %6d)\n", sensor->getName().c_str(), 0, x[0], y[( numberOfReadings - 1 )/ 2]);
     }
+    sensor->publishScan( scan, receiveTime_us );
 }
 
 std::vector<std::string> robotManager::requestsHandler::get_sensorsVector()
 {
-    return my_sensorsVector;
+    std::vector<std::string> sensorsVector;
+    sensorTable* sensors = my_sensors.load();
+    for( int i = 0; sensors != NULL && i < sensors->getCount(); i++ )
+        sensorsVector.push_back( sensors->get( i )->getName() );
+    return sensorsVector;
+}
+
+scanHandle robotManager::requestsHandler::get_laserScan()
+{
+    sensorTable* sensors = my_sensors.load();
+    if( sensors == NULL || sensors->getCount() == 0 )
+        return scanHandle();
+    return sensors->get( 0 )->getScan();
+}
+
+scanHandle robotManager::requestsHandler::get_sensorScan( const std::string& name )
+{
+    sensorTable* sensors = my_sensors.load();
+    sensorStream* sensor = sensors != NULL ? sensors->find( name.c_str() ) : NULL;
+    if( sensor == NULL )
+        return scanHandle();
+    return sensor->getScan();
+}
+
+scanHandle robotManager::requestsHandler::wait_laserScan( unsigned long long lastSequence, int timeout_ms )
+{
+    sensorTable* sensors = my_sensors.load();
+    if( sensors == NULL || sensors->getCount() == 0 )
+        return scanHandle();
+    return sensors->get( 0 )->waitForScan( lastSequence, timeout_ms );
+}
+
+scanHandle robotManager::requestsHandler::wait_sensorScan( const std::string& name,
+        unsigned long long lastSequence, int timeout_ms )
+{
+    sensorTable* sensors = my_sensors.load();
+    sensorStream* sensor = sensors != NULL ? sensors->find( name.c_str() ) : NULL;
+    if( sensor == NULL )
+        return scanHandle();
+    return sensor->waitForScan( lastSequence, timeout_ms );
+}
+
+int robotManager::requestsHandler::get_sensorEventFd( const std::string& name )
+{
+    sensorTable* sensors = my_sensors.load();
+    sensorStream* sensor = sensors != NULL ? sensors->find( name.c_str() ) : NULL;
+    return sensor != NULL ? sensor->getEventFd() : -1;
 }
 
 std::map< int, std::pair<int, int> > robotManager::requestsHandler::get_laserReading()
 {
-    return my_laserReading;
+    std::map< int, std::pair<int, int> > laserReading;
+    scanHandle scan = get_laserScan();
+    if( scan.empty() )
+        return laserReading;
+
+    for( int i = 0; i < scan->getSize(); i++ )
+        laserReading[scan->getFirstIndex() + i] = std::make_pair( scan->getX()[i], scan->getY()[i] );
+    return laserReading;
 }
 
 void robotManager::requestsHandler::enableVerboseMode()
@@ -190,43 +480,110 @@ void robotManager::requestsHandler::enableVerboseMode()
     my_verboseMode = true;
 }
 
+bool robotManager::requestsHandler::get_poseAt( long long timestamp_us, timedPose* pose )
+{
+    return my_poseHistory.getPoseAt( timestamp_us, pose );
+}
+
+poseHistory* robotManager::requestsHandler::get_poseHistory()
+{
+    return &my_poseHistory;
+}
+
+commandTracker<robotState>* robotManager::requestsHandler::get_motionTracker()
+{
+    return &my_motionTracker;
+}
+
+rateController* robotManager::requestsHandler::get_updateNumbersRate()
+{
+    return &my_updateNumbersRate;
+}
+
+rateController* robotManager::requestsHandler::get_sensorRate( const std::string& name )
+{
+    sensorTable* sensors = my_sensors.load();
+    sensorStream* sensor = sensors != NULL ? sensors->find( name.c_str() ) : NULL;
+    return sensor != NULL ? sensor->getRate() : NULL;
+}
+
+streamStats* robotManager::requestsHandler::get_updateNumbersStats()
+{
+    return &my_updateNumbersStats;
+}
+
+std::vector<streamStats*> robotManager::requestsHandler::get_streamStats()
+{
+    std::vector<streamStats*> stats( 1, &my_updateNumbersStats );
+    sensorTable* sensors = my_sensors.load();
+    for( int i = 0; sensors != NULL && i < sensors->getCount(); i++ )
+        stats.push_back( sensors->get( i )->getStats() );
+    return stats;
+}
+
+robotState robotManager::requestsHandler::get_robotState()
+{
+    robotState state;
+    my_state.load( &state );
+    return state;
+}
+
+bool robotManager::requestsHandler::wait_robotState( unsigned long long lastSequence, int timeout_ms,
+        robotState* state )
+{
+    return my_stateNotifier.waitFor( [&]() { my_state.load( state ); return state->sequence > lastSequence; },
+                                     timeout_ms );
+}
+
+int robotManager::requestsHandler::get_robotStateEventFd()
+{
+    return my_stateNotifier.getEventFd();
+}
+
 double robotManager::requestsHandler::get_xPosition()
 {
-    return my_xPosition;
+    return get_robotState().xPosition;
 }
 
 double robotManager::requestsHandler::get_yPosition()
 {
-    return my_yPosition;
+    return get_robotState().yPosition;
 }
 
 double robotManager::requestsHandler::get_theta()
 {
-    return my_theta;
+    return get_robotState().theta;
 }
 
 double robotManager::requestsHandler::get_velocity()
 {
-    return my_velocity;
+    return get_robotState().velocity;
 }
 
 double robotManager::requestsHandler::get_rotationalVelocity()
 {
-    return my_rotationalVelocity;
+    return get_robotState().rotationalVelocity;
 }
 
 robotManager::steeringManager::steeringManager( ArClientBase *_client,
-        keyHandlerMaster *_keyHandler, bool _activateKeySteering) :
+        keyHandlerMaster *_keyHandler, requestsHandler *_requests, bool _activateKeySteering) :
     my_verboseMode( false ), my_keySteeringActiveStatus( false ),
     my_isRunningByKeys( false ), my_isVelocitySteering( false ),
     VEL_PERC( 50 ), my_velThrottle(0), my_rotThrottle(0),
-    my_client( _client ), my_keyHandler( _keyHandler ), my_clientRatioDrive( my_client ),
+    my_distanceTolerance_mm( 10.0 ), my_angleTolerance_deg( 2.0 ),
+    my_velocityTolerance_mms( 10.0 ), my_rotationalVelocityTolerance_degs( 2.0 ),
+    my_client( _client ), my_keyHandler( _keyHandler ), my_requests( _requests ),
+    my_clientRatioDrive( my_client ),
+    my_command_moveDist( _client, "moveDist" ), my_command_turnByAngle( _client, "turnByAngle" ),
+    my_command_turnToHeading( _client, "turnToHeading" ),
     my_functor_handle_key_up( this, &robotManager::steeringManager::handle_key_up),
     my_functor_handle_key_down( this, &robotManager::steeringManager::handle_key_down),
     my_functor_handle_key_left( this, &robotManager::steeringManager::handle_key_left),
     my_functor_handle_key_right( this, &robotManager::steeringManager::handle_key_right),
     my_functor_handle_key_space( this, &robotManager::steeringManager::handle_key_space),
-    my_functor_callback_keySteeringCallback( this, &robotManager::steeringManager::callback_keySteeringCallback)
+    my_functor_callback_keySteeringCallback( this, &robotManager::steeringManager::callback_keySteeringCallback),
+    my_functor_handle_sendVelocity( this, &robotManager::steeringManager::handle_sendVelocity),
+    my_velocityCoalescer( &my_functor_handle_sendVelocity, 2, commandCoalescer::MERGE_LATEST, 20 )
 {
     if ( _activateKeySteering )
         activateKeySteering();
@@ -238,7 +595,9 @@ void robotManager::steeringManager::handle_key_up()
 {
     if( my_isVelocitySteering )
     {
+        my_throttleMutex.lock();
         my_velThrottle += 0.025; //@ThrottleKeyboardMode
+        my_throttleMutex.unlock();
         //my_clientRatioDrive.setTransVelRatio( VEL_PERC ); //@ThrottleKeyboardMode
     }
     else moveDistance( 20 );
@@ -248,7 +607,9 @@ void robotManager::steeringManager::handle_key_down()
 {
     if( my_isVelocitySteering )
     {
+        my_throttleMutex.lock();
         my_velThrottle -= 0.025; //@ThrottleKeyboardMode
+        my_throttleMutex.unlock();
         //my_clientRatioDrive.setTransVelRatio( -VEL_PERC ); //@ThrottleKeyboardMode
     }
     else moveDistance( -10 );
@@ -258,7 +619,9 @@ void robotManager::steeringManager::handle_key_left()
 {
     if( my_isVelocitySteering )
     {
+        my_throttleMutex.lock();
         my_rotThrottle += 0.1; //@ThrottleKeyboardMode
+        my_throttleMutex.unlock();
         //my_clientRatioDrive.setRotVelRatio( VEL_PERC ); //@ThrottleKeyboardMode
     }
     else turnByAngle( 5 );
@@ -268,7 +631,9 @@ void robotManager::steeringManager::handle_key_right()
 {
     if( my_isVelocitySteering )
     {
+        my_throttleMutex.lock();
         my_rotThrottle -= 0.1; //@ThrottleKeyboardMode
+        my_throttleMutex.unlock();
         //my_clientRatioDrive.setRotVelRatio( -VEL_PERC ); //@ThrottleKeyboardMode
     }
     else turnByAngle( -5 );
@@ -276,46 +641,65 @@ void robotManager::steeringManager::handle_key_right()
 
 void robotManager::steeringManager::handle_key_space()
 {
+    my_velocityCoalescer.discard();
     my_clientRatioDrive.stop();
 }
 
 void robotManager::steeringManager::callback_keySteeringCallback()
 {
+    // Throttle decay per second (0.015 / 0.025 per tick of the former 10 Hz loop),
+    // scaled by the control period so it does not depend on the tick rate
+    const double VEL_DECAY = 0.15, ROT_DECAY = 0.25;
+    double period_s = my_keyHandler->getControlPeriod_s();
+
+    my_throttleMutex.lock();
     if (ArMath::fabs( my_velThrottle ) < 0.01 &&
             ArMath::fabs( my_rotThrottle ) < 0.01)
     {
+        my_throttleMutex.unlock();
         if ( my_isRunningByKeys )
         {
+            my_velocityCoalescer.discard();
             my_clientRatioDrive.stop();
             my_isRunningByKeys = false;
         }
+        return;
     }
-    else
-    {
-        my_isRunningByKeys = true;
 
-        if (my_velThrottle > 0)
-            my_velThrottle -= 0.015;
-        else
-            my_velThrottle += 0.015;
+    my_isRunningByKeys = true;
 
-        if (my_rotThrottle > 0)
-            my_rotThrottle -= 0.025;
-        else
-            my_rotThrottle += 0.025;
+    my_velThrottle = decayThrottle( my_velThrottle, VEL_DECAY * period_s );
+    my_rotThrottle = decayThrottle( my_rotThrottle, ROT_DECAY * period_s );
+    double velThrottle = my_velThrottle, rotThrottle = my_rotThrottle;
+    my_throttleMutex.unlock();
 
-        if (my_velThrottle < -1)
-            my_velThrottle = -1;
-        else if(my_velThrottle > 1)
-            my_velThrottle = 1;
-        if (my_rotThrottle < -1)
-            my_rotThrottle = -1;
-        else if (my_rotThrottle > 1)
-            my_rotThrottle = 1;
+    setVelocityRatio( VEL_PERC * velThrottle, VEL_PERC * rotThrottle );
+}
 
-        my_clientRatioDrive.setTransVelRatio( VEL_PERC * my_velThrottle);
-        my_clientRatioDrive.setRotVelRatio( VEL_PERC * my_rotThrottle);
-    }
+double robotManager::steeringManager::decayThrottle( double throttle, double decay )
+{
+    // Towards zero without overshooting it, then limited to [-1, 1]
+    if( ArMath::fabs( throttle ) <= decay )
+        return 0.0;
+    throttle += throttle > 0 ? -decay : decay;
+    return std::min( std::max( throttle, -1.0 ), 1.0 );
+}
+
+void robotManager::steeringManager::setVelocityRatio( double transRatio, double rotRatio )
+{
+    double setpoint[2] = { transRatio, rotRatio };
+    my_velocityCoalescer.submit( setpoint );
+}
+
+commandCoalescer* robotManager::steeringManager::getVelocityCoalescer()
+{
+    return &my_velocityCoalescer;
+}
+
+void robotManager::steeringManager::handle_sendVelocity( const double* values )
+{
+    my_clientRatioDrive.setTransVelRatio( values[0] );
+    my_clientRatioDrive.setRotVelRatio( values[1] );
 }
 
 void robotManager::steeringManager::activateKeySteering()
@@ -366,31 +750,109 @@ void robotManager::steeringManager::turnToHeading( double angle_deg )
     return;
 }
 
+std::future<commandStatus> robotManager::steeringManager::moveDistanceAsync( double distance_mm, int timeout_ms )
+{
+    robotState start = my_requests->get_robotState();
+    double distanceTolerance_mm = my_distanceTolerance_mm, velocityTolerance_mms = my_velocityTolerance_mms;
+    // Without a state yet the first received pose is the starting point
+    bool hasStart = start.sequence != 0;
+    std::future<commandStatus> result = my_requests->get_motionTracker()->track(
+        [=]( const robotState& state ) mutable
+        {
+            if( !hasStart )
+            {
+                start = state;
+                hasStart = true;
+            }
+            double dx = state.xPosition - start.xPosition, dy = state.yPosition - start.yPosition;
+            return sqrt( dx * dx + dy * dy ) >= fabs( distance_mm ) - distanceTolerance_mm &&
+                   fabs( state.velocity ) <= velocityTolerance_mms;
+        }, timeout_ms, clientUtil::monotonicTime_us() );
+
+    handle_jogModeRequests(0, distance_mm);
+    return result;
+}
+
+std::future<commandStatus> robotManager::steeringManager::turnByAngleAsync( double angle_deg, int timeout_ms )
+{
+    // A pose older than this may not be the heading the turn starts from
+    static const long long FRESH_STATE_US = 100000;
+
+    long long now_us = clientUtil::monotonicTime_us();
+    robotState start = my_requests->get_robotState();
+    double angleTolerance_deg = my_angleTolerance_deg, rotationalVelocityTolerance_degs = my_rotationalVelocityTolerance_degs;
+    bool hasStart = start.sequence != 0 && now_us - start.timestamp_us <= FRESH_STATE_US;
+    double lastTheta = start.theta, turned_deg = 0.0;
+    // The heading change is summed, so turns of 360 degrees and more are tracked too
+    // (as long as the robot turns less than 180 degrees between two updateNumbers packets)
+    std::future<commandStatus> result = my_requests->get_motionTracker()->track(
+        [=]( const robotState& state ) mutable
+        {
+            if( !hasStart )
+            {
+                // The command is sent only now, from the first pose received after the call
+                lastTheta = state.theta;
+                hasStart = true;
+                handle_jogModeRequests(1, angle_deg);
+                return false;
+            }
+            turned_deg += ArMath::subAngle( state.theta, lastTheta );
+            lastTheta = state.theta;
+            bool reached = angle_deg >= 0 ? turned_deg >= angle_deg - angleTolerance_deg
+                                          : turned_deg <= angle_deg + angleTolerance_deg;
+            return reached && ArMath::fabs( state.rotationalVelocity ) <= rotationalVelocityTolerance_degs;
+        }, timeout_ms, now_us );
+
+    if( hasStart )
+        handle_jogModeRequests(1, angle_deg);
+    return result;
+}
+
+std::future<commandStatus> robotManager::steeringManager::turnToHeadingAsync( double angle_deg, int timeout_ms )
+{
+    double angleTolerance_deg = my_angleTolerance_deg, rotationalVelocityTolerance_degs = my_rotationalVelocityTolerance_degs;
+    double heading = ArMath::fixAngle( angle_deg );
+    std::future<commandStatus> result = my_requests->get_motionTracker()->track(
+        [=]( const robotState& state )
+        {
+            return ArMath::fabs( ArMath::subAngle( state.theta, heading )) <= angleTolerance_deg &&
+                   ArMath::fabs( state.rotationalVelocity ) <= rotationalVelocityTolerance_degs;
+        }, timeout_ms, clientUtil::monotonicTime_us() );
+
+    handle_jogModeRequests(2, angle_deg);
+    return result;
+}
+
+void robotManager::steeringManager::setMotionTolerance( double distance_mm, double angle_deg,
+        double velocity_mms, double rotationalVelocity_degs )
+{
+    my_distanceTolerance_mm = distance_mm;
+    my_angleTolerance_deg = angle_deg;
+    my_velocityTolerance_mms = velocity_mms;
+    my_rotationalVelocityTolerance_degs = rotationalVelocity_degs;
+}
+
 void robotManager::steeringManager::handle_jogModeRequests(int i, double value )
 {
-    std::string mode;
+    clientCommand* command;
     switch ( i )
     {
     case 0:
-        mode = "moveDist";
+        command = &my_command_moveDist;
         break;
 
     case 1:
-        mode = "turnByAngle";
+        command = &my_command_turnByAngle;
         break;
 
     case 2:
-        mode = "turnToHeading";
+        command = &my_command_turnToHeading;
         break;
 
     default:
         return;
     }
-    ArNetPacket* packet = new ArNetPacket();
-    packet->doubleToBuf( value );
-    packet->finalizePacket();
-
-    my_client->requestOnce(mode.c_str(), packet);
+    command->sendOnce( [value]( ArNetPacket* packet ) { packet->doubleToBuf( value ); } );
     return;
 }
 
@@ -409,34 +871,59 @@ void robotManager::steeringManager::enableVerboseMode()
     my_verboseMode = true;
 }
 
-robotManager::cameraManager::cameraManager( ArClientBase* _client, keyHandlerMaster* _keyHandler ) :
-    my_sendVideoDelay( 200 ), my_video_mutexOn(true),
-    my_recordToFolder( false ), my_cameraSteeringActiveStatus( false ),
-    my_client( _client ), my_keyHandler( _keyHandler ),
+robotManager::cameraManager::cameraManager( ArClientBase* _client, keyHandlerMaster* _keyHandler,
+                                            telemetryRecorder* _telemetry ) :
+    my_cameraTolerance( 1 ), my_isRequestingCameraData( false ),
+    my_frameSequence( 0 ), my_oversizedFrames( 0 ), my_videoStats( "sendVideo" ), my_lastConsumerDrops( 0 ),
+    my_decoder( &my_videoStats ),
+    my_videoRate( &my_functor_handle_applyVideoPeriod, 0 ),
+    my_cameraInfoRate( &my_functor_handle_applyCameraInfoPeriod, 0 ),
+    my_recorder( &my_frameSubscribers ), my_replay( &my_functor_handle_replayFrame ),
+    my_cameraSteeringActiveStatus( false ),
+    my_client( _client ), my_keyHandler( _keyHandler ), my_telemetry( _telemetry ),
+    my_command_setCameraAbs( _client, "setCameraAbsCamera_1" ), my_command_setCameraRel( _client, "setCameraRelCamera_1" ),
     my_functor_handle_getCameraList(this, &robotManager::cameraManager::handle_getCameraList),
     my_functor_handle_snapshot(this, &robotManager::cameraManager::handle_snapshot),
     my_functor_handle_getCameraInfoCamera_1(this, &robotManager::cameraManager::handle_getCameraInfoCamera_1),
     my_functor_hanlde_getCameraDataCamera_1(this, &robotManager::cameraManager::handle_getCameraDataCamera_1),
+    my_functor_handle_replayFrame(this, &robotManager::cameraManager::handle_replayFrame),
+    my_functor_handle_applyVideoPeriod(this, &robotManager::cameraManager::handle_applyVideoPeriod),
+    my_functor_handle_applyCameraInfoPeriod(this, &robotManager::cameraManager::handle_applyCameraInfoPeriod),
+    my_functor_handle_sendCameraMove(this, &robotManager::cameraManager::handle_sendCameraMove),
     my_functor_handle_key_w(this, &robotManager::cameraManager::handle_key_w),
     my_functor_handle_key_s(this, &robotManager::cameraManager::handle_key_s),
     my_functor_handle_key_a(this, &robotManager::cameraManager::handle_key_a),
     my_functor_handle_key_d(this, &robotManager::cameraManager::handle_key_d),
     my_functor_handle_key_r(this, &robotManager::cameraManager::handle_key_r),
-    my_functor_handle_key_f(this, &robotManager::cameraManager::handle_key_f)
+    my_functor_handle_key_f(this, &robotManager::cameraManager::handle_key_f),
+    my_cameraMoveCoalescer( &my_functor_handle_sendCameraMove, 3, commandCoalescer::MERGE_SUM, 100 )
 {
 //        Something is wrong with this request. Please check in header file.
 //        my_client->addHandler("getCameraList", &my_functor_handle_getCameraList);
 //        my_client->requestOnce("getCameraList");
 
+    // Periods can be changed later - see getVideoRate() and getCameraInfoRate()
+    my_videoRate.setStats( &my_videoStats );
     my_client->addHandler("sendVideo", &my_functor_handle_snapshot);
-    my_client->request("sendVideo", my_sendVideoDelay);
+    my_videoRate.setPeriod( 200 );
 
     my_client->addHandler("getCameraInfoCamera_1", &my_functor_handle_getCameraInfoCamera_1);
-    my_client->request("getCameraInfoCamera_1", 1000);
+    my_cameraInfoRate.setPeriod( 1000 );
+
+    // Requested only while camera commands wait for completion
+    my_client->addHandler("getCameraDataCamera_1", &my_functor_hanlde_getCameraDataCamera_1);
 
     resetPosition();
 }
 
+robotManager::cameraManager::~cameraManager()
+{
+    // Replay delivers frames to the recorder and the decoder, so it is stopped first
+    stopReplay();
+    stopRecording();
+    stopDecoding();
+}
+
 void robotManager::cameraManager::handle_getCameraList( ArNetPacket* packet )
 {
     int numberOfCameras = (int) packet->bufToByte2();
@@ -486,28 +973,111 @@ void robotManager::cameraManager::handle_getCameraList( ArNetPacket* packet )
 
 void robotManager::cameraManager::handle_snapshot( ArNetPacket* packet )
 {
+    long long receiveTime_us = clientUtil::monotonicTime_us();
+
+    // Only one thread may deliver frames - a replayed session takes over the
+    // stream until it finishes. tryLock() keeps this thread from ever waiting.
+    if( my_replay.isRunning() || my_deliveryMutex.tryLock() != 0 )
+        return;
+
     // Meta data variables:
     int width = (int) packet->bufToByte2();
     int height = (int) packet->bufToByte2();
 
     // Calculate how much should we read to obtain image
-    my_video_mutexOn = true;
-    my_lastSnapSize = (int) packet->getDataLength() - (int) packet->getDataReadLength();
-
-    // Set on the mutex so other functions know that my_lastSnap is under
-    // maintenance.
-    memset( my_lastSnap, 0, sizeof( my_lastSnap ));
-    packet->bufToData( my_lastSnap, my_lastSnapSize );
-    my_video_mutexOn = false;
+    int snapSize = (int) packet->getDataLength() - (int) packet->getDataReadLength();
 
-    if( my_recordToFolder )
-        recordFrame( my_lastSnap, my_lastSnapSize );
+    // The frame is written into a buffer nobody else can see yet and becomes
+    // visible to readers only after it is complete.
+    frameBuffer* frame = my_framePool.acquire( snapSize );
+    if( frame == NULL )
+    {
+        my_deliveryMutex.unlock();
+        my_oversizedFrames++;
+        my_videoStats.recordDrops();
+        if( my_verboseMode )
+        {
+            asyncLog::getDefault()->print("Snap dropped: %d bytes exceeds the limit of %d bytes\n",
+                                          snapSize, my_framePool.getMaxBufferSize());
+        }
+        return;
+    }
+    packet->bufToData( frame->getWritableData(), snapSize );
+    frame->setLength( snapSize );
+    frame->setFrameInfo( width, height, ++my_frameSequence, receiveTime_us );
+    // The receive thread serves every handler of the connection - it must never wait for a subscriber
+    deliverFrame( frame, false );
+    my_deliveryMutex.unlock();
+
+    unsigned long long consumerDrops = 0;
+    my_frameSubscribers.forEach( [&consumerDrops]( frameSubscriber* subscriber )
+    {
+        consumerDrops += subscriber->getDroppedCount();
+    } );
+    // The sum falls when a subscriber leaves - only growth counts as new drops
+    unsigned long long newDrops = consumerDrops > my_lastConsumerDrops ? consumerDrops - my_lastConsumerDrops : 0;
+    my_lastConsumerDrops = consumerDrops;
+    my_videoRate.recordArrival( receiveTime_us, snapSize, newDrops );
+    my_videoStats.recordArrival( receiveTime_us, snapSize );
+    if( newDrops > 0 )
+        my_videoStats.recordDrops( newDrops );
 
     if (my_verboseMode)
     {
-        printf("Snap: %d | %d | %d\n", width, height, my_lastSnapSize);
-        fflush(stdout);
+        asyncLog::getDefault()->print("Snap: %d | %d | %d\n", width, height, snapSize);
+    }
+}
+
+void robotManager::cameraManager::deliverFrame( frameBuffer* frame, bool mayWait )
+{
+    if( my_telemetry->isRecording() )
+    {
+        telemetryFrame description = { frame->getTimestamp_us(), frame->getSequence(),
+                                       frame->getWidth(), frame->getHeight(), frame->getLength() };
+        my_telemetry->recordFrame( description );
     }
+
+    my_frameSubscribers.forEach( [frame, mayWait]( frameSubscriber* subscriber )
+    {
+        subscriber->push( frame, mayWait );
+    } );
+    my_decoder.push( frame );
+
+    my_frameStore.publish( frame );
+    my_frameNotifier.notify();
+}
+
+void robotManager::cameraManager::handle_replayFrame( const frameLogFrame* replayed )
+{
+    frameBuffer* frame = my_framePool.acquire( replayed->length );
+    if( frame == NULL )
+    {
+        my_oversizedFrames++;
+        return;
+    }
+    memcpy( frame->getWritableData(), replayed->data, replayed->length );
+    frame->setLength( replayed->length );
+    my_deliveryMutex.lock();
+    frame->setFrameInfo( replayed->width, replayed->height, ++my_frameSequence,
+                         clientUtil::monotonicTime_us() );
+    deliverFrame( frame, true );
+    my_deliveryMutex.unlock();
+}
+
+bool robotManager::cameraManager::startReplay( const std::string& path, frameReplay::pace pace,
+        bool loop, double speed )
+{
+    return my_replay.start( path, pace, loop, speed );
+}
+
+void robotManager::cameraManager::stopReplay()
+{
+    my_replay.stop();
+}
+
+bool robotManager::cameraManager::isReplaying()
+{
+    return my_replay.isRunning();
 }
 
 void robotManager::cameraManager::handle_getCameraInfoCamera_1( ArNetPacket* packet )
@@ -522,7 +1092,7 @@ void robotManager::cameraManager::handle_getCameraInfoCamera_1( ArNetPacket* pac
 
     if( my_verboseMode )
     {
-        printf("## Camera parameters:\n\
+        asyncLog::getDefault()->print("## Camera parameters:\n\
 # min Pan: %d\n\
 # max Pan: %d\n\
 # min Tilt: %d\n\
@@ -530,9 +1100,8 @@ void robotManager::cameraManager::handle_getCameraInfoCamera_1( ArNetPacket* pac
 # min Zoom: %d\n\
 # max Zoom: %d\n\
 ##\n", my_camera_minPan, my_camera_maxPan,
-               my_camera_minTilt, my_camera_maxTilt,
-               my_camera_minZoom, my_camera_maxZoom);
-        fflush(stdout);
+                                      my_camera_minTilt, my_camera_maxTilt,
+                                      my_camera_minZoom, my_camera_maxZoom);
     }
 }
 
@@ -544,70 +1113,124 @@ void robotManager::cameraManager::handle_getCameraDataCamera_1( ArNetPacket* pac
 
     if (my_verboseMode)
     {
-        printf("## Camera position:\n\
+        asyncLog::getDefault()->print("## Camera position:\n\
 # Pan: %d\n\
 # Tilt: %d\n\
 # Zoom: %d\n\
 ##\n", my_camera_pan, my_camera_tilt, my_camera_zoom);
-        fflush(stdout);
     }
+
+    cameraPosition position = { my_camera_pan, my_camera_tilt, my_camera_zoom };
+    my_cameraTracker.update( position, clientUtil::monotonicTime_us() );
+
+    my_cameraDataMutex.lock();
+    if( my_isRequestingCameraData && my_cameraTracker.getPendingCount() == 0 )
+    {
+        my_client->requestStop("getCameraDataCamera_1");
+        my_isRequestingCameraData = false;
+    }
+    my_cameraDataMutex.unlock();
 }
 
 void robotManager::cameraManager::handle_setCameraAbsCamera_1(int pan, int tilt, int zoom)
 {
-    ArNetPacket* packet = new ArNetPacket();
-    packet->byte2ToBuf(pan);
-    packet->byte2ToBuf(tilt);
-    packet->byte2ToBuf(zoom);
-    packet->finalizePacket();
-    my_client->requestOnce("setCameraAbsCamera_1", packet);
+    my_command_setCameraAbs.sendOnce( [=]( ArNetPacket* packet )
+    {
+        packet->byte2ToBuf(pan);
+        packet->byte2ToBuf(tilt);
+        packet->byte2ToBuf(zoom);
+    } );
 }
 
 void robotManager::cameraManager::handle_setCameraRelCamera_1(int plus_pan, int plus_tilt, int plus_zoom)
 {
-    ArNetPacket* packet = new ArNetPacket();
-    packet->byte2ToBuf(plus_pan);
-    packet->byte2ToBuf(plus_tilt);
-    packet->byte2ToBuf(plus_zoom);
-    packet->finalizePacket();
-    my_client->requestOnce("setCameraRelCamera_1", packet);
+    my_command_setCameraRel.sendOnce( [=]( ArNetPacket* packet )
+    {
+        packet->byte2ToBuf(plus_pan);
+        packet->byte2ToBuf(plus_tilt);
+        packet->byte2ToBuf(plus_zoom);
+    } );
 }
 
-void robotManager::cameraManager::resetPosition()
+std::future<commandStatus> robotManager::cameraManager::setCameraAbsAsync( int pan, int tilt, int zoom, int timeout_ms )
 {
-    handle_setCameraAbsCamera_1(0, 0, 0);
+    int tolerance = my_cameraTolerance;
+    my_cameraDataMutex.lock();
+    std::future<commandStatus> result = my_cameraTracker.track(
+        [=]( const cameraPosition& position )
+        {
+            return abs( position.pan - pan ) <= tolerance && abs( position.tilt - tilt ) <= tolerance &&
+                   abs( position.zoom - zoom ) <= tolerance;
+        }, timeout_ms, clientUtil::monotonicTime_us() );
+    if( !my_isRequestingCameraData )
+    {
+        my_client->request("getCameraDataCamera_1", 100);
+        my_isRequestingCameraData = true;
+    }
+    my_cameraDataMutex.unlock();
+
+    handle_setCameraAbsCamera_1(pan, tilt, zoom);
+    return result;
+}
+
+void robotManager::cameraManager::expireCommands( long long now_us )
+{
+    my_cameraTracker.expire( now_us );
+
+    // The server may never answer - stop asking once nothing waits for the position
+    my_cameraDataMutex.lock();
+    if( my_isRequestingCameraData && my_cameraTracker.getPendingCount() == 0 )
+    {
+        my_client->requestStop("getCameraDataCamera_1");
+        my_isRequestingCameraData = false;
+    }
+    my_cameraDataMutex.unlock();
+}
+
+void robotManager::cameraManager::cancelCommands()
+{
+    my_cameraTracker.cancelAll();
 }
 
-void robotManager::cameraManager::recordFrame(unsigned char* image, int length_of_image)
+void robotManager::cameraManager::setCameraTolerance( int tolerance )
 {
-    // Please be careful, this image is encoded in jpeg format
-    std::ostringstream stream_converter;
-    stream_converter << my_frame_number;
-    std::string temp_string = stream_converter.str();
-    std::string filename;
-    filename = std::string("video_record/")
-               + std::string( my_filename_length - temp_string.length(), '0')
-               + temp_string + my_file_extension;
+    my_cameraTolerance = tolerance;
+}
 
-    FILE *image_file;
-    image_file = fopen(filename.c_str(), "wb");
-    fwrite(image, length_of_image, 1, image_file);
-    fclose(image_file);
+void robotManager::cameraManager::moveCameraRelative(int plus_pan, int plus_tilt, int plus_zoom)
+{
+    double move[3] = { (double) plus_pan, (double) plus_tilt, (double) plus_zoom };
+    my_cameraMoveCoalescer.submit( move );
+}
 
-    my_frame_number++;
+commandCoalescer* robotManager::cameraManager::getCameraMoveCoalescer()
+{
+    return &my_cameraMoveCoalescer;
+}
+
+void robotManager::cameraManager::handle_sendCameraMove( const double* values )
+{
+    handle_setCameraRelCamera_1( (int) lround( values[0] ), (int) lround( values[1] ), (int) lround( values[2] ));
+}
+
+void robotManager::cameraManager::resetPosition()
+{
+    handle_setCameraAbsCamera_1(0, 0, 0);
 }
 
 void robotManager::cameraManager::startRecording()
 {
-    my_filename_length = 10;
-    my_file_extension = std::string(".jpg");
-    my_frame_number = 0;
-    my_recordToFolder = true;
+    my_recorder.start();
 }
 
 void robotManager::cameraManager::stopRecording()
 {
-    my_recordToFolder = false;
+    my_recorder.stop();
+}
+
+frameRecorder* robotManager::cameraManager::getRecorder()
+{
+    return &my_recorder;
 }
 
 void robotManager::cameraManager::activateCameraSteering()
@@ -645,55 +1268,164 @@ void robotManager::cameraManager::deactivateCameraSteering()
 void robotManager::cameraManager::handle_key_w()
 {
     // UP by 5 degree
-    handle_setCameraRelCamera_1(0, 5 * 100, 0);
+    moveCameraRelative(0, 5 * 100, 0);
     fflush(stdout);
 }
 
 void robotManager::cameraManager::handle_key_s()
 {
     // DOWN by 5 degree
-    handle_setCameraRelCamera_1(0, -5 * 100, 0);
+    moveCameraRelative(0, -5 * 100, 0);
 }
 
 void robotManager::cameraManager::handle_key_a()
 {
     // LEFT by 5 degree
-    handle_setCameraRelCamera_1(-5 * 100, 0, 0);
+    moveCameraRelative(-5 * 100, 0, 0);
 }
 
 void robotManager::cameraManager::handle_key_d()
 {
     // RIGHT by 5 degree
-    handle_setCameraRelCamera_1(5 * 100, 0, 0);
+    moveCameraRelative(5 * 100, 0, 0);
 }
 
 void robotManager::cameraManager::handle_key_r()
 {
     // Add 5% zoom
-    handle_setCameraRelCamera_1(0, 0, 5 * 100);
+    moveCameraRelative(0, 0, 5 * 100);
 }
 
 void robotManager::cameraManager::handle_key_f()
 {
     // Add -5% zoom
-    handle_setCameraRelCamera_1(0, 0, -5 * 100);
+    moveCameraRelative(0, 0, -5 * 100);
 }
 
 int robotManager::cameraManager::getSendVideoDelay()
 {
-    return my_sendVideoDelay;
+    return my_videoRate.getPeriod();
+}
+
+void robotManager::cameraManager::setSendVideoDelay( int delay_ms )
+{
+    my_videoRate.setPeriod( delay_ms );
+}
+
+rateController* robotManager::cameraManager::getVideoRate()
+{
+    return &my_videoRate;
+}
+
+rateController* robotManager::cameraManager::getCameraInfoRate()
+{
+    return &my_cameraInfoRate;
+}
+
+streamStats* robotManager::cameraManager::getVideoStats()
+{
+    return &my_videoStats;
+}
+
+void robotManager::cameraManager::handle_applyVideoPeriod( int period_ms )
+{
+    if( period_ms > 0 )
+        my_client->request("sendVideo", period_ms);
+    else
+        my_client->requestStop("sendVideo");
+}
+
+void robotManager::cameraManager::handle_applyCameraInfoPeriod( int period_ms )
+{
+    if( period_ms > 0 )
+        my_client->request("getCameraInfoCamera_1", period_ms);
+    else
+        my_client->requestStop("getCameraInfoCamera_1");
 }
 
 int robotManager::cameraManager::getSynchroTime_ums()
 {
-    return my_sendVideoDelay * 1000;
+    return my_videoRate.getPeriod() * 1000;
+}
+
+frameHandle robotManager::cameraManager::getLatestFrame()
+{
+    return my_frameStore.acquire();
+}
+
+frameHandle robotManager::cameraManager::waitForNextFrame( unsigned long long lastSequence, int timeout_ms )
+{
+    frameHandle frame;
+    if( !my_frameNotifier.waitFor( [&]() { frame = my_frameStore.acquire();
+                                           return !frame.empty() && frame->getSequence() > lastSequence; },
+                                   timeout_ms ))
+        return frameHandle();
+    return frame;
+}
+
+int robotManager::cameraManager::getFrameEventFd()
+{
+    return my_frameNotifier.getEventFd();
 }
 
 std::pair<unsigned char*, int> robotManager::cameraManager::getSendVideoFrame()
 {
-    while( my_video_mutexOn )
-        ArUtil::sleep( 2 );
-    return std::make_pair( &my_lastSnap[0], my_lastSnapSize);
+    // Keep the frame referenced until the next call so the returned pointer
+    // stays valid while the caller decodes it.
+    my_legacyFrame = my_frameStore.acquire();
+    if( my_legacyFrame.empty() )
+        return std::make_pair( (unsigned char*) NULL, 0 );
+    return std::make_pair( const_cast<unsigned char*>( my_legacyFrame->getData() ),
+                           my_legacyFrame->getLength() );
+}
+
+frameSubscriber* robotManager::cameraManager::subscribeFrames( int queueCapacity,
+        frameSubscriber::dropPolicy policy, int decimation )
+{
+    frameSubscriber* subscriber = new frameSubscriber( queueCapacity, policy, decimation );
+    my_frameSubscribers.add( subscriber );
+    return subscriber;
+}
+
+void robotManager::cameraManager::unsubscribeFrames( frameSubscriber* subscriber )
+{
+    if( my_frameSubscribers.remove( subscriber ) )
+        delete subscriber;
+}
+
+void robotManager::cameraManager::startDecoding( int workersCount, frameDecoder::colorMode mode, int scale )
+{
+    my_decoder.start( workersCount, mode, scale );
+}
+
+void robotManager::cameraManager::stopDecoding()
+{
+    my_decoder.stop();
+}
+
+decodedHandle robotManager::cameraManager::waitForNextDecodedFrame( unsigned long long lastSequence, int timeout_ms )
+{
+    return my_decoder.waitForNext( lastSequence, timeout_ms );
+}
+
+frameDecoder* robotManager::cameraManager::getDecoder()
+{
+    return &my_decoder;
+}
+
+void robotManager::cameraManager::setMaxFrameSize( int maxFrameSize_bytes )
+{
+    my_framePool.setMaxBufferSize( maxFrameSize_bytes );
+}
+
+int robotManager::cameraManager::getMaxFrameSize()
+{
+    return my_framePool.getMaxBufferSize();
+}
+
+unsigned long long robotManager::cameraManager::getOversizedFramesCount()
+{
+    return my_oversizedFrames.load();
 }
 
 void robotManager::cameraManager::enableVerboseMode()
@@ -706,63 +1438,124 @@ robotManager::keyHandlerMaster::keyHandlerMaster(bool blocking,
         FILE* stream,
         bool takeKeysInConstructor) :
     ArKeyHandler(blocking, addAriaExitCB, stream, takeKeysInConstructor),
-    my_functor_thread_checkKeys( this, &robotManager::keyHandlerMaster::thread_checkKeys)
+    my_isRunning( false ), my_wakeFd( eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ),
+    my_controlPeriod_us( 20000 ), my_controlOverruns( 0 ),
+    my_functor_thread_checkKeys( this, &robotManager::keyHandlerMaster::thread_checkKeys),
+    my_functor_thread_controlTick( this, &robotManager::keyHandlerMaster::thread_controlTick)
 {
 
 }
 
 robotManager::keyHandlerMaster::~keyHandlerMaster()
 {
-    my_thread_checkKeys.cancel();
+    stopKeyMaster();
+    if( my_wakeFd >= 0 )
+        close( my_wakeFd );
 }
 
 void robotManager::keyHandlerMaster::thread_checkKeys()
 {
-    while( true )
+    const int FALLBACK_PERIOD_ms = 100;
+    int inputFd = fileno( myStream != NULL ? myStream : stdin );
+    bool isInputPollable = inputFd >= 0;
+
+    while( my_isRunning )
     {
-        checkKeys();
-        for(std::vector<ArFunctor*>::iterator func = my_callbacksVector.begin();
-                func != my_callbacksVector.end(); ++func)
-            (*func)->invoke();
-        ArUtil::sleep(100);
+        struct pollfd fds[2];
+        fds[0].fd = my_wakeFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = inputFd;
+        fds[1].events = POLLIN;
+        int fdsCount = isInputPollable ? 2 : 1;
+
+        int ready = poll( fds, fdsCount, isInputPollable ? -1 : FALLBACK_PERIOD_ms );
+        if( ready < 0 && errno != EINTR )
+            isInputPollable = false;
+        if( !my_isRunning )
+            break;
+        if( ready > 0 && ( fds[0].revents & POLLIN ))
+        {
+            uint64_t count;
+            if( read( my_wakeFd, &count, sizeof( count )) < 0 )
+            {
+                // Already reset
+            }
+        }
+
+        int keys = dispatchKeys();
+        // Readable but no key - the input is closed (e.g. redirected); check it periodically
+        if( isInputPollable && ready > 0 && ( fds[1].revents & ( POLLIN | POLLHUP | POLLERR )) && keys == 0 )
+            isInputPollable = false;
     }
 }
 
-int robotManager::keyHandlerMaster::findElementIndex( ArFunctor* func_ )
+void robotManager::keyHandlerMaster::thread_controlTick()
 {
-    int index = 0;
-    for(std::vector<ArFunctor*>::iterator func = my_callbacksVector.begin();
-            func != my_callbacksVector.end(); ++func, index++)
+    long long deadline_us = clientUtil::monotonicTime_us();
+    while( my_isRunning )
     {
-        if( func_ == (*func) )
-            return index;
+        invokeCallbacks();
+
+        long long period_us = my_controlPeriod_us.load();
+        deadline_us += period_us;
+        long long now_us = clientUtil::monotonicTime_us();
+        if( now_us > deadline_us )
+        {
+            // Missed the deadline - skip the lost ticks instead of running a burst
+            my_controlOverruns.fetch_add( 1 );
+            deadline_us = now_us;
+        }
+        clientUtil::sleepUntil_us( deadline_us );
     }
-    return -1;
 }
 
-void robotManager::keyHandlerMaster::addCallback( ArFunctor* func )
+int robotManager::keyHandlerMaster::dispatchKeys()
 {
-    if( findElementIndex( func ) < 0 )
-        my_callbacksVector.push_back( func );
+    int keys = 0;
+    int key;
+    while( ( key = getKey() ) != -1 )
+    {
+        keys++;
+        if( myMap.count( key ) )
+            myMap[key]->invoke();
+    }
+    return keys;
+}
+
+callbackRegistry::handle robotManager::keyHandlerMaster::addCallback( ArFunctor* func )
+{
+    return my_callbacks.add( func );
 }
 
 void robotManager::keyHandlerMaster::removeCallback( ArFunctor* func )
 {
-    int element_index = findElementIndex( func );
-    if( element_index > -1 )
-        my_callbacksVector.erase( my_callbacksVector.begin() + element_index );
+    my_callbacks.remove( func );
+}
+
+void robotManager::keyHandlerMaster::removeCallback( callbackRegistry::handle callback )
+{
+    my_callbacks.remove( callback );
 }
 
 void robotManager::keyHandlerMaster::startKeyMaster()
 {
-    if( !my_thread_checkKeys.getRunning() )
+    if( !my_isRunning.exchange( true ))
+    {
         my_thread_checkKeys.create( &my_functor_thread_checkKeys );
+        my_thread_controlTick.create( &my_functor_thread_controlTick );
+    }
 }
 
 void robotManager::keyHandlerMaster::stopKeyMaster()
 {
-    if( my_thread_checkKeys.getRunning() )
-        my_thread_checkKeys.cancel();
+    if( my_isRunning.exchange( false ))
+    {
+        uint64_t one = 1;
+        if( my_wakeFd < 0 || write( my_wakeFd, &one, sizeof( one )) != sizeof( one ))
+            my_thread_checkKeys.cancel();
+        my_thread_checkKeys.join();
+        my_thread_controlTick.join();
+    }
 }
 
 void robotManager::keyHandlerMaster::pressKey( int key )
@@ -773,7 +1566,26 @@ void robotManager::keyHandlerMaster::pressKey( int key )
 
 void robotManager::keyHandlerMaster::invokeCallbacks()
 {
-    for(std::vector<ArFunctor*>::iterator func = my_callbacksVector.begin();
-            func != my_callbacksVector.end(); ++func)
-        (*func)->invoke();
+    my_callbacks.invokeAll();
+}
+
+void robotManager::keyHandlerMaster::setControlRate( double rate_Hz )
+{
+    rate_Hz = std::min( std::max( rate_Hz, 0.1 ), 1000.0 );
+    my_controlPeriod_us = llround( 1e6 / rate_Hz );
+}
+
+double robotManager::keyHandlerMaster::getControlRate() const
+{
+    return 1e6 / my_controlPeriod_us.load();
+}
+
+double robotManager::keyHandlerMaster::getControlPeriod_s() const
+{
+    return my_controlPeriod_us.load() * 1e-6;
+}
+
+unsigned long long robotManager::keyHandlerMaster::getControlOverruns() const
+{
+    return my_controlOverruns.load();
 }
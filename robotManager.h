@@ -5,6 +5,29 @@
 #include "ArNetworking.h"
 #include "ArClientRatioDrive.h"
 
+#include "asyncLog.h"
+#include "callbackRegistry.h"
+#include "clientCommand.h"
+#include "commandCoalescer.h"
+#include "commandTracker.h"
+#include "frameDecoder.h"
+#include "frameBuffer.h"
+#include "frameRecorder.h"
+#include "frameReplay.h"
+#include "frameSubscriber.h"
+#include "laserScan.h"
+#include "latestStore.h"
+#include "poseHistory.h"
+#include "rateController.h"
+#include "rcuList.h"
+#include "robotState.h"
+#include "seqlockStore.h"
+#include "sensorStream.h"
+#include "streamNotifier.h"
+#include "streamStats.h"
+#include "taskScheduler.h"
+#include "telemetryLog.h"
+
 /** \brief Główna klasa odpowiadająca za komunikację z robotem
  *
  * Klasa \c robotManager reprezentuje obiekt, przez który przeprowadzana jest
@@ -20,6 +43,7 @@
  * \li \c steering - sterowanie robotem
  * \li \c camera - obsługa kamery
  * \li \c keyHandler - obsługa klawiatury w programie użytkownika
+ * \li \c telemetry - zapis telemetrii robota (stan, laser, klatki) do pliku
  */
 class robotManager
 {
@@ -44,6 +68,25 @@ public:
      *
      */
     bool client_getRunningWithLock();
+    /** \brief Przekazuje wywołanie metody ArClientBase.addHandler()
+     *
+     * Pozwala dodać własną obsługę danych odbieranych z serwera, obok obsługi
+     * zapewnianej przez klasy zagnieżdżone (np. w celu pomiaru opóźnień).
+     *
+     * \param name const char* - nazwa polecenia
+     * \param functor ArFunctor1<ArNetPacket*>* - functor wywoływany dla każdego odebranego pakietu
+     * \return bool - wyjście metody ArClientBase.addHandler()
+     *
+     */
+    bool client_addHandler( const char* name, ArFunctor1<ArNetPacket*>* functor );
+    /** \brief Przekazuje wywołanie metody ArClientBase.requestOnce()
+     *
+     * \param name const char* - nazwa polecenia
+     * \param packet ArNetPacket* - parametry polecenia
+     * \return bool - wyjście metody ArClientBase.requestOnce()
+     *
+     */
+    bool client_requestOnce( const char* name, ArNetPacket* packet = NULL );
     /** \brief Sprawdza czy klient robota działa
      *
      * \return bool - \b True, jeśli klient robota działa
@@ -57,6 +100,34 @@ public:
      */
     void disableNativeAriaLogging();
 
+    /** \brief Zwraca statystyki wszystkich strumieni danych (\c updateNumbers, czujniki, \c sendVideo)
+     *
+     * \return std::vector<streamStats*> - statystyki strumieni
+     *
+     */
+    std::vector<streamStats*> getStreamStats();
+    /** \brief Wypisuje podsumowanie statystyk wszystkich strumieni
+     *
+     * \param output FILE* - strumień wyjściowy
+     * \return void
+     *
+     */
+    void printStreamStats( FILE* output = stdout );
+    /** \brief Rozpoczyna okresowe wypisywanie statystyk strumieni (zadanie planisty \c scheduler)
+     *
+     * \param period_ms int - okres w \c ms
+     * \param output FILE* - strumień wyjściowy
+     * \return void
+     *
+     */
+    void startStatsDump( int period_ms, FILE* output = stdout );
+    /** \brief Kończy okresowe wypisywanie statystyk strumieni
+     *
+     * \return void
+     *
+     */
+    void stopStatsDump();
+
 private:
     /** \brief Odbieranie informacji dotyczących robota
      *
@@ -69,9 +140,15 @@ private:
         /** \brief Konstruktor klasy \c robotManager::requestsHandler
          *
          * \param _client ArClientBase* - wskaźnik do obiektu klienta Aria
+         * \param _telemetry telemetryRecorder* - wskaźnik do obiektu zapisu telemetrii
          *
          */
-        requestsHandler( ArClientBase *_client );
+        requestsHandler( ArClientBase *_client, telemetryRecorder* _telemetry );
+        /** \brief Destruktor klasy \c robotManager::requestsHandler
+         *
+         *
+         */
+        ~requestsHandler();
         /** \brief Włącza wyświetlanie dotakowych informacji
          *
          * \return void
@@ -79,11 +156,76 @@ private:
          */
         void enableVerboseMode();
         /** \brief Rozpoczyna pobieranie danych z dalmierza laserowego
+         *
+         * Dalmierzem laserowym jest pierwszy czujnik z listy \c getSensorList,
+         * odpytywany co 100 ms.
          *
          * \return bool - \b True, jeżeli udało się połączyć z dalmierzem
          *
          */
         bool startReadingLaser();
+        /** \brief Rozpoczyna (lub zmienia okres) pobierania danych z dowolnego czujnika
+         *
+         * Każdy czujnik odpytywany jest z własnym okresem, np.:
+         * \code
+         * rManager.requests->startReadingSensor( "laser_1", 50 );
+         * rManager.requests->startReadingSensor( "sonar", 200 );
+         * \endcode
+         *
+         * \param name const std::string& - nazwa czujnika (patrz \c get_sensorsVector())
+         * \param period_ms int - okres odpytywania w \c ms
+         * \return bool - \b False, jeżeli nie ma czujnika o takiej nazwie (lub lista czujników nie została jeszcze odebrana)
+         *
+         */
+        bool startReadingSensor( const std::string& name, int period_ms = 100 );
+        /** \brief Zatrzymuje pobieranie danych z czujnika
+         *
+         * \param name const std::string& - nazwa czujnika
+         * \return bool - \b False, jeżeli nie ma czujnika o takiej nazwie
+         *
+         */
+        bool stopReadingSensor( const std::string& name );
+        /** \brief Zatrzymuje pobieranie danych ze wszystkich czujników i wątek odpytywania
+         *
+         * \return void
+         *
+         */
+        void stopReadingSensors();
+
+        /** \brief Zwraca spójny stan robota (położenie, prędkości, napięcie baterii)
+         *
+         * Wszystkie pola pochodzą z jednego pakietu \c updateNumbers. Metoda nie blokuje
+         * (stan chroniony jest licznikiem sekwencji), więc może być wywoływana z pętli
+         * sterowania o dużej częstotliwości. Pojedyncze metody \c get_xPosition() itd.
+         * odczytują pola z osobnych kopii stanu - do obliczeń na kilku polach należy
+         * używać tej metody, np.:
+         * \code
+         * robotState state = rManager.requests->get_robotState();
+         * if( state.sequence != lastSequence )
+         *     control( state.xPosition, state.yPosition, state.theta );
+         * \endcode
+         *
+         * \return robotState - stan robota (\c sequence równe 0, jeśli nie odebrano jeszcze stanu)
+         *
+         */
+        robotState get_robotState();
+        /** \brief Czeka na stan robota nowszy niż \c lastSequence
+         *
+         * Wątek jest usypiany do chwili odebrania pakietu \c updateNumbers (bez odpytywania).
+         *
+         * \param lastSequence unsigned long long - numer ostatnio przetworzonego stanu (0 - dowolny stan)
+         * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+         * \param state robotState* - wynikowy stan robota
+         * \return bool - \b False, jeśli w zadanym czasie nie odebrano nowszego stanu
+         *
+         */
+        bool wait_robotState( unsigned long long lastSequence, int timeout_ms, robotState* state );
+        /** \brief Zwraca deskryptor \c eventfd sygnalizujący odebranie stanu robota (patrz \c streamNotifier::getEventFd())
+         *
+         * \return int - deskryptor lub -1, jeśli nie udało się go utworzyć
+         *
+         */
+        int get_robotStateEventFd();
 
         // Getters for position information
         /** \brief Zwraca współrzędną \c x robota w układzie współrzędnych robota
@@ -116,6 +258,69 @@ private:
          *
          */
         double get_rotationalVelocity();
+        /** \brief Wyznacza położenie robota w zadanej chwili
+         *
+         * Położenie interpolowane jest z historii odczytów \c updateNumbers, co pozwala
+         * oznaczyć pomiar lub klatkę położeniem robota w chwili jej odebrania, np.:
+         * \code
+         * frameHandle frame = rManager.camera->getLatestFrame();
+         * timedPose pose;
+         * if( !frame.empty() && rManager.requests->get_poseAt( frame->getTimestamp_us(), &pose ) )
+         *     process( frame, pose );
+         * \endcode
+         *
+         * \param timestamp_us long long - chwila w \c us (patrz \c clientUtil::monotonicTime_us())
+         * \param pose timedPose* - wynikowe położenie
+         * \return bool - \b False, jeśli chwila jest spoza zakresu historii (patrz \c poseHistory::getPoseAt())
+         *
+         */
+        bool get_poseAt( long long timestamp_us, timedPose* pose );
+        /** \brief Zwraca okres strumienia \c updateNumbers
+         *
+         * Okres można zmienić w trakcie działania, np.
+         * \c get_updateNumbersRate()->setPeriod(100) (zapytanie \c request() jest ponawiane).
+         *
+         * \return rateController* - okres strumienia \c updateNumbers (domyślnie 1000 ms)
+         *
+         */
+        rateController* get_updateNumbersRate();
+        /** \brief Zwraca okres odpytywania czujnika
+         *
+         * Pozwala np. włączyć adaptację okresu do przepustowości łącza:
+         * \code
+         * rManager.requests->startReadingSensor( "laser_1", 50 );
+         * rManager.requests->get_sensorRate( "laser_1" )->enableAdaptive( 1000 );
+         * \endcode
+         *
+         * \param name const std::string& - nazwa czujnika
+         * \return rateController* - okres odpytywania lub \c NULL, jeśli nie ma czujnika o takiej nazwie
+         *
+         */
+        rateController* get_sensorRate( const std::string& name );
+        /** \brief Zwraca statystyki strumienia \c updateNumbers
+         *
+         * \return streamStats* - statystyki strumienia \c updateNumbers
+         *
+         */
+        streamStats* get_updateNumbersStats();
+        /** \brief Zwraca statystyki wszystkich strumieni odbieranych przez obiekt
+         *
+         * \return std::vector<streamStats*> - statystyki strumienia \c updateNumbers i strumieni czujników
+         *
+         */
+        std::vector<streamStats*> get_streamStats();
+        /** \brief Zwraca historię położeń robota
+         *
+         * \return poseHistory* - historia położeń (np. w celu zmiany dopuszczalnej ekstrapolacji)
+         *
+         */
+        poseHistory* get_poseHistory();
+        /** \brief Zwraca obiekt śledzenia poleceń ruchu (sprawdzanych przy każdym pakiecie \c updateNumbers)
+         *
+         * \return commandTracker<robotState>* - śledzenie poleceń ruchu (patrz \c steeringManager::moveDistanceAsync())
+         *
+         */
+        commandTracker<robotState>* get_motionTracker();
 
         /** \brief Zwraca listę wszystkich dostępnych czujników pomiarowych w robocie
          *
@@ -123,9 +328,69 @@ private:
          *
          */
         std::vector<std::string> get_sensorsVector();
+        /** \brief Zwraca uchwyt do ostatniego pomiaru z dalmierza laserowego
+         *
+         * Metoda nie blokuje i nie kopiuje danych - punkty pomiaru pozostają niezmienione
+         * tak długo, jak istnieje zwrócony uchwyt, np.:
+         * \code
+         * scanHandle scan = rManager.requests->get_laserScan();
+         * if( !scan.empty() )
+         *     for( int i = 0; i < scan->getSize(); i++ )
+         *         process( scan->getX()[i], scan->getY()[i] );
+         * \endcode
+         *
+         * \return scanHandle - uchwyt do pomiaru lub pusty uchwyt, jeśli nie odebrano jeszcze żadnego pomiaru
+         *
+         */
+        scanHandle get_laserScan();
+        /** \brief Zwraca uchwyt do ostatniego pomiaru z zadanego czujnika
+         *
+         * \param name const std::string& - nazwa czujnika
+         * \return scanHandle - uchwyt do pomiaru lub pusty uchwyt, jeśli nie ma czujnika lub nie odebrano jeszcze żadnego pomiaru
+         *
+         */
+        scanHandle get_sensorScan( const std::string& name );
+        /** \brief Czeka na pomiar z dalmierza laserowego nowszy niż \c lastSequence
+         *
+         * Wątek jest usypiany do chwili odebrania pomiaru (bez odpytywania), np.:
+         * \code
+         * unsigned long long lastSequence = 0;
+         * scanHandle scan = rManager.requests->wait_laserScan( lastSequence, 500 );
+         * if( !scan.empty() )
+         *     lastSequence = scan->getSequence();
+         * \endcode
+         *
+         * \param lastSequence unsigned long long - numer ostatnio przetworzonego pomiaru (0 - dowolny pomiar)
+         * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+         * \return scanHandle - uchwyt do nowszego pomiaru lub pusty uchwyt po upływie czasu
+         * (natychmiast, jeśli nie odebrano jeszcze listy czujników)
+         *
+         */
+        scanHandle wait_laserScan( unsigned long long lastSequence, int timeout_ms );
+        /** \brief Czeka na pomiar z zadanego czujnika nowszy niż \c lastSequence
+         *
+         * \param name const std::string& - nazwa czujnika
+         * \param lastSequence unsigned long long - numer ostatnio przetworzonego pomiaru (0 - dowolny pomiar)
+         * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+         * \return scanHandle - uchwyt do nowszego pomiaru lub pusty uchwyt po upływie czasu
+         * (natychmiast, jeśli nie ma czujnika o takiej nazwie)
+         *
+         */
+        scanHandle wait_sensorScan( const std::string& name, unsigned long long lastSequence, int timeout_ms );
+        /** \brief Zwraca deskryptor \c eventfd sygnalizujący odebranie pomiaru z czujnika (patrz \c streamNotifier::getEventFd())
+         *
+         * \param name const std::string& - nazwa czujnika
+         * \return int - deskryptor lub -1, jeśli nie ma czujnika o takiej nazwie
+         *
+         */
+        int get_sensorEventFd( const std::string& name );
         /** \brief Zwraca ostatni pomiar z dalmierza laserowego
          *
-         * \todo Przetworzenie pomiarów z postaci \c RAW do innej, wygodniejszej w użyciu postaci, np.: kąt - odległość
+         * Metoda tworzy kopię pomiaru w postaci mapy - w nowym kodzie należy używać
+         * \c get_laserScan().
+         *
+         * Postać kąt - odległość (oraz współrzędne w układzie świata) wyznaczają funkcje
+         * klasy \c laserKernels wywołane na tablicach z \c get_laserScan().
          *
          * \return std::map< int, std::pair<int, int>> - pomiar w postaci \c RAW (patrz dokumentacja biblioteki Aria)
          *
@@ -133,25 +398,35 @@ private:
         std::map< int, std::pair<int, int> > get_laserReading();
 
     private:
-        double my_batteryVoltage,
-               my_xPosition, my_yPosition,
-               my_theta, my_velocity,
-               my_rotationalVelocity,
-               my_temperatur;/**< Podstawowe informacje o stanie robota */
+        seqlockStore<robotState> my_state;/**< Podstawowe informacje o stanie robota (ostatni pakiet \c updateNumbers) */
+        streamNotifier my_stateNotifier;/**< Powiadamianie o odebranych pakietach \c updateNumbers */
+        poseHistory my_poseHistory;/**< Historia położeń robota */
+        rateController my_updateNumbersRate;/**< Okres strumienia \c updateNumbers */
+        streamStats my_updateNumbersStats;/**< Statystyki strumienia \c updateNumbers */
+        commandTracker<robotState> my_motionTracker;/**< Polecenia ruchu oczekujące na zakończenie */
 
         ArClientBase* my_client;/**< Wskaźnik do obiektu klienta Aria */
+        telemetryRecorder* my_telemetry;/**< Wskaźnik do obiektu zapisu telemetrii */
+        clientCommand my_command_getSensorCurrent;/**< Polecenie \c getSensorCurrent */
 
         bool my_verboseMode;/**< Stan opcji wyświetlania dodatkowych informacji */
 
-        std::vector<std::string> my_sensorsVector;/**< Lista nazw dostępnych sensorów w robocie */
-        std::map< int, std::pair<int, int> > my_laserReading;/**< Ostatnio odczytany pomiar z dalmierza laserowego */
+        std::atomic<sensorTable*> my_sensors;/**< Czujniki dostępne w robocie (\c NULL do odebrania listy \c getSensorList) */
+
+        ArThread my_thread_requestSensors;/**< handler wątku odpytywania czujników */
+        ArMutex my_requestSensorsMutex;/**< blokada uruchamiania i zatrzymywania wątku odpytywania */
+        std::atomic<bool> my_isRequestingSensors;/**< stan wątku odpytywania czujników */
 
         // CALLBACKS FUNCTIONS
+        void thread_requestSensors(void);/**< wątek odpytywania czujników */
         void handle_updateNumbers( ArNetPacket *packet );/**< \brief callback polecenia \c updateNumbers */
         void handle_getSensorList( ArNetPacket *packet );/**< \brief callback polecenia \c getSensorList */
         void handle_getSensorCurrent( ArNetPacket *packet );/**< \brief callback polecenia \c getSensorCurrent */
+        void handle_applyUpdateNumbersPeriod( int period_ms );/**< \brief ponawia zapytanie \c updateNumbers z nowym okresem */
 
         // CALLBACKS FUNCTORS
+        ArFunctor1C<requestsHandler, int> my_functor_handle_applyUpdateNumbersPeriod;/**< functor do metody \c handle_applyUpdateNumbersPeriod() */
+        ArFunctorC<requestsHandler> my_functor_thread_requestSensors;/**< functor do metody \c thread_requestSensors() (wątku odpytywania czujników) */
         ArFunctor1C<requestsHandler, ArNetPacket*> my_functor_handle_updateNumbers;/**< functor dla polecenia \c updateNumbers */
         ArFunctor1C<requestsHandler, ArNetPacket*> my_functor_handle_getSensorList;/**< functor dla polecenia \c getSensorList */
         ArFunctor1C<requestsHandler, ArNetPacket*> my_functor_handle_getSensorCurrent;/**< functor dla polecenia \c getSensorList */
@@ -163,14 +438,17 @@ private:
      * \c robotManager może aktywować działania tej klasy poprzez wywołanie metody
      * \c startKeyMaster().
      *
-     * Dodatkowo, możliwe jest przekazanie funkcji typu \c callback, które zostaną
-     * wywoałne podczas każdego sprawdzenia przez klasą stanu klawiszy - metody
+     * Dodatkowo, możliwe jest przekazanie funkcji typu \c callback, które wywoływane są
+     * ze stałą częstotliwością (takt sterowania, patrz \c setControlRate()) - metody
      * \c addCallback(ArFunction \c *func) oraz \c removeCallback(ArFunction \c *func).
      *
      * Możliwa jest także symulacja wciśnięcia danego klawisza poprzez podanie kodu
      * klawisza do funckji \c pressKey(int \c key).
      *
-     * Klasa ta (sprawdzanie stanu klawiszy) działa we własnym wątku.
+     * Klasa działa w dwóch wątkach: wątek klawiatury czeka (\c poll) na dane ze
+     * strumienia wejściowego i obsługuje klawisz natychmiast po jego wciśnięciu, a wątek
+     * taktu sterowania wywołuje funkcje \c callback w stałych odstępach czasu
+     * (terminy bezwzględne na zegarze monotonicznym, więc opóźnienia się nie kumulują).
      */
     class keyHandlerMaster: public ArKeyHandler
     {
@@ -189,20 +467,35 @@ private:
          */
         ~keyHandlerMaster();
 
-        /** \brief Dodaje \c callback do pętli sprawdzającej stan klawiszy
+        /** \brief Dodaje \c callback do taktu sterowania
+         *
+         * Metoda może być wywoływana z dowolnego wątku, również w trakcie działania taktu
+         * sterowania - takt nigdy na nią nie czeka. \c callback dodany z wnętrza innego
+         * \c callback wywoływany jest od następnego taktu.
          *
          * \param func ArFunctor* - wskaźnik na \c functor obsługujący zadaną funkcję typu \c callback
-         * \return void
+         * \return callbackRegistry::handle - uchwyt do \c callback (patrz \c removeCallback())
          *
          */
-        void addCallback(ArFunctor *func);
-        /** \brief Usuwa \c callback z pętli sprawdzającej stan klawiszy
+        callbackRegistry::handle addCallback(ArFunctor *func);
+        /** \brief Usuwa \c callback z taktu sterowania
+         *
+         * Po powrocie z metody \c callback nie jest już wywoływany. Może ją wywołać
+         * również sam \c callback (np. jednorazowy manewr) - zmiana listy publikowana jest
+         * wtedy po zakończeniu bieżącego taktu.
          *
          * \param func ArFunctor* - wskaźnik na \c functor obsługujący zadaną funkcję typu \c callback
          * \return void
          *
          */
         void removeCallback(ArFunctor *func);
+        /** \brief Usuwa \c callback o zadanym uchwycie z taktu sterowania
+         *
+         * \param callback callbackRegistry::handle - uchwyt zwrócony przez \c addCallback()
+         * \return void
+         *
+         */
+        void removeCallback(callbackRegistry::handle callback);
 
         /** \brief Rozpoczyna obsługę klawiatury
          *
@@ -235,17 +528,54 @@ private:
          */
         void invokeCallbacks();
 
+        /** \brief Ustawia częstotliwość taktu sterowania (wywołań funkcji typu \c callback)
+         *
+         * \param rate_Hz double - częstotliwość w \c Hz (domyślnie 50, najwyżej 1000)
+         * \return void
+         *
+         */
+        void setControlRate( double rate_Hz );
+        /** \brief Zwraca częstotliwość taktu sterowania
+         *
+         * \return double - częstotliwość w \c Hz
+         *
+         */
+        double getControlRate() const;
+        /** \brief Zwraca okres taktu sterowania
+         *
+         * Funkcje typu \c callback powinny skalować zmiany w czasie (np. wygaszanie
+         * prędkości) tym okresem, aby ich działanie nie zależało od częstotliwości taktu.
+         *
+         * \return double - okres w sekundach
+         *
+         */
+        double getControlPeriod_s() const;
+        /** \brief Zwraca liczbę taktów sterowania, które nie zdążyły w swoim terminie
+         *
+         * \return unsigned long long - liczba opóźnionych taktów
+         *
+         */
+        unsigned long long getControlOverruns() const;
+
     private:
         ArThread my_thread_checkKeys;/**< handler wątku sprawdzania stanu klawiszy */
-        std::vector<ArFunctor*> my_callbacksVector;/**< zbiór funkcji typu \c callback */
+        ArThread my_thread_controlTick;/**< handler wątku taktu sterowania */
+        callbackRegistry my_callbacks;/**< zbiór funkcji typu \c callback */
+
+        std::atomic<bool> my_isRunning;/**< stan wątków obsługi klawiatury */
+        int my_wakeFd;/**< deskryptor \c eventfd budzący wątek klawiatury przy zatrzymaniu */
+        std::atomic<long long> my_controlPeriod_us;/**< okres taktu sterowania */
+        std::atomic<unsigned long long> my_controlOverruns;/**< liczba opóźnionych taktów sterowania */
 
-        int findElementIndex(ArFunctor *func);/**< \brief Zwraca pozycję danego funkctora w wektorze \c my_callbacksVector  */
+        int dispatchKeys();/**< \brief Obsługuje wszystkie oczekujące klawisze i zwraca ich liczbę */
 
         // CALLBACKS FUNCTIONS
         void thread_checkKeys(void);/**< wątek sprawdzania stanu klawiszy */
+        void thread_controlTick(void);/**< wątek taktu sterowania */
 
         // CALLBACKS FUNCTORS
         ArFunctorC<keyHandlerMaster> my_functor_thread_checkKeys;/**< functor do metody \c thread_checkKeys() (wątku sprawdzania stanu klawiszy) */
+        ArFunctorC<keyHandlerMaster> my_functor_thread_controlTick;/**< functor do metody \c thread_controlTick() (wątku taktu sterowania) */
     };
 
     /** \brief Obsługa kamery
@@ -262,13 +592,45 @@ private:
     class cameraManager
     {
     public:
+        /** \brief Położenie kamery (pakiet \c getCameraDataCamera_1) */
+        struct cameraPosition
+        {
+            int pan;/**< obrót */
+            int tilt;/**< pochylenie */
+            int zoom;/**< zbliżenie */
+        };
+
         /** \brief Konstruktor klasy \c robotManager::cameraManager
          *
          * \param _client ArClientBase* - wskaźnik do klienta Aria
          * \param _keyHandler keyHandlerMaster* - wskaźnik do obiektu obsługującego zdarzenia związane z klawiaturą
+         * \param _telemetry telemetryRecorder* - wskaźnik do obiektu zapisu telemetrii
          *
          */
-        cameraManager( ArClientBase* _client, keyHandlerMaster* _keyHandler );
+        cameraManager( ArClientBase* _client, keyHandlerMaster* _keyHandler, telemetryRecorder* _telemetry );
+        /** \brief Destruktor klasy \c robotManager::cameraManager - zatrzymuje odtwarzanie, zapis i dekodowanie klatek
+         *
+         * Wątki odtwarzania, zapisu i dekodowania korzystają z pól obiektu (blokad,
+         * functorów), więc muszą zostać zatrzymane, zanim pola zostaną zniszczone.
+         *
+         */
+        ~cameraManager();
+
+        /** \brief Kończy polecenia kamery, których czas minął (wywoływane okresowo przez \c robotManager)
+         *
+         * Gdy nie zostało żadne oczekujące polecenie, przestaje odpytywać serwer o położenie kamery.
+         *
+         * \param now_us long long - bieżąca chwila w \c us
+         * \return void
+         *
+         */
+        void expireCommands( long long now_us );
+        /** \brief Kończy wszystkie oczekujące polecenia kamery z wynikiem \c COMMAND_CANCELLED
+         *
+         * \return void
+         *
+         */
+        void cancelCommands();
 
         // Camera steering
         /** \brief Resetuje ustawianie kamery do położenia początkowego.
@@ -299,6 +661,50 @@ private:
          *
          */
         void handle_setCameraRelCamera_1(int plus_pan, int plus_tilt, int plus_zoom);
+        /** \brief Przestawia kamerę o zadaną wartość, łącząc polecenia wydawane w krótkich odstępach
+         *
+         * Przestawienia zgłoszone w trakcie okna \c getCameraMoveCoalescer() są sumowane
+         * i wysyłane jednym poleceniem \c setCameraRelCamera_1 (z tej metody korzysta
+         * sterowanie kamerą klawiaturą).
+         *
+         * \param plus_pan int - obrót
+         * \param plus_tilt int - pochylenie
+         * \param plus_zoom int - zbliżenie
+         * \return void
+         *
+         */
+        void moveCameraRelative(int plus_pan, int plus_tilt, int plus_zoom);
+        /** \brief Zwraca obiekt łączenia przestawień kamery (np. w celu zmiany okna)
+         *
+         * \return commandCoalescer* - łączenie poleceń \c setCameraRelCamera_1 (domyślne okno 100 ms)
+         *
+         */
+        commandCoalescer* getCameraMoveCoalescer();
+        /** \brief Ustawia kamerę dla obrotu, pochylenia i zbliżenia z powiadomieniem o zakończeniu
+         *
+         * Na czas oczekiwania klient odpytuje serwer o położenie kamery (\c getCameraDataCamera_1
+         * co 100 ms). Polecenie kończy się, gdy wszystkie współrzędne kamery różnią się
+         * od zadanych co najwyżej o \c setCameraTolerance(), np.:
+         * \code
+         * rManager.camera->setCameraAbsAsync( 30, -10, 0 ).wait();
+         * takePicture();
+         * \endcode
+         *
+         * \param pan int - obrót
+         * \param tilt int - pochylenie
+         * \param zoom int - zbliżenie
+         * \param timeout_ms int - maksymalny czas wykonania polecenia w \c ms (ujemny - bez limitu)
+         * \return std::future<commandStatus> - wynik polecenia
+         *
+         */
+        std::future<commandStatus> setCameraAbsAsync( int pan, int tilt, int zoom, int timeout_ms = 5000 );
+        /** \brief Ustawia dokładność, z jaką wykrywane jest zakończenie poleceń kamery
+         *
+         * \param tolerance int - dopuszczalna różnica każdej ze współrzędnych (domyślnie 1)
+         * \return void
+         *
+         */
+        void setCameraTolerance( int tolerance );
 
         // Key camera steering
         /** \brief Aktywuje sterowanie kamerą za pomocą klawiatury
@@ -326,31 +732,212 @@ private:
          *
          */
         int getSendVideoDelay();
+        /** \brief Ustawia odstęp czasowy pomiędzy kolejnymi klatkami w strumieniu z kamery
+         *
+         * Zapytanie \c sendVideo jest ponawiane z nowym okresem. W trybie adaptacyjnym
+         * (patrz \c getVideoRate()) jest to najkrótszy używany odstęp.
+         *
+         * \param delay_ms int - odstęp czasowy w \c ms
+         * \return void
+         *
+         */
+        void setSendVideoDelay( int delay_ms );
+        /** \brief Zwraca okres strumienia \c sendVideo
+         *
+         * Pozwala włączyć adaptację częstotliwości klatek do opóźnienia odbiorców
+         * i przepustowości łącza, np.:
+         * \code
+         * rManager.camera->getVideoRate()->enableAdaptive( 2000 );
+         * // w wątku odbiorcy, po przetworzeniu klatki:
+         * rManager.camera->getVideoRate()->reportConsumerLag( clientUtil::monotonicTime_us() - frame->getTimestamp_us() );
+         * \endcode
+         * Klatki odrzucone przez subskrybentów (\c subscribeFrames()) są uwzględniane automatycznie.
+         *
+         * \return rateController* - okres strumienia \c sendVideo
+         *
+         */
+        rateController* getVideoRate();
+        /** \brief Zwraca okres strumienia \c getCameraInfoCamera_1
+         *
+         * \return rateController* - okres strumienia \c getCameraInfoCamera_1 (domyślnie 1000 ms)
+         *
+         */
+        rateController* getCameraInfoRate();
+        /** \brief Zwraca statystyki strumienia \c sendVideo
+         *
+         * Obejmują odstępy i rozmiary klatek, czasy dekodowania (\c startDecoding()),
+         * opóźnienia zgłoszone przez \c getVideoRate()->reportConsumerLag() oraz klatki
+         * odrzucone z powodu rozmiaru, przez subskrybentów i przez dekoder.
+         *
+         * \return streamStats* - statystyki strumienia \c sendVideo
+         *
+         */
+        streamStats* getVideoStats();
         /** \brief Zwraca odstęp czasowy pomiędzy kolejnymi klatkami w strumieniu z kamery
          *
          * \return int - odtęp czasowy pomiędzy kolejnymi klatkami w \c ums
          *
          */
         int getSynchroTime_ums();
-        /** \brief Zwraca ostatnio pobraną klatkę obrazu z kamery
+        /** \brief Zwraca uchwyt do ostatnio pobranej kompletnej klatki obrazu z kamery
          *
-         * Para, która zwraca jest przez funkcję reprezentuje blob obrazu z kamery wraz z jego długością.
-         * Zaproponowany format zwracanej wielkości jest bardzo łatwy do zintegrowania z OpenCV, np.:
+         * Metoda nie blokuje i nie usypia wątku. Uchwyt udostępnia dane klatki
+         * (bez kopiowania) wraz z jej rozmiarem, numerem kolejnym i chwilą odbioru.
+         * Dane pozostają niezmienione tak długo, jak istnieje zwrócony uchwyt, np.:
          * \code
-         * std::pair<unsigned char*, int> imageData;
-         * imageData = rManager.camera->getSendVideoFrame();
-         * std::vector<unsigned char> buffer( imageData.first, imageData.first + imageData.second );
-         * cv::Mat image = imdecode(buffer, cv::IMREAD_ANYCOLOR);
+         * frameHandle frame = rManager.camera->getLatestFrame();
+         * if( !frame.empty() )
+         * {
+         *     cv::Mat rawData( 1, frame->getLength(), CV_8UC1, (void*) frame->getData() );
+         *     cv::Mat image = cv::imdecode( rawData, cv::IMREAD_ANYCOLOR );
+         * }
          * \endcode
          *
+         * \return frameHandle - uchwyt do klatki lub pusty uchwyt, jeśli nie odebrano jeszcze żadnej klatki
+         *
+         */
+        frameHandle getLatestFrame();
+        /** \brief Czeka na klatkę nowszą niż \c lastSequence
+         *
+         * Wątek jest usypiany do chwili odebrania klatki (bez odpytywania), np.:
+         * \code
+         * unsigned long long lastSequence = 0;
+         * while( running )
+         * {
+         *     frameHandle frame = rManager.camera->waitForNextFrame( lastSequence, 100 );
+         *     if( frame.empty() )
+         *         continue;
+         *     lastSequence = frame->getSequence();
+         *     show( frame );
+         * }
+         * \endcode
+         *
+         * \param lastSequence unsigned long long - numer ostatnio przetworzonej klatki (0 - dowolna klatka)
+         * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+         * \return frameHandle - uchwyt do nowszej klatki lub pusty uchwyt po upływie czasu
+         *
+         */
+        frameHandle waitForNextFrame( unsigned long long lastSequence, int timeout_ms );
+        /** \brief Zwraca deskryptor \c eventfd sygnalizujący odebranie klatki
+         *
+         * Deskryptor można dodać do własnej pętli \c poll / \c epoll; po wybudzeniu należy
+         * odczytać z niego 8 bajtów i pobrać klatkę metodą \c getLatestFrame().
+         * Deskryptor należy do obiektu - nie wolno go zamykać.
+         *
+         * \return int - deskryptor lub -1, jeśli nie udało się go utworzyć
+         *
+         */
+        int getFrameEventFd();
+        /** \brief Zwraca ostatnio pobraną klatkę obrazu z kamery
+         *
+         * Para, która zwraca jest przez funkcję reprezentuje blob obrazu z kamery wraz z jego długością.
+         * Wskaźnik pozostaje ważny do następnego wywołania tej metody, dlatego może z niej
+         * korzystać tylko jeden wątek - w nowym kodzie należy używać \c getLatestFrame().
+         *
          * \return std::pair<unsigned char*, int> - blob obrazu z kamery wzraz z jego długością
+         * (\c NULL i \c 0, jeśli nie odebrano jeszcze żadnej klatki)
          *
          */
         std::pair<unsigned char*, int> getSendVideoFrame();
 
+        /** \brief Tworzy subskrypcję strumienia klatek z kamery
+         *
+         * Każdy subskrybent otrzymuje klatki do własnej kolejki i pobiera je we własnym
+         * tempie metodą \c frameSubscriber::tryPop(), np.:
+         * \code
+         * frameSubscriber* recorder = rManager.camera->subscribeFrames( 32, frameSubscriber::BLOCK );
+         * frameSubscriber* preview = rManager.camera->subscribeFrames( 1, frameSubscriber::DROP_OLDEST, 5 );
+         * frameHandle frame;
+         * while( preview->tryPop( frame ) )
+         *     show( frame );
+         * \endcode
+         *
+         * \param queueCapacity int - pojemność kolejki subskrybenta
+         * \param policy frameSubscriber::dropPolicy - zachowanie przy pełnej kolejce
+         * \param decimation int - co która klatka strumienia trafia do subskrybenta
+         * \return frameSubscriber* - subskrybent (zwalniany przez \c unsubscribeFrames())
+         *
+         */
+        frameSubscriber* subscribeFrames( int queueCapacity = 8,
+                                          frameSubscriber::dropPolicy policy = frameSubscriber::DROP_OLDEST,
+                                          int decimation = 1 );
+        /** \brief Kończy subskrypcję i niszczy obiekt subskrybenta
+         *
+         * Po powrocie z metody do subskrybenta nie trafi już żadna klatka.
+         *
+         * \param subscriber frameSubscriber* - subskrybent zwrócony przez \c subscribeFrames()
+         * \return void
+         *
+         */
+        void unsubscribeFrames( frameSubscriber* subscriber );
+
+        /** \brief Uruchamia dekodowanie klatek w puli wątków
+         *
+         * Każda klatka dekodowana jest raz, a zdekodowany obraz współdzielą wszyscy
+         * odbiorcy \c waitForNextDecodedFrame() i \c getDecoder()->getLatest(), np.:
+         * \code
+         * rManager.camera->startDecoding( 2, frameDecoder::DECODE_GRAYSCALE, 2 );
+         * decodedHandle frame = rManager.camera->waitForNextDecodedFrame( lastSequence, 100 );
+         * if( !frame.empty() )
+         *     cv::imshow( "Stream", frame->getImage() );
+         * \endcode
+         *
+         * \param workersCount int - liczba wątków dekodujących
+         * \param mode frameDecoder::colorMode - format obrazu
+         * \param scale int - dzielnik rozdzielczości obrazu: 1, 2, 4 lub 8
+         * \return void
+         *
+         */
+        void startDecoding( int workersCount = 2, frameDecoder::colorMode mode = frameDecoder::DECODE_COLOR, int scale = 1 );
+        /** \brief Zatrzymuje dekodowanie klatek
+         *
+         * \return void
+         *
+         */
+        void stopDecoding();
+        /** \brief Czeka na zdekodowaną klatkę nowszą niż \c lastSequence (patrz \c startDecoding())
+         *
+         * \param lastSequence unsigned long long - numer ostatnio przetworzonej klatki (0 - dowolna klatka)
+         * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+         * \return decodedHandle - uchwyt do nowszej klatki lub pusty uchwyt po upływie czasu
+         *
+         */
+        decodedHandle waitForNextDecodedFrame( unsigned long long lastSequence, int timeout_ms );
+        /** \brief Zwraca dekoder klatek, np. w celu odczytu statystyk
+         *
+         * \return frameDecoder* - dekoder używany przez \c startDecoding()
+         *
+         */
+        frameDecoder* getDecoder();
+
+        /** \brief Ustawia największy dopuszczalny rozmiar klatki
+         *
+         * Bufory klatek dobierane są do rozmiaru odbieranych obrazów, więc zwiększenie
+         * rozdzielczości lub jakości obrazu po stronie serwera nie wymaga zmian w kliencie.
+         * Klatki większe niż limit są odrzucane (patrz \c getOversizedFramesCount()).
+         *
+         * \param maxFrameSize_bytes int - limit rozmiaru klatki w bajtach (domyślnie 1 MB)
+         * \return void
+         *
+         */
+        void setMaxFrameSize( int maxFrameSize_bytes );
+        /** \brief Zwraca największy dopuszczalny rozmiar klatki
+         *
+         * \return int - limit rozmiaru klatki w bajtach
+         *
+         */
+        int getMaxFrameSize();
+        /** \brief Zwraca liczbę klatek odrzuconych z powodu przekroczenia limitu rozmiaru
+         *
+         * \return unsigned long long - liczba odrzuconych klatek
+         *
+         */
+        unsigned long long getOversizedFramesCount();
+
         /** \brief Rozpoczyna zapisywanie serii klatek ze strumienia kamery do folderu \c "video_record/"
          *
-         * Kolejne klatki zapisywane są w formacie \c .jpg
+         * Kolejne klatki zapisywane są w formacie \c .jpg w osobnym wątku - patrz
+         * \c getRecorder().
          *
          * \return void
          *
@@ -362,6 +949,40 @@ private:
          *
          */
         void stopRecording();
+        /** \brief Zwraca rejestrator klatek, np. w celu zmiany jego ustawień lub odczytu statystyk
+         *
+         * \return frameRecorder* - rejestrator używany przez \c startRecording()
+         *
+         */
+        frameRecorder* getRecorder();
+
+        /** \brief Rozpoczyna odtwarzanie nagranej sesji zamiast strumienia z kamery
+         *
+         * Klatki z nagrania (patrz \c frameRecorder::MODE_FRAME_LOG) trafiają do
+         * wszystkich odbiorców (\c getLatestFrame(), subskrybenci, rejestrator) tak, jak
+         * klatki odbierane z serwera; w tym czasie klatki z serwera są pomijane.
+         *
+         * \param path const std::string& - nagranie (patrz \c frameLogReader::open())
+         * \param pace frameReplay::pace - tempo odtwarzania
+         * \param loop bool - \b True, jeśli nagranie ma być odtwarzane w pętli
+         * \param speed double - mnożnik tempa dla \c frameReplay::PACE_REALTIME
+         * \return bool - \b True, jeśli udało się otworzyć nagranie
+         *
+         */
+        bool startReplay( const std::string& path, frameReplay::pace pace = frameReplay::PACE_REALTIME,
+                          bool loop = false, double speed = 1.0 );
+        /** \brief Kończy odtwarzanie nagrania i przywraca strumień z kamery
+         *
+         * \return void
+         *
+         */
+        void stopReplay();
+        /** \brief Sprawdza czy trwa odtwarzanie nagrania
+         *
+         * \return bool - \b True, jeśli trwa odtwarzanie
+         *
+         */
+        bool isReplaying();
 
         /** \brief Włącza wyświetlanie dodatkowych informacji
          *
@@ -387,15 +1008,32 @@ private:
         int my_camera_pan, my_camera_tilt,
             my_camera_zoom;/**< aktualne współrzędne opisujące stan konfiguracji kamery */
 
+        // Camera commands completion
+        commandTracker<cameraPosition> my_cameraTracker;/**< polecenia kamery oczekujące na zakończenie */
+        std::atomic<int> my_cameraTolerance;/**< dokładność wykrywania zakończenia poleceń kamery */
+        bool my_isRequestingCameraData;/**< stan odpytywania o położenie kamery */
+        ArMutex my_cameraDataMutex;/**< blokada rozpoczynania i kończenia odpytywania o położenie kamery */
+
         // Send video
-        unsigned char my_lastSnap[38400];/**< ostatnia pobrana klatka ze strumienia obrazu z kamery */
-        int my_lastSnapSize, my_sendVideoDelay; /**< dane dotyczący strumienia obrazu z kamery */
-        bool my_video_mutexOn;/**< mutex blokujący dostęp do \c my_lastSnap[] */
+        framePool my_framePool;/**< pula buforów klatek ze strumienia obrazu z kamery */
+        latestStore<frameBuffer> my_frameStore;/**< ostatnia kompletna klatka ze strumienia obrazu z kamery */
+        frameHandle my_legacyFrame;/**< klatka zwrócona ostatnio przez \c getSendVideoFrame() */
+        unsigned long long my_frameSequence;/**< numer ostatnio odebranej klatki */
+        std::atomic<unsigned long long> my_oversizedFrames;/**< liczba klatek odrzuconych z powodu rozmiaru */
+        rcuList<frameSubscriber*> my_frameSubscribers;/**< subskrybenci strumienia klatek */
+        streamNotifier my_frameNotifier;/**< powiadamianie o odebranych klatkach */
+        streamStats my_videoStats;/**< statystyki strumienia \c sendVideo */
+        unsigned long long my_lastConsumerDrops;/**< suma odrzuceń subskrybentów przy poprzedniej klatce */
+        frameDecoder my_decoder;/**< dekodowanie klatek w puli wątków */
+        rateController my_videoRate;/**< okres strumienia \c sendVideo (odstęp czasowy pomiędzy kolejnymi klatkami) */
+        rateController my_cameraInfoRate;/**< okres strumienia \c getCameraInfoCamera_1 */
 
-        // Frame recording variables
-        bool my_recordToFolder;/**< stan opcji nagrywania strumienia obrazu z kamery do plików \c .jpg */
-        int my_frame_number, my_filename_length;/**< dane dotyczące nagrywania strumienia */
-        std::string my_file_extension;/**< rozszerzenie plików, do których zapisywane są klatki ze strumienia */
+        // Frame recording
+        frameRecorder my_recorder;/**< zapis strumienia obrazu z kamery do plików \c .jpg */
+
+        // Frame replay
+        frameReplay my_replay;/**< odtwarzanie nagranej sesji */
+        ArMutex my_deliveryMutex;/**< zapewnia, że klatki przekazuje tylko jeden wątek naraz */
 
         // Camera key steering
         bool my_cameraSteeringActiveStatus;/**< stan opcji sterowania kamerą klawiaturą */
@@ -403,14 +1041,20 @@ private:
     private:
         ArClientBase* my_client;/**< wskaźnik do klienta Aria */
         keyHandlerMaster* my_keyHandler;/**< wskaźnik do obiektu klasu \c robotManager::keyHandlerMaster */
+        telemetryRecorder* my_telemetry;/**< wskaźnik do obiektu zapisu telemetrii */
+        clientCommand my_command_setCameraAbs, my_command_setCameraRel;/**< polecenia \c setCameraAbsCamera_1 i \c setCameraRelCamera_1 */
 
-        void recordFrame(unsigned char* image, int length_of_image );/**< \brief Zapisuje przekazaną klatkę do kolejnego pliku \c .jpg */
+        void deliverFrame( frameBuffer* frame, bool mayWait );/**< \brief Publikuje kompletną klatkę wszystkim odbiorcom (przejmuje referencję); \c mayWait - patrz \c frameSubscriber::push() */
 
         // CALLBACKS FUNCTIONS
         void handle_getCameraList( ArNetPacket* packet ); /**< callback polecenia \c getCameraList */
         void handle_snapshot( ArNetPacket* packet);/**< callback polecenia \c snapshot */
         void handle_getCameraInfoCamera_1( ArNetPacket* packet);/**< callback polecenia \c getCameraInfoCamera */
         void handle_getCameraDataCamera_1( ArNetPacket* packet);/**< callback polecenia \c getCameraDataCamera */
+        void handle_replayFrame( const frameLogFrame* frame );/**< callback odtwarzanej klatki */
+        void handle_applyVideoPeriod( int period_ms );/**< ponawia zapytanie \c sendVideo z nowym okresem */
+        void handle_applyCameraInfoPeriod( int period_ms );/**< ponawia zapytanie \c getCameraInfoCamera_1 z nowym okresem */
+        void handle_sendCameraMove( const double* values );/**< wysyła połączone przestawienie kamery */
         // Key handling (S)
         void handle_key_w(void);/**< odchylenie kamery*/
         void handle_key_s(void);/**< pochylenie kamery */
@@ -425,6 +1069,10 @@ private:
         ArFunctor1C<cameraManager, ArNetPacket*> my_functor_handle_snapshot;/**< functor dla polecenie \c snapshot */
         ArFunctor1C<cameraManager, ArNetPacket*> my_functor_handle_getCameraInfoCamera_1;/**< functor dla polecenie \c getCameraInfoCamera */
         ArFunctor1C<cameraManager, ArNetPacket*> my_functor_hanlde_getCameraDataCamera_1;/**< functor dla polecenie \c getCameraDataCamera */
+        ArFunctor1C<cameraManager, const frameLogFrame*> my_functor_handle_replayFrame;/**< functor odtwarzanej klatki */
+        ArFunctor1C<cameraManager, int> my_functor_handle_applyVideoPeriod;/**< functor do metody \c handle_applyVideoPeriod() */
+        ArFunctor1C<cameraManager, int> my_functor_handle_applyCameraInfoPeriod;/**< functor do metody \c handle_applyCameraInfoPeriod() */
+        ArFunctor1C<cameraManager, const double*> my_functor_handle_sendCameraMove;/**< functor do metody \c handle_sendCameraMove() */
         // Key handling (S)
         ArFunctorC<cameraManager> my_functor_handle_key_w;/**< functor do obsługi klawisza \c W */
         ArFunctorC<cameraManager> my_functor_handle_key_s;/**< functor do obsługi klawisza \c S */
@@ -433,6 +1081,9 @@ private:
         ArFunctorC<cameraManager> my_functor_handle_key_r;/**< functor do obsługi klawisza \c E */
         ArFunctorC<cameraManager> my_functor_handle_key_f;/**< functor do obsługi klawisza \c F */
         // Key handling (E)
+
+        // Declared after the functors, so its thread stops before they are destroyed
+        commandCoalescer my_cameraMoveCoalescer;/**< łączenie przestawień kamery */
     };
 
     /** \brief Sterowanie robotem
@@ -452,11 +1103,12 @@ private:
          *
          * \param _client ArClientBase* - klient Aria
          * \param _keyHandler keyHandlerMaster* - obiekt klasy \c robotManager::keyHandlerMaster
+         * \param _requests requestsHandler* - obiekt klasy \c robotManager::requestsHandler (stan robota)
          * \param _activateKeySteering - domyślny stan opcji sterowania za pomocą klawiatury
          *
          */
         steeringManager( ArClientBase *_client, keyHandlerMaster *_keyHandler,
-                         bool _activateKeySteering = true);
+                         requestsHandler *_requests, bool _activateKeySteering = true);
 
         /** \brief Przejechanie robotem w przód / tył o zadaną wartość
          *
@@ -480,6 +1132,76 @@ private:
          */
         void turnToHeading( double angle_deg );
 
+        /** \brief Przejechanie robotem w przód / tył o zadaną wartość z powiadomieniem o zakończeniu
+         *
+         * Polecenie kończy się, gdy robot przejedzie zadaną odległość (z dokładnością
+         * \c setMotionTolerance()) i się zatrzyma. Zakończenie wykrywane jest na podstawie
+         * pakietów \c updateNumbers, więc opóźnienie zależy od ich okresu
+         * (patrz \c requestsHandler::get_updateNumbersRate()), np.:
+         * \code
+         * rManager.requests->get_updateNumbersRate()->setPeriod( 100 );
+         * if( rManager.steering->moveDistanceAsync( 500 ).get() == COMMAND_COMPLETED )
+         *     rManager.steering->turnByAngleAsync( 90 ).wait();
+         * \endcode
+         *
+         * \param distance_mm double - wartość o jaką robot ma się przesunąć
+         * \param timeout_ms int - maksymalny czas wykonania polecenia w \c ms (ujemny - bez limitu)
+         * \return std::future<commandStatus> - wynik polecenia
+         *
+         */
+        std::future<commandStatus> moveDistanceAsync( double distance_mm, int timeout_ms = 30000 );
+        /** \brief Obrót robotem o zadany kąt z powiadomieniem o zakończeniu
+         *
+         * Kąt obrotu sumowany jest z kolejnych pakietów \c updateNumbers od położenia
+         * z chwili wysłania polecenia, więc obroty o 360 stopni i więcej są wykrywane
+         * poprawnie, o ile pomiędzy pakietami robot obraca się o mniej niż 180 stopni.
+         * Jeśli ostatnie znane położenie jest starsze niż 100 ms, polecenie wysyłane
+         * jest dopiero po odebraniu następnego pakietu.
+         *
+         * \param angle_deg double - kąt w stopniach o jaki robot ma się obrócić
+         * \param timeout_ms int - maksymalny czas wykonania polecenia w \c ms (ujemny - bez limitu)
+         * \return std::future<commandStatus> - wynik polecenia (patrz \c moveDistanceAsync())
+         *
+         */
+        std::future<commandStatus> turnByAngleAsync( double angle_deg, int timeout_ms = 30000 );
+        /** \brief Obrót robotem na azymut z powiadomieniem o zakończeniu
+         *
+         * \param angle_deg double - kąt w stopniach, do którego robot ma się obrócić
+         * \param timeout_ms int - maksymalny czas wykonania polecenia w \c ms (ujemny - bez limitu)
+         * \return std::future<commandStatus> - wynik polecenia (patrz \c moveDistanceAsync())
+         *
+         */
+        std::future<commandStatus> turnToHeadingAsync( double angle_deg, int timeout_ms = 30000 );
+        /** \brief Ustawia dokładność, z jaką wykrywane jest zakończenie poleceń ruchu
+         *
+         * \param distance_mm double - dopuszczalny błąd odległości w \c mm (domyślnie 10)
+         * \param angle_deg double - dopuszczalny błąd kąta w stopniach (domyślnie 2)
+         * \param velocity_mms double - prędkość w \c mm/s, poniżej której robot uznawany jest za zatrzymany (domyślnie 10)
+         * \param rotationalVelocity_degs double - prędkość kątowa w stopniach/s, poniżej której robot uznawany jest za zatrzymany (domyślnie 2)
+         * \return void
+         *
+         */
+        void setMotionTolerance( double distance_mm, double angle_deg,
+                                 double velocity_mms, double rotationalVelocity_degs );
+        /** \brief Ustawia prędkość robota, zachowując tylko najnowszą wartość zadaną w oknie
+         *
+         * Wartości zgłoszone w trakcie okna \c getVelocityCoalescer() zastępowane są
+         * najnowszą, a robot otrzymuje co najwyżej jedną wartość zadaną na okno
+         * (z tej metody korzysta sterowanie prędkościowe klawiaturą).
+         *
+         * \param transRatio double - prędkość translacyjna w procentach prędkości maksymalnej
+         * \param rotRatio double - prędkość kątowa w procentach prędkości maksymalnej
+         * \return void
+         *
+         */
+        void setVelocityRatio( double transRatio, double rotRatio );
+        /** \brief Zwraca obiekt łączenia wartości zadanych prędkości (np. w celu zmiany okna)
+         *
+         * \return commandCoalescer* - łączenie wartości zadanych prędkości (domyślne okno 20 ms - jeden takt sterowania)
+         *
+         */
+        commandCoalescer* getVelocityCoalescer();
+
         /** \brief Aktywacja sterowania prędkościowego za pomocą klawiatury
          *
          * \return void
@@ -518,14 +1240,22 @@ private:
         const int VEL_PERC;/**< limit wykorzystania mocy silników podany w procentach */
 
         double my_velThrottle, my_rotThrottle; /**< dane chwilowe potrzebne do sterowania prędkościowego */
+        ArMutex my_throttleMutex;/**< blokada danych sterowania prędkościowego (klawisze i takt sterowania działają w osobnych wątkach) */
+
+        std::atomic<double> my_distanceTolerance_mm, my_angleTolerance_deg,
+            my_velocityTolerance_mms, my_rotationalVelocityTolerance_degs;/**< dokładność wykrywania zakończenia poleceń ruchu */
 
     private:
         ArClientBase* my_client;/**< wskaźnik do klienta Aria */
         keyHandlerMaster* my_keyHandler;/**< wskaźnik do obiektu klasy \c robotManager::keyHandlerMaster */
+        requestsHandler* my_requests;/**< wskaźnik do obiektu klasy \c robotManager::requestsHandler */
         ArClientRatioDrive my_clientRatioDrive;/**< wskaźnik do obiektu klasy \c ArClientRatioDrive */
+        clientCommand my_command_moveDist, my_command_turnByAngle,
+            my_command_turnToHeading;/**< polecenia \c moveDist, \c turnByAngle i \c turnToHeading */
 
 
         void handle_jogModeRequests( int type, double value );/**< \brief Wewnętrzna metoda do obsługi poleceń \c JogModeRequest */
+        static double decayThrottle( double throttle, double decay );/**< \brief Zbliża przepustnicę do zera o \c decay i ogranicza ją do [-1, 1] */
 
         // CALLBACKS FUNCTIONS
         void handle_key_up(void);/**< callback do obsługi wciśnięcia strzałki w górę */
@@ -534,6 +1264,7 @@ private:
         void handle_key_right(void);/**< callback do obsługi wciśnięcia strzałki w prawo */
         void handle_key_space(void);/**< callback do obsługi wciśnięcia spacji */
         void callback_keySteeringCallback(void);/**< callback do obsługi sterowania prędkościowego */
+        void handle_sendVelocity( const double* values );/**< wysyła najnowszą wartość zadaną prędkości */
 
         // CALLBACKS FUNCTORS
         ArFunctorC<steeringManager> my_functor_handle_key_up;/**< functor do obsługi wciśnięcia strzałki w górę */
@@ -542,6 +1273,10 @@ private:
         ArFunctorC<steeringManager> my_functor_handle_key_right;/**< functor do obsługi wciśnięcia strzałki w prawo */
         ArFunctorC<steeringManager> my_functor_handle_key_space;/**< functor do obsługi wciśnięcia spacji */
         ArFunctorC<steeringManager> my_functor_callback_keySteeringCallback;/**< functor do obsługi sterowania prędkościowego */
+        ArFunctor1C<steeringManager, const double*> my_functor_handle_sendVelocity;/**< functor do metody \c handle_sendVelocity() */
+
+        // Declared after the functors, so its thread stops before they are destroyed
+        commandCoalescer my_velocityCoalescer;/**< łączenie wartości zadanych prędkości */
     };
 
 private:
@@ -551,11 +1286,29 @@ private:
 
     bool my_isClienRunning;/**< stan działania klienta */
 
+    ArMutex my_statsDumpMutex;/**< blokada uruchamiania i kończenia wypisywania statystyk */
+    taskScheduler::taskHandle my_statsDumpTask;/**< zadanie wypisywania statystyk (0 - brak) */
+    FILE* my_statsOutput;/**< strumień wyjściowy statystyk */
+
+    taskScheduler::taskHandle my_commandExpiryTask;/**< zadanie kończenia przeterminowanych poleceń */
+
+    // CALLBACKS FUNCTIONS
+    void handle_dumpStats(void);/**< wypisuje statystyki strumieni (zadanie planisty) */
+    void handle_expireCommands(void);/**< kończy polecenia, których czas minął (zadanie planisty) */
+    void handle_disconnected(void);/**< anuluje oczekujące polecenia po rozłączeniu z serwerem */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<robotManager> my_functor_handle_dumpStats;/**< functor do metody \c handle_dumpStats() */
+    ArFunctorC<robotManager> my_functor_handle_expireCommands;/**< functor do metody \c handle_expireCommands() */
+    ArFunctorC<robotManager> my_functor_handle_disconnected;/**< functor do metody \c handle_disconnected() */
+
 public:
     requestsHandler* requests; /**< Wskaźnik do obiektu obsługującego \c pobieranie informacji dot. robota */
     steeringManager* steering;/**< Wskaźnik do obiektu obsługującego \c sterowanie robota*/
     cameraManager* camera;/**< Wskaźnik do obiektu obsługującego \c kamerę*/
     keyHandlerMaster* keyHandler;/**< Wskaźnik do obiektu obsługującego \c klawiaturę*/
+    telemetryRecorder* telemetry;/**< Wskaźnik do obiektu obsługującego \c zapis \c telemetrii*/
+    taskScheduler* scheduler;/**< Wskaźnik do \c planisty \c zadań okresowych klienta*/
 };
 
 #endif // ROBOTMANAGER_H_INCLUDED
@@ -0,0 +1,21 @@
+#ifndef ROBOTSTATE_H_INCLUDED
+#define ROBOTSTATE_H_INCLUDED
+
+/** \brief Spójny stan robota z jednego pakietu \c updateNumbers
+ *
+ * Zwracany przez \c robotManager::requestsHandler::get_robotState() - wszystkie
+ * pola pochodzą z tego samego pakietu.
+ */
+struct robotState
+{
+    unsigned long long sequence;/**< numer kolejny pakietu (0 - nie odebrano jeszcze stanu) */
+    long long timestamp_us;/**< chwila odebrania w \c us (patrz \c clientUtil::monotonicTime_us()) */
+    double batteryVoltage;/**< napięcie baterii */
+    double xPosition, yPosition;/**< położenie robota w \c mm */
+    double theta;/**< kąt obrotu robota w stopniach */
+    double velocity;/**< prędkość translacyjna w \c mm/s */
+    double rotationalVelocity;/**< prędkość kątowa w stopniach/s */
+    double temperature;/**< temperatura */
+};
+
+#endif // ROBOTSTATE_H_INCLUDED
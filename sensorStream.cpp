@@ -0,0 +1,222 @@
+#include "sensorStream.h"
+
+#include <cstring>
+
+// Scans created up front for every sensor (arrays grow on the first larger scan)
+static const int PREALLOCATED_SCANS = 4;
+static const int PREALLOCATED_POINTS = 361;
+
+sensorStream::sensorStream( const std::string& name, int index ) :
+    my_name( name ), my_index( index ), my_rate( NULL, 0 ), my_stats( name ), my_scansCount( 0 ),
+    my_nextRequest_us( 0 )
+{
+    my_rate.setStats( &my_stats );
+    my_scanPool.preallocate( PREALLOCATED_SCANS, PREALLOCATED_POINTS );
+    my_requestPacket.strToBuf( my_name.c_str() );
+    my_requestPacket.finalizePacket();
+}
+
+const std::string& sensorStream::getName() const
+{
+    return my_name;
+}
+
+int sensorStream::getIndex() const
+{
+    return my_index;
+}
+
+int sensorStream::getPeriod() const
+{
+    return my_rate.getPeriod();
+}
+
+void sensorStream::setPeriod( int period_ms )
+{
+    my_rate.setPeriod( period_ms );
+}
+
+rateController* sensorStream::getRate()
+{
+    return &my_rate;
+}
+
+streamStats* sensorStream::getStats()
+{
+    return &my_stats;
+}
+
+scanHandle sensorStream::getScan()
+{
+    return my_scanStore.acquire();
+}
+
+unsigned long long sensorStream::getScansCount() const
+{
+    return my_scansCount.load();
+}
+
+scanHandle sensorStream::waitForScan( unsigned long long lastSequence, int timeout_ms )
+{
+    scanHandle scan;
+    if( !my_scanNotifier.waitFor( [&]() { scan = my_scanStore.acquire();
+                                          return !scan.empty() && scan->getSequence() > lastSequence; },
+                                  timeout_ms ))
+        return scanHandle();
+    return scan;
+}
+
+int sensorStream::getEventFd()
+{
+    return my_scanNotifier.getEventFd();
+}
+
+laserScan* sensorStream::acquireScan( int points )
+{
+    return my_scanPool.acquire( points );
+}
+
+void sensorStream::publishScan( laserScan* scan, long long timestamp_us )
+{
+    scan->setScanInfo( my_scansCount.load( std::memory_order_relaxed ) + 1, timestamp_us );
+    my_scanStore.publish( scan );
+    my_scansCount.fetch_add( 1, std::memory_order_release );
+    my_scanNotifier.notify();
+}
+
+ArNetPacket* sensorStream::getRequestPacket()
+{
+    return &my_requestPacket;
+}
+
+long long sensorStream::getNextRequest_us() const
+{
+    return my_nextRequest_us;
+}
+
+void sensorStream::setNextRequest_us( long long nextRequest_us )
+{
+    my_nextRequest_us = nextRequest_us;
+}
+
+sensorTable::sensorTable( const std::vector<std::string>& names ) :
+    my_seed( 0 )
+{
+    for( size_t i = 0; i < names.size(); i++ )
+    {
+        bool duplicate = false;
+        for( size_t j = 0; j < my_streams.size() && !duplicate; j++ )
+            duplicate = my_streams[j]->getName() == names[i];
+        if( !duplicate )
+            my_streams.push_back( new sensorStream( names[i], (int) my_streams.size() ));
+    }
+
+    size_t slotsCount = 8;
+    while( slotsCount < 2 * my_streams.size() )
+        slotsCount *= 2;
+
+    // Names are distinct, so some seed gives distinct 64-bit hashes (nearly always the first one)
+    std::vector<uint64_t> hashes( my_streams.size() );
+    bool unique = false;
+    while( !unique )
+    {
+        unique = true;
+        for( size_t i = 0; i < my_streams.size() && unique; i++ )
+        {
+            hashes[i] = hashName( my_streams[i]->getName().c_str(), my_streams[i]->getName().size() + 1, NULL );
+            for( size_t j = 0; j < i && unique; j++ )
+                unique = hashes[j] != hashes[i];
+        }
+        if( !unique )
+            my_seed++;
+    }
+
+    slot empty = { 0, NULL };
+    my_slots.assign( slotsCount, empty );
+    for( size_t i = 0; i < my_streams.size(); i++ )
+    {
+        size_t position = hashes[i] & ( slotsCount - 1 );
+        while( my_slots[position].stream != NULL )
+            position = ( position + 1 ) & ( slotsCount - 1 );
+        my_slots[position].hash = hashes[i];
+        my_slots[position].stream = my_streams[i];
+    }
+}
+
+sensorTable::~sensorTable()
+{
+    for( size_t i = 0; i < my_streams.size(); i++ )
+        delete my_streams[i];
+}
+
+int sensorTable::getCount() const
+{
+    return (int) my_streams.size();
+}
+
+sensorStream* sensorTable::get( int index ) const
+{
+    if( index < 0 || index >= (int) my_streams.size() )
+        return NULL;
+    return my_streams[index];
+}
+
+sensorStream* sensorTable::find( const char* name ) const
+{
+    size_t length = strlen( name );
+    return findByHash( hashName( name, length + 1, NULL ), name, length );
+}
+
+sensorStream* sensorTable::findInPacket( ArNetPacket* packet ) const
+{
+    int readLength = packet->getReadLength();
+    int remaining = (int) packet->getLength() - readLength;
+    if( remaining <= 0 )
+        return NULL;
+
+    size_t length;
+    uint64_t hash = hashName( packet->getBuf() + readLength, remaining, &length );
+    if( length == (size_t) remaining )
+    {
+        // Name is not terminated within the packet
+        packet->setReadLength( packet->getLength() );
+        return NULL;
+    }
+    packet->setReadLength( readLength + length + 1 );
+    return findByHash( hash, packet->getBuf() + readLength, length );
+}
+
+uint64_t sensorTable::hashName( const char* name, size_t maxLength, size_t* length ) const
+{
+    uint64_t hash = 14695981039346656037ULL ^ ( my_seed * 0x9e3779b97f4a7c15ULL );
+    size_t i = 0;
+    for( ; i < maxLength && name[i] != '\0'; i++ )
+    {
+        hash ^= (unsigned char) name[i];
+        hash *= 1099511628211ULL;
+    }
+    if( length )
+        *length = i;
+
+    // Mix the high bits into the low ones, which select the slot
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+sensorStream* sensorTable::findByHash( uint64_t hash, const char* name, size_t length ) const
+{
+    size_t mask = my_slots.size() - 1;
+    for( size_t position = hash & mask; my_slots[position].stream != NULL; position = ( position + 1 ) & mask )
+    {
+        if( my_slots[position].hash != hash )
+            continue;
+        // Hashes of listed names are distinct, but an unknown name may still collide
+        const std::string& stored = my_slots[position].stream->getName();
+        if( stored.size() == length && memcmp( stored.data(), name, length ) == 0 )
+            return my_slots[position].stream;
+        return NULL;
+    }
+    return NULL;
+}
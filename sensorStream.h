@@ -0,0 +1,230 @@
+#ifndef SENSORSTREAM_H_INCLUDED
+#define SENSORSTREAM_H_INCLUDED
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ArNetworking.h"
+
+#include "laserScan.h"
+#include "latestStore.h"
+#include "rateController.h"
+#include "streamStats.h"
+#include "streamNotifier.h"
+
+/** \brief Strumień pomiarów jednego czujnika (dalmierza laserowego, sonaru)
+ *
+ * Każdy czujnik ma własną pulę pomiarów (wstępnie zaalokowaną), własny magazyn
+ * ostatniego pomiaru oraz gotowy pakiet zapytania \c getSensorCurrent z jego
+ * nazwą. Okres odpytywania czujnika ustawia \c setPeriod() (lub adaptacyjnie
+ * \c getRate()) - zapytania wysyła wątek \c robotManager::requestsHandler.
+ */
+class sensorStream
+{
+public:
+    /** \brief Konstruktor klasy \c sensorStream
+     *
+     * \param name const std::string& - nazwa czujnika (z listy \c getSensorList)
+     * \param index int - pozycja czujnika na liście \c getSensorList
+     *
+     */
+    sensorStream( const std::string& name, int index );
+
+    /** \brief Zwraca nazwę czujnika
+     *
+     * \return const std::string& - nazwa czujnika
+     *
+     */
+    const std::string& getName() const;
+    /** \brief Zwraca pozycję czujnika na liście \c getSensorList
+     *
+     * \return int - pozycja czujnika
+     *
+     */
+    int getIndex() const;
+    /** \brief Zwraca aktualny okres odpytywania czujnika
+     *
+     * \return int - okres w \c ms (0 - czujnik nie jest odpytywany)
+     *
+     */
+    int getPeriod() const;
+    /** \brief Ustawia okres odpytywania czujnika
+     *
+     * \param period_ms int - okres w \c ms (0 - zatrzymuje odpytywanie)
+     * \return void
+     *
+     */
+    void setPeriod( int period_ms );
+    /** \brief Zwraca obiekt okresu odpytywania (np. w celu włączenia adaptacji)
+     *
+     * \return rateController* - okres odpytywania czujnika
+     *
+     */
+    rateController* getRate();
+    /** \brief Zwraca statystyki strumienia pomiarów czujnika
+     *
+     * \return streamStats* - statystyki (nazwa strumienia jest nazwą czujnika)
+     *
+     */
+    streamStats* getStats();
+    /** \brief Zwraca uchwyt do ostatniego pomiaru czujnika
+     *
+     * \return scanHandle - uchwyt do pomiaru lub pusty uchwyt, jeśli nie odebrano jeszcze żadnego pomiaru
+     *
+     */
+    scanHandle getScan();
+    /** \brief Zwraca liczbę odebranych pomiarów
+     *
+     * \return unsigned long long - liczba pomiarów
+     *
+     */
+    unsigned long long getScansCount() const;
+    /** \brief Czeka na pomiar nowszy niż \c lastSequence
+     *
+     * \param lastSequence unsigned long long - numer ostatnio przetworzonego pomiaru (0 - dowolny pomiar)
+     * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+     * \return scanHandle - uchwyt do nowszego pomiaru lub pusty uchwyt po upływie czasu
+     *
+     */
+    scanHandle waitForScan( unsigned long long lastSequence, int timeout_ms );
+    /** \brief Zwraca deskryptor \c eventfd sygnalizujący nowy pomiar (patrz \c streamNotifier::getEventFd())
+     *
+     * \return int - deskryptor lub -1, jeśli nie udało się go utworzyć
+     *
+     */
+    int getEventFd();
+
+    /** \brief Pobiera pusty pomiar z puli czujnika (tylko dla wątku odbioru)
+     *
+     * \param points int - liczba punktów
+     * \return laserScan* - pomiar lub \c NULL, jeśli nie udało się przydzielić pamięci
+     *
+     */
+    laserScan* acquireScan( int points );
+    /** \brief Numeruje i publikuje wypełniony pomiar (tylko dla wątku odbioru)
+     *
+     * \param scan laserScan* - pomiar z \c acquireScan()
+     * \param timestamp_us long long - chwila odebrania pomiaru w \c us
+     * \return void
+     *
+     */
+    void publishScan( laserScan* scan, long long timestamp_us );
+
+    /** \brief Zwraca pakiet zapytania \c getSensorCurrent dla czujnika (tylko dla wątku odpytywania)
+     *
+     * \return ArNetPacket* - pakiet z nazwą czujnika
+     *
+     */
+    ArNetPacket* getRequestPacket();
+    /** \brief Zwraca termin następnego zapytania (tylko dla wątku odpytywania)
+     *
+     * \return long long - termin w \c us (0 - odpytywanie nie trwa)
+     *
+     */
+    long long getNextRequest_us() const;
+    /** \brief Ustawia termin następnego zapytania (tylko dla wątku odpytywania)
+     *
+     * \param nextRequest_us long long - termin w \c us (0 - odpytywanie nie trwa)
+     * \return void
+     *
+     */
+    void setNextRequest_us( long long nextRequest_us );
+
+private:
+    std::string my_name;/**< nazwa czujnika */
+    int my_index;/**< pozycja czujnika na liście */
+    rateController my_rate;/**< okres odpytywania */
+    streamStats my_stats;/**< statystyki strumienia pomiarów */
+
+    laserScanPool my_scanPool;/**< pula pomiarów czujnika */
+    latestStore<laserScan> my_scanStore;/**< ostatni pomiar czujnika */
+    std::atomic<unsigned long long> my_scansCount;/**< numer ostatniego pomiaru */
+    streamNotifier my_scanNotifier;/**< powiadamianie o nowych pomiarach */
+
+    ArNetPacket my_requestPacket;/**< pakiet zapytania \c getSensorCurrent */
+    long long my_nextRequest_us;/**< termin następnego zapytania (0 - odpytywanie nie trwa), używany tylko przez wątek odpytywania */
+
+    sensorStream( const sensorStream& );
+    sensorStream& operator=( const sensorStream& );
+};
+
+/** \brief Tablica czujników robota z wyszukiwaniem po nazwie
+ *
+ * Tablica tworzona jest raz, z listy \c getSensorList. Nazwy czujników są
+ * haszowane (64-bitowy FNV-1a z ziarnem dobranym tak, aby skróty nazw z listy
+ * były różne) do tablicy z adresowaniem otwartym, więc odnalezienie czujnika
+ * dla pakietu \c getSensorCurrent to obliczenie skrótu nazwy bezpośrednio
+ * w buforze pakietu, porównanie liczb i jedno porównanie nazwy znalezionego
+ * czujnika (nazwa spoza listy może mieć ten sam skrót) - bez kopiowania nazwy
+ * i alokacji pamięci.
+ *
+ * Po utworzeniu tablica nie jest modyfikowana, więc może być czytana z wielu
+ * wątków jednocześnie.
+ */
+class sensorTable
+{
+public:
+    /** \brief Konstruktor klasy \c sensorTable
+     *
+     * \param names const std::vector<std::string>& - nazwy czujników w kolejności z listy \c getSensorList
+     *
+     */
+    sensorTable( const std::vector<std::string>& names );
+    /** \brief Destruktor klasy \c sensorTable
+     *
+     *
+     */
+    ~sensorTable();
+
+    /** \brief Zwraca liczbę czujników
+     *
+     * \return int - liczba czujników
+     *
+     */
+    int getCount() const;
+    /** \brief Zwraca czujnik o zadanej pozycji na liście
+     *
+     * \param index int - pozycja czujnika
+     * \return sensorStream* - czujnik lub \c NULL dla pozycji spoza listy
+     *
+     */
+    sensorStream* get( int index ) const;
+    /** \brief Wyszukuje czujnik po nazwie
+     *
+     * \param name const char* - nazwa czujnika
+     * \return sensorStream* - czujnik lub \c NULL, jeśli nie ma go na liście
+     *
+     */
+    sensorStream* find( const char* name ) const;
+    /** \brief Odczytuje nazwę czujnika z pakietu i wyszukuje czujnik
+     *
+     * Pozycja odczytu pakietu przesuwana jest za nazwę (jak po \c bufToStr()).
+     *
+     * \param packet ArNetPacket* - pakiet ustawiony na początku nazwy
+     * \return sensorStream* - czujnik lub \c NULL, jeśli nie ma go na liście
+     *
+     */
+    sensorStream* findInPacket( ArNetPacket* packet ) const;
+
+private:
+    /** \brief Element tablicy skrótów */
+    struct slot
+    {
+        uint64_t hash;/**< skrót nazwy */
+        sensorStream* stream;/**< czujnik (\c NULL - pusty element) */
+    };
+
+    std::vector<sensorStream*> my_streams;/**< czujniki w kolejności z listy */
+    std::vector<slot> my_slots;/**< tablica skrótów (rozmiar jest potęgą dwójki) */
+    uint64_t my_seed;/**< ziarno funkcji skrótu */
+
+    uint64_t hashName( const char* name, size_t maxLength, size_t* length ) const;/**< \brief Liczy skrót nazwy zakończonej zerem */
+    sensorStream* findByHash( uint64_t hash, const char* name, size_t length ) const;/**< \brief Wyszukuje czujnik o zadanym skrócie i nazwie (o długości \c length) */
+
+    sensorTable( const sensorTable& );
+    sensorTable& operator=( const sensorTable& );
+};
+
+#endif // SENSORSTREAM_H_INCLUDED
@@ -0,0 +1,88 @@
+#ifndef SEQLOCKSTORE_H_INCLUDED
+#define SEQLOCKSTORE_H_INCLUDED
+
+#include <atomic>
+#include <cstring>
+#include <sched.h>
+#include <stdint.h>
+
+/** \brief Magazyn małej struktury danych chronionej licznikiem sekwencji (seqlock)
+ *
+ * Jeden wątek producenta zapisuje kolejne wartości metodą \c store(), a dowolna
+ * liczba wątków odczytuje spójną kopię ostatniej wartości metodą \c load() -
+ * bez blokad i bez alokacji. Czytelnik nigdy nie blokuje producenta: jeśli
+ * wartość zmieniła się w trakcie kopiowania, odczyt jest powtarzany.
+ *
+ * W przeciwieństwie do \c latestStore wartość jest kopiowana, więc typ \c T musi
+ * być prostą strukturą (kopiowalną przez \c memcpy), najlepiej o rozmiarze kilku
+ * linii pamięci podręcznej. Dane przechowywane są w słowach atomowych, dzięki
+ * czemu równoczesny zapis i odczyt nie jest wyścigiem w sensie modelu pamięci C++.
+ */
+template<class T>
+class seqlockStore
+{
+public:
+    seqlockStore() : my_sequence( 0 )
+    {
+        for( int i = 0; i < WORDS; i++ )
+            my_words[i].store( 0, std::memory_order_relaxed );
+    }
+
+    /** \brief Zapisuje nową wartość (wywoływane tylko z wątku producenta)
+     *
+     * \param value const T& - wartość
+     * \return void
+     *
+     */
+    void store( const T& value )
+    {
+        uint64_t words[WORDS] = { 0 };
+        memcpy( words, &value, sizeof( T ));
+
+        unsigned long long sequence = my_sequence.load( std::memory_order_relaxed );
+        my_sequence.store( sequence + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        for( int i = 0; i < WORDS; i++ )
+            my_words[i].store( words[i], std::memory_order_relaxed );
+        my_sequence.store( sequence + 2, std::memory_order_release );
+    }
+    /** \brief Odczytuje spójną kopię ostatniej wartości
+     *
+     * \param value T* - wynikowa wartość (przed pierwszym \c store() - same zera)
+     * \return unsigned long long - liczba zapisanych dotąd wartości
+     *
+     */
+    unsigned long long load( T* value ) const
+    {
+        uint64_t words[WORDS];
+        while( true )
+        {
+            unsigned long long before = my_sequence.load( std::memory_order_acquire );
+            if( before & 1 )
+            {
+                // The producer is in the middle of a store - it takes nanoseconds
+                sched_yield();
+                continue;
+            }
+            for( int i = 0; i < WORDS; i++ )
+                words[i] = my_words[i].load( std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_acquire );
+            if( my_sequence.load( std::memory_order_relaxed ) == before )
+            {
+                memcpy( value, words, sizeof( T ));
+                return before / 2;
+            }
+        }
+    }
+
+private:
+    enum { WORDS = ( sizeof( T ) + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t ) };
+
+    std::atomic<unsigned long long> my_sequence;/**< licznik sekwencji (nieparzysty w trakcie zapisu) */
+    std::atomic<uint64_t> my_words[WORDS];/**< kopia wartości */
+
+    seqlockStore( const seqlockStore& );
+    seqlockStore& operator=( const seqlockStore& );
+};
+
+#endif // SEQLOCKSTORE_H_INCLUDED
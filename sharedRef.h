@@ -0,0 +1,87 @@
+#ifndef SHAREDREF_H_INCLUDED
+#define SHAREDREF_H_INCLUDED
+
+#include <cstddef>
+
+/** \brief Uchwyt zliczający referencje do współdzielonego obiektu
+ *
+ * Szablon \c sharedRef przechowuje wskaźnik do obiektu, który sam zlicza
+ * odwołania do siebie (metody \c addRef() oraz \c release()). Kopiowanie
+ * uchwytu zwiększa licznik, a zniszczenie uchwytu go zmniejsza - obiekt jest
+ * zwalniany (lub zwracany do puli) dopiero wtedy, gdy nikt już z niego nie
+ * korzysta. Operacje na liczniku są atomowe, więc uchwyty mogą być
+ * przekazywane pomiędzy wątkami.
+ */
+template<class T>
+class sharedRef
+{
+public:
+    /** \brief Tworzy pusty uchwyt
+     *
+     *
+     */
+    sharedRef() : my_ptr( NULL ) {}
+    /** \brief Tworzy uchwyt do przekazanego obiektu
+     *
+     * \param ptr T* - wskaźnik do obiektu
+     * \param addRef bool - \b False, jeżeli uchwyt przejmuje już posiadaną referencję
+     *
+     */
+    explicit sharedRef( T* ptr, bool addRef = true ) : my_ptr( ptr )
+    {
+        if( my_ptr && addRef )
+            my_ptr->addRef();
+    }
+    sharedRef( const sharedRef& other ) : my_ptr( other.my_ptr )
+    {
+        if( my_ptr )
+            my_ptr->addRef();
+    }
+    ~sharedRef()
+    {
+        if( my_ptr )
+            my_ptr->release();
+    }
+
+    sharedRef& operator=( const sharedRef& other )
+    {
+        if( other.my_ptr )
+            other.my_ptr->addRef();
+        if( my_ptr )
+            my_ptr->release();
+        my_ptr = other.my_ptr;
+        return *this;
+    }
+
+    T* operator->() const { return my_ptr; }
+    T& operator*() const { return *my_ptr; }
+
+    /** \brief Zwraca wskaźnik do obiektu (bez zmiany licznika referencji)
+     *
+     * \return T* - wskaźnik do obiektu lub \c NULL
+     *
+     */
+    T* get() const { return my_ptr; }
+    /** \brief Sprawdza czy uchwyt jest pusty
+     *
+     * \return bool - \b True, jeśli uchwyt nie wskazuje na żaden obiekt
+     *
+     */
+    bool empty() const { return my_ptr == NULL; }
+    /** \brief Zwalnia trzymaną referencję
+     *
+     * \return void
+     *
+     */
+    void reset()
+    {
+        if( my_ptr )
+            my_ptr->release();
+        my_ptr = NULL;
+    }
+
+private:
+    T* my_ptr;/**< wskaźnik do obiektu */
+};
+
+#endif // SHAREDREF_H_INCLUDED
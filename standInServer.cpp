@@ -0,0 +1,647 @@
+#include "standInServer.h"
+#include "clientUtil.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static const char* LASER_NAME = "laser_1";
+static const char* SONAR_NAME = "sonar_1";
+static const int SONAR_POINTS = 16;
+
+static double normalizeAngle( double angle_deg )
+{
+    while( angle_deg > 180.0 )
+        angle_deg -= 360.0;
+    while( angle_deg <= -180.0 )
+        angle_deg += 360.0;
+    return angle_deg;
+}
+
+standInServer::standInServer() :
+    my_frameWidth( 640 ), my_frameHeight( 480 ), my_frameLength( 20000 ),
+    my_scanSize( 181 ), my_wallRadius( 5000.0 ),
+    my_maxVelocity( 500.0 ), my_maxRotationalVelocity( 100.0 ),
+    my_startTime_us( clientUtil::monotonicTime_us() ), my_lastUpdate_us( my_startTime_us ),
+    my_xPosition( 0.0 ), my_yPosition( 0.0 ), my_theta( 0.0 ),
+    my_velocity( 0.0 ), my_rotationalVelocity( 0.0 ),
+    my_remainingDistance( 0.0 ), my_remainingAngle( 0.0 ),
+    my_transRatio( 0.0 ), my_rotRatio( 0.0 ), my_throttleRatio( 0.0 ),
+    my_isRatioDriving( false ), my_safeDrive( true ),
+    my_camera_pan( 0 ), my_camera_tilt( 0 ), my_camera_zoom( 0 ),
+    my_loopPoseScript( false ), my_isReplaying( false ), my_replayFrame( 0 ), my_sentFrames( 0 ),
+    my_isOpen( false ), my_broadcastRunning( false ),
+    my_functor_handle_updateNumbers(this, &standInServer::handle_updateNumbers),
+    my_functor_handle_getSensorList(this, &standInServer::handle_getSensorList),
+    my_functor_handle_getSensorCurrent(this, &standInServer::handle_getSensorCurrent),
+    my_functor_handle_sendVideo(this, &standInServer::handle_sendVideo),
+    my_functor_handle_getCameraInfoCamera_1(this, &standInServer::handle_getCameraInfoCamera_1),
+    my_functor_handle_getCameraDataCamera_1(this, &standInServer::handle_getCameraDataCamera_1),
+    my_functor_handle_setCameraAbsCamera_1(this, &standInServer::handle_setCameraAbsCamera_1),
+    my_functor_handle_setCameraRelCamera_1(this, &standInServer::handle_setCameraRelCamera_1),
+    my_functor_handle_moveDist(this, &standInServer::handle_moveDist),
+    my_functor_handle_turnByAngle(this, &standInServer::handle_turnByAngle),
+    my_functor_handle_turnToHeading(this, &standInServer::handle_turnToHeading),
+    my_functor_handle_ratioDrive(this, &standInServer::handle_ratioDrive),
+    my_functor_handle_stop(this, &standInServer::handle_stop),
+    my_functor_handle_setSafeDrive(this, &standInServer::handle_setSafeDrive),
+    my_functor_handle_standInConfigure(this, &standInServer::handle_standInConfigure),
+    my_functor_thread_broadcast(this, &standInServer::thread_broadcast)
+{
+    for( int i = 0; i < STREAM_COUNT; i++ )
+        my_streamPeriods_ms[i] = 0;
+    buildJpegImage();
+
+    // Data handlers installation
+    my_server.addData("updateNumbers", "robot state", &my_functor_handle_updateNumbers,
+                      "none", "byte2: battery, byte4: x, byte4: y, byte2: th, byte2: vel, byte2: rotVel, byte2: latVel, byte: temperature");
+    my_server.addData("getSensorList", "list of sensors", &my_functor_handle_getSensorList,
+                      "none", "byte2: count, (string: name)*");
+    my_server.addData("getSensorCurrent", "current readings of a sensor", &my_functor_handle_getSensorCurrent,
+                      "string: name", "byte2: count, string: name, (byte4: x, byte4: y)*");
+    my_server.addData("sendVideo", "camera frame", &my_functor_handle_sendVideo,
+                      "none", "ubyte2: width, ubyte2: height, data: jpeg");
+    my_server.addData("getCameraInfoCamera_1", "camera limits", &my_functor_handle_getCameraInfoCamera_1,
+                      "none", "byte2: minPan, maxPan, minTilt, maxTilt, minZoom, maxZoom, byte: zoom available");
+    my_server.addData("getCameraDataCamera_1", "camera position", &my_functor_handle_getCameraDataCamera_1,
+                      "none", "byte2: pan, byte2: tilt, byte2: zoom");
+
+    // Command handlers installation
+    my_server.addData("setCameraAbsCamera_1", "set camera position", &my_functor_handle_setCameraAbsCamera_1,
+                      "byte2: pan, byte2: tilt, byte2: zoom", "none (empty acknowledgement)");
+    my_server.addData("setCameraRelCamera_1", "move camera", &my_functor_handle_setCameraRelCamera_1,
+                      "byte2: pan, byte2: tilt, byte2: zoom", "none (empty acknowledgement)");
+    my_server.addData("moveDist", "move by distance", &my_functor_handle_moveDist,
+                      "double: distance", "none (empty acknowledgement)");
+    my_server.addData("turnByAngle", "turn by angle", &my_functor_handle_turnByAngle,
+                      "double: angle", "none (empty acknowledgement)");
+    my_server.addData("turnToHeading", "turn to heading", &my_functor_handle_turnToHeading,
+                      "double: heading", "none (empty acknowledgement)");
+    my_server.addData("ratioDrive", "drive by velocity ratios", &my_functor_handle_ratioDrive,
+                      "double: trans, double: rot, double: throttle", "none (empty acknowledgement)");
+    my_server.addData("stop", "stop the robot", &my_functor_handle_stop,
+                      "none", "none (empty acknowledgement)");
+    my_server.addData("setSafeDrive", "toggle safe drive", &my_functor_handle_setSafeDrive,
+                      "byte: safe", "none (empty acknowledgement)");
+    my_server.addData("standInConfigure", "reconfigure the stand-in server", &my_functor_handle_standInConfigure,
+                      "byte4: numbers, laser and video period, byte4: width, height, jpeg length, scan size",
+                      "none (empty acknowledgement)");
+}
+
+standInServer::~standInServer()
+{
+    close();
+}
+
+bool standInServer::open( unsigned int port )
+{
+    if( my_isOpen )
+        return true;
+    if( !my_server.open( port ))
+    {
+        printf("standInServer: could not open port %u\n", port);
+        fflush(stdout);
+        return false;
+    }
+    my_server.runAsync();
+    my_isOpen = true;
+
+    my_broadcastRunning = true;
+    my_thread_broadcast.create( &my_functor_thread_broadcast );
+    return true;
+}
+
+void standInServer::close()
+{
+    if( !my_isOpen )
+        return;
+
+    my_broadcastRunning = false;
+    my_thread_broadcast.join();
+    my_server.close();
+    my_isOpen = false;
+}
+
+void standInServer::setStreamPeriod( stream dataStream, int period_ms )
+{
+    my_stateMutex.lock();
+    my_streamPeriods_ms[dataStream] = period_ms;
+    my_stateMutex.unlock();
+}
+
+void standInServer::setFrameSize( int width, int height, int length_bytes )
+{
+    my_stateMutex.lock();
+    my_frameWidth = width;
+    my_frameHeight = height;
+    my_frameLength = length_bytes;
+    buildJpegImage();
+    my_stateMutex.unlock();
+}
+
+void standInServer::setScanSize( int points )
+{
+    my_stateMutex.lock();
+    my_scanSize = points;
+    my_stateMutex.unlock();
+}
+
+void standInServer::setWallRadius( double radius_mm )
+{
+    my_stateMutex.lock();
+    my_wallRadius = radius_mm;
+    my_stateMutex.unlock();
+}
+
+void standInServer::setPoseScript( const std::vector<standInPose>& script, bool loop )
+{
+    my_stateMutex.lock();
+    my_poseScript = script;
+    my_loopPoseScript = loop;
+    my_stateMutex.unlock();
+}
+
+bool standInServer::loadPoseScript( const std::string& filename, bool loop )
+{
+    FILE* file = fopen( filename.c_str(), "r" );
+    if( file == NULL )
+        return false;
+
+    std::vector<standInPose> script;
+    char line[256];
+    while( fgets( line, sizeof( line ), file ) != NULL )
+    {
+        standInPose pose;
+        if( line[0] == '#' ||
+            sscanf( line, "%lld %lf %lf %lf %lf %lf", &pose.time_ms, &pose.xPosition, &pose.yPosition,
+                    &pose.theta, &pose.velocity, &pose.rotationalVelocity ) != 6 )
+            continue;
+        script.push_back( pose );
+    }
+    fclose( file );
+
+    setPoseScript( script, loop );
+    return !script.empty();
+}
+
+bool standInServer::setReplayPath( const std::string& path )
+{
+    my_stateMutex.lock();
+    my_isReplaying = my_replayReader.open( path ) && my_replayReader.getFrameCount() > 0;
+    my_replayFrame = 0;
+    bool replaying = my_isReplaying;
+    my_stateMutex.unlock();
+    return replaying;
+}
+
+unsigned long long standInServer::getCommandsCount( const std::string& command )
+{
+    my_stateMutex.lock();
+    unsigned long long count = my_commandsCount[command];
+    my_stateMutex.unlock();
+    return count;
+}
+
+unsigned long long standInServer::getSentFramesCount()
+{
+    return my_sentFrames.load();
+}
+
+void standInServer::updatePose( long long now_us )
+{
+    double dt = ( now_us - my_lastUpdate_us ) / 1000000.0;
+    my_lastUpdate_us = now_us;
+
+    if( !my_poseScript.empty() )
+    {
+        long long elapsed_ms = ( now_us - my_startTime_us ) / 1000;
+        long long duration_ms = my_poseScript.back().time_ms;
+        if( my_loopPoseScript && duration_ms > 0 )
+            elapsed_ms %= duration_ms;
+
+        size_t current = 0;
+        while( current + 1 < my_poseScript.size() && my_poseScript[current + 1].time_ms <= elapsed_ms )
+            current++;
+        my_xPosition = my_poseScript[current].xPosition;
+        my_yPosition = my_poseScript[current].yPosition;
+        my_theta = my_poseScript[current].theta;
+        my_velocity = my_poseScript[current].velocity;
+        my_rotationalVelocity = my_poseScript[current].rotationalVelocity;
+        return;
+    }
+    if( dt <= 0.0 )
+        return;
+
+    double distance, angle;
+    if( my_isRatioDriving )
+    {
+        distance = my_transRatio / 100.0 * my_throttleRatio / 100.0 * my_maxVelocity * dt;
+        angle = my_rotRatio / 100.0 * my_throttleRatio / 100.0 * my_maxRotationalVelocity * dt;
+    }
+    else
+    {
+        // Jog commands - move at full speed until the requested distance / angle is done
+        distance = std::min( fabs( my_remainingDistance ), my_maxVelocity * dt );
+        distance = my_remainingDistance < 0 ? -distance : distance;
+        angle = std::min( fabs( my_remainingAngle ), my_maxRotationalVelocity * dt );
+        angle = my_remainingAngle < 0 ? -angle : angle;
+        my_remainingDistance -= distance;
+        my_remainingAngle -= angle;
+    }
+
+    my_theta = normalizeAngle( my_theta + angle );
+    my_xPosition += distance * cos( my_theta * M_PI / 180.0 );
+    my_yPosition += distance * sin( my_theta * M_PI / 180.0 );
+    my_velocity = distance / dt;
+    my_rotationalVelocity = angle / dt;
+}
+
+void standInServer::countCommand( const char* command, ArServerClient* client )
+{
+    my_commandsCount[command]++;
+
+    ArNetPacket acknowledgement;
+    client->sendPacketTcp( &acknowledgement );
+}
+
+void standInServer::buildNumbersPacket( ArNetPacket* packet )
+{
+    updatePose( clientUtil::monotonicTime_us() );
+
+    packet->byte2ToBuf( 130 ); // 13.0 V, in tenths of volt as sent by aria_server
+    packet->byte4ToBuf( (ArTypes::Byte4) lround( my_xPosition ));
+    packet->byte4ToBuf( (ArTypes::Byte4) lround( my_yPosition ));
+    packet->byte2ToBuf( (ArTypes::Byte2) lround( my_theta ));
+    packet->byte2ToBuf( (ArTypes::Byte2) lround( my_velocity ));
+    packet->byte2ToBuf( (ArTypes::Byte2) lround( my_rotationalVelocity ));
+    packet->byte2ToBuf( 0 ); // lateral velocity
+    packet->byteToBuf( 30 ); // temperature
+}
+
+void standInServer::buildLaserPacket( ArNetPacket* packet )
+{
+    // Beams spread evenly over -90 - 90 deg
+    buildSensorPacket( packet, LASER_NAME, my_scanSize, -90.0, 180.0 );
+}
+
+void standInServer::buildSonarPacket( ArNetPacket* packet )
+{
+    // Ring of sonars all around the robot
+    buildSensorPacket( packet, SONAR_NAME, SONAR_POINTS, -180.0, 360.0 * ( SONAR_POINTS - 1 ) / SONAR_POINTS );
+}
+
+void standInServer::buildSensorPacket( ArNetPacket* packet, const char* name, int points, double firstBeam, double span )
+{
+    updatePose( clientUtil::monotonicTime_us() );
+
+    packet->byte2ToBuf( points );
+    packet->strToBuf( name );
+    for( int i = 0; i < points; i++ )
+    {
+        // Beams intersected with the circular wall
+        double beam = points > 1 ? firstBeam + span * i / ( points - 1 ) : firstBeam + span / 2;
+        double direction = ( my_theta + beam ) * M_PI / 180.0;
+        double dx = cos( direction ), dy = sin( direction );
+        double projection = my_xPosition * dx + my_yPosition * dy;
+        double discriminant = projection * projection + my_wallRadius * my_wallRadius
+                              - my_xPosition * my_xPosition - my_yPosition * my_yPosition;
+        double range = discriminant > 0 ? -projection + sqrt( discriminant ) : 0.0;
+        packet->byte4ToBuf( (ArTypes::Byte4) lround( my_xPosition + range * dx ));
+        packet->byte4ToBuf( (ArTypes::Byte4) lround( my_yPosition + range * dy ));
+    }
+}
+
+bool standInServer::buildVideoPacket( ArNetPacket* packet )
+{
+    unsigned long long sequence = ++my_sentFrames;
+    if( my_isReplaying )
+    {
+        // Frames that do not fit into a packet are skipped
+        frameLogFrame frame;
+        for( int attempt = 0; attempt < my_replayReader.getFrameCount(); attempt++ )
+        {
+            my_replayReader.getFrame( my_replayFrame, frame );
+            my_replayFrame = ( my_replayFrame + 1 ) % my_replayReader.getFrameCount();
+            if( frame.length <= ArNetPacket::MAX_DATA_LENGTH - 4 )
+            {
+                packet->uByte2ToBuf( frame.width );
+                packet->uByte2ToBuf( frame.height );
+                packet->dataToBuf( (const char*) frame.data, frame.length );
+                return true;
+            }
+        }
+        my_sentFrames--;
+        return false;
+    }
+
+    // SOI, comment padded up to the requested length, then the image itself
+    char comment[64];
+    int commentLength = snprintf( comment, sizeof( comment ), "standin seq=%llu t=%lld",
+                                  sequence, clientUtil::monotonicTime_us() );
+    int maxLength = std::min( (int) ArNetPacket::MAX_DATA_LENGTH - 4, 2 + 4 + 65533 + (int) my_jpegImage.size() );
+    int length = std::min( maxLength, std::max( my_frameLength, 2 + 4 + commentLength + (int) my_jpegImage.size() ));
+    int segmentLength = length - 2 - (int) my_jpegImage.size();
+    if( segmentLength < 4 )
+    {
+        // The image alone does not fit into a packet
+        my_sentFrames--;
+        return false;
+    }
+
+    my_videoData.assign( length, ' ' );
+    unsigned char* data = &my_videoData[0];
+    data[0] = 0xFF; data[1] = 0xD8;
+    data[2] = 0xFF; data[3] = 0xFE;
+    data[4] = ( segmentLength - 2 ) >> 8; data[5] = ( segmentLength - 2 ) & 0xFF;
+    memcpy( data + 6, comment, std::min( commentLength, segmentLength - 4 ));
+    memcpy( data + 2 + segmentLength, &my_jpegImage[0], my_jpegImage.size() );
+
+    packet->uByte2ToBuf( my_frameWidth );
+    packet->uByte2ToBuf( my_frameHeight );
+    packet->dataToBuf( (const char*) data, length );
+    return true;
+}
+
+void standInServer::buildJpegImage()
+{
+    // Baseline, single component JPEG of a uniform gray image. Every 8x8 block
+    // codes a zero DC difference ("00" in the standard DC table) followed by an
+    // end of block ("0" in a one-symbol AC table) - 3 zero bits per block, so
+    // the entropy coded data never needs byte stuffing.
+    static const unsigned char dcCounts[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    std::vector<unsigned char>& image = my_jpegImage;
+    image.clear();
+
+    // DQT - all ones
+    const unsigned char dqt[] = { 0xFF, 0xDB, 0x00, 0x43, 0x00 };
+    image.insert( image.end(), dqt, dqt + sizeof( dqt ));
+    image.insert( image.end(), 64, 1 );
+
+    // SOF0
+    const unsigned char sof[] = { 0xFF, 0xC0, 0x00, 0x0B, 0x08,
+                                  (unsigned char)( my_frameHeight >> 8 ), (unsigned char) my_frameHeight,
+                                  (unsigned char)( my_frameWidth >> 8 ), (unsigned char) my_frameWidth,
+                                  0x01, 0x01, 0x11, 0x00 };
+    image.insert( image.end(), sof, sof + sizeof( sof ));
+
+    // DHT - standard luminance DC table
+    const unsigned char dhtDc[] = { 0xFF, 0xC4, 0x00, 0x1F, 0x00 };
+    image.insert( image.end(), dhtDc, dhtDc + sizeof( dhtDc ));
+    image.insert( image.end(), dcCounts, dcCounts + sizeof( dcCounts ));
+    for( unsigned char symbol = 0; symbol < 12; symbol++ )
+        image.push_back( symbol );
+
+    // DHT - AC table with end of block only
+    const unsigned char dhtAc[] = { 0xFF, 0xC4, 0x00, 0x14, 0x10, 0x01 };
+    image.insert( image.end(), dhtAc, dhtAc + sizeof( dhtAc ));
+    image.insert( image.end(), 15, 0 );
+    image.push_back( 0x00 );
+
+    // SOS
+    const unsigned char sos[] = { 0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00 };
+    image.insert( image.end(), sos, sos + sizeof( sos ));
+
+    long long blocks = (long long)( ( my_frameWidth + 7 ) / 8 ) * ( ( my_frameHeight + 7 ) / 8 );
+    long long bits = blocks * 3;
+    image.insert( image.end(), ( bits + 7 ) / 8, 0 );
+    if( bits % 8 != 0 )
+        image.back() = 0xFF >> ( bits % 8 ); // pad with ones
+
+    // EOI
+    image.push_back( 0xFF );
+    image.push_back( 0xD9 );
+}
+
+void standInServer::handle_updateNumbers( ArServerClient* client, ArNetPacket* packet )
+{
+    ArNetPacket reply;
+    my_stateMutex.lock();
+    bool answer = my_streamPeriods_ms[STREAM_NUMBERS] == 0;
+    if( answer )
+        buildNumbersPacket( &reply );
+    my_stateMutex.unlock();
+    if( answer )
+        client->sendPacketTcp( &reply );
+}
+
+void standInServer::handle_getSensorList( ArServerClient* client, ArNetPacket* packet )
+{
+    ArNetPacket reply;
+    reply.byte2ToBuf( 2 );
+    reply.strToBuf( LASER_NAME );
+    reply.strToBuf( SONAR_NAME );
+    client->sendPacketTcp( &reply );
+}
+
+void standInServer::handle_getSensorCurrent( ArServerClient* client, ArNetPacket* packet )
+{
+    char sensorName[255];
+    memset(sensorName, 0, sizeof(sensorName));
+    packet->bufToStr( sensorName, sizeof( sensorName ));
+
+    ArNetPacket reply;
+    if( strcmp( sensorName, SONAR_NAME ) == 0 )
+    {
+        // Sonar is never pushed - always answer
+        my_stateMutex.lock();
+        buildSonarPacket( &reply );
+        my_stateMutex.unlock();
+        client->sendPacketTcp( &reply );
+        return;
+    }
+    if( strcmp( sensorName, LASER_NAME ) != 0 )
+    {
+        reply.byte2ToBuf( -1 );
+        reply.strToBuf( sensorName );
+        client->sendPacketTcp( &reply );
+        return;
+    }
+
+    my_stateMutex.lock();
+    bool answer = my_streamPeriods_ms[STREAM_LASER] == 0;
+    if( answer )
+        buildLaserPacket( &reply );
+    my_stateMutex.unlock();
+    if( answer )
+        client->sendPacketTcp( &reply );
+}
+
+void standInServer::handle_sendVideo( ArServerClient* client, ArNetPacket* packet )
+{
+    ArNetPacket reply;
+    my_stateMutex.lock();
+    bool built = my_streamPeriods_ms[STREAM_VIDEO] == 0 && buildVideoPacket( &reply );
+    my_stateMutex.unlock();
+    if( built )
+        client->sendPacketTcp( &reply );
+}
+
+void standInServer::handle_getCameraInfoCamera_1( ArServerClient* client, ArNetPacket* packet )
+{
+    ArNetPacket reply;
+    reply.byte2ToBuf( -100 );
+    reply.byte2ToBuf( 100 );
+    reply.byte2ToBuf( -30 );
+    reply.byte2ToBuf( 90 );
+    reply.byte2ToBuf( 0 );
+    reply.byte2ToBuf( 1000 );
+    reply.byteToBuf( 1 );
+    client->sendPacketTcp( &reply );
+}
+
+void standInServer::handle_getCameraDataCamera_1( ArServerClient* client, ArNetPacket* packet )
+{
+    ArNetPacket reply;
+    my_stateMutex.lock();
+    reply.byte2ToBuf( my_camera_pan );
+    reply.byte2ToBuf( my_camera_tilt );
+    reply.byte2ToBuf( my_camera_zoom );
+    my_stateMutex.unlock();
+    client->sendPacketTcp( &reply );
+}
+
+void standInServer::handle_setCameraAbsCamera_1( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    my_camera_pan = packet->bufToByte2();
+    my_camera_tilt = packet->bufToByte2();
+    my_camera_zoom = packet->bufToByte2();
+    countCommand( "setCameraAbsCamera_1", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_setCameraRelCamera_1( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    my_camera_pan += packet->bufToByte2();
+    my_camera_tilt += packet->bufToByte2();
+    my_camera_zoom += packet->bufToByte2();
+    countCommand( "setCameraRelCamera_1", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_moveDist( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    updatePose( clientUtil::monotonicTime_us() );
+    my_isRatioDriving = false;
+    my_remainingDistance = packet->bufToDouble();
+    countCommand( "moveDist", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_turnByAngle( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    updatePose( clientUtil::monotonicTime_us() );
+    my_isRatioDriving = false;
+    my_remainingAngle = packet->bufToDouble();
+    countCommand( "turnByAngle", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_turnToHeading( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    updatePose( clientUtil::monotonicTime_us() );
+    my_isRatioDriving = false;
+    my_remainingAngle = normalizeAngle( packet->bufToDouble() - my_theta );
+    countCommand( "turnToHeading", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_ratioDrive( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    updatePose( clientUtil::monotonicTime_us() );
+    my_transRatio = packet->bufToDouble();
+    my_rotRatio = packet->bufToDouble();
+    my_throttleRatio = packet->bufToDouble();
+    my_isRatioDriving = true;
+    my_remainingDistance = 0.0;
+    my_remainingAngle = 0.0;
+    countCommand( "ratioDrive", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_stop( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    updatePose( clientUtil::monotonicTime_us() );
+    my_isRatioDriving = false;
+    my_remainingDistance = 0.0;
+    my_remainingAngle = 0.0;
+    countCommand( "stop", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_setSafeDrive( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    my_safeDrive = packet->bufToByte() != 0;
+    countCommand( "setSafeDrive", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::handle_standInConfigure( ArServerClient* client, ArNetPacket* packet )
+{
+    my_stateMutex.lock();
+    for( int i = 0; i < STREAM_COUNT; i++ )
+        my_streamPeriods_ms[i] = packet->bufToByte4();
+    my_frameWidth = packet->bufToByte4();
+    my_frameHeight = packet->bufToByte4();
+    my_frameLength = packet->bufToByte4();
+    my_scanSize = packet->bufToByte4();
+    buildJpegImage();
+    countCommand( "standInConfigure", client );
+    my_stateMutex.unlock();
+}
+
+void standInServer::thread_broadcast()
+{
+    static const char* streamNames[STREAM_COUNT] = { "updateNumbers", "getSensorCurrent", "sendVideo" };
+    long long deadlines_us[STREAM_COUNT];
+    long long now_us = clientUtil::monotonicTime_us();
+    for( int i = 0; i < STREAM_COUNT; i++ )
+        deadlines_us[i] = now_us;
+
+    while( my_broadcastRunning )
+    {
+        // Wake up at least every 100 ms to notice configuration changes and close()
+        long long wakeUp_us = clientUtil::monotonicTime_us() + 100000;
+        for( int i = 0; i < STREAM_COUNT; i++ )
+        {
+            my_stateMutex.lock();
+            int period_ms = my_streamPeriods_ms[i];
+            now_us = clientUtil::monotonicTime_us();
+            if( period_ms <= 0 || now_us < deadlines_us[i] )
+            {
+                if( period_ms <= 0 )
+                    deadlines_us[i] = now_us;
+                else
+                    wakeUp_us = std::min( wakeUp_us, deadlines_us[i] );
+                my_stateMutex.unlock();
+                continue;
+            }
+
+            ArNetPacket packet;
+            bool built = true;
+            if( i == STREAM_NUMBERS )
+                buildNumbersPacket( &packet );
+            else if( i == STREAM_LASER )
+                buildLaserPacket( &packet );
+            else
+                built = buildVideoPacket( &packet );
+            my_stateMutex.unlock();
+            if( built )
+                my_server.broadcastPacketTcp( &packet, streamNames[i] );
+
+            // Absolute deadlines - a late packet does not shift the following ones,
+            // but a long stall does not cause a burst either
+            deadlines_us[i] = std::max( deadlines_us[i] + period_ms * 1000LL, now_us );
+            wakeUp_us = std::min( wakeUp_us, deadlines_us[i] );
+        }
+        clientUtil::sleepUntil_us( wakeUp_us );
+    }
+}
@@ -0,0 +1,256 @@
+#ifndef STANDINSERVER_H_INCLUDED
+#define STANDINSERVER_H_INCLUDED
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Aria.h"
+#include "ArNetworking.h"
+
+#include "frameLog.h"
+
+/** \brief Pozycja robota w skrypcie serwera zastępczego */
+struct standInPose
+{
+    long long time_ms;/**< chwila (od uruchomienia serwera), od której obowiązuje pozycja */
+    double xPosition, yPosition, theta;/**< położenie robota w \c mm i kąt w stopniach */
+    double velocity, rotationalVelocity;/**< prędkości zgłaszane w \c updateNumbers */
+};
+
+/** \brief Serwer zastępujący robota podczas testów
+ *
+ * Serwer (\c ArServerBase z biblioteki ArNetworking) udostępnia polecenia, z których
+ * korzysta \c robotManager: \c updateNumbers, \c getSensorList, \c getSensorCurrent,
+ * \c sendVideo, \c getCameraInfoCamera_1, \c getCameraDataCamera_1, polecenia ruchu
+ * (\c moveDist, \c turnByAngle, \c turnToHeading, \c ratioDrive, \c stop,
+ * \c setSafeDrive) oraz sterowania kamerą (\c setCameraAbsCamera_1,
+ * \c setCameraRelCamera_1). Dane są deterministyczne:
+ * \li pozycja wynika z wykonywanych poleceń ruchu albo ze skryptu (\c setPoseScript())
+ * \li pomiary lasera (\c laser_1) i pierścienia 16 sonarów (\c sonar_1) to odległości do okrągłej
+ * ściany o środku w początku układu współrzędnych
+ * \li klatki to poprawne obrazy \c JPEG o zadanym rozmiarze, uzupełnione do zadanej długości
+ * segmentami komentarza (\c COM); pierwszy komentarz zawiera numer klatki i chwilę wysłania
+ * (\c "standin seq=<numer> t=<czas monotoniczny w us>")
+ * \li zamiast obrazów syntetycznych mogą być wysyłane klatki z nagrania (\c setReplayPath())
+ *
+ * Klient może zmienić ustawienia serwera poleceniem \c standInConfigure (\c byte4: okresy
+ * strumieni \c updateNumbers, \c getSensorCurrent i \c sendVideo, szerokość i wysokość obrazu,
+ * długość pliku \c JPEG, liczba punktów pomiaru lasera) - patrz \c setStreamPeriod().
+ *
+ * Na każde polecenie ruchu lub sterowania kamerą serwer odpowiada pustym pakietem o
+ * tej samej nazwie, co pozwala klientowi zmierzyć czas obsługi polecenia.
+ *
+ * Serwer może działać w procesie klienta, np.:
+ * \code
+ * standInServer server;
+ * server.setFrameSize( 640, 480, 20000 );
+ * server.open( 7272 );
+ * robotManager rManager( &argc, argv, "localhost" );
+ * \endcode
+ * lub jako osobny program \c standin_server (patrz \c standInServerMain.cpp).
+ */
+class standInServer
+{
+public:
+    /** \brief Strumienie danych serwera */
+    enum stream
+    {
+        STREAM_NUMBERS,/**< \c updateNumbers */
+        STREAM_LASER,/**< \c getSensorCurrent */
+        STREAM_VIDEO,/**< \c sendVideo */
+        STREAM_COUNT
+    };
+
+    /** \brief Konstruktor klasy \c standInServer
+     *
+     *
+     */
+    standInServer();
+    /** \brief Destruktor klasy \c standInServer - zamyka serwer
+     *
+     *
+     */
+    ~standInServer();
+
+    /** \brief Uruchamia serwer
+     *
+     * \param port unsigned int - port, na którym serwer przyjmuje połączenia
+     * \return bool - \b True, jeśli udało się otworzyć port
+     *
+     */
+    bool open( unsigned int port = 7272 );
+    /** \brief Zatrzymuje serwer
+     *
+     * \return void
+     *
+     */
+    void close();
+
+    /** \brief Ustawia okres wysyłania danych danego strumienia przez serwer
+     *
+     * Przy okresie \c 0 (domyślnie) dane wysyłane są w odpowiedzi na zapytania klienta,
+     * z okresem ustalonym przez klienta. Przy okresie dodatnim serwer sam rozsyła dane
+     * do wszystkich klientów, a zapytania klienta są pomijane. Przy okresie ujemnym
+     * strumień jest wyłączony.
+     *
+     * \param dataStream stream - strumień
+     * \param period_ms int - okres w \c ms
+     * \return void
+     *
+     */
+    void setStreamPeriod( stream dataStream, int period_ms );
+    /** \brief Ustawia rozmiar wysyłanych klatek
+     *
+     * \param width int - szerokość obrazu
+     * \param height int - wysokość obrazu
+     * \param length_bytes int - długość pliku \c JPEG (najmniej tyle, ile wymaga sam obraz;
+     * najwięcej tyle, ile mieści pakiet ArNetworking)
+     * \return void
+     *
+     */
+    void setFrameSize( int width, int height, int length_bytes );
+    /** \brief Ustawia liczbę punktów pomiaru z dalmierza laserowego
+     *
+     * \param points int - liczba punktów (rozłożonych równomiernie w zakresie -90 - 90 stopni)
+     * \return void
+     *
+     */
+    void setScanSize( int points );
+    /** \brief Ustawia promień okrągłej ściany widzianej przez dalmierz
+     *
+     * \param radius_mm double - promień w \c mm
+     * \return void
+     *
+     */
+    void setWallRadius( double radius_mm );
+    /** \brief Ustawia skrypt położenia robota
+     *
+     * Przy niepustym skrypcie pozycja robota nie zależy od poleceń ruchu - obowiązuje
+     * ostatni element skryptu o chwili nie późniejszej niż czas od uruchomienia serwera.
+     *
+     * \param script const std::vector<standInPose>& - elementy skryptu uporządkowane według czasu
+     * \param loop bool - \b True, jeśli skrypt ma być powtarzany
+     * \return void
+     *
+     */
+    void setPoseScript( const std::vector<standInPose>& script, bool loop = false );
+    /** \brief Wczytuje skrypt położenia robota z pliku tekstowego
+     *
+     * Każdy wiersz pliku ma postać \c "czas_ms x y kąt prędkość prędkość_kątowa";
+     * wiersze zaczynające się od \c # są pomijane.
+     *
+     * \param filename const std::string& - ścieżka pliku
+     * \param loop bool - \b True, jeśli skrypt ma być powtarzany
+     * \return bool - \b True, jeśli udało się wczytać plik
+     *
+     */
+    bool loadPoseScript( const std::string& filename, bool loop = false );
+    /** \brief Wysyła klatki z nagrania zamiast obrazów syntetycznych
+     *
+     * Klatki wysyłane są po kolei, w pętli; klatki niemieszczące się w pakiecie są pomijane.
+     *
+     * \param path const std::string& - nagranie (patrz \c frameLogReader::open())
+     * \return bool - \b True, jeśli udało się otworzyć nagranie
+     *
+     */
+    bool setReplayPath( const std::string& path );
+
+    /** \brief Zwraca liczbę odebranych poleceń o danej nazwie
+     *
+     * \param command const std::string& - nazwa polecenia, np. \c "moveDist"
+     * \return unsigned long long - liczba poleceń
+     *
+     */
+    unsigned long long getCommandsCount( const std::string& command );
+    /** \brief Zwraca liczbę wysłanych klatek
+     *
+     * \return unsigned long long - liczba klatek
+     *
+     */
+    unsigned long long getSentFramesCount();
+
+private:
+    ArServerBase my_server;/**< serwer ArNetworking */
+    ArMutex my_stateMutex;/**< chroni stan symulowanego robota */
+
+    // Configuration
+    int my_streamPeriods_ms[STREAM_COUNT];/**< okresy strumieni rozsyłanych przez serwer */
+    int my_frameWidth, my_frameHeight, my_frameLength;/**< rozmiar syntetycznych klatek */
+    int my_scanSize;/**< liczba punktów pomiaru lasera */
+    double my_wallRadius;/**< promień ściany widzianej przez laser */
+    double my_maxVelocity, my_maxRotationalVelocity;/**< prędkości przy wykonywaniu poleceń ruchu */
+
+    // Simulated robot
+    long long my_startTime_us, my_lastUpdate_us;/**< chwila uruchomienia i ostatniej aktualizacji pozycji */
+    double my_xPosition, my_yPosition, my_theta;/**< pozycja robota */
+    double my_velocity, my_rotationalVelocity;/**< zadane prędkości robota */
+    double my_remainingDistance, my_remainingAngle;/**< pozostała część poleceń \c moveDist i \c turn... */
+    double my_transRatio, my_rotRatio, my_throttleRatio;/**< ostatnie polecenie \c ratioDrive */
+    bool my_isRatioDriving, my_safeDrive;/**< stan sterowania prędkościowego */
+    int my_camera_pan, my_camera_tilt, my_camera_zoom;/**< ustawienie kamery */
+    std::vector<standInPose> my_poseScript;/**< skrypt położenia */
+    bool my_loopPoseScript;/**< powtarzanie skryptu */
+
+    // Video
+    std::vector<unsigned char> my_jpegImage;/**< obraz syntetycznej klatki bez komentarzy */
+    frameLogReader my_replayReader;/**< nagranie wysyłane zamiast obrazów syntetycznych */
+    bool my_isReplaying;/**< wysyłanie klatek z nagrania */
+    int my_replayFrame;/**< następna klatka nagrania */
+    std::vector<unsigned char> my_videoData;/**< bufor wysyłanej klatki */
+    std::atomic<unsigned long long> my_sentFrames;/**< liczba wysłanych klatek */
+
+    std::map<std::string, unsigned long long> my_commandsCount;/**< liczniki poleceń */
+
+    bool my_isOpen;/**< stan serwera */
+    std::atomic<bool> my_broadcastRunning;/**< stan wątku rozsyłania danych */
+    ArThread my_thread_broadcast;/**< handler wątku rozsyłania danych */
+
+    void updatePose( long long now_us );/**< \brief Przesuwa symulowanego robota do chwili \c now_us */
+    void countCommand( const char* command, ArServerClient* client );/**< \brief Zlicza polecenie i odsyła potwierdzenie */
+    void buildNumbersPacket( ArNetPacket* packet );/**< \brief Wypełnia pakiet \c updateNumbers */
+    void buildLaserPacket( ArNetPacket* packet );/**< \brief Wypełnia pakiet \c getSensorCurrent dla lasera */
+    void buildSonarPacket( ArNetPacket* packet );/**< \brief Wypełnia pakiet \c getSensorCurrent dla sonarów */
+    void buildSensorPacket( ArNetPacket* packet, const char* name, int points, double firstBeam, double span );/**< \brief Wypełnia pakiet \c getSensorCurrent pomiarem wiązek rozłożonych co \c span / (\c points - 1) stopni */
+    bool buildVideoPacket( ArNetPacket* packet );/**< \brief Wypełnia pakiet \c sendVideo (\b False, jeśli klatka nie mieści się w pakiecie) */
+    void buildJpegImage();/**< \brief Koduje syntetyczny obraz w \c my_jpegImage */
+
+    // CALLBACKS FUNCTIONS
+    void handle_updateNumbers( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c updateNumbers */
+    void handle_getSensorList( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c getSensorList */
+    void handle_getSensorCurrent( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c getSensorCurrent */
+    void handle_sendVideo( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c sendVideo */
+    void handle_getCameraInfoCamera_1( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c getCameraInfoCamera_1 */
+    void handle_getCameraDataCamera_1( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c getCameraDataCamera_1 */
+    void handle_setCameraAbsCamera_1( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c setCameraAbsCamera_1 */
+    void handle_setCameraRelCamera_1( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c setCameraRelCamera_1 */
+    void handle_moveDist( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c moveDist */
+    void handle_turnByAngle( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c turnByAngle */
+    void handle_turnToHeading( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c turnToHeading */
+    void handle_ratioDrive( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c ratioDrive */
+    void handle_stop( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c stop */
+    void handle_setSafeDrive( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c setSafeDrive */
+    void handle_standInConfigure( ArServerClient* client, ArNetPacket* packet );/**< callback polecenia \c standInConfigure */
+    void thread_broadcast(void);/**< wątek rozsyłania danych strumieni z okresem ustalonym przez serwer */
+
+    // CALLBACKS FUNCTORS
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_updateNumbers;/**< functor dla polecenia \c updateNumbers */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_getSensorList;/**< functor dla polecenia \c getSensorList */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_getSensorCurrent;/**< functor dla polecenia \c getSensorCurrent */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_sendVideo;/**< functor dla polecenia \c sendVideo */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_getCameraInfoCamera_1;/**< functor dla polecenia \c getCameraInfoCamera_1 */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_getCameraDataCamera_1;/**< functor dla polecenia \c getCameraDataCamera_1 */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_setCameraAbsCamera_1;/**< functor dla polecenia \c setCameraAbsCamera_1 */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_setCameraRelCamera_1;/**< functor dla polecenia \c setCameraRelCamera_1 */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_moveDist;/**< functor dla polecenia \c moveDist */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_turnByAngle;/**< functor dla polecenia \c turnByAngle */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_turnToHeading;/**< functor dla polecenia \c turnToHeading */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_ratioDrive;/**< functor dla polecenia \c ratioDrive */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_stop;/**< functor dla polecenia \c stop */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_setSafeDrive;/**< functor dla polecenia \c setSafeDrive */
+    ArFunctor2C<standInServer, ArServerClient*, ArNetPacket*> my_functor_handle_standInConfigure;/**< functor dla polecenia \c standInConfigure */
+    ArFunctorC<standInServer> my_functor_thread_broadcast;/**< functor do metody \c thread_broadcast() */
+};
+
+#endif // STANDINSERVER_H_INCLUDED
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Aria.h"
+#include "ArNetworking.h"
+
+#include "standInServer.h"
+
+// Stand-in robot server for testing the client without a robot:
+//   standin_server [-port 7272] [-frame 640x480] [-jpeg 20000] [-scan 181]
+//                  [-videoPeriod 0] [-numbersPeriod 0] [-laserPeriod 0]
+//                  [-poseScript poses.txt] [-loop] [-replay video_record/frames_...]
+// A period of 0 means that data is sent at the rate requested by the client.
+
+static void printUsage()
+{
+    printf("Usage: standin_server [-port N] [-frame WxH] [-jpeg BYTES] [-scan POINTS]\n"
+           "                      [-videoPeriod MS] [-numbersPeriod MS] [-laserPeriod MS]\n"
+           "                      [-poseScript FILE] [-loop] [-replay PATH]\n");
+}
+
+int main(int argc, char **argv)
+{
+    Aria::init();
+
+    standInServer server;
+    unsigned int port = 7272;
+    int width = 640, height = 480, length = 20000;
+    const char* poseScript = NULL;
+    const char* replay = NULL;
+    bool loop = false;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        bool hasValue = i + 1 < argc;
+        if( strcmp( argv[i], "-port" ) == 0 && hasValue )
+            port = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-frame" ) == 0 && hasValue )
+            sscanf( argv[++i], "%dx%d", &width, &height );
+        else if( strcmp( argv[i], "-jpeg" ) == 0 && hasValue )
+            length = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-scan" ) == 0 && hasValue )
+            server.setScanSize( atoi( argv[++i] ));
+        else if( strcmp( argv[i], "-videoPeriod" ) == 0 && hasValue )
+            server.setStreamPeriod( standInServer::STREAM_VIDEO, atoi( argv[++i] ));
+        else if( strcmp( argv[i], "-numbersPeriod" ) == 0 && hasValue )
+            server.setStreamPeriod( standInServer::STREAM_NUMBERS, atoi( argv[++i] ));
+        else if( strcmp( argv[i], "-laserPeriod" ) == 0 && hasValue )
+            server.setStreamPeriod( standInServer::STREAM_LASER, atoi( argv[++i] ));
+        else if( strcmp( argv[i], "-poseScript" ) == 0 && hasValue )
+            poseScript = argv[++i];
+        else if( strcmp( argv[i], "-replay" ) == 0 && hasValue )
+            replay = argv[++i];
+        else if( strcmp( argv[i], "-loop" ) == 0 )
+            loop = true;
+        else
+        {
+            printUsage();
+            Aria::exit( 1 );
+            return 1;
+        }
+    }
+
+    server.setFrameSize( width, height, length );
+    if( poseScript != NULL && !server.loadPoseScript( poseScript, loop ))
+    {
+        printf("Could not load pose script %s\n", poseScript);
+        Aria::exit( 1 );
+        return 1;
+    }
+    if( replay != NULL && !server.setReplayPath( replay ))
+    {
+        printf("Could not open recording %s\n", replay);
+        Aria::exit( 1 );
+        return 1;
+    }
+    if( !server.open( port ))
+    {
+        Aria::exit( 1 );
+        return 1;
+    }
+
+    printf("Stand-in server listening on port %u\n", port);
+    fflush(stdout);
+    // Runs until interrupted (Aria handles SIGINT)
+    while( true )
+        ArUtil::sleep( 1000 );
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "streamNotifier.h"
+
+#include <chrono>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+streamNotifier::streamNotifier() :
+    my_sequence( 0 ), my_waiters( 0 ), my_eventFd( -1 )
+{
+
+}
+
+streamNotifier::~streamNotifier()
+{
+    int eventFd = my_eventFd.exchange( -1 );
+    if( eventFd >= 0 )
+        close( eventFd );
+}
+
+void streamNotifier::notify()
+{
+    // Sequentially consistent with my_waiters in waitForNext() - either the
+    // waiter sees the new sequence or this thread sees the waiter.
+    my_sequence.fetch_add( 1 );
+
+    if( my_waiters.load() > 0 )
+    {
+        my_mutex.lock();
+        my_mutex.unlock();
+        my_condition.notify_all();
+    }
+
+    int eventFd = my_eventFd.load( std::memory_order_acquire );
+    if( eventFd >= 0 )
+    {
+        uint64_t one = 1;
+        if( write( eventFd, &one, sizeof( one )) != sizeof( one ))
+        {
+            // Counter saturated - the descriptor is readable anyway
+        }
+    }
+}
+
+unsigned long long streamNotifier::getSequence() const
+{
+    return my_sequence.load();
+}
+
+unsigned long long streamNotifier::waitForNext( unsigned long long lastSequence, int timeout_ms )
+{
+    unsigned long long sequence = my_sequence.load();
+    if( sequence != lastSequence || timeout_ms == 0 )
+        return sequence;
+
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds( timeout_ms );
+    my_waiters.fetch_add( 1 );
+    my_mutex.lock();
+    while( ( sequence = my_sequence.load() ) == lastSequence )
+    {
+        if( timeout_ms < 0 )
+            my_condition.wait( my_mutex );
+        else if( my_condition.wait_until( my_mutex, deadline ) == std::cv_status::timeout )
+        {
+            sequence = my_sequence.load();
+            break;
+        }
+    }
+    my_mutex.unlock();
+    my_waiters.fetch_sub( 1 );
+    return sequence;
+}
+
+int streamNotifier::getEventFd()
+{
+    int eventFd = my_eventFd.load( std::memory_order_acquire );
+    if( eventFd >= 0 )
+        return eventFd;
+
+    my_mutex.lock();
+    eventFd = my_eventFd.load();
+    if( eventFd < 0 )
+    {
+        eventFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+        if( eventFd >= 0 )
+            my_eventFd.store( eventFd, std::memory_order_release );
+    }
+    my_mutex.unlock();
+    return eventFd;
+}
@@ -0,0 +1,112 @@
+#ifndef STREAMNOTIFIER_H_INCLUDED
+#define STREAMNOTIFIER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+
+#include "Aria.h"
+
+#include "clientUtil.h"
+
+/** \brief Powiadamianie odbiorców o nowych danych strumienia (klatki, pomiary, stan robota)
+ *
+ * Producent po opublikowaniu danych wywołuje \c notify(), co zwiększa licznik
+ * powiadomień. Odbiorca może:
+ * \li czekać na kolejne powiadomienie z limitem czasu - \c waitForNext(),
+ * \li dodać deskryptor \c getEventFd() (\c eventfd) do własnej pętli \c poll / \c epoll;
+ * deskryptor jest gotowy do odczytu po każdym powiadomieniu, a odczyt 8 bajtów go zeruje.
+ *
+ * Gdy nikt nie czeka i deskryptor nie został utworzony, \c notify() to jedna operacja
+ * atomowa - producent (wątek odbioru danych) nigdy nie czeka na odbiorców.
+ */
+class streamNotifier
+{
+public:
+    /** \brief Konstruktor klasy \c streamNotifier
+     *
+     *
+     */
+    streamNotifier();
+    /** \brief Destruktor klasy \c streamNotifier - zamyka deskryptor \c eventfd
+     *
+     *
+     */
+    ~streamNotifier();
+
+    /** \brief Powiadamia odbiorców o nowych danych (wywoływane przez producenta po publikacji)
+     *
+     * \return void
+     *
+     */
+    void notify();
+    /** \brief Zwraca liczbę powiadomień
+     *
+     * \return unsigned long long - liczba powiadomień
+     *
+     */
+    unsigned long long getSequence() const;
+    /** \brief Czeka, aż liczba powiadomień przekroczy \c lastSequence
+     *
+     * \param lastSequence unsigned long long - ostatnio znana liczba powiadomień (patrz \c getSequence())
+     * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+     * \return unsigned long long - aktualna liczba powiadomień (równa \c lastSequence po upływie czasu)
+     *
+     */
+    unsigned long long waitForNext( unsigned long long lastSequence, int timeout_ms );
+    /** \brief Czeka, aż warunek \c ready zostanie spełniony
+     *
+     * Warunek sprawdzany jest od razu i po każdym powiadomieniu. Numer powiadomienia
+     * odczytywany jest przed sprawdzeniem, więc dane opublikowane w trakcie
+     * sprawdzania kończą oczekiwanie, np.:
+     * \code
+     * frameHandle frame;
+     * notifier.waitFor( [&]() { frame = store.acquire(); return !frame.empty(); }, 100 );
+     * \endcode
+     *
+     * \param ready Ready - funkcja bez argumentów zwracająca \b True, gdy dane są gotowe
+     * \param timeout_ms int - maksymalny czas oczekiwania w \c ms (ujemny - bez limitu)
+     * \return bool - \b True, jeśli warunek został spełniony przed upływem czasu
+     *
+     */
+    template<typename Ready>
+    bool waitFor( Ready ready, int timeout_ms )
+    {
+        long long deadline_us = clientUtil::monotonicTime_us() + (long long) timeout_ms * 1000;
+        while( true )
+        {
+            unsigned long long sequence = getSequence();
+            if( ready() )
+                return true;
+
+            int remaining_ms = -1;
+            if( timeout_ms >= 0 )
+            {
+                remaining_ms = (int) (( deadline_us - clientUtil::monotonicTime_us() + 999 ) / 1000 );
+                if( remaining_ms <= 0 )
+                    return false;
+            }
+            waitForNext( sequence, remaining_ms );
+        }
+    }
+    /** \brief Zwraca deskryptor \c eventfd sygnalizujący nowe dane (tworzony przy pierwszym wywołaniu)
+     *
+     * Deskryptor jest nieblokujący i należy do obiektu - nie wolno go zamykać.
+     *
+     * \return int - deskryptor lub -1, jeśli nie udało się go utworzyć
+     *
+     */
+    int getEventFd();
+
+private:
+    std::atomic<unsigned long long> my_sequence;/**< liczba powiadomień */
+    std::atomic<int> my_waiters;/**< liczba wątków czekających w \c waitForNext() */
+    std::atomic<int> my_eventFd;/**< deskryptor \c eventfd (-1 - nie utworzony) */
+
+    ArMutex my_mutex;/**< blokada zmiennej warunkowej i tworzenia deskryptora */
+    std::condition_variable_any my_condition;/**< zmienna warunkowa czekających wątków */
+
+    streamNotifier( const streamNotifier& );
+    streamNotifier& operator=( const streamNotifier& );
+};
+
+#endif // STREAMNOTIFIER_H_INCLUDED
@@ -0,0 +1,101 @@
+#include "streamStats.h"
+
+streamStats::streamStats( const std::string& name ) :
+    my_name( name ), my_arrivals( 0 ), my_bytes( 0 ), my_drops( 0 ), my_lastArrival_us( 0 )
+{
+
+}
+
+const std::string& streamStats::getName() const
+{
+    return my_name;
+}
+
+void streamStats::recordArrival( long long now_us, int bytes )
+{
+    my_arrivals.fetch_add( 1, std::memory_order_relaxed );
+    my_bytes.fetch_add( bytes, std::memory_order_relaxed );
+    my_packetSize.record( bytes );
+
+    long long last_us = my_lastArrival_us.exchange( now_us, std::memory_order_relaxed );
+    if( last_us != 0 )
+        my_interArrival.record( now_us - last_us );
+}
+
+void streamStats::recordDrops( unsigned long long count )
+{
+    my_drops.fetch_add( count, std::memory_order_relaxed );
+}
+
+void streamStats::recordDecode( long long decode_us )
+{
+    my_decodeTime.record( decode_us );
+}
+
+void streamStats::recordConsumerLag( long long lag_us )
+{
+    my_consumerLag.record( lag_us );
+}
+
+unsigned long long streamStats::getArrivalsCount() const
+{
+    return my_arrivals.load();
+}
+
+unsigned long long streamStats::getBytesCount() const
+{
+    return my_bytes.load();
+}
+
+unsigned long long streamStats::getDropsCount() const
+{
+    return my_drops.load();
+}
+
+const hdrHistogram& streamStats::getInterArrival() const
+{
+    return my_interArrival;
+}
+
+const hdrHistogram& streamStats::getPacketSize() const
+{
+    return my_packetSize;
+}
+
+const hdrHistogram& streamStats::getDecodeTime() const
+{
+    return my_decodeTime;
+}
+
+const hdrHistogram& streamStats::getConsumerLag() const
+{
+    return my_consumerLag;
+}
+
+void streamStats::print( FILE* output ) const
+{
+    fprintf( output, "%s: %llu packets, %llu bytes, %llu drops\n", my_name.c_str(),
+             getArrivalsCount(), getBytesCount(), getDropsCount() );
+
+    const hdrHistogram* histograms[] = { &my_interArrival, &my_packetSize, &my_decodeTime, &my_consumerLag };
+    const char* names[] = { "interval [us]", "size [B]", "decode [us]", "lag [us]" };
+    for( int i = 0; i < 4; i++ )
+    {
+        if( histograms[i]->getCount() == 0 )
+            continue;
+        fprintf( output, "\t%-14s p50 %10lld | p99 %10lld | max %10lld\n", names[i],
+                 histograms[i]->getPercentile( 50 ), histograms[i]->getPercentile( 99 ), histograms[i]->getMax() );
+    }
+}
+
+void streamStats::reset()
+{
+    my_arrivals = 0;
+    my_bytes = 0;
+    my_drops = 0;
+    my_lastArrival_us = 0;
+    my_interArrival.reset();
+    my_packetSize.reset();
+    my_decodeTime.reset();
+    my_consumerLag.reset();
+}
@@ -0,0 +1,136 @@
+#ifndef STREAMSTATS_H_INCLUDED
+#define STREAMSTATS_H_INCLUDED
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+#include "hdrHistogram.h"
+
+/** \brief Statystyki strumienia danych (klatek, pomiarów, stanu robota)
+ *
+ * Dla strumienia zliczane są odebrane pakiety, bajty i odrzucone elementy oraz
+ * zbierane histogramy (\c hdrHistogram):
+ * \li odstępów pomiędzy kolejnymi pakietami,
+ * \li rozmiarów pakietów,
+ * \li czasów dekodowania (np. klatek JPEG),
+ * \li opóźnień odbiorców (od odebrania danych do ich przetworzenia).
+ *
+ * Wszystkie metody zapisu są bezblokadowe i nie wykonują wywołań systemowych,
+ * więc mogą być wywoływane z wątku odbierającego dane z serwera.
+ */
+class streamStats
+{
+public:
+    /** \brief Konstruktor klasy \c streamStats
+     *
+     * \param name const std::string& - nazwa strumienia
+     *
+     */
+    streamStats( const std::string& name );
+
+    /** \brief Zwraca nazwę strumienia
+     *
+     * \return const std::string& - nazwa strumienia
+     *
+     */
+    const std::string& getName() const;
+
+    /** \brief Rejestruje odebrany pakiet
+     *
+     * \param now_us long long - chwila odbioru w \c us (patrz \c clientUtil::monotonicTime_us())
+     * \param bytes int - rozmiar pakietu w bajtach
+     * \return void
+     *
+     */
+    void recordArrival( long long now_us, int bytes );
+    /** \brief Rejestruje odrzucone elementy strumienia
+     *
+     * \param count unsigned long long - liczba odrzuconych elementów
+     * \return void
+     *
+     */
+    void recordDrops( unsigned long long count = 1 );
+    /** \brief Rejestruje czas dekodowania elementu
+     *
+     * \param decode_us long long - czas dekodowania w \c us
+     * \return void
+     *
+     */
+    void recordDecode( long long decode_us );
+    /** \brief Rejestruje opóźnienie odbiorcy
+     *
+     * \param lag_us long long - czas od odebrania danych do ich przetworzenia w \c us
+     * \return void
+     *
+     */
+    void recordConsumerLag( long long lag_us );
+
+    /** \brief Zwraca liczbę odebranych pakietów
+     *
+     * \return unsigned long long - liczba pakietów
+     *
+     */
+    unsigned long long getArrivalsCount() const;
+    /** \brief Zwraca liczbę odebranych bajtów
+     *
+     * \return unsigned long long - liczba bajtów
+     *
+     */
+    unsigned long long getBytesCount() const;
+    /** \brief Zwraca liczbę odrzuconych elementów
+     *
+     * \return unsigned long long - liczba elementów
+     *
+     */
+    unsigned long long getDropsCount() const;
+    /** \brief Zwraca histogram odstępów pomiędzy pakietami
+     *
+     * \return const hdrHistogram& - histogram (wartości w \c us)
+     *
+     */
+    const hdrHistogram& getInterArrival() const;
+    /** \brief Zwraca histogram rozmiarów pakietów
+     *
+     * \return const hdrHistogram& - histogram (wartości w bajtach)
+     *
+     */
+    const hdrHistogram& getPacketSize() const;
+    /** \brief Zwraca histogram czasów dekodowania
+     *
+     * \return const hdrHistogram& - histogram (wartości w \c us)
+     *
+     */
+    const hdrHistogram& getDecodeTime() const;
+    /** \brief Zwraca histogram opóźnień odbiorców
+     *
+     * \return const hdrHistogram& - histogram (wartości w \c us)
+     *
+     */
+    const hdrHistogram& getConsumerLag() const;
+
+    /** \brief Wypisuje podsumowanie statystyk (liczniki oraz p50 / p99 / maksimum niepustych histogramów)
+     *
+     * \param output FILE* - strumień wyjściowy
+     * \return void
+     *
+     */
+    void print( FILE* output ) const;
+    /** \brief Zeruje statystyki
+     *
+     * \return void
+     *
+     */
+    void reset();
+
+private:
+    std::string my_name;/**< nazwa strumienia */
+    std::atomic<unsigned long long> my_arrivals, my_bytes, my_drops;/**< liczniki strumienia */
+    std::atomic<long long> my_lastArrival_us;/**< chwila odebrania poprzedniego pakietu (0 - brak) */
+    hdrHistogram my_interArrival, my_packetSize, my_decodeTime, my_consumerLag;/**< histogramy strumienia */
+
+    streamStats( const streamStats& );
+    streamStats& operator=( const streamStats& );
+};
+
+#endif // STREAMSTATS_H_INCLUDED
@@ -0,0 +1,361 @@
+#include "taskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "clientUtil.h"
+
+taskScheduler::worker::worker( taskScheduler* scheduler, runQueue* queue ) :
+    my_scheduler( scheduler ), my_queue( queue ),
+    functor_thread_work( this, &taskScheduler::worker::thread_work )
+{
+
+}
+
+taskScheduler::taskScheduler( int workersCount, long long tick_us ) :
+    my_workersCount( std::max( workersCount, 1 )), my_tick_us( std::max( tick_us, 100LL )),
+    my_currentSlot( 0 ), my_wheelTime_us( 0 ), my_nextHandle( 1 ), my_isRunning( false ),
+    my_functor_thread_timer( this, &taskScheduler::thread_timer )
+{
+
+}
+
+taskScheduler::~taskScheduler()
+{
+    stop();
+    for( std::unordered_map<taskHandle, task*>::iterator it = my_tasks.begin(); it != my_tasks.end(); it++ )
+        delete it->second;
+}
+
+taskScheduler::taskHandle taskScheduler::addTask( ArFunctor* func, long long period_us, int cpu )
+{
+    if( func == NULL || period_us <= 0 || cpu < NO_CPU )
+        return 0;
+
+    my_mutex.lock();
+    long long now_us = clientUtil::monotonicTime_us();
+    if( my_tasks.empty() )
+    {
+        // The wheel was idle - restart it from now, so new deadlines stay within a few rounds
+        my_wheelTime_us = now_us;
+        my_currentSlot = 0;
+    }
+
+    task* added = new task();
+    added->handle = my_nextHandle++;
+    added->func = func;
+    added->cpu = cpu;
+    added->deadline_us = now_us + period_us;
+    added->runDeadline_us = 0;
+    added->isQueued = false;
+    added->isRemoved = false;
+    added->stats = taskStats();
+    added->stats.period_us = period_us;
+    my_tasks[added->handle] = added;
+
+    if( my_isRunning )
+        schedule( added );
+    else
+        start();
+    getQueue( cpu );
+    my_timerCondition.notify_all();
+    my_mutex.unlock();
+    return added->handle;
+}
+
+bool taskScheduler::removeTask( taskHandle handle )
+{
+    my_mutex.lock();
+    std::unordered_map<taskHandle, task*>::iterator found = my_tasks.find( handle );
+    if( found == my_tasks.end() )
+    {
+        my_mutex.unlock();
+        return false;
+    }
+
+    task* removed = found->second;
+    my_tasks.erase( found );
+    unschedule( removed );
+    removed->isRemoved = true;
+
+    // The queue is gone while stop() runs (it drops waiting runs itself)
+    std::map<int, runQueue*>::iterator queue = my_queues.find( removed->cpu );
+    if( removed->isQueued && queue != my_queues.end() )
+    {
+        std::deque<task*>& tasks = queue->second->tasks;
+        std::deque<task*>::iterator waiting = std::find( tasks.begin(), tasks.end(), removed );
+        if( waiting != tasks.end() )
+        {
+            tasks.erase( waiting );
+            removed->isQueued = false;
+        }
+    }
+    // Still running on a worker - the functor must stay valid until it returns
+    while( removed->isQueued )
+        my_doneCondition.wait( my_mutex );
+    my_mutex.unlock();
+
+    delete removed;
+    return true;
+}
+
+bool taskScheduler::setTaskPeriod( taskHandle handle, long long period_us )
+{
+    if( period_us <= 0 )
+        return false;
+
+    my_mutex.lock();
+    std::unordered_map<taskHandle, task*>::iterator found = my_tasks.find( handle );
+    if( found == my_tasks.end() )
+    {
+        my_mutex.unlock();
+        return false;
+    }
+
+    task* item = found->second;
+    unschedule( item );
+    item->stats.period_us = period_us;
+    item->deadline_us = clientUtil::monotonicTime_us() + period_us;
+    schedule( item );
+    my_timerCondition.notify_all();
+    my_mutex.unlock();
+    return true;
+}
+
+bool taskScheduler::getTaskStats( taskHandle handle, taskStats* stats )
+{
+    my_mutex.lock();
+    std::unordered_map<taskHandle, task*>::iterator found = my_tasks.find( handle );
+    if( found != my_tasks.end() )
+        *stats = found->second->stats;
+    my_mutex.unlock();
+    return found != my_tasks.end();
+}
+
+int taskScheduler::getTasksCount()
+{
+    my_mutex.lock();
+    int tasksCount = (int) my_tasks.size();
+    my_mutex.unlock();
+    return tasksCount;
+}
+
+void taskScheduler::stop()
+{
+    my_mutex.lock();
+    if( !my_isRunning )
+    {
+        my_mutex.unlock();
+        return;
+    }
+    my_isRunning = false;
+    std::map<int, runQueue*> queues;
+    queues.swap( my_queues );
+    for( std::map<int, runQueue*>::iterator it = queues.begin(); it != queues.end(); it++ )
+    {
+        // Runs that have not started yet are dropped
+        for( size_t i = 0; i < it->second->tasks.size(); i++ )
+            it->second->tasks[i]->isQueued = false;
+        it->second->tasks.clear();
+        it->second->condition.notify_all();
+    }
+    my_timerCondition.notify_all();
+    my_mutex.unlock();
+
+    my_thread_timer.join();
+    for( std::map<int, runQueue*>::iterator it = queues.begin(); it != queues.end(); it++ )
+    {
+        for( size_t i = 0; i < it->second->workers.size(); i++ )
+        {
+            it->second->workers[i]->thread.join();
+            delete it->second->workers[i];
+        }
+        delete it->second;
+    }
+}
+
+void taskScheduler::schedule( task* item )
+{
+    long long ticks = ( item->deadline_us - my_wheelTime_us + my_tick_us - 1 ) / my_tick_us;
+    ticks = std::max( ticks, 1LL );
+    item->slot = (int) (( my_currentSlot + ticks ) % WHEEL_SLOTS );
+    item->rounds = ( ticks - 1 ) / WHEEL_SLOTS;
+    my_wheel[item->slot].push_back( item );
+}
+
+void taskScheduler::unschedule( task* item )
+{
+    std::vector<task*>& slot = my_wheel[item->slot];
+    std::vector<task*>::iterator found = std::find( slot.begin(), slot.end(), item );
+    if( found != slot.end() )
+    {
+        *found = slot.back();
+        slot.pop_back();
+    }
+}
+
+void taskScheduler::dispatch( task* item, long long now_us )
+{
+    if( item->isQueued )
+        item->stats.missed++;
+    else
+    {
+        item->isQueued = true;
+        item->runDeadline_us = item->deadline_us;
+        runQueue* queue = getQueue( item->cpu );
+        queue->tasks.push_back( item );
+        queue->condition.notify_one();
+    }
+
+    // Deadlines stay on the task's own grid; periods that already passed count as missed
+    long long period_us = item->stats.period_us;
+    item->deadline_us += period_us;
+    if( item->deadline_us <= now_us )
+    {
+        long long skipped = ( now_us - item->deadline_us ) / period_us + 1;
+        item->stats.missed += skipped;
+        item->deadline_us += skipped * period_us;
+    }
+    schedule( item );
+}
+
+void taskScheduler::expireSlot( long long now_us )
+{
+    std::vector<task*> slot;
+    slot.swap( my_wheel[my_currentSlot] );
+    for( size_t i = 0; i < slot.size(); i++ )
+    {
+        if( slot[i]->rounds > 0 )
+        {
+            slot[i]->rounds--;
+            my_wheel[my_currentSlot].push_back( slot[i] );
+        }
+        else
+            dispatch( slot[i], now_us );
+    }
+}
+
+int taskScheduler::ticksToNextTask() const
+{
+    for( int ticks = 1; ticks <= WHEEL_SLOTS; ticks++ )
+    {
+        if( !my_wheel[( my_currentSlot + ticks ) % WHEEL_SLOTS].empty() )
+            return ticks;
+    }
+    return 0;
+}
+
+taskScheduler::runQueue* taskScheduler::getQueue( int cpu )
+{
+    std::map<int, runQueue*>::iterator found = my_queues.find( cpu );
+    if( found != my_queues.end() )
+        return found->second;
+
+    runQueue* queue = new runQueue();
+    queue->cpu = cpu;
+    my_queues[cpu] = queue;
+    int workersCount = cpu == NO_CPU ? my_workersCount : 1;
+    for( int i = 0; i < workersCount; i++ )
+    {
+        worker* added = new worker( this, queue );
+        queue->workers.push_back( added );
+        added->thread.create( &added->functor_thread_work );
+    }
+    return queue;
+}
+
+void taskScheduler::start()
+{
+    // Tasks left from before stop() restart their periods from now
+    long long now_us = clientUtil::monotonicTime_us();
+    for( int i = 0; i < WHEEL_SLOTS; i++ )
+        my_wheel[i].clear();
+    my_wheelTime_us = now_us;
+    my_currentSlot = 0;
+    for( std::unordered_map<taskHandle, task*>::iterator it = my_tasks.begin(); it != my_tasks.end(); it++ )
+    {
+        it->second->deadline_us = std::max( it->second->deadline_us, now_us + it->second->stats.period_us );
+        schedule( it->second );
+    }
+
+    my_isRunning = true;
+    my_thread_timer.create( &my_functor_thread_timer );
+}
+
+void taskScheduler::worker::thread_work()
+{
+    if( my_queue->cpu != NO_CPU )
+    {
+        cpu_set_t cpus;
+        CPU_ZERO( &cpus );
+        CPU_SET( my_queue->cpu, &cpus );
+        if( pthread_setaffinity_np( pthread_self(), sizeof( cpus ), &cpus ) != 0 )
+            ArLog::log( ArLog::Normal, "taskScheduler: could not pin worker to CPU %d", my_queue->cpu );
+    }
+
+    ArMutex& mutex = my_scheduler->my_mutex;
+    mutex.lock();
+    while( my_scheduler->my_isRunning )
+    {
+        if( my_queue->tasks.empty() )
+        {
+            my_queue->condition.wait( mutex );
+            continue;
+        }
+
+        task* item = my_queue->tasks.front();
+        my_queue->tasks.pop_front();
+        ArFunctor* func = item->func;
+        long long deadline_us = item->runDeadline_us;
+        mutex.unlock();
+
+        long long start_us = clientUtil::monotonicTime_us();
+        func->invoke();
+        long long duration_us = clientUtil::monotonicTime_us() - start_us;
+
+        mutex.lock();
+        taskStats& stats = item->stats;
+        stats.runs++;
+        stats.maxLateness_us = std::max( stats.maxLateness_us, start_us - deadline_us );
+        stats.lastDuration_us = duration_us;
+        stats.maxDuration_us = std::max( stats.maxDuration_us, duration_us );
+        if( duration_us > stats.period_us )
+            stats.overruns++;
+        item->isQueued = false;
+        if( item->isRemoved )
+            my_scheduler->my_doneCondition.notify_all();
+    }
+    mutex.unlock();
+}
+
+void taskScheduler::thread_timer()
+{
+    my_mutex.lock();
+    while( my_isRunning )
+    {
+        // Empty slots are skipped, so an idle wheel does not wake up on every tick
+        int ticks = ticksToNextTask();
+        if( ticks == 0 )
+        {
+            my_timerCondition.wait( my_mutex );
+            continue;
+        }
+
+        long long slotTime_us = my_wheelTime_us + ticks * my_tick_us;
+        long long now_us = clientUtil::monotonicTime_us();
+        if( now_us < slotTime_us )
+        {
+            // Woken early by addTask() or setTaskPeriod() - the next slot is recomputed
+            my_timerCondition.wait_for( my_mutex, std::chrono::microseconds( slotTime_us - now_us ));
+            continue;
+        }
+
+        my_currentSlot = ( my_currentSlot + ticks ) % WHEEL_SLOTS;
+        my_wheelTime_us = slotTime_us;
+        expireSlot( now_us );
+    }
+    my_mutex.unlock();
+}
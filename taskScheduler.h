@@ -0,0 +1,196 @@
+#ifndef TASKSCHEDULER_H_INCLUDED
+#define TASKSCHEDULER_H_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "Aria.h"
+
+/** \brief Planista zadań okresowych klienta (np. kontrola przeszkód, śledzenie kamerą, zapis telemetrii)
+ *
+ * Każde zadanie ma własny okres. Terminy zadań przechowywane są w haszowanym kole
+ * czasowym (\c WHEEL_SLOTS przegródek po jednym takcie), obsługiwanym przez wątek
+ * zegara, który śpi do najbliższej niepustej przegródki. Zadania, których termin
+ * minął, trafiają do kolejki wykonywanej przez pulę wątków roboczych, więc wolne
+ * zadanie nie opóźnia pozostałych ani obsługi klawiatury.
+ *
+ * Terminy są bezwzględne (kolejny termin = poprzedni + okres), więc zadania nie
+ * dryfują. Zadanie nigdy nie jest wykonywane równolegle samo ze sobą - termin,
+ * w którym poprzednie wykonanie jeszcze trwa lub czeka w kolejce, jest pomijany
+ * i liczony jako niedotrzymany.
+ *
+ * Zadanie może zostać przypięte do rdzenia procesora - wykonuje je wtedy osobny
+ * wątek przypięty do tego rdzenia (jeden wątek na rdzeń).
+ *
+ * Wątki uruchamiane są przy dodaniu pierwszego zadania.
+ */
+class taskScheduler
+{
+public:
+    typedef unsigned long long taskHandle;/**< uchwyt do zadania (0 - brak zadania) */
+
+    /** \brief Statystyki wykonywania zadania */
+    struct taskStats
+    {
+        long long period_us;/**< okres zadania w \c us */
+        unsigned long long runs;/**< liczba wykonań */
+        unsigned long long missed;/**< liczba pominiętych terminów (poprzednie wykonanie trwało lub planista nie nadążał) */
+        unsigned long long overruns;/**< liczba wykonań dłuższych niż okres */
+        long long maxLateness_us;/**< największe opóźnienie rozpoczęcia względem terminu w \c us */
+        long long lastDuration_us;/**< czas ostatniego wykonania w \c us */
+        long long maxDuration_us;/**< najdłuższy czas wykonania w \c us */
+    };
+
+    static const int WHEEL_SLOTS = 256;/**< liczba przegródek koła czasowego */
+    static const int NO_CPU = -1;/**< zadanie nieprzypięte do rdzenia */
+
+    /** \brief Konstruktor klasy \c taskScheduler
+     *
+     * \param workersCount int - liczba wątków roboczych wykonujących nieprzypięte zadania
+     * \param tick_us long long - takt koła czasowego w \c us (rozdzielczość terminów)
+     *
+     */
+    taskScheduler( int workersCount = 2, long long tick_us = 1000 );
+    /** \brief Destruktor klasy \c taskScheduler - zatrzymuje wątki i usuwa zadania
+     *
+     *
+     */
+    ~taskScheduler();
+
+    /** \brief Dodaje zadanie okresowe (pierwsze wykonanie po upływie okresu)
+     *
+     * \param func ArFunctor* - funkcja zadania
+     * \param period_us long long - okres w \c us
+     * \param cpu int - numer rdzenia, do którego zadanie jest przypięte (\c NO_CPU - pula wątków roboczych)
+     * \return taskHandle - uchwyt do zadania (0 - błędne parametry)
+     *
+     */
+    taskHandle addTask( ArFunctor* func, long long period_us, int cpu = NO_CPU );
+    /** \brief Usuwa zadanie, czekając na zakończenie jego trwającego wykonania
+     *
+     * Metoda nie może być wywoływana z wnętrza usuwanego zadania.
+     *
+     * \param task taskHandle - uchwyt zwrócony przez \c addTask()
+     * \return bool - \b True, jeśli zadanie istniało
+     *
+     */
+    bool removeTask( taskHandle task );
+    /** \brief Zmienia okres zadania (kolejny termin liczony jest od chwili wywołania)
+     *
+     * \param task taskHandle - uchwyt do zadania
+     * \param period_us long long - nowy okres w \c us
+     * \return bool - \b True, jeśli zadanie istnieje
+     *
+     */
+    bool setTaskPeriod( taskHandle task, long long period_us );
+    /** \brief Zwraca statystyki zadania
+     *
+     * \param task taskHandle - uchwyt do zadania
+     * \param stats taskStats* - statystyki
+     * \return bool - \b True, jeśli zadanie istnieje
+     *
+     */
+    bool getTaskStats( taskHandle task, taskStats* stats );
+    /** \brief Zwraca liczbę zadań
+     *
+     * \return int - liczba zadań
+     *
+     */
+    int getTasksCount();
+    /** \brief Zatrzymuje wątki planisty (zadania pozostają zarejestrowane, a dodanie kolejnego wznawia pracę)
+     *
+     * Trwające wykonania zadań są kończone, a oczekujące w kolejkach - odrzucane.
+     * Metoda nie może być wywoływana równolegle z \c addTask().
+     *
+     * \return void
+     *
+     */
+    void stop();
+
+private:
+    /** \brief Zadanie okresowe */
+    struct task
+    {
+        taskHandle handle;/**< uchwyt zadania */
+        ArFunctor* func;/**< funkcja zadania */
+        int cpu;/**< rdzeń zadania (\c NO_CPU - pula) */
+        long long deadline_us;/**< kolejny termin */
+        long long runDeadline_us;/**< termin wykonania czekającego w kolejce lub trwającego */
+        int slot;/**< przegródka koła czasowego */
+        long long rounds;/**< liczba pełnych obrotów koła do terminu */
+        bool isQueued;/**< zadanie czeka w kolejce lub jest wykonywane */
+        bool isRemoved;/**< zadanie jest usuwane */
+        taskStats stats;/**< statystyki zadania */
+    };
+
+    class worker;
+
+    /** \brief Kolejka zadań do wykonania (pula albo rdzeń) */
+    struct runQueue
+    {
+        int cpu;/**< rdzeń wątków kolejki (\c NO_CPU - pula) */
+        std::deque<task*> tasks;/**< zadania do wykonania */
+        std::condition_variable_any condition;/**< budzenie wątków kolejki */
+        std::vector<worker*> workers;/**< wątki kolejki */
+    };
+
+    /** \brief Wątek roboczy wykonujący zadania z kolejki */
+    class worker
+    {
+    public:
+        worker( taskScheduler* scheduler, runQueue* queue );
+
+        ArThread thread;/**< handler wątku */
+
+    private:
+        taskScheduler* my_scheduler;/**< planista */
+        runQueue* my_queue;/**< obsługiwana kolejka */
+
+        // CALLBACKS FUNCTIONS
+        void thread_work(void);/**< wątek wykonywania zadań */
+
+    public:
+        // CALLBACKS FUNCTORS
+        ArFunctorC<worker> functor_thread_work;/**< functor do metody \c thread_work() */
+    };
+
+    int my_workersCount;/**< liczba wątków puli */
+    long long my_tick_us;/**< takt koła czasowego */
+
+    ArMutex my_mutex;/**< blokada stanu planisty (koło, kolejki, zadania i statystyki) */
+    std::condition_variable_any my_timerCondition;/**< budzenie wątku zegara */
+    std::condition_variable_any my_doneCondition;/**< sygnalizacja zakończenia wykonania usuwanego zadania */
+
+    std::vector<task*> my_wheel[WHEEL_SLOTS];/**< koło czasowe */
+    int my_currentSlot;/**< przegródka ostatniego obsłużonego taktu */
+    long long my_wheelTime_us;/**< chwila ostatniego obsłużonego taktu */
+
+    std::unordered_map<taskHandle, task*> my_tasks;/**< zadania według uchwytów */
+    taskHandle my_nextHandle;/**< uchwyt następnego dodanego zadania */
+
+    std::map<int, runQueue*> my_queues;/**< kolejki według rdzeni (\c NO_CPU - pula) */
+    ArThread my_thread_timer;/**< handler wątku zegara */
+    bool my_isRunning;/**< stan wątków */
+
+    void schedule( task* item );/**< \brief Umieszcza zadanie w kole według jego terminu (pod blokadą) */
+    void unschedule( task* item );/**< \brief Wyjmuje zadanie z koła (pod blokadą) */
+    void dispatch( task* item, long long now_us );/**< \brief Przekazuje zadanie do kolejki i wyznacza kolejny termin (pod blokadą) */
+    void expireSlot( long long now_us );/**< \brief Obsługuje bieżącą przegródkę koła (pod blokadą) */
+    int ticksToNextTask() const;/**< \brief Zwraca liczbę taktów do najbliższej niepustej przegródki (pod blokadą) */
+    runQueue* getQueue( int cpu );/**< \brief Zwraca kolejkę dla rdzenia, uruchamiając jej wątki (pod blokadą) */
+    void start();/**< \brief Uruchamia wątek zegara (pod blokadą) */
+
+    // CALLBACKS FUNCTIONS
+    void thread_timer(void);/**< wątek zegara - obsługa koła czasowego */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<taskScheduler> my_functor_thread_timer;/**< functor do metody \c thread_timer() */
+
+    taskScheduler( const taskScheduler& );
+    taskScheduler& operator=( const taskScheduler& );
+};
+
+#endif // TASKSCHEDULER_H_INCLUDED
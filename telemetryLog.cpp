@@ -0,0 +1,451 @@
+#include "telemetryLog.h"
+#include "clientUtil.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+template<typename T>
+static void appendValue( std::vector<unsigned char>& column, const T& value )
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( &value );
+    column.insert( column.end(), bytes, bytes + sizeof( T ));
+}
+
+template<typename T>
+static T readValue( const unsigned char* column, size_t index )
+{
+    T value;
+    memcpy( &value, column + index * sizeof( T ), sizeof( T ));
+    return value;
+}
+
+static bool writeAll( int file, const unsigned char* data, size_t length )
+{
+    while( length > 0 )
+    {
+        ssize_t written = write( file, data, length );
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+telemetryRing::telemetryRing( size_t capacity ) :
+    my_data( new unsigned char[capacity] ), my_capacity( capacity ), my_head( 0 ), my_tail( 0 )
+{
+
+}
+
+telemetryRing::~telemetryRing()
+{
+    delete[] my_data;
+}
+
+void telemetryRing::copyIn( unsigned long long position, const void* source, size_t length )
+{
+    size_t offset = position % my_capacity;
+    size_t first = length < my_capacity - offset ? length : my_capacity - offset;
+    memcpy( my_data + offset, source, first );
+    memcpy( my_data, (const unsigned char*) source + first, length - first );
+}
+
+void telemetryRing::copyOut( unsigned long long position, void* destination, size_t length )
+{
+    size_t offset = position % my_capacity;
+    size_t first = length < my_capacity - offset ? length : my_capacity - offset;
+    memcpy( destination, my_data + offset, first );
+    memcpy( (unsigned char*) destination + first, my_data, length - first );
+}
+
+bool telemetryRing::push( const struct iovec* parts, int count )
+{
+    uint32_t length = 0;
+    for( int i = 0; i < count; i++ )
+        length += parts[i].iov_len;
+
+    unsigned long long head = my_head.load( std::memory_order_relaxed );
+    unsigned long long tail = my_tail.load( std::memory_order_acquire );
+    if( head - tail + sizeof( length ) + length > my_capacity )
+        return false;
+
+    copyIn( head, &length, sizeof( length ));
+    unsigned long long position = head + sizeof( length );
+    for( int i = 0; i < count; i++ )
+    {
+        copyIn( position, parts[i].iov_base, parts[i].iov_len );
+        position += parts[i].iov_len;
+    }
+    my_head.store( position, std::memory_order_release );
+    return true;
+}
+
+bool telemetryRing::pop( std::vector<unsigned char>& record )
+{
+    unsigned long long tail = my_tail.load( std::memory_order_relaxed );
+    unsigned long long head = my_head.load( std::memory_order_acquire );
+    if( tail == head )
+        return false;
+
+    uint32_t length;
+    copyOut( tail, &length, sizeof( length ));
+    record.resize( length );
+    if( length > 0 )
+        copyOut( tail + sizeof( length ), &record[0], length );
+    my_tail.store( tail + sizeof( length ) + length, std::memory_order_release );
+    return true;
+}
+
+void telemetryRing::clear()
+{
+    my_tail.store( my_head.load( std::memory_order_acquire ), std::memory_order_release );
+}
+
+telemetryRecorder::telemetryRecorder( size_t ringCapacity ) :
+    my_file( -1 ), my_flushInterval_ms( 200 ),
+    my_isRecording( false ), my_writtenRecords( 0 ), my_droppedRecords( 0 ),
+    my_functor_thread_write( this, &telemetryRecorder::thread_write )
+{
+    for( int i = 0; i < STREAM_COUNT; i++ )
+        my_rings[i] = new telemetryRing( ringCapacity );
+}
+
+telemetryRecorder::~telemetryRecorder()
+{
+    stop();
+    for( int i = 0; i < STREAM_COUNT; i++ )
+        delete my_rings[i];
+}
+
+bool telemetryRecorder::start( const std::string& filename )
+{
+    if( my_isRecording )
+        return true;
+
+    my_file = open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( my_file < 0 )
+    {
+        printf("telemetryRecorder: could not create %s: %s\n", filename.c_str(), strerror( errno ));
+        fflush(stdout);
+        return false;
+    }
+
+    telemetryFileHeader header;
+    struct timeval wallClock;
+    gettimeofday( &wallClock, NULL );
+    memset( &header, 0, sizeof( header ));
+    memcpy( header.magic, TELEMETRY_MAGIC, sizeof( TELEMETRY_MAGIC ));
+    header.version = TELEMETRY_VERSION;
+    header.headerSize = sizeof( telemetryFileHeader );
+    header.wallClockAtStart_us = (int64_t) wallClock.tv_sec * 1000000 + wallClock.tv_usec;
+    header.monotonicAtStart_us = clientUtil::monotonicTime_us();
+    if( !writeAll( my_file, (const unsigned char*) &header, sizeof( header )))
+    {
+        close( my_file );
+        my_file = -1;
+        return false;
+    }
+
+    // Records left over from the previous session (pushed while it was stopping)
+    for( int i = 0; i < STREAM_COUNT; i++ )
+        my_rings[i]->clear();
+
+    my_isRecording = true;
+    my_thread_write.create( &my_functor_thread_write );
+    return true;
+}
+
+void telemetryRecorder::stop()
+{
+    if( !my_isRecording )
+        return;
+
+    my_isRecording = false;
+    my_thread_write.join();
+}
+
+bool telemetryRecorder::isRecording()
+{
+    return my_isRecording;
+}
+
+void telemetryRecorder::setFlushInterval( int interval_ms )
+{
+    my_flushInterval_ms = interval_ms;
+}
+
+void telemetryRecorder::push( telemetryStream stream, const struct iovec* parts, int count )
+{
+    if( !my_isRecording )
+        return;
+    if( !my_rings[stream]->push( parts, count ))
+        my_droppedRecords++;
+}
+
+void telemetryRecorder::recordPose( const telemetryPose& pose )
+{
+    struct iovec part = { const_cast<telemetryPose*>( &pose ), sizeof( pose ) };
+    push( STREAM_POSE, &part, 1 );
+}
+
+void telemetryRecorder::recordLaser( long long timestamp_us, const int* x, const int* y, int count )
+{
+    int64_t timestamp = timestamp_us;
+    int32_t pointCount = count;
+    struct iovec parts[4] =
+    {
+        { &timestamp, sizeof( timestamp ) },
+        { &pointCount, sizeof( pointCount ) },
+        { const_cast<int*>( x ), count * sizeof( int32_t ) },
+        { const_cast<int*>( y ), count * sizeof( int32_t ) }
+    };
+    push( STREAM_LASER, parts, 4 );
+}
+
+void telemetryRecorder::recordFrame( const telemetryFrame& frame )
+{
+    struct iovec part = { const_cast<telemetryFrame*>( &frame ), sizeof( frame ) };
+    push( STREAM_FRAME, &part, 1 );
+}
+
+unsigned long long telemetryRecorder::getWrittenRecordsCount()
+{
+    return my_writtenRecords.load();
+}
+
+unsigned long long telemetryRecorder::getDroppedRecordsCount()
+{
+    return my_droppedRecords.load();
+}
+
+void telemetryRecorder::thread_write()
+{
+    while( my_isRecording )
+    {
+        flush();
+        ArUtil::sleep( my_flushInterval_ms );
+    }
+    // Records pushed before the recording was stopped
+    flush();
+    close( my_file );
+    my_file = -1;
+}
+
+void telemetryRecorder::flush()
+{
+    for( int stream = 0; stream < STREAM_COUNT; stream++ )
+        flushStream( (telemetryStream) stream );
+}
+
+void telemetryRecorder::flushStream( telemetryStream stream )
+{
+    const int columnsCount[STREAM_COUNT] = { 8, 4, 5 };
+    for( int i = 0; i < columnsCount[stream]; i++ )
+        my_columns[i].clear();
+
+    // Split the records into columns
+    uint32_t count = 0;
+    while( my_rings[stream]->pop( my_record ))
+    {
+        const unsigned char* record = &my_record[0];
+        if( stream == STREAM_POSE )
+        {
+            const telemetryPose pose = readValue<telemetryPose>( record, 0 );
+            appendValue( my_columns[0], (int64_t) pose.timestamp_us );
+            appendValue( my_columns[1], pose.batteryVoltage );
+            appendValue( my_columns[2], pose.xPosition );
+            appendValue( my_columns[3], pose.yPosition );
+            appendValue( my_columns[4], pose.theta );
+            appendValue( my_columns[5], pose.velocity );
+            appendValue( my_columns[6], pose.rotationalVelocity );
+            appendValue( my_columns[7], pose.temperature );
+        }
+        else if( stream == STREAM_LASER )
+        {
+            int32_t pointCount = readValue<int32_t>( record + sizeof( int64_t ), 0 );
+            const unsigned char* points = record + sizeof( int64_t ) + sizeof( int32_t );
+            my_columns[0].insert( my_columns[0].end(), record, record + sizeof( int64_t ));
+            appendValue( my_columns[1], pointCount );
+            my_columns[2].insert( my_columns[2].end(), points, points + pointCount * sizeof( int32_t ));
+            points += pointCount * sizeof( int32_t );
+            my_columns[3].insert( my_columns[3].end(), points, points + pointCount * sizeof( int32_t ));
+        }
+        else
+        {
+            const telemetryFrame frame = readValue<telemetryFrame>( record, 0 );
+            appendValue( my_columns[0], (int64_t) frame.timestamp_us );
+            appendValue( my_columns[1], (uint64_t) frame.sequence );
+            appendValue( my_columns[2], frame.width );
+            appendValue( my_columns[3], frame.height );
+            appendValue( my_columns[4], frame.length );
+        }
+        count++;
+    }
+    if( count == 0 )
+        return;
+
+    telemetryBlockHeader header;
+    header.magic = TELEMETRY_BLOCK_MAGIC;
+    header.stream = stream;
+    header.count = count;
+    header.payloadSize = 0;
+    for( int i = 0; i < columnsCount[stream]; i++ )
+        header.payloadSize += my_columns[i].size();
+
+    my_block.clear();
+    appendValue( my_block, header );
+    for( int i = 0; i < columnsCount[stream]; i++ )
+        my_block.insert( my_block.end(), my_columns[i].begin(), my_columns[i].end() );
+
+    if( writeAll( my_file, &my_block[0], my_block.size() ))
+        my_writtenRecords += count;
+    else
+        my_droppedRecords += count;
+}
+
+telemetryReader::telemetryReader()
+{
+    memset( &my_header, 0, sizeof( my_header ));
+}
+
+bool telemetryReader::open( const std::string& filename )
+{
+    my_poses.clear();
+    my_scans.clear();
+    my_frames.clear();
+
+    FILE* file = fopen( filename.c_str(), "rb" );
+    if( file == NULL )
+        return false;
+
+    std::vector<unsigned char> data;
+    unsigned char chunk[65536];
+    size_t read;
+    while( ( read = fread( chunk, 1, sizeof( chunk ), file )) > 0 )
+        data.insert( data.end(), chunk, chunk + read );
+    fclose( file );
+
+    if( data.size() < sizeof( telemetryFileHeader ))
+        return false;
+    memcpy( &my_header, &data[0], sizeof( my_header ));
+    if( memcmp( my_header.magic, TELEMETRY_MAGIC, sizeof( TELEMETRY_MAGIC )) != 0 ||
+        my_header.headerSize < sizeof( telemetryFileHeader ) || my_header.headerSize > data.size() )
+        return false;
+
+    // A block cut off by a crash ends the log
+    size_t offset = my_header.headerSize;
+    while( offset + sizeof( telemetryBlockHeader ) <= data.size() )
+    {
+        telemetryBlockHeader header;
+        memcpy( &header, &data[offset], sizeof( header ));
+        offset += sizeof( header );
+        if( header.magic != TELEMETRY_BLOCK_MAGIC || header.payloadSize > data.size() - offset ||
+            !readBlock( header, &data[offset] ))
+            break;
+        offset += header.payloadSize;
+    }
+    return true;
+}
+
+bool telemetryReader::readBlock( const telemetryBlockHeader& header, const unsigned char* payload )
+{
+    size_t count = header.count;
+    if( header.stream == STREAM_POSE )
+    {
+        if( header.payloadSize != count * ( sizeof( int64_t ) + 7 * sizeof( double )))
+            return false;
+        const unsigned char* values = payload + count * sizeof( int64_t );
+        for( size_t i = 0; i < count; i++ )
+        {
+            telemetryPose pose;
+            pose.timestamp_us = readValue<int64_t>( payload, i );
+            pose.batteryVoltage = readValue<double>( values, i );
+            pose.xPosition = readValue<double>( values, count + i );
+            pose.yPosition = readValue<double>( values, 2 * count + i );
+            pose.theta = readValue<double>( values, 3 * count + i );
+            pose.velocity = readValue<double>( values, 4 * count + i );
+            pose.rotationalVelocity = readValue<double>( values, 5 * count + i );
+            pose.temperature = readValue<double>( values, 6 * count + i );
+            my_poses.push_back( pose );
+        }
+    }
+    else if( header.stream == STREAM_LASER )
+    {
+        size_t fixedSize = count * ( sizeof( int64_t ) + sizeof( int32_t ));
+        if( header.payloadSize < fixedSize )
+            return false;
+        const unsigned char* pointCounts = payload + count * sizeof( int64_t );
+        size_t totalPoints = 0;
+        for( size_t i = 0; i < count; i++ )
+            totalPoints += (uint32_t) readValue<int32_t>( pointCounts, i );
+        if( header.payloadSize != fixedSize + 2 * totalPoints * sizeof( int32_t ))
+            return false;
+
+        const unsigned char* xs = payload + fixedSize;
+        const unsigned char* ys = xs + totalPoints * sizeof( int32_t );
+        size_t point = 0;
+        for( size_t i = 0; i < count; i++ )
+        {
+            telemetryScan scan;
+            scan.timestamp_us = readValue<int64_t>( payload, i );
+            int32_t pointCount = readValue<int32_t>( pointCounts, i );
+            scan.x.resize( pointCount );
+            scan.y.resize( pointCount );
+            if( pointCount > 0 )
+            {
+                memcpy( &scan.x[0], xs + point * sizeof( int32_t ), pointCount * sizeof( int32_t ));
+                memcpy( &scan.y[0], ys + point * sizeof( int32_t ), pointCount * sizeof( int32_t ));
+            }
+            point += pointCount;
+            my_scans.push_back( scan );
+        }
+    }
+    else if( header.stream == STREAM_FRAME )
+    {
+        if( header.payloadSize != count * ( sizeof( int64_t ) + sizeof( uint64_t ) + 3 * sizeof( int32_t )))
+            return false;
+        const unsigned char* sequences = payload + count * sizeof( int64_t );
+        const unsigned char* sizes = sequences + count * sizeof( uint64_t );
+        for( size_t i = 0; i < count; i++ )
+        {
+            telemetryFrame frame;
+            frame.timestamp_us = readValue<int64_t>( payload, i );
+            frame.sequence = readValue<uint64_t>( sequences, i );
+            frame.width = readValue<int32_t>( sizes, i );
+            frame.height = readValue<int32_t>( sizes, count + i );
+            frame.length = readValue<int32_t>( sizes, 2 * count + i );
+            my_frames.push_back( frame );
+        }
+    }
+    // Blocks of unknown streams (newer versions) are skipped
+    return true;
+}
+
+const telemetryFileHeader& telemetryReader::getHeader() const
+{
+    return my_header;
+}
+
+const std::vector<telemetryPose>& telemetryReader::getPoses() const
+{
+    return my_poses;
+}
+
+const std::vector<telemetryScan>& telemetryReader::getScans() const
+{
+    return my_scans;
+}
+
+const std::vector<telemetryFrame>& telemetryReader::getFrames() const
+{
+    return my_frames;
+}
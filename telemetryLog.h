@@ -0,0 +1,289 @@
+#ifndef TELEMETRYLOG_H_INCLUDED
+#define TELEMETRYLOG_H_INCLUDED
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+#include "Aria.h"
+
+/** \brief Format pliku z zapisem telemetrii robota (\c .tlog)
+ *
+ * Plik rozpoczyna się nagłówkiem \c telemetryFileHeader, po którym następują
+ * kolejne bloki. Każdy blok zawiera rekordy jednego strumienia
+ * (\c telemetryStream) zapisane kolumnami: nagłówek \c telemetryBlockHeader,
+ * a za nim kolejno całe kolumny wartości:
+ * \li \c STREAM_POSE: \c int64 czas[n], a następnie \c double: napięcie[n], x[n], y[n],
+ * kąt[n], prędkość[n], prędkość kątowa[n], temperatura[n]
+ * \li \c STREAM_LASER: \c int64 czas[n], \c int32 liczba punktów[n], a następnie punkty
+ * wszystkich pomiarów: \c int32 x[m], \c int32 y[m]
+ * \li \c STREAM_FRAME: \c int64 czas[n], \c uint64 numer klatki[n], \c int32 szerokość[n],
+ * wysokość[n], długość[n]
+ *
+ * Czas to monotoniczna chwila odbioru danych w \c us. Dane obrazu nie są tu
+ * zapisywane - klatki łączy się z zapisem \c frameRecorder po numerze klatki.
+ * Struktury i kolumny zapisywane są bezpośrednio z pamięci, więc liczby mają
+ * porządek bajtów komputera zapisującego (little-endian na x86 i ARM).
+ */
+struct telemetryFileHeader
+{
+    char magic[8];/**< \c "ARTLOG01" */
+    uint32_t version;/**< wersja formatu */
+    uint32_t headerSize;/**< rozmiar nagłówka pliku w bajtach */
+    int64_t wallClockAtStart_us;/**< czas rzeczywisty rozpoczęcia zapisu (od 1970 r.) */
+    int64_t monotonicAtStart_us;/**< czas monotoniczny rozpoczęcia zapisu */
+};
+
+/** \brief Nagłówek bloku rekordów jednego strumienia */
+struct telemetryBlockHeader
+{
+    uint32_t magic;/**< \c TELEMETRY_BLOCK_MAGIC */
+    uint32_t stream;/**< strumień (\c telemetryStream) */
+    uint32_t count;/**< liczba rekordów w bloku */
+    uint32_t payloadSize;/**< rozmiar kolumn w bajtach */
+};
+
+/** \brief Strumienie zapisywane w pliku telemetrii */
+enum telemetryStream
+{
+    STREAM_POSE = 0,/**< dane z polecenia \c updateNumbers */
+    STREAM_LASER = 1,/**< pomiary z dalmierza laserowego */
+    STREAM_FRAME = 2,/**< opis klatek ze strumienia kamery */
+    STREAM_COUNT = 3
+};
+
+static_assert( sizeof( telemetryFileHeader ) == 32, "telemetryFileHeader layout changed" );
+static_assert( sizeof( telemetryBlockHeader ) == 16, "telemetryBlockHeader layout changed" );
+
+static const char TELEMETRY_MAGIC[8] = { 'A', 'R', 'T', 'L', 'O', 'G', '0', '1' };
+static const uint32_t TELEMETRY_VERSION = 1;
+static const uint32_t TELEMETRY_BLOCK_MAGIC = 0x4b4c4254;/**< \c "TBLK" */
+
+/** \brief Rekord strumienia \c STREAM_POSE */
+struct telemetryPose
+{
+    int64_t timestamp_us;/**< chwila odbioru */
+    double batteryVoltage, xPosition, yPosition, theta,
+           velocity, rotationalVelocity, temperature;/**< stan robota */
+};
+
+/** \brief Rekord strumienia \c STREAM_FRAME */
+struct telemetryFrame
+{
+    int64_t timestamp_us;/**< chwila odbioru */
+    uint64_t sequence;/**< numer klatki */
+    int32_t width, height, length;/**< rozmiar obrazu i danych */
+};
+
+/** \brief Rekord strumienia \c STREAM_LASER */
+struct telemetryScan
+{
+    int64_t timestamp_us;/**< chwila odbioru */
+    std::vector<int32_t> x, y;/**< współrzędne punktów pomiaru */
+};
+
+/** \brief Bezblokadowy bufor cykliczny rekordów o zmiennej długości
+ *
+ * Jeden producent, jeden konsument. Gdy brakuje miejsca, rekord jest odrzucany
+ * (producent nigdy nie czeka).
+ */
+class telemetryRing
+{
+public:
+    telemetryRing( size_t capacity );
+    ~telemetryRing();
+
+    /** \brief Dopisuje rekord złożony z kilku części (wywoływane przez producenta)
+     *
+     * \param parts const struct iovec* - kolejne części rekordu
+     * \param count int - liczba części
+     * \return bool - \b False, jeśli zabrakło miejsca
+     *
+     */
+    bool push( const struct iovec* parts, int count );
+    /** \brief Pobiera najstarszy rekord (wywoływane przez konsumenta)
+     *
+     * \param record std::vector<unsigned char>& - bufor na rekord
+     * \return bool - \b False, jeśli bufor jest pusty
+     *
+     */
+    bool pop( std::vector<unsigned char>& record );
+    /** \brief Usuwa wszystkie rekordy (wywoływane przez konsumenta)
+     *
+     * \return void
+     *
+     */
+    void clear();
+
+private:
+    unsigned char* my_data;/**< dane bufora */
+    size_t my_capacity;/**< pojemność bufora */
+    std::atomic<unsigned long long> my_head, my_tail;/**< indeksy zapisu i odczytu */
+
+    void copyIn( unsigned long long position, const void* source, size_t length );
+    void copyOut( unsigned long long position, void* destination, size_t length );
+
+    telemetryRing( const telemetryRing& );
+    telemetryRing& operator=( const telemetryRing& );
+};
+
+/** \brief Zapis telemetrii robota do pliku w osobnym wątku
+ *
+ * Metody \c record...() wywoływane są przez wątki odbierające dane - kopiują
+ * jedynie rekord do bezblokadowego bufora danego strumienia (każdy strumień ma
+ * własny bufor i jednego producenta). Wątek zapisu co \c setFlushInterval() ms
+ * przenosi rekordy z buforów do bloków kolumnowych i dopisuje je do pliku.
+ * Gdy zapis nie nadąża, nowe rekordy są odrzucane i zliczane.
+ */
+class telemetryRecorder
+{
+public:
+    /** \brief Konstruktor klasy \c telemetryRecorder
+     *
+     * \param ringCapacity size_t - pojemność bufora każdego strumienia w bajtach
+     *
+     */
+    telemetryRecorder( size_t ringCapacity = 4 * 1024 * 1024 );
+    /** \brief Destruktor klasy \c telemetryRecorder - kończy zapis
+     *
+     *
+     */
+    ~telemetryRecorder();
+
+    /** \brief Rozpoczyna zapis telemetrii do pliku
+     *
+     * \param filename const std::string& - ścieżka pliku (np. \c "session.tlog")
+     * \return bool - \b True, jeśli udało się utworzyć plik
+     *
+     */
+    bool start( const std::string& filename );
+    /** \brief Kończy zapis - zapisuje rekordy pozostałe w buforach i zamyka plik
+     *
+     * \return void
+     *
+     */
+    void stop();
+    /** \brief Sprawdza czy trwa zapis
+     *
+     * \return bool - \b True, jeśli trwa zapis
+     *
+     */
+    bool isRecording();
+    /** \brief Ustawia odstęp czasowy pomiędzy kolejnymi zapisami bloków
+     *
+     * \param interval_ms int - odstęp w \c ms
+     * \return void
+     *
+     */
+    void setFlushInterval( int interval_ms );
+
+    /** \brief Zapisuje stan robota (dane polecenia \c updateNumbers)
+     *
+     * \param pose const telemetryPose& - stan robota
+     * \return void
+     *
+     */
+    void recordPose( const telemetryPose& pose );
+    /** \brief Zapisuje pomiar z dalmierza laserowego
+     *
+     * \param timestamp_us long long - chwila odbioru pomiaru
+     * \param x const int* - współrzędne \c x punktów
+     * \param y const int* - współrzędne \c y punktów
+     * \param count int - liczba punktów
+     * \return void
+     *
+     */
+    void recordLaser( long long timestamp_us, const int* x, const int* y, int count );
+    /** \brief Zapisuje opis klatki ze strumienia kamery
+     *
+     * \param frame const telemetryFrame& - opis klatki
+     * \return void
+     *
+     */
+    void recordFrame( const telemetryFrame& frame );
+
+    /** \brief Zwraca liczbę zapisanych rekordów
+     *
+     * \return unsigned long long - liczba rekordów
+     *
+     */
+    unsigned long long getWrittenRecordsCount();
+    /** \brief Zwraca liczbę rekordów odrzuconych z powodu przepełnienia bufora
+     *
+     * \return unsigned long long - liczba rekordów
+     *
+     */
+    unsigned long long getDroppedRecordsCount();
+
+private:
+    telemetryRing* my_rings[STREAM_COUNT];/**< bufory strumieni */
+    int my_file;/**< deskryptor pliku */
+    int my_flushInterval_ms;/**< odstęp pomiędzy zapisami bloków */
+
+    std::atomic<bool> my_isRecording;/**< stan zapisu */
+    std::atomic<unsigned long long> my_writtenRecords, my_droppedRecords;/**< statystyki zapisu */
+
+    std::vector<unsigned char> my_record;/**< bufor pojedynczego rekordu */
+    std::vector<unsigned char> my_block;/**< bufor budowanego bloku */
+    std::vector<unsigned char> my_columns[8];/**< bufory kolumn budowanego bloku */
+
+    ArThread my_thread_write;/**< handler wątku zapisu */
+
+    void push( telemetryStream stream, const struct iovec* parts, int count );/**< \brief Dopisuje rekord do bufora strumienia */
+    void flush();/**< \brief Zapisuje bloki ze wszystkich strumieni */
+    void flushStream( telemetryStream stream );/**< \brief Zapisuje blok z rekordów jednego strumienia */
+
+    // CALLBACKS FUNCTIONS
+    void thread_write(void);/**< wątek zapisu */
+
+    // CALLBACKS FUNCTORS
+    ArFunctorC<telemetryRecorder> my_functor_thread_write;/**< functor do metody \c thread_write() */
+
+    telemetryRecorder( const telemetryRecorder& );
+    telemetryRecorder& operator=( const telemetryRecorder& );
+};
+
+/** \brief Odczyt pliku telemetrii
+ *
+ * Wczytuje cały plik i rozdziela rekordy na strumienie, np.:
+ * \code
+ * telemetryReader reader;
+ * if( reader.open( "session.tlog" ) )
+ *     for( size_t i = 0; i < reader.getPoses().size(); i++ )
+ *         printf( "%lld %f %f\n", reader.getPoses()[i].timestamp_us, reader.getPoses()[i].xPosition, reader.getPoses()[i].yPosition );
+ * \endcode
+ */
+class telemetryReader
+{
+public:
+    /** \brief Konstruktor klasy \c telemetryReader
+     *
+     *
+     */
+    telemetryReader();
+
+    /** \brief Wczytuje plik telemetrii
+     *
+     * \param filename const std::string& - ścieżka pliku
+     * \return bool - \b True, jeśli plik ma poprawny nagłówek (uszkodzony koniec pliku jest pomijany)
+     *
+     */
+    bool open( const std::string& filename );
+
+    const telemetryFileHeader& getHeader() const;/**< \brief Zwraca nagłówek pliku */
+    const std::vector<telemetryPose>& getPoses() const;/**< \brief Zwraca rekordy strumienia \c STREAM_POSE */
+    const std::vector<telemetryScan>& getScans() const;/**< \brief Zwraca rekordy strumienia \c STREAM_LASER */
+    const std::vector<telemetryFrame>& getFrames() const;/**< \brief Zwraca rekordy strumienia \c STREAM_FRAME */
+
+private:
+    telemetryFileHeader my_header;/**< nagłówek pliku */
+    std::vector<telemetryPose> my_poses;/**< rekordy strumienia \c STREAM_POSE */
+    std::vector<telemetryScan> my_scans;/**< rekordy strumienia \c STREAM_LASER */
+    std::vector<telemetryFrame> my_frames;/**< rekordy strumienia \c STREAM_FRAME */
+
+    bool readBlock( const telemetryBlockHeader& header, const unsigned char* payload );/**< \brief Rozdziela kolumny bloku na rekordy */
+};
+
+#endif // TELEMETRYLOG_H_INCLUDED
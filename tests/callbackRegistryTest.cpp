@@ -0,0 +1,119 @@
+#include "callbackRegistry.h"
+#include "testUtil.h"
+
+#include <atomic>
+#include <thread>
+
+static const int CALLBACKS = 8;
+
+/** \brief Funkcja zliczająca wywołania, niszczona zaraz po usunięciu z rejestru */
+struct counter
+{
+    std::atomic<long> calls;
+    std::atomic<bool> removed;
+
+    counter() : calls( 0 ), removed( false ) {}
+
+    void call()
+    {
+        // remove() must not return while the function can still be called
+        CHECK( !removed.load() );
+        calls++;
+    }
+};
+
+/** \brief Funkcja jednorazowa - przy pierwszym wywołaniu usuwa samą siebie i dodaje następną */
+struct oneShot
+{
+    callbackRegistry* registry;
+    ArFunctor* self;
+    ArFunctor* next;
+    std::atomic<int> calls;
+
+    oneShot() : registry( NULL ), self( NULL ), next( NULL ), calls( 0 ) {}
+
+    void call()
+    {
+        calls++;
+        CHECK( registry->remove( self ));
+        CHECK( registry->find( self ) == 0 );
+        if( next != NULL )
+            CHECK( registry->add( next ) != 0 );
+    }
+};
+
+int main()
+{
+    // Concurrent invokeAll() while another thread adds and removes functions
+    {
+        callbackRegistry registry;
+        std::atomic<bool> done( false );
+        std::thread invoker( [&]()
+        {
+            while( !done.load() )
+                registry.invokeAll();
+        });
+
+        for( int round = 0; round < 2000; round++ )
+        {
+            counter* work = new counter;
+            ArFunctorC<counter>* functor = new ArFunctorC<counter>( work, &counter::call );
+            callbackRegistry::handle handle = registry.add( functor );
+            CHECK( handle != 0 );
+            CHECK( registry.add( functor ) == handle );
+            CHECK( registry.find( functor ) == handle );
+            if( round % 2 )
+                CHECK( registry.remove( handle ));
+            else
+                CHECK( registry.remove( functor ));
+            work->removed = true;
+            CHECK( !registry.remove( handle ));
+            delete functor;
+            delete work;
+        }
+
+        counter works[CALLBACKS];
+        ArFunctorC<counter>* functors[CALLBACKS];
+        for( int i = 0; i < CALLBACKS; i++ )
+        {
+            functors[i] = new ArFunctorC<counter>( &works[i], &counter::call );
+            registry.add( functors[i] );
+        }
+        CHECK( registry.remove( functors[3] ));
+        works[3].removed = true;
+        ArUtil::sleep( 20 );
+        for( int i = 0; i < CALLBACKS; i++ )
+            if( i != 3 )
+                CHECK( works[i].calls.load() > 0 );
+
+        done = true;
+        invoker.join();
+        for( int i = 0; i < CALLBACKS; i++ )
+            delete functors[i];
+    }
+
+    // add() and remove() called from inside invokeAll() take effect after it returns
+    {
+        callbackRegistry registry;
+        oneShot first, second;
+        ArFunctorC<oneShot> firstFunctor( &first, &oneShot::call ), secondFunctor( &second, &oneShot::call );
+        first.registry = second.registry = &registry;
+        first.self = &firstFunctor;
+        first.next = &secondFunctor;
+        second.self = &secondFunctor;
+
+        registry.add( &firstFunctor );
+        registry.invokeAll();
+        CHECK( first.calls.load() == 1 && second.calls.load() == 0 );
+        CHECK( registry.find( &firstFunctor ) == 0 );
+        CHECK( registry.find( &secondFunctor ) != 0 );
+
+        registry.invokeAll();
+        registry.invokeAll();
+        CHECK( first.calls.load() == 1 && second.calls.load() == 1 );
+        CHECK( registry.find( &secondFunctor ) == 0 );
+    }
+
+    printf("callbackRegistryTest: OK\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "frameLog.h"
+#include "testUtil.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const int FRAMES = 60;
+static const long long SEGMENT_SIZE = 16 * 1024;
+
+static int frameLength( int i )
+{
+    return 500 + ( i * 977 ) % 2500;
+}
+
+static unsigned char frameByte( int i, int offset )
+{
+    return (unsigned char) ( i * 31 + offset );
+}
+
+static frameHandle makeFrame( framePool& pool, int i )
+{
+    int length = frameLength( i );
+    frameBuffer* buffer = pool.acquire( length );
+    CHECK( buffer != NULL );
+    for( int offset = 0; offset < length; offset++ )
+        buffer->getWritableData()[offset] = frameByte( i, offset );
+    buffer->setLength( length );
+    buffer->setFrameInfo( 640, 480, i + 1, 1000000LL + i * 33000LL );
+    // acquire() already gave us the only reference
+    return frameHandle( buffer, false );
+}
+
+static void checkSession( const std::string& session )
+{
+    frameLogReader reader;
+    CHECK( reader.open( session ));
+    CHECK( reader.getFrameCount() == FRAMES );
+
+    for( int i = 0; i < FRAMES; i++ )
+    {
+        frameLogFrame frame;
+        CHECK( reader.getFrame( i, frame ));
+        CHECK( frame.sequence == (unsigned long long) i + 1 );
+        CHECK( frame.timestamp_us == 1000000LL + i * 33000LL );
+        CHECK( frame.width == 640 && frame.height == 480 );
+        CHECK( frame.length == frameLength( i ));
+        for( int offset = 0; offset < frame.length; offset++ )
+            CHECK( frame.data[offset] == frameByte( i, offset ));
+    }
+
+    frameLogFrame frame;
+    CHECK( !reader.getFrame( FRAMES, frame ));
+    CHECK( reader.findFrameByTimestamp( 0 ) == -1 );
+    CHECK( reader.findFrameByTimestamp( 1000000LL + 10 * 33000LL ) == 10 );
+    CHECK( reader.findFrameByTimestamp( 1000000LL + 10 * 33000LL + 1 ) == 10 );
+    CHECK( reader.findFrameByTimestamp( 1LL << 60 ) == FRAMES - 1 );
+}
+
+static std::string segmentName( const std::string& session, int number )
+{
+    char suffix[32];
+    snprintf( suffix, sizeof( suffix ), "_%04d.flog", number );
+    return session + suffix;
+}
+
+int main()
+{
+    char directory[] = "/tmp/frameLogTestXXXXXX";
+    CHECK( mkdtemp( directory ) != NULL );
+    const std::string session = std::string( directory ) + "/frames";
+
+    // Write -> rotate: frames are flushed in batches and the size limit forces several segments
+    {
+        framePool pool;
+        frameLogWriter writer;
+        writer.setSegmentLimits( SEGMENT_SIZE, 0 );
+        CHECK( writer.open( directory, "frames" ));
+
+        std::vector<frameHandle> batch;
+        for( int i = 0; i < FRAMES; i++ )
+        {
+            batch.push_back( makeFrame( pool, i ));
+            CHECK( writer.append( batch.back() ));
+            if( batch.size() == 4 )
+            {
+                CHECK( writer.flush() );
+                batch.clear();
+            }
+        }
+        CHECK( writer.close() );
+        CHECK( !writer.isOpen() );
+        CHECK( writer.takeLostFrames() == 0 );
+    }
+
+    int segments = 0;
+    while( access( segmentName( session, segments ).c_str(), R_OK ) == 0 )
+        segments++;
+    CHECK( segments > 2 );
+    for( int number = 0; number < segments; number++ )
+    {
+        struct stat status;
+        CHECK( stat( segmentName( session, number ).c_str(), &status ) == 0 );
+        CHECK( status.st_size <= SEGMENT_SIZE );
+    }
+
+    // Reopen -> read: the indexes of all segments form one session
+    checkSession( session );
+
+    // An interrupted recording leaves the last segment without the index and footer -
+    // its frames are recovered from the record headers
+    const std::string last = segmentName( session, segments - 1 );
+    {
+        frameLogReader reader;
+        CHECK( reader.open( last ));
+        int lastFrames = reader.getFrameCount();
+        CHECK( lastFrames > 0 );
+
+        struct stat status;
+        CHECK( stat( last.c_str(), &status ) == 0 );
+        long long trailer = lastFrames * sizeof( frameLogIndexEntry ) + sizeof( frameLogFooter );
+        CHECK( truncate( last.c_str(), status.st_size - trailer ) == 0 );
+    }
+    checkSession( session );
+
+    // A damaged footer is not trusted either
+    {
+        struct stat status;
+        CHECK( stat( last.c_str(), &status ) == 0 );
+        FILE* file = fopen( last.c_str(), "ab" );
+        CHECK( file != NULL );
+        frameLogFooter footer;
+        footer.magic = FRAME_LOG_FOOTER_MAGIC;
+        footer.version = FRAME_LOG_VERSION;
+        footer.frameCount = 1000000;
+        footer.indexOffset = status.st_size;
+        CHECK( fwrite( &footer, sizeof( footer ), 1, file ) == 1 );
+        CHECK( fclose( file ) == 0 );
+    }
+    checkSession( session );
+
+    for( int number = 0; number < segments; number++ )
+        unlink( segmentName( session, number ).c_str() );
+    rmdir( directory );
+
+    printf("frameLogTest: %d frames in %d segments - OK\n", FRAMES, segments);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "frameBuffer.h"
+#include "testUtil.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const int FRAMES = 50000;
+static const int CONSUMERS = 4;
+static const int SLOTS = 8;
+
+/** \brief Ostatnie klatki producenta - konsumenci kopiują uchwyty i zwalniają je z własnych wątków */
+struct frameSlots
+{
+    std::mutex mutex;
+    frameHandle frames[SLOTS];
+};
+
+static unsigned char frameByte( unsigned long long sequence, int offset )
+{
+    return (unsigned char) ( sequence * 7 + offset );
+}
+
+static int frameLength( unsigned long long sequence )
+{
+    // Lengths span several size classes
+    return 100 + (int) (( sequence * 2654435761ULL ) % 20000 );
+}
+
+/** \brief Sprawdza, że bufor nie został ponownie wydany, dopóki istnieje uchwyt do niego */
+static void checkFrame( const frameHandle& frame )
+{
+    unsigned long long sequence = frame->getSequence();
+    CHECK( frame->getLength() == frameLength( sequence ));
+    CHECK( frame->getTimestamp_us() == (long long) sequence );
+    const unsigned char* data = frame->getData();
+    for( int offset = 0; offset < frame->getLength(); offset += 97 )
+        CHECK( data[offset] == frameByte( sequence, offset ));
+    CHECK( data[frame->getLength() - 1] == frameByte( sequence, frame->getLength() - 1 ));
+}
+
+int main()
+{
+    framePool pool;
+    frameSlots slots;
+    std::atomic<bool> done( false );
+    std::atomic<long long> checked( 0 );
+
+    std::vector<std::thread> consumers;
+    for( int c = 0; c < CONSUMERS; c++ )
+    {
+        consumers.push_back( std::thread( [&, c]()
+        {
+            std::vector<frameHandle> held;
+            unsigned int i = c;
+            unsigned long long lastSequence = 0;
+            while( !done.load() )
+            {
+                frameHandle frame;
+                {
+                    std::lock_guard<std::mutex> lock( slots.mutex );
+                    frame = slots.frames[i++ % SLOTS];
+                }
+                if( frame.empty() || frame->getSequence() == lastSequence )
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                lastSequence = frame->getSequence();
+                checkFrame( frame );
+                // Handles are kept for a while, so buffers are released out of order
+                held.push_back( frame );
+                if( held.size() > 16 )
+                {
+                    checkFrame( held.front() );
+                    held.erase( held.begin() );
+                }
+                checked++;
+            }
+            for( size_t h = 0; h < held.size(); h++ )
+                checkFrame( held[h] );
+        }));
+    }
+
+    for( unsigned long long sequence = 1; sequence <= FRAMES; sequence++ )
+    {
+        int length = frameLength( sequence );
+        frameBuffer* buffer = pool.acquire( length );
+        CHECK( buffer != NULL );
+        CHECK( buffer->getCapacity() >= length );
+        unsigned char* data = buffer->getWritableData();
+        for( int offset = 0; offset < length; offset++ )
+            data[offset] = frameByte( sequence, offset );
+        buffer->setLength( length );
+        buffer->setFrameInfo( 640, 480, sequence, (long long) sequence );
+
+        frameHandle frame( buffer, false );
+        std::lock_guard<std::mutex> lock( slots.mutex );
+        slots.frames[sequence % SLOTS] = frame;
+    }
+
+    done = true;
+    for( size_t c = 0; c < consumers.size(); c++ )
+        consumers[c].join();
+    for( int s = 0; s < SLOTS; s++ )
+        slots.frames[s].reset();
+
+    // Oversized frames are refused
+    CHECK( pool.acquire( pool.getMaxBufferSize() + 1 ) == NULL );
+
+    printf("framePoolTest: %d frames, %lld checked by %d consumers - OK\n", FRAMES, checked.load(), CONSUMERS);
+    return 0;
+}
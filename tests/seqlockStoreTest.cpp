@@ -0,0 +1,67 @@
+#include "seqlockStore.h"
+#include "testUtil.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const unsigned long long STORES = 1000000;
+static const int READERS = 4;
+
+/** \brief Wartość o rozmiarze kilku słów - każde pole zapisywane jest tą samą liczbą */
+struct sample
+{
+    unsigned long long values[9];
+    int tail;
+};
+
+int main()
+{
+    seqlockStore<sample> store;
+    std::atomic<bool> done( false );
+    std::atomic<long long> loads( 0 );
+
+    std::vector<std::thread> readers;
+    for( int r = 0; r < READERS; r++ )
+    {
+        readers.push_back( std::thread( [&]()
+        {
+            unsigned long long lastCount = 0, lastValue = 0;
+            while( !done.load() )
+            {
+                sample value;
+                unsigned long long count = store.load( &value );
+                // A torn copy would mix fields of two stores
+                for( int i = 1; i < 9; i++ )
+                    CHECK( value.values[i] == value.values[0] );
+                CHECK( value.tail == (int) ( value.values[0] & 0x7fffffff ));
+                // The count and the value never go back
+                CHECK( count >= lastCount && value.values[0] >= lastValue );
+                CHECK( value.values[0] == count );
+                lastCount = count;
+                lastValue = value.values[0];
+                loads++;
+            }
+        }));
+    }
+
+    for( unsigned long long n = 1; n <= STORES; n++ )
+    {
+        sample value;
+        for( int i = 0; i < 9; i++ )
+            value.values[i] = n;
+        value.tail = (int) ( n & 0x7fffffff );
+        store.store( value );
+    }
+
+    done = true;
+    for( size_t r = 0; r < readers.size(); r++ )
+        readers[r].join();
+
+    sample value;
+    CHECK( store.load( &value ) == STORES );
+    CHECK( value.values[8] == STORES );
+
+    printf("seqlockStoreTest: %llu stores, %lld loads by %d readers - OK\n", STORES, loads.load(), READERS);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "taskScheduler.h"
+#include "testUtil.h"
+
+#include <atomic>
+#include <thread>
+
+/** \brief Zadanie trwające kilka milisekund, zgłaszające wykonanie po zakończeniu usunięcia */
+struct slowTask
+{
+    std::atomic<int> runs;
+    std::atomic<bool> running;
+    std::atomic<bool> removed;
+
+    slowTask() : runs( 0 ), running( false ), removed( false ) {}
+
+    void run()
+    {
+        // removeTask() must not return while a run is in progress
+        CHECK( !removed.load() );
+        running = true;
+        runs++;
+        ArUtil::sleep( 5 );
+        running = false;
+    }
+};
+
+int main()
+{
+    Aria::init();
+
+    // A periodic task runs, and stops running once removeTask() returns
+    {
+        taskScheduler scheduler;
+        slowTask work;
+        ArFunctorC<slowTask> functor( &work, &slowTask::run );
+        taskScheduler::taskHandle handle = scheduler.addTask( &functor, 1000 );
+        CHECK( handle != 0 );
+        CHECK( scheduler.getTasksCount() == 1 );
+
+        ArUtil::sleep( 50 );
+        CHECK( work.runs.load() > 0 );
+        CHECK( scheduler.removeTask( handle ));
+        work.removed = true;
+        CHECK( !work.running.load() );
+        CHECK( !scheduler.removeTask( handle ));
+        CHECK( scheduler.getTasksCount() == 0 );
+
+        int runs = work.runs.load();
+        ArUtil::sleep( 20 );
+        CHECK( work.runs.load() == runs );
+    }
+
+    // removeTask() racing stop() still waits for the running task
+    for( int round = 0; round < 50; round++ )
+    {
+        taskScheduler scheduler;
+        slowTask work;
+        ArFunctorC<slowTask> functor( &work, &slowTask::run );
+        taskScheduler::taskHandle handle = scheduler.addTask( &functor, 1000 );
+        ArUtil::sleep( 3 );
+
+        std::thread stopper( [&]() { scheduler.stop(); } );
+        scheduler.removeTask( handle );
+        work.removed = true;
+        CHECK( !work.running.load() );
+        stopper.join();
+    }
+
+    // Adding a task after stop() resumes the scheduler
+    {
+        taskScheduler scheduler;
+        slowTask work;
+        ArFunctorC<slowTask> functor( &work, &slowTask::run );
+        scheduler.stop();
+        taskScheduler::taskHandle handle = scheduler.addTask( &functor, 1000 );
+        ArUtil::sleep( 30 );
+        CHECK( work.runs.load() > 0 );
+        CHECK( scheduler.removeTask( handle ));
+    }
+
+    printf("taskSchedulerTest: OK\n");
+    Aria::exit( 0 );
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef TESTUTIL_H_INCLUDED
+#define TESTUTIL_H_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+
+/** \brief Sprawdza warunek testu - przy niespełnieniu wypisuje miejsce błędu i kończy program
+ *
+ * W przeciwieństwie do \c assert() działa również w kompilacji z \c NDEBUG.
+ */
+#define CHECK( condition ) \
+    do \
+    { \
+        if( !( condition )) \
+        { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            fflush(stdout); \
+            exit( 1 ); \
+        } \
+    } while( 0 )
+
+#endif // TESTUTIL_H_INCLUDED